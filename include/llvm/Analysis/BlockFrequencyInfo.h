@@ -21,6 +21,7 @@
 namespace llvm {
 
 class BranchProbabilityInfo;
+class LoopInfo;
 template <class BlockT> class BlockFrequencyInfoImpl;
 
 /// BlockFrequencyInfo pass uses BlockFrequencyInfoImpl implementation to
@@ -40,6 +41,12 @@ public:
 
   bool runOnFunction(Function &F) override;
   void releaseMemory() override;
+
+  /// calculate - Compute the frequencies for \p F from the probabilities in
+  /// \p BPI and the loops in \p LI, for clients that cannot require this
+  /// analysis.
+  void calculate(const Function &F, const BranchProbabilityInfo &BPI,
+                 const LoopInfo &LI);
   void print(raw_ostream &O, const Module *M) const override;
   const Function *getFunction() const;
   void view() const;
@@ -942,20 +942,46 @@ void BlockFrequencyInfoImpl<BT>::doFunction(const FunctionT *F,
 }
 
 template <class BT> void BlockFrequencyInfoImpl<BT>::initializeRPOT() {
+  typedef typename Successor::ChildIteratorType ChildIteratorT;
+
+  // Walk the CFG depth-first in the same order as po_iterator, but use Nodes
+  // as the visited set so that each block costs a single hash table insertion.
+  // Until the walk is done, Nodes holds post-order numbers.
+  size_t NumBlocks = F->size();
+  RPOT.reserve(NumBlocks);
+  Nodes.resize(NumBlocks);
+
   const BlockT *Entry = F->begin();
-  RPOT.reserve(F->size());
-  std::copy(po_begin(Entry), po_end(Entry), std::back_inserter(RPOT));
+  SmallVector<std::pair<const BlockT *, ChildIteratorT>, 16> VisitStack;
+  Nodes.insert(std::make_pair(Entry, BlockNode()));
+  VisitStack.push_back(std::make_pair(Entry, Successor::child_begin(Entry)));
+  while (!VisitStack.empty()) {
+    const BlockT *BB = VisitStack.back().first;
+    ChildIteratorT &I = VisitStack.back().second;
+    if (I != Successor::child_end(BB)) {
+      const BlockT *Succ = *I++;
+      if (Nodes.insert(std::make_pair(Succ, BlockNode())).second)
+        VisitStack.push_back(std::make_pair(Succ, Successor::child_begin(Succ)));
+      continue;
+    }
+    Nodes[BB] = RPOT.size();
+    RPOT.push_back(BB);
+    VisitStack.pop_back();
+  }
   std::reverse(RPOT.begin(), RPOT.end());
 
   assert(RPOT.size() - 1 <= BlockNode::getMaxIndex() &&
          "More nodes in function than Block Frequency Info supports");
 
-  DEBUG(dbgs() << "reverse-post-order-traversal\n");
-  for (rpot_iterator I = rpot_begin(), E = rpot_end(); I != E; ++I) {
-    BlockNode Node = getNode(I);
-    DEBUG(dbgs() << " - " << getIndex(I) << ": " << getBlockName(Node) << "\n");
-    Nodes[*I] = Node;
-  }
+  // Turn the post-order numbers into indexes into RPOT.
+  BlockNode::IndexType Last = RPOT.size() - 1;
+  for (auto &I : Nodes)
+    I.second.Index = Last - I.second.Index;
+
+  DEBUG(dbgs() << "reverse-post-order-traversal\n";
+        for (rpot_iterator I = rpot_begin(), E = rpot_end(); I != E; ++I)
+          dbgs() << " - " << getIndex(I) << ": " << getBlockName(getNode(I))
+                 << "\n");
 
   Working.reserve(RPOT.size());
   for (size_t Index = 0; Index < RPOT.size(); ++Index)
@@ -990,6 +1016,8 @@ template <class BT> void BlockFrequencyInfoImpl<BT>::initializeLoops() {
 
   // Visit nodes in reverse post-order and add them to their deepest containing
   // loop.
+  const LoopT *LastLoop = nullptr;
+  BlockNode Header;
   for (size_t Index = 0; Index < RPOT.size(); ++Index) {
     // Loop headers have already been mostly mapped.
     if (Working[Index].isLoopHeader()) {
@@ -1003,8 +1031,12 @@ template <class BT> void BlockFrequencyInfoImpl<BT>::initializeLoops() {
     if (!Loop)
       continue;
 
-    // Add this node to its containing loop's member list.
-    BlockNode Header = getNode(Loop->getHeader());
+    // Add this node to its containing loop's member list.  Neighbouring nodes
+    // are usually in the same loop, so remember the last header looked up.
+    if (Loop != LastLoop) {
+      LastLoop = Loop;
+      Header = getNode(Loop->getHeader());
+    }
     assert(Header.isValid());
     const auto &HeaderData = Working[Header.Index];
     assert(HeaderData.isLoopHeader());
@@ -49,6 +49,11 @@ public:
   bool runOnFunction(Function &F) override;
   void print(raw_ostream &OS, const Module *M = nullptr) const override;
 
+  /// \brief Compute the probabilities for \p F, whose loops are described by
+  /// \p LI.  This is what runOnFunction does; it allows passes that cannot
+  /// require this analysis, such as call graph SCC passes, to use it.
+  void calculate(Function &F, LoopInfo &LI);
+
   /// \brief Get an edge's probability, relative to other out-edges of the Src.
   ///
   /// This routine provides access to the fractional probability between zero
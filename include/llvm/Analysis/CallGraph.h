@@ -52,6 +52,7 @@
 #ifndef LLVM_ANALYSIS_CALLGRAPH_H
 #define LLVM_ANALYSIS_CALLGRAPH_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/CallSite.h"
@@ -98,9 +99,20 @@ class CallGraph {
   /// callers from the old function to the new.
   void spliceFunction(const Function *From, const Function *To);
 
+  /// \brief A call in a function body and the node for its callee.
+  typedef std::pair<Instruction *, CallGraphNode *> CallEdgeTy;
+
+  /// \brief Find the calls made by \c F, in instruction order.
+  ///
+  /// \p Nodes maps every function in the module to its node.  This only reads
+  /// the IR and \p Nodes, so it may run for several functions at once.
+  void findCalls(Function *F,
+                 const DenseMap<const Function *, CallGraphNode *> &Nodes,
+                 std::vector<CallEdgeTy> &Calls) const;
+
   /// \brief Add a function to the call graph, and link the node to all of the
-  /// functions that it calls.
-  void addToCallGraph(Function *F);
+  /// functions that it calls, given by \p Calls.
+  void addToCallGraph(Function *F, const std::vector<CallEdgeTy> &Calls);
 
 public:
   CallGraph(Module &M);
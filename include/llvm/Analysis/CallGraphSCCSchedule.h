@@ -0,0 +1,89 @@
+//===- CallGraphSCCSchedule.h - Call graph SCC dependencies -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines CallGraphSCCSchedule, which records the SCCs of a call
+// graph and which of them each SCC calls.  A bottom-up pass must finish with
+// every SCC an SCC calls before starting on it; SCCs that don't depend on each
+// other, directly or indirectly, may be processed in any order.
+//
+// The schedule tracks which SCCs are ready as others are finished, and groups
+// the SCCs into levels: an SCC's level is one more than the highest level of
+// the SCCs it calls, so all SCCs in one level are independent.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_CALLGRAPHSCCSCHEDULE_H
+#define LLVM_ANALYSIS_CALLGRAPHSCCSCHEDULE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include <vector>
+
+namespace llvm {
+
+class CallGraph;
+class CallGraphNode;
+class raw_ostream;
+
+class CallGraphSCCSchedule {
+public:
+  /// \brief Compute the SCCs of \p CG and the dependencies between them.
+  ///
+  /// SCCs are numbered in the bottom-up order that scc_iterator visits them,
+  /// which is one valid schedule.
+  explicit CallGraphSCCSchedule(CallGraph &CG);
+
+  unsigned getNumSCCs() const { return SCCs.size(); }
+
+  /// \brief The nodes of SCC \p I.
+  ArrayRef<CallGraphNode *> getSCC(unsigned I) const { return SCCs[I].Nodes; }
+
+  /// \brief The SCCs that SCC \p I calls, and so must be finished first.
+  ArrayRef<unsigned> getCallees(unsigned I) const { return SCCs[I].Callees; }
+
+  /// \brief The SCCs that call SCC \p I.
+  ArrayRef<unsigned> getCallers(unsigned I) const { return SCCs[I].Callers; }
+
+  /// \brief The level of SCC \p I.  SCCs that call no other SCC are at level
+  /// zero.
+  unsigned getLevel(unsigned I) const { return SCCs[I].Level; }
+
+  unsigned getNumLevels() const { return NumLevels; }
+
+  /// \brief The largest number of SCCs in one level.
+  unsigned getMaxLevelWidth() const { return MaxLevelWidth; }
+
+  /// \brief Forget which SCCs have been finished, and return the SCCs that
+  /// are ready: those that call no other SCC.
+  void reset(SmallVectorImpl<unsigned> &Ready);
+
+  /// \brief Record that SCC \p I is finished, and append the SCCs that became
+  /// ready because of it to \p Ready.
+  void finish(unsigned I, SmallVectorImpl<unsigned> &Ready);
+
+  void print(raw_ostream &OS) const;
+
+private:
+  struct SCCInfo {
+    SmallVector<CallGraphNode *, 1> Nodes;
+    SmallVector<unsigned, 4> Callees;
+    SmallVector<unsigned, 4> Callers;
+    unsigned Level;
+    /// The number of callees not yet finished.
+    unsigned Pending;
+  };
+
+  std::vector<SCCInfo> SCCs;
+  unsigned NumLevels;
+  unsigned MaxLevelWidth;
+};
+
+} // End llvm namespace
+
+#endif
@@ -30,6 +30,7 @@
 #ifndef LLVM_ANALYSIS_LOOPINFO_H
 #define LLVM_ANALYSIS_LOOPINFO_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -323,6 +324,22 @@ public:
     DenseBlockSet.erase(BB);
   }
 
+  /// removeBlocksFromLoop - This removes the basic blocks in BBs from the
+  /// current loop.  Unlike calling removeBlockFromLoop for each of them, this
+  /// takes time linear in the size of the loop.  This does not update the
+  /// mapping in the LoopInfo class.
+  void removeBlocksFromLoop(const SmallPtrSetImpl<const BlockT *> &BBs) {
+    typename std::vector<BlockT *>::iterator Out = Blocks.begin();
+    for (typename std::vector<BlockT *>::iterator I = Blocks.begin(),
+           E = Blocks.end(); I != E; ++I) {
+      if (BBs.count(*I))
+        DenseBlockSet.erase(*I);
+      else
+        *Out++ = *I;
+    }
+    Blocks.erase(Out, Blocks.end());
+  }
+
   /// verifyLoop - Verify loop structure
   void verifyLoop() const;
 
@@ -604,6 +621,28 @@ public:
     }
   }
 
+  /// removeBlocks - This method removes all of the blocks in BBs from all data
+  /// structures, as removeBlock does, but visits each loop they are removed
+  /// from only once.  Use it when deleting many blocks of a large loop.
+  void removeBlocks(ArrayRef<BlockT *> BBs) {
+    SmallPtrSet<const BlockT *, 32> Removed;
+    SmallPtrSet<LoopT *, 8> Loops;
+    for (unsigned i = 0, e = BBs.size(); i != e; ++i) {
+      typename DenseMap<BlockT *, LoopT *>::iterator I = BBMap.find(BBs[i]);
+      if (I == BBMap.end())
+        continue;
+      Removed.insert(BBs[i]);
+      // Stop at the first loop already visited; its parents have been too.
+      for (LoopT *L = I->second; L && Loops.insert(L); L = L->getParentLoop())
+        ;
+      BBMap.erase(I);
+    }
+
+    for (typename SmallPtrSet<LoopT *, 8>::iterator I = Loops.begin(),
+           E = Loops.end(); I != E; ++I)
+      (*I)->removeBlocksFromLoop(Removed);
+  }
+
   // Internals
 
   static bool isNotAlreadyContainedIn(const LoopT *SubLoop,
@@ -720,6 +759,13 @@ public:
     LI.removeBlock(BB);
   }
 
+  /// removeBlocks - This method removes all of the blocks in BBs from all data
+  /// structures, like removeBlock, in time linear in the size of the loops
+  /// they are removed from.
+  void removeBlocks(ArrayRef<BasicBlock *> BBs) {
+    LI.removeBlocks(BBs);
+  }
+
   /// updateUnloop - Update LoopInfo after removing the last backedge from a
   /// loop--now the "unloop". This updates the loop forest and parent loops for
   /// each block so that Unloop is no longer referenced, but the caller must
@@ -0,0 +1,306 @@
+//===- llvm/Analysis/MemorySSA.h - Memory SSA form --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the MemorySSA analysis, which puts the memory operations
+// of a function into SSA form.  All of memory is treated as a single
+// variable:
+//
+//  - Each instruction that may write memory is a MemoryDef, which defines a
+//    new version of memory.
+//  - Each instruction that may only read memory is a MemoryUse of the version
+//    that reaches it.
+//  - A MemoryPhi merges the versions reaching a block along different edges.
+//
+// The version that reaches an access (its defining access) is only a
+// conservative answer to "which write may this instruction depend on?".  The
+// clobber walker, getClobberingMemoryAccess, uses alias analysis to skip
+// MemoryDefs that don't affect a given location.  Since it follows def-use
+// chains rather than scanning instructions and blocks, a query costs time
+// proportional to the number of writes it skips, not to the size of the code
+// in between.
+//
+// For example:
+//
+//   define void @foo(i32* %a, i32* noalias %b) {
+//   ; 1 = MemoryDef(liveOnEntry)
+//     store i32 0, i32* %a
+//   ; 2 = MemoryDef(1)
+//     store i32 1, i32* %b
+//   ; MemoryUse(2)
+//     %x = load i32* %a
+//
+// The defining access of the load is 2, but its clobbering access is 1.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Pass.h"
+#include <memory>
+#include <vector>
+
+namespace llvm {
+  class BasicBlock;
+  class DominatorTree;
+  class Function;
+  class Instruction;
+  class MemoryPhi;
+  class raw_ostream;
+
+  /// MemoryAccess - A node of the memory SSA form: a MemoryDef, MemoryUse or
+  /// MemoryPhi.  Each access knows the accesses that use it.
+  class MemoryAccess {
+  public:
+    enum AccessKind { AccessUse, AccessDef, AccessPhi };
+
+    virtual ~MemoryAccess() {}
+
+    AccessKind getKind() const { return Kind; }
+
+    /// getBlock - The block the access is in, or null for liveOnEntry.
+    BasicBlock *getBlock() const { return Block; }
+
+    typedef SmallVectorImpl<MemoryAccess *>::const_iterator user_iterator;
+    user_iterator user_begin() const { return Users.begin(); }
+    user_iterator user_end() const { return Users.end(); }
+    iterator_range<user_iterator> users() const {
+      return iterator_range<user_iterator>(user_begin(), user_end());
+    }
+    bool use_empty() const { return Users.empty(); }
+
+    /// print - Print the access the way it is shown in annotated IR.
+    virtual void print(raw_ostream &OS) const = 0;
+    void dump() const;
+
+    /// printAsOperand - Print the name other accesses use for this one: its
+    /// ID, or "liveOnEntry".
+    void printAsOperand(raw_ostream &OS) const;
+
+  protected:
+    friend class MemorySSA;
+    friend class MemoryUseOrDef;
+    friend class MemoryPhi;
+
+    MemoryAccess(AccessKind Kind, BasicBlock *BB) : Kind(Kind), Block(BB) {}
+
+    void addUser(MemoryAccess *U) { Users.push_back(U); }
+
+  private:
+    MemoryAccess(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+    void operator=(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+
+    AccessKind Kind;
+    BasicBlock *Block;
+    SmallVector<MemoryAccess *, 4> Users;
+  };
+
+  inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+    MA.print(OS);
+    return OS;
+  }
+
+  /// MemoryUseOrDef - An access for an instruction that reads or writes
+  /// memory.
+  class MemoryUseOrDef : public MemoryAccess {
+  public:
+    /// getMemoryInst - The instruction this access is for.  Null for
+    /// liveOnEntry.
+    Instruction *getMemoryInst() const { return MemoryInst; }
+
+    /// getDefiningAccess - The MemoryDef or MemoryPhi for the version of
+    /// memory that reaches this access.  Null for liveOnEntry.
+    MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+    static bool classof(const MemoryAccess *MA) {
+      return MA->getKind() == AccessUse || MA->getKind() == AccessDef;
+    }
+
+  protected:
+    friend class MemorySSA;
+
+    MemoryUseOrDef(AccessKind Kind, Instruction *MI, BasicBlock *BB)
+        : MemoryAccess(Kind, BB), MemoryInst(MI), DefiningAccess(nullptr) {}
+
+    void setDefiningAccess(MemoryAccess *DMA) {
+      assert(!DefiningAccess && "Defining access is already set!");
+      DefiningAccess = DMA;
+      DMA->addUser(this);
+    }
+
+  private:
+    Instruction *MemoryInst;
+    MemoryAccess *DefiningAccess;
+  };
+
+  /// MemoryUse - An instruction that may read memory but doesn't write it.
+  class MemoryUse : public MemoryUseOrDef {
+  public:
+    void print(raw_ostream &OS) const override;
+
+    static bool classof(const MemoryAccess *MA) {
+      return MA->getKind() == AccessUse;
+    }
+
+  protected:
+    friend class MemorySSA;
+
+    MemoryUse(Instruction *MI, BasicBlock *BB)
+        : MemoryUseOrDef(AccessUse, MI, BB) {}
+  };
+
+  /// MemoryDef - An instruction that may write memory, or liveOnEntry, the
+  /// version of memory on entry to the function.
+  class MemoryDef : public MemoryUseOrDef {
+  public:
+    /// getID - The number the access is printed with.  Zero for liveOnEntry.
+    unsigned getID() const { return ID; }
+
+    void print(raw_ostream &OS) const override;
+
+    static bool classof(const MemoryAccess *MA) {
+      return MA->getKind() == AccessDef;
+    }
+
+  protected:
+    friend class MemorySSA;
+
+    MemoryDef(Instruction *MI, BasicBlock *BB, unsigned ID)
+        : MemoryUseOrDef(AccessDef, MI, BB), ID(ID) {}
+
+  private:
+    unsigned ID;
+  };
+
+  /// MemoryPhi - Merges the versions of memory reaching a block from its
+  /// predecessors.  There is one incoming access per reachable predecessor.
+  class MemoryPhi : public MemoryAccess {
+  public:
+    unsigned getID() const { return ID; }
+
+    unsigned getNumIncomingValues() const { return Operands.size(); }
+    MemoryAccess *getIncomingValue(unsigned i) const {
+      return Operands[i].first;
+    }
+    BasicBlock *getIncomingBlock(unsigned i) const {
+      return Operands[i].second;
+    }
+
+    void print(raw_ostream &OS) const override;
+
+    static bool classof(const MemoryAccess *MA) {
+      return MA->getKind() == AccessPhi;
+    }
+
+  protected:
+    friend class MemorySSA;
+
+    MemoryPhi(BasicBlock *BB, unsigned ID)
+        : MemoryAccess(AccessPhi, BB), ID(ID) {}
+
+    void addIncoming(MemoryAccess *MA, BasicBlock *BB) {
+      Operands.push_back(std::make_pair(MA, BB));
+      MA->addUser(this);
+    }
+
+  private:
+    unsigned ID;
+    SmallVector<std::pair<MemoryAccess *, BasicBlock *>, 4> Operands;
+  };
+
+  /// MemorySSA - Builds the memory SSA form of a function and answers
+  /// clobber queries on it.  The form is not updated when the function
+  /// changes, so clients that modify memory instructions must stop using it.
+  class MemorySSA : public FunctionPass {
+  public:
+    static char ID;
+    MemorySSA();
+    ~MemorySSA();
+
+    bool runOnFunction(Function &F) override;
+    void releaseMemory() override;
+    void getAnalysisUsage(AnalysisUsage &AU) const override;
+    void print(raw_ostream &OS, const Module *M) const override;
+
+    /// getMemoryAccess - Return the MemoryUse or MemoryDef for I, or null if
+    /// I doesn't access memory.
+    MemoryUseOrDef *getMemoryAccess(const Instruction *I) const {
+      return AccessOfInst.lookup(I);
+    }
+
+    /// getMemoryAccess - Return the MemoryPhi at the start of BB, if any.
+    MemoryPhi *getMemoryAccess(const BasicBlock *BB) const {
+      return PhiOfBlock.lookup(BB);
+    }
+
+    /// getLiveOnEntryDef - The MemoryDef standing for the state of memory on
+    /// entry to the function.
+    MemoryDef *getLiveOnEntryDef() const { return LiveOnEntryDef.get(); }
+
+    bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+      return MA == LiveOnEntryDef.get();
+    }
+
+    /// dominates - Return true if the version of memory defined by Dominator
+    /// is available at Dominatee, i.e. Dominator comes first on every path
+    /// from the entry to Dominatee.  Accesses in unreachable blocks are
+    /// dominated by everything.
+    bool dominates(const MemoryAccess *Dominator,
+                   const MemoryAccess *Dominatee) const;
+
+    /// getClobberingMemoryAccess - Return the nearest access above I that may
+    /// write the memory I accesses: a MemoryDef, liveOnEntry, or a MemoryPhi
+    /// where different paths disagree.  For instructions without a single
+    /// memory location, such as calls and ordered loads and stores, this is
+    /// the defining access.  Returns null if I doesn't access memory.
+    MemoryAccess *getClobberingMemoryAccess(const Instruction *I);
+
+    /// getClobberingMemoryAccess - Return the nearest access at or above
+    /// Start that may write Loc.
+    MemoryAccess *getClobberingMemoryAccess(MemoryAccess *Start,
+                                            const AliasAnalysis::Location &Loc);
+
+    /// verifyMemorySSA - Check that every defining access dominates its users
+    /// and that use lists match the operands.  Aborts on failure.
+    void verifyMemorySSA() const;
+
+  private:
+    /// PhiWalkStateTy - The MemoryPhis a clobber walk is currently inside,
+    /// with their nesting depth.
+    typedef DenseMap<MemoryPhi *, unsigned> PhiWalkStateTy;
+
+    void buildMemorySSA(Function &F);
+    MemoryAccess *renameBlock(BasicBlock *BB, MemoryAccess *IncomingVal);
+    MemoryAccess *walkToClobber(MemoryAccess *MA,
+                                const AliasAnalysis::Location &Loc,
+                                PhiWalkStateTy &PhiState, unsigned Depth,
+                                unsigned &MinDepthHit, unsigned &Budget);
+
+    AliasAnalysis *AA;
+    DominatorTree *DT;
+    Function *F;
+
+    std::vector<std::unique_ptr<MemoryAccess> > Accesses;
+    std::unique_ptr<MemoryDef> LiveOnEntryDef;
+    DenseMap<const Instruction *, MemoryUseOrDef *> AccessOfInst;
+    DenseMap<const BasicBlock *, MemoryPhi *> PhiOfBlock;
+
+    /// CachedClobbers - Results of getClobberingMemoryAccess, by the access
+    /// the walk started at and the location.
+    DenseMap<std::pair<MemoryAccess *, AliasAnalysis::Location>,
+             MemoryAccess *> CachedClobbers;
+  };
+
+} // End llvm namespace
+
+#endif
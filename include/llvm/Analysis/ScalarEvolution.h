@@ -354,6 +354,11 @@ namespace llvm {
       /// subexpression.
       bool hasOperand(const SCEV *S, ScalarEvolution *SE) const;
 
+      /// getCountExprs - Add the computed exact and max count expressions to
+      /// Exprs.
+      void getCountExprs(SmallVectorImpl<const SCEV *> &Exprs,
+                         ScalarEvolution *SE) const;
+
       /// clear - Invalidate this result and free associated memory.
       void clear();
     };
@@ -362,6 +367,10 @@ namespace llvm {
     /// this function as they are computed.
     DenseMap<const Loop*, BackedgeTakenInfo> BackedgeTakenCounts;
 
+    /// UnknownBackedgeTakenInfo - Returned for loops whose backedge-taken
+    /// count isn't computed because of the depth limit.
+    BackedgeTakenInfo UnknownBackedgeTakenInfo;
+
     /// ConstantEvolutionLoopExitValue - This map contains entries for all of
     /// the PHI instructions that we attempt to compute constant evolutions for.
     /// This allows us to avoid potentially expensive recomputation of these
@@ -415,6 +424,21 @@ namespace llvm {
       return Pair.first->second;
     }
 
+    /// ActiveComputations - The number of memoized computations in progress.
+    /// The caches may hold placeholder entries for them, so they are only
+    /// compacted when this is zero.
+    unsigned ActiveComputations;
+
+    /// CreateSCEVDepth - The current nesting depth of createSCEV.
+    unsigned CreateSCEVDepth;
+
+    /// BECountDepth - The current nesting depth of ComputeBackedgeTakenCount.
+    unsigned BECountDepth;
+
+    /// getNumCacheEntries - Return the number of entries in the caches that
+    /// compactCaches can shrink.
+    unsigned getNumCacheEntries() const;
+
     /// createSCEV - We know that there is no SCEV for the specified value.
     /// Analyze the expression.
     const SCEV *createSCEV(Value *V);
@@ -904,6 +928,17 @@ namespace llvm {
                              SmallVectorImpl<const SCEV *> &Sizes,
                              const SCEV *ElementSize) const;
 
+    /// getMemoryUsage - Return an estimate of the number of bytes used by the
+    /// expressions and caches for the current function.
+    size_t getMemoryUsage() const;
+
+    /// compactCaches - Drop the memoized ranges, dispositions and values at
+    /// scopes of the expressions that are not reachable from the SCEV of any
+    /// value or from any backedge-taken count.  These are typically the
+    /// temporaries created while folding.  The expressions themselves are
+    /// never freed, so pointers to them held by clients remain valid.
+    void compactCaches();
+
     bool runOnFunction(Function &F) override;
     void releaseMemory() override;
     void getAnalysisUsage(AnalysisUsage &AU) const override;
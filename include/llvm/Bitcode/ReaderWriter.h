@@ -30,8 +30,14 @@ namespace llvm {
   /// Read the header of the specified bitcode buffer and prepare for lazy
   /// deserialization of function bodies.  If successful, this takes ownership
   /// of 'buffer. On error, this *does not* take ownership of Buffer.
+  ///
+  /// If ShouldLazyLoadMetadata is true, module-level metadata is only indexed
+  /// up front.  Nodes are read when a materialized function refers to them,
+  /// and named metadata (including module flags) is read by
+  /// Module::materializeMetadata() or Module::materializeAll().
   ErrorOr<Module *> getLazyBitcodeModule(std::unique_ptr<MemoryBuffer> &Buffer,
-                                         LLVMContext &Context);
+                                         LLVMContext &Context,
+                                         bool ShouldLazyLoadMetadata = false);
 
   /// getStreamedBitcodeModule - Read the header of the specified stream
   /// and prepare for lazy deserialization and streaming of function bodies.
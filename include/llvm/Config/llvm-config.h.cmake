@@ -32,6 +32,9 @@
 /* Define if threads enabled */
 #cmakedefine01 LLVM_ENABLE_THREADS
 
+/* Define if every Use stores a pointer to its User */
+#cmakedefine01 LLVM_ENABLE_USE_USER_POINTERS
+
 /* Installation directory for config files */
 #cmakedefine LLVM_ETCDIR "${LLVM_ETCDIR}"
 
@@ -27,6 +27,7 @@ class DiagnosticPrinter;
 class Function;
 class Instruction;
 class LLVMContextImpl;
+class Module;
 class Twine;
 class Value;
 class DebugLoc;
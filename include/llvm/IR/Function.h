@@ -28,6 +28,7 @@
 
 namespace llvm {
 
+class AssemblyAnnotationWriter;
 class FunctionType;
 class LLVMContext;
 
@@ -451,6 +452,10 @@ public:
   Constant *getPrefixData() const;
   void setPrefixData(Constant *PrefixData);
 
+  /// print - Print the function to an output stream with an optional
+  /// AssemblyAnnotationWriter.
+  void print(raw_ostream &OS, AssemblyAnnotationWriter *AAW = nullptr) const;
+
   /// viewCFG - This function is meant for use from the debugger.  You can just
   /// say 'call F->viewCFG()' and a ghostview window should pop up from the
   /// program, displaying the CFG of the current function with the code for each
@@ -54,6 +54,11 @@ public:
   /// Make sure the entire Module has been completely read.
   ///
   virtual std::error_code MaterializeModule(Module *M) = 0;
+
+  /// Make sure any metadata that was not read eagerly, such as named
+  /// metadata, has been read in.
+  ///
+  virtual std::error_code materializeMetadata() = 0;
 };
 
 } // End llvm namespace
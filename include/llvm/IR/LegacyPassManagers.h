@@ -92,6 +92,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 
 namespace llvm {
+  class Function;
   class Module;
   class Pass;
   class StringRef;
@@ -159,6 +160,60 @@ private:
 };
 
 
+//===----------------------------------------------------------------------===//
+// PMChangeTracker
+//
+/// PMChangeTracker records which functions the passes run by a top level
+/// manager have reported as modified.  Every reported change advances an
+/// epoch counter; a function is considered verified only if it was stamped by
+/// the verifier at or after the epoch of its last reported change.  Changes
+/// that cannot be attributed to a single function (module passes, call graph
+/// SCC passes, initialization and finalization) invalidate every stamp.
+///
+/// This is what lets the incremental verifier (-verify-incremental) skip
+/// functions no pass has touched since they were last verified.  It trusts
+/// the "changed" result of each pass; a pass that modifies the IR and reports
+/// that it did not will escape incremental verification.
+class PMChangeTracker {
+  unsigned Epoch;
+  DenseMap<const Function *, unsigned> FunctionChangedEpoch;
+  DenseMap<const Function *, unsigned> FunctionVerifiedEpoch;
+  DenseMap<AnalysisID, unsigned> ModuleVerifiedEpoch;
+
+public:
+  PMChangeTracker() : Epoch(1) {}
+
+  /// Record that a pass reported modifying \p F and nothing else.
+  void functionChanged(const Function &F) {
+    FunctionChangedEpoch[&F] = ++Epoch;
+  }
+
+  /// Record a modification that may have touched any function or global.
+  void moduleChanged() {
+    ++Epoch;
+    FunctionChangedEpoch.clear();
+    FunctionVerifiedEpoch.clear();
+  }
+
+  /// Return true if \p F was verified and not reported modified since.
+  bool isVerified(const Function &F) const {
+    DenseMap<const Function *, unsigned>::const_iterator I =
+        FunctionVerifiedEpoch.find(&F);
+    if (I == FunctionVerifiedEpoch.end())
+      return false;
+    return I->second >= FunctionChangedEpoch.lookup(&F);
+  }
+  void markVerified(const Function &F) { FunctionVerifiedEpoch[&F] = Epoch; }
+
+  /// Return true if nothing at all was reported modified since the module
+  /// level checks of the verifier pass \p ID last passed.
+  bool isModuleVerified(AnalysisID ID) const {
+    return ModuleVerifiedEpoch.lookup(ID) == Epoch;
+  }
+  void markModuleVerified(AnalysisID ID) { ModuleVerifiedEpoch[ID] = Epoch; }
+};
+
+
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager
 //
@@ -224,6 +279,9 @@ public:
   void dumpPasses() const;
   void dumpArguments() const;
 
+  /// Modifications reported by the passes run through this manager.
+  PMChangeTracker &getChangeTracker() { return ChangeTracker; }
+
   // Active Pass Managers
   PMStack activeStack;
 
@@ -251,6 +309,8 @@ private:
   SmallVector<ImmutablePass *, 16> ImmutablePasses;
 
   DenseMap<Pass *, AnalysisUsage *> AnUsageMap;
+
+  PMChangeTracker ChangeTracker;
 };
 
 
@@ -18,7 +18,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
-#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/ilist_node.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/IR/Value.h"
@@ -123,14 +123,15 @@ class MDNodeOperand;
 
 //===----------------------------------------------------------------------===//
 /// MDNode - a tuple of other values.
-class MDNode : public Value, public FoldingSetNode {
+class MDNode : public Value {
   MDNode(const MDNode &) LLVM_DELETED_FUNCTION;
   void operator=(const MDNode &) LLVM_DELETED_FUNCTION;
   friend class MDNodeOperand;
   friend class LLVMContextImpl;
-  friend struct FoldingSetTrait<MDNode>;
+  friend struct MDNodeKeyInfo;
 
-  /// Hash - If the MDNode is uniqued cache the hash to speed up lookup.
+  /// Hash - The hash of the operands, computed once when the node is created
+  /// and updated in constant time when a single operand is replaced.
   unsigned Hash;
 
   /// NumOperands - This many 'MDNodeOperand' items are co-allocated onto the
@@ -209,10 +210,6 @@ public:
   // critical code because it recursively visits all the MDNode's operands.
   const Function *getFunction() const;
 
-  /// Profile - calculate a unique identifier for this MDNode to collapse
-  /// duplicates
-  void Profile(FoldingSetNodeID &ID) const;
-
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static bool classof(const Value *V) {
     return V->getValueID() == MDNodeVal;
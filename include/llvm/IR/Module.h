@@ -480,6 +480,10 @@ public:
   /// Make sure all GlobalValues in this Module are fully read.
   std::error_code materializeAll();
 
+  /// Make sure all named metadata in this Module has been read.  Metadata
+  /// referenced from materialized functions is read as it is needed.
+  std::error_code materializeMetadata();
+
   /// Make sure all GlobalValues in this Module are fully read and clear the
   /// Materializer. If the module is corrupt, this DOES NOT clear the old
   /// Materializer.
@@ -27,6 +27,7 @@
 
 #include "llvm-c/Core.h"
 #include "llvm/ADT/PointerIntPair.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Compiler.h"
 #include <cstddef>
@@ -62,6 +63,10 @@ public:
 ///
 ///   http://www.llvm.org/docs/ProgrammersManual.html#the-waymarking-algorithm
 ///
+/// When LLVM is configured with LLVM_ENABLE_USE_USER_POINTERS, every Use also
+/// stores its User explicitly. This trades one pointer per Use for making
+/// getUser() a single load instead of a walk over the waymarking tags.
+///
 /// This is essentially the single most memory intensive object in LLVM because
 /// of the number of uses in the system. At the same time, the constant time
 /// operations it allows are essential to many optimizations having reasonable
@@ -98,7 +103,11 @@ public:
   ///
   /// For an instruction operand, for example, this will return the
   /// instruction.
+#if LLVM_ENABLE_USE_USER_POINTERS
+  User *getUser() const { return Parent; }
+#else
   User *getUser() const;
+#endif
 
   inline void set(Value *Val);
 
@@ -125,6 +134,12 @@ public:
   /// any of those Uses.
   static Use *initTags(Use *Start, Use *Stop);
 
+  /// \brief Initializes an array of Uses owned by \p U.
+  ///
+  /// Like initTags, but also records \p U in each Use when Uses store their
+  /// User explicitly. \p U need not be constructed yet.
+  static Use *initTags(Use *Start, Use *Stop, User *U);
+
   /// \brief Destroys Use operands when the number of operands of
   /// a User changes.
   static void zap(Use *Start, const Use *Stop, bool del = false);
@@ -135,6 +150,9 @@ private:
   Value *Val;
   Use *Next;
   PointerIntPair<Use **, 2, PrevPtrTag> Prev;
+#if LLVM_ENABLE_USE_USER_POINTERS
+  User *Parent;
+#endif
 
   void setPrev(Use **NewPrev) { Prev.setPointer(NewPrev); }
   void addToList(Use **List) {
@@ -0,0 +1,219 @@
+//=-- SampleProfReader.h - Sampling profile readers ---------------*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for reading sample profiles, as produced by a
+// sampling profiler (e.g. Linux Perf - http://perf.wiki.kernel.org/) and the
+// tools that convert its output.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROFREADER_H
+#define LLVM_PROFILEDATA_SAMPLEPROFREADER_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/OnDiskHashTable.h"
+
+namespace llvm {
+
+class LLVMContext;
+
+namespace IndexedSampleProf {
+enum class HashT : uint32_t;
+}
+
+namespace sampleprof {
+
+/// \brief Sample-based profile reader.
+///
+/// Each profile contains sample counts for all the functions
+/// executed. Inside each function, statements are annotated with the
+/// collected samples on all the instructions associated with that
+/// statement.
+///
+/// For this to produce meaningful data, the program needs to be
+/// compiled with some debug information (at minimum, line numbers:
+/// -gline-tables-only). Otherwise, it will be impossible to match IR
+/// instructions to the line numbers collected by the profiler.
+///
+/// From the profile file, we are interested in collecting the
+/// following information:
+///
+/// * A list of functions included in the profile (mangled names).
+///
+/// * For each function F:
+///   1. The total number of samples collected in F.
+///
+///   2. The samples collected at each line in F. To provide some
+///      protection against source code shuffling, line numbers should
+///      be relative to the start of the function.
+class SampleProfileReader {
+public:
+  SampleProfileReader(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
+      : Profiles(0), Ctx(C), Buffer(std::move(B)) {}
+
+  virtual ~SampleProfileReader() {}
+
+  /// \brief Read the header of the profile, which must be done before any
+  /// samples can be looked up.  Formats without an index read every function
+  /// profile here.
+  virtual std::error_code readHeader() = 0;
+
+  /// \brief Read every function profile, so that getProfiles() returns all of
+  /// them.
+  virtual std::error_code read() = 0;
+
+  /// \brief Return the samples collected for the function \p FName, or null
+  /// if there are none.  Indexed formats only read a function's samples the
+  /// first time they are asked for.
+  virtual FunctionSamples *getSamplesFor(StringRef FName) {
+    auto I = Profiles.find(FName);
+    return I == Profiles.end() ? nullptr : &I->second;
+  }
+
+  /// \brief Return the function profiles read so far.
+  StringMap<FunctionSamples> &getProfiles() { return Profiles; }
+
+  /// \brief Print the profile for \p FName on stream \p OS.
+  void printFunctionProfile(raw_ostream &OS, StringRef FName);
+
+  /// \brief Print all the profiles read so far on stream \p OS.
+  void print(raw_ostream &OS);
+
+  /// \brief Print all the profiles read so far on dbgs().
+  void dump();
+
+  /// \brief Report a parse error message.
+  void reportParseError(int64_t LineNumber, Twine Msg) const;
+
+  /// \brief Create a reader for the sample profile in \p Filename, picking the
+  /// format from the file's contents, and read its header.
+  static std::error_code create(StringRef Filename,
+                                std::unique_ptr<SampleProfileReader> &Result,
+                                LLVMContext &C);
+
+protected:
+  /// \brief Map every function to its associated profile.
+  ///
+  /// The profile of every function executed at runtime is collected
+  /// in the structure FunctionSamples. This maps function objects
+  /// to their corresponding profiles.
+  StringMap<FunctionSamples> Profiles;
+
+  /// \brief LLVM context used to emit diagnostics.
+  LLVMContext &Ctx;
+
+  /// \brief Memory buffer holding the profile file.
+  std::unique_ptr<MemoryBuffer> Buffer;
+};
+
+/// \brief Reader for the text sample profile format.
+///
+/// This format has no index, so readHeader() reads the whole file.
+class SampleProfileReaderText : public SampleProfileReader {
+public:
+  SampleProfileReaderText(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
+      : SampleProfileReader(std::move(B), C) {}
+
+  /// \brief Read every function profile in the file.
+  std::error_code readHeader() override;
+
+  /// \brief Nothing to do: readHeader() has read every function profile.
+  std::error_code read() override { return sampleprof_error::success; }
+};
+
+/// \brief Trait for lookups into the on-disk hash table of the binary sample
+/// profile format.
+///
+/// The function data is returned undecoded; SampleProfileReaderBinary decodes
+/// it into a FunctionSamples.
+class SampleProfLookupTrait {
+  IndexedSampleProf::HashT HashType;
+
+public:
+  SampleProfLookupTrait(IndexedSampleProf::HashT HashType)
+      : HashType(HashType) {}
+
+  struct data_type {
+    data_type(StringRef Name, const unsigned char *Data, uint64_t Size)
+        : Name(Name), Data(Data), Size(Size) {}
+    StringRef Name;
+    const unsigned char *Data;
+    uint64_t Size;
+  };
+  typedef StringRef internal_key_type;
+  typedef StringRef external_key_type;
+  typedef uint64_t hash_value_type;
+  typedef uint64_t offset_type;
+
+  static bool EqualKey(StringRef A, StringRef B) { return A == B; }
+  static StringRef GetInternalKey(StringRef K) { return K; }
+
+  hash_value_type ComputeHash(StringRef K);
+
+  static std::pair<offset_type, offset_type>
+  ReadKeyDataLength(const unsigned char *&D) {
+    using namespace support;
+    offset_type KeyLen = endian::readNext<offset_type, little, unaligned>(D);
+    offset_type DataLen = endian::readNext<offset_type, little, unaligned>(D);
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  StringRef ReadKey(const unsigned char *D, offset_type N) {
+    return StringRef((const char *)D, N);
+  }
+
+  data_type ReadData(StringRef K, const unsigned char *D, offset_type N) {
+    return data_type(K, D, N);
+  }
+};
+typedef OnDiskIterableChainedHashTable<SampleProfLookupTrait>
+    SampleProfReaderIndex;
+
+/// \brief Reader for the binary sample profile format.
+///
+/// The file holds an on-disk hash table keyed by function name, so looking up
+/// one function does not require reading the others.  See
+/// SampleProfileWriter::writeBinary() for a description of the format.
+class SampleProfileReaderBinary : public SampleProfileReader {
+public:
+  SampleProfileReaderBinary(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
+      : SampleProfileReader(std::move(B), C) {}
+
+  /// \brief Return true if \p Buffer is in the binary sample profile format.
+  static bool hasFormat(const MemoryBuffer &Buffer);
+
+  /// \brief Read the header and set up the index.
+  std::error_code readHeader() override;
+
+  /// \brief Read every function profile that has not been read yet.
+  std::error_code read() override;
+
+  /// \brief Look up \p FName in the index and read its samples, unless they
+  /// were read before.
+  FunctionSamples *getSamplesFor(StringRef FName) override;
+
+private:
+  /// \brief Decode the samples of one function from its data in the index.
+  std::error_code readFunction(const SampleProfLookupTrait::data_type &Data,
+                               FunctionSamples &Samples);
+
+  /// \brief The index of function profiles.
+  std::unique_ptr<SampleProfReaderIndex> Index;
+};
+
+} // End namespace sampleprof
+
+} // End namespace llvm
+
+#endif // LLVM_PROFILEDATA_SAMPLEPROFREADER_H
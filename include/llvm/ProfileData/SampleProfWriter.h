@@ -0,0 +1,51 @@
+//=-- SampleProfWriter.h - Sampling profile writer ----------------*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for writing sample profiles.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROFWRITER_H
+#define LLVM_PROFILEDATA_SAMPLEPROFWRITER_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+
+namespace sampleprof {
+
+/// \brief Writer for sample profiles.
+///
+/// Samples added for the same function are summed, so adding the profiles of
+/// several files merges them.
+class SampleProfileWriter {
+  StringMap<FunctionSamples> Profiles;
+
+public:
+  /// \brief Add \p Samples to the samples of the function \p FName.
+  void addFunctionSamples(StringRef FName, const FunctionSamples &Samples);
+
+  /// \brief Write the profile in the text format read by
+  /// SampleProfileReaderText.  Functions and lines are written in sorted
+  /// order.
+  void writeText(raw_ostream &OS);
+
+  /// \brief Write the profile in the binary format read by
+  /// SampleProfileReaderBinary: a header followed by an on-disk hash table
+  /// keyed by function name.
+  void writeBinary(raw_fd_ostream &OS);
+};
+
+} // End namespace sampleprof
+
+} // End namespace llvm
+
+#endif // LLVM_PROFILEDATA_SAMPLEPROFWRITER_H
@@ -18,6 +18,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -177,8 +178,31 @@ template<class FuncT, class N>
 void Calculate(DominatorTreeBase<typename GraphTraits<N>::NodeType>& DT,
                FuncT& F);
 
+template<class FuncT, class N>
+void CalculateSemiNCA(DominatorTreeBase<typename GraphTraits<N>::NodeType>& DT,
+                      FuncT& F);
+
+/// DomTreeUseSemiNCA - If true, dominator trees are built with the Semi-NCA
+/// algorithm instead of Lengauer-Tarjan.  Set by -dom-tree-semi-nca.
+extern bool DomTreeUseSemiNCA;
+
 template<class NodeT>
 class DominatorTreeBase : public DominatorBase<NodeT> {
+public:
+  /// The kind of a CFG edge update passed to applyUpdates().
+  enum UpdateKind { Insert, Delete };
+
+  /// UpdateType - A CFG edge From->To that has been inserted or deleted.
+  struct UpdateType {
+    UpdateKind Kind;
+    NodeT *From;
+    NodeT *To;
+
+    UpdateType(UpdateKind Kind, NodeT *From, NodeT *To)
+        : Kind(Kind), From(From), To(To) {}
+  };
+
+private:
   bool dominatedBySlowTreeWalk(const DomTreeNodeBase<NodeT> *A,
                                const DomTreeNodeBase<NodeT> *B) const {
     assert(A != B);
@@ -290,6 +314,260 @@ protected:
     }
   }
 
+  /// Return the nearest common dominator of two tree nodes, or null if it is
+  /// the virtual root of a post-dominator tree with several exits.
+  DomTreeNodeBase<NodeT> *getNearestCommonDominator(DomTreeNodeBase<NodeT> *A,
+                                                    DomTreeNodeBase<NodeT> *B) {
+    if (!A || !B || !A->getBlock() || !B->getBlock())
+      return nullptr;
+    return getNode(findNearestCommonDominator(A->getBlock(), B->getBlock()));
+  }
+
+  /// Bring the tree up to date after the CFG edge updates in Updates, where N
+  /// is the graph the tree is built over (NodeT* or Inverse<NodeT*>).
+  ///
+  /// Every path created or destroyed by an update passes through the source
+  /// of the updated edge, so only the dominator subtree rooted at the nearest
+  /// common dominator of the updated edges' endpoints can change, apart from
+  /// blocks that become reachable.  That region is recomputed with the
+  /// Cooper-Harvey-Kennedy iterative algorithm, restricted to edges inside the
+  /// region.  If a block in the region becomes unreachable and has an edge
+  /// out of the region, the blocks it used to reach may lose paths, so the
+  /// region is widened to cover them and recomputed.
+  template<class N>
+  void applyUpdatesImpl(ArrayRef<UpdateType> Updates) {
+    typedef GraphTraits<N> GraphT;
+    typedef GraphTraits<Inverse<N> > InvTraits;
+    typedef DomTreeNodeBase<NodeT> TreeNode;
+
+    NodeT *AnyBB = Updates.front().From;
+
+    // A post-dominator tree for a single exit plus blocks that cannot reach
+    // it has a virtual root that the exit block is not part of.  Leave that
+    // shape to recalculate().
+    if (this->IsPostDominators &&
+        (!this->RootNode ||
+         (!this->RootNode->getBlock() && this->Roots.size() == 1))) {
+      recalculate(*AnyBB->getParent());
+      return;
+    }
+
+    DomTreeNodeBase<NodeT> *Top = nullptr;
+    SmallVector<NodeT *, 8> NewlyReached;
+    bool CanSkip = Updates.size() == 1;
+    for (unsigned i = 0, e = Updates.size(); i != e; ++i) {
+      const UpdateType &U = Updates[i];
+      // Express the edge in the direction the tree is built over.
+      NodeT *Src = this->IsPostDominators ? U.To : U.From;
+      NodeT *Dst = this->IsPostDominators ? U.From : U.To;
+
+      // Post-dominator roots are the blocks without successors.  If an update
+      // may change that set, start over.
+      if (this->IsPostDominators) {
+        bool NoSuccs = GraphTraits<NodeT*>::child_begin(U.From) ==
+                       GraphTraits<NodeT*>::child_end(U.From);
+        bool WasRoot = std::find(this->Roots.begin(), this->Roots.end(),
+                                 U.From) != this->Roots.end();
+        if (NoSuccs != WasRoot) {
+          recalculate(*AnyBB->getParent());
+          return;
+        }
+      }
+
+      // Edges out of unreachable blocks don't affect the tree.
+      TreeNode *SrcNode = getNode(Src);
+      if (!SrcNode)
+        continue;
+
+      TreeNode *DstNode = getNode(Dst);
+      if (!DstNode) {
+        if (U.Kind == Insert)
+          NewlyReached.push_back(Dst);
+      } else if (CanSkip) {
+        // An edge to a dominator of its source never changes dominance, and
+        // neither does inserting an edge whose source is already dominated by
+        // the target's immediate dominator.
+        if (dominates(DstNode, SrcNode))
+          return;
+        if (U.Kind == Insert && DstNode->getIDom() &&
+            dominates(DstNode->getIDom(), SrcNode))
+          return;
+      }
+
+      Top = Top ? getNearestCommonDominator(Top, SrcNode) : SrcNode;
+      if (Top && DstNode)
+        Top = getNearestCommonDominator(Top, DstNode);
+      if (!Top || !Top->getBlock()) {
+        recalculate(*AnyBB->getParent());
+        return;
+      }
+    }
+
+    if (!Top)
+      return;
+
+    // For post-dominators, whether a virtual root is needed depends on which
+    // blocks can reach an exit, so recalculate when that set changes.
+    if (this->IsPostDominators && !NewlyReached.empty()) {
+      recalculate(*AnyBB->getParent());
+      return;
+    }
+
+    std::vector<TreeNode *> RegionNodes;
+    SmallPtrSet<NodeT *, 32> InRegion;
+    DenseMap<NodeT *, unsigned> PostNum;
+    std::vector<NodeT *> PostOrder;
+    std::vector<unsigned> IDomNum;
+    SmallVector<NodeT *, 8> Widen;
+    for (;;) {
+      // Collect the dominator subtree of Top in preorder.
+      RegionNodes.clear();
+      InRegion.clear();
+      RegionNodes.push_back(Top);
+      for (unsigned i = 0; i != RegionNodes.size(); ++i) {
+        InRegion.insert(RegionNodes[i]->getBlock());
+        RegionNodes.insert(RegionNodes.end(), RegionNodes[i]->begin(),
+                           RegionNodes[i]->end());
+      }
+
+      // Add blocks that were unreachable and that inserted edges now reach.
+      // Their edges into the tree must stay inside the region.
+      Widen.clear();
+      SmallVector<NodeT *, 16> Worklist(NewlyReached.begin(),
+                                        NewlyReached.end());
+      while (!Worklist.empty()) {
+        NodeT *BB = Worklist.pop_back_val();
+        if (!InRegion.insert(BB))
+          continue;
+        for (typename GraphT::ChildIteratorType SI = GraphT::child_begin(BB),
+             SE = GraphT::child_end(BB); SI != SE; ++SI) {
+          if (!getNode(*SI))
+            Worklist.push_back(*SI);
+          else if (!InRegion.count(*SI))
+            Widen.push_back(*SI);
+        }
+      }
+      if (widenRegion(Top, Widen))
+        continue;
+      if (!Top) {
+        recalculate(*AnyBB->getParent());
+        return;
+      }
+
+      // Number the blocks reachable from Top inside the region in post order.
+      PostNum.clear();
+      PostOrder.clear();
+      SmallVector<std::pair<NodeT *, typename GraphT::ChildIteratorType>, 32>
+          Stack;
+      PostNum[Top->getBlock()] = ~0U;
+      Stack.push_back(std::make_pair(Top->getBlock(),
+                                     GraphT::child_begin(Top->getBlock())));
+      while (!Stack.empty()) {
+        NodeT *BB = Stack.back().first;
+        if (Stack.back().second == GraphT::child_end(BB)) {
+          PostNum[BB] = PostOrder.size();
+          PostOrder.push_back(BB);
+          Stack.pop_back();
+          continue;
+        }
+        NodeT *Succ = *Stack.back().second++;
+        if (!InRegion.count(Succ) || !PostNum.insert(std::make_pair(Succ, ~0U))
+                                          .second)
+          continue;
+        Stack.push_back(std::make_pair(Succ, GraphT::child_begin(Succ)));
+      }
+
+      // Region blocks that Top no longer reaches are unreachable.  Blocks
+      // outside the region that they branch to may have lost paths.
+      for (unsigned i = 0, e = RegionNodes.size(); i != e; ++i) {
+        NodeT *BB = RegionNodes[i]->getBlock();
+        if (PostNum.count(BB))
+          continue;
+        if (this->IsPostDominators) {
+          recalculate(*AnyBB->getParent());
+          return;
+        }
+        for (typename GraphT::ChildIteratorType SI = GraphT::child_begin(BB),
+             SE = GraphT::child_end(BB); SI != SE; ++SI)
+          if (!InRegion.count(*SI) && getNode(*SI))
+            Widen.push_back(*SI);
+      }
+      if (widenRegion(Top, Widen))
+        continue;
+      if (!Top) {
+        recalculate(*AnyBB->getParent());
+        return;
+      }
+      break;
+    }
+
+    // Compute immediate dominators of the region by post order number, with
+    // Top (numbered last) as the root.
+    unsigned TopNum = PostOrder.size() - 1;
+    IDomNum.assign(PostOrder.size(), ~0U);
+    IDomNum[TopNum] = TopNum;
+    bool Changed = true;
+    while (Changed) {
+      Changed = false;
+      for (unsigned i = TopNum; i-- != 0;) {
+        NodeT *BB = PostOrder[i];
+        unsigned NewIDom = ~0U;
+        for (typename InvTraits::ChildIteratorType PI = InvTraits::child_begin(BB),
+             PE = InvTraits::child_end(BB); PI != PE; ++PI) {
+          typename DenseMap<NodeT *, unsigned>::iterator PN = PostNum.find(*PI);
+          if (PN == PostNum.end() || IDomNum[PN->second] == ~0U)
+            continue;
+          unsigned Pred = PN->second;
+          if (NewIDom == ~0U) {
+            NewIDom = Pred;
+            continue;
+          }
+          while (Pred != NewIDom) {
+            while (Pred < NewIDom)
+              Pred = IDomNum[Pred];
+            while (NewIDom < Pred)
+              NewIDom = IDomNum[NewIDom];
+          }
+        }
+        if (IDomNum[i] != NewIDom) {
+          IDomNum[i] = NewIDom;
+          Changed = true;
+        }
+      }
+    }
+
+    // Apply the result in reverse post order, so that a block's new immediate
+    // dominator is in the tree before the block is attached to it.
+    for (unsigned i = TopNum; i-- != 0;) {
+      NodeT *BB = PostOrder[i];
+      TreeNode *IDom = getNode(PostOrder[IDomNum[i]]);
+      if (TreeNode *Node = getNode(BB)) {
+        if (Node->getIDom() != IDom)
+          changeImmediateDominator(Node, IDom);
+      } else {
+        addNewBlock(BB, IDom->getBlock());
+      }
+    }
+
+    // Drop blocks that became unreachable, children first.  Their reachable
+    // children have been moved away above.
+    for (unsigned i = RegionNodes.size(); i-- != 0;)
+      if (!PostNum.count(RegionNodes[i]->getBlock()))
+        eraseNode(RegionNodes[i]->getBlock());
+  }
+
+  /// Move Top up to the nearest common dominator of itself and the blocks in
+  /// Blocks.  Return true if it changed.  Top becomes null if the result is
+  /// a virtual root.
+  bool widenRegion(DomTreeNodeBase<NodeT> *&Top, ArrayRef<NodeT *> Blocks) {
+    DomTreeNodeBase<NodeT> *OldTop = Top;
+    for (unsigned i = 0, e = Blocks.size(); i != e && Top; ++i)
+      Top = getNearestCommonDominator(Top, getNode(Blocks[i]));
+    if (Top && !Top->getBlock())
+      Top = nullptr;
+    return Top && Top != OldTop;
+  }
+
 public:
   explicit DominatorTreeBase(bool isPostDom)
     : DominatorBase<NodeT>(isPostDom), DFSInfoValid(false), SlowQueries(0) {}
@@ -530,6 +808,33 @@ public:
     changeImmediateDominator(getNode(BB), getNode(NewBB));
   }
 
+  /// insertEdge - Inform the tree that the CFG edge From->To has been added.
+  /// The CFG must already contain the edge.  Only the part of the tree that
+  /// the edge can affect is recomputed.
+  void insertEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Insert, From, To));
+  }
+
+  /// deleteEdge - Inform the tree that the CFG edge From->To has been
+  /// removed.  The CFG must no longer contain the edge.  Blocks that become
+  /// unreachable are removed from the tree.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Delete, From, To));
+  }
+
+  /// applyUpdates - Bring the tree up to date after a batch of edge
+  /// insertions and deletions.  The CFG must already reflect all of them.
+  /// This is cheaper than applying the updates one at a time, since the
+  /// affected part of the tree is recomputed only once.
+  void applyUpdates(ArrayRef<UpdateType> Updates) {
+    if (Updates.empty())
+      return;
+    if (this->IsPostDominators)
+      applyUpdatesImpl<Inverse<NodeT*> >(Updates);
+    else
+      applyUpdatesImpl<NodeT*>(Updates);
+  }
+
   /// eraseNode - Removes a node from the dominator tree. Block must not
   /// dominate any other blocks. Removes node from its immediate dominator's
   /// children list. Deletes dominator node associated with basic block BB.
@@ -603,6 +908,11 @@ protected:
   friend void Calculate(DominatorTreeBase<typename GraphTraits<N>::NodeType>& DT,
                         FuncT& F);
 
+  template<class FuncT, class N>
+  friend void
+  CalculateSemiNCA(DominatorTreeBase<typename GraphTraits<N>::NodeType>& DT,
+                   FuncT& F);
+
   /// updateDFSNumbers - Assign In and Out numbers to the nodes while walking
   /// dominator tree in dfs order.
   void updateDFSNumbers() const {
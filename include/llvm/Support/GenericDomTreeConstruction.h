@@ -19,6 +19,15 @@
 /// out that the theoretically slower O(n*log(n)) implementation is actually
 /// faster than the almost-linear O(n*alpha(n)) version, even for large CFGs.
 ///
+/// When -dom-tree-semi-nca is given, the Semi-NCA algorithm is used instead:
+///
+///   Finding Dominators in Practice
+///   L. Georgiadis, R. E. Tarjan & R. F. Werneck, JGAA 10(1), pgs 69-94.
+///
+/// It computes the same semidominators, but derives immediate dominators by a
+/// nearest common ancestor walk rather than with buckets, and keeps its state
+/// in vectors indexed by DFS number rather than in maps keyed by block.
+///
 //===----------------------------------------------------------------------===//
 
 
@@ -147,9 +156,173 @@ Eval(DominatorTreeBase<typename GraphT::NodeType>& DT,
   return VInInfo.Label;
 }
 
+/// SemiNCAInfoRec - Per-vertex state of the Semi-NCA algorithm.  All fields
+/// are DFS numbers.
+struct SemiNCAInfoRec {
+  unsigned Ancestor; // Link-eval forest parent, compressed by SemiNCAEval.
+  unsigned Semi;     // Semidominator.
+  unsigned Label;    // Vertex with minimal Semi on the compressed path.
+  unsigned IDom;     // DFS tree parent, then the immediate dominator.
+
+  SemiNCAInfoRec(unsigned Num, unsigned Parent)
+      : Ancestor(Parent), Semi(Num), Label(Num), IDom(Parent) {}
+};
+
+/// SemiNCAEval - Return the vertex with the minimal semidominator on the
+/// forest path from V up to the vertices numbered below LastLinked, which
+/// have not been linked yet.  Compresses the path on the way.
+inline unsigned SemiNCAEval(std::vector<SemiNCAInfoRec> &Info, unsigned V,
+                            unsigned LastLinked,
+                            SmallVectorImpl<unsigned> &Stack) {
+  if (V < LastLinked)
+    return V;
+
+  Stack.clear();
+  for (unsigned U = V; Info[U].Ancestor >= LastLinked; U = Info[U].Ancestor)
+    Stack.push_back(U);
+
+  // Compress from the top of the path down, so that each vertex sees the
+  // already compressed state of its ancestor.
+  while (!Stack.empty()) {
+    SemiNCAInfoRec &UInfo = Info[Stack.pop_back_val()];
+    const SemiNCAInfoRec &AInfo = Info[UInfo.Ancestor];
+    if (Info[AInfo.Label].Semi < Info[UInfo.Label].Semi)
+      UInfo.Label = AInfo.Label;
+    UInfo.Ancestor = AInfo.Ancestor;
+  }
+  return Info[V].Label;
+}
+
+template<class FuncT, class NodeT>
+void CalculateSemiNCA(
+    DominatorTreeBase<typename GraphTraits<NodeT>::NodeType>& DT, FuncT& F) {
+  typedef GraphTraits<NodeT> GraphT;
+  typedef GraphTraits<Inverse<NodeT> > InvTraits;
+  typedef typename GraphT::NodeType NodeType;
+  typedef DomTreeNodeBase<NodeType> TreeNode;
+
+  // Vertex and Info are indexed by DFS number, starting at 1.  NodeToNum is
+  // only consulted once per edge; the inner loops work on DFS numbers alone.
+  std::vector<NodeType*> Vertex(1);
+  std::vector<SemiNCAInfoRec> Info(1, SemiNCAInfoRec(0, 0));
+  DenseMap<NodeType*, unsigned> NodeToNum;
+
+  bool MultipleRoots = (DT.Roots.size() > 1);
+  if (MultipleRoots) {
+    Vertex.push_back(nullptr);
+    Info.push_back(SemiNCAInfoRec(1, 0));
+  }
+
+  // Step #1: Number blocks in depth-first order.
+  struct WorkItem {
+    NodeType *BB;
+    unsigned Num;
+    typename GraphT::ChildIteratorType NextSucc;
+  };
+  SmallVector<WorkItem, 32> Worklist;
+  for (unsigned i = 0, e = static_cast<unsigned>(DT.Roots.size());
+       i != e; ++i) {
+    NodeType *Root = DT.Roots[i];
+    unsigned Num = Vertex.size();
+    NodeToNum[Root] = Num;
+    Vertex.push_back(Root);
+    Info.push_back(SemiNCAInfoRec(Num, MultipleRoots ? 1 : 0));
+    WorkItem Item = { Root, Num, GraphT::child_begin(Root) };
+    Worklist.push_back(Item);
+
+    while (!Worklist.empty()) {
+      WorkItem &Top = Worklist.back();
+      if (Top.NextSucc == GraphT::child_end(Top.BB)) {
+        Worklist.pop_back();
+        continue;
+      }
+      NodeType *Succ = *Top.NextSucc++;
+      unsigned &SuccNum = NodeToNum[Succ];
+      if (SuccNum)
+        continue;
+      SuccNum = Vertex.size();
+      Vertex.push_back(Succ);
+      Info.push_back(SemiNCAInfoRec(SuccNum, Top.Num));
+      WorkItem SuccItem = { Succ, SuccNum, GraphT::child_begin(Succ) };
+      Worklist.push_back(SuccItem);
+    }
+  }
+  unsigned N = Vertex.size() - 1;
+
+  // As in Calculate, blocks that can't reach an exit (e.g. infinite loops)
+  // require an artificial exit node.
+  MultipleRoots |= (DT.isPostDominator() && N != GraphTraits<FuncT*>::size(&F));
+
+  // Step #2: Compute semidominators in reverse DFS order.  A vertex is linked
+  // to its DFS parent once it has been processed, which is implicit in the
+  // LastLinked bound passed to SemiNCAEval.
+  SmallVector<unsigned, 32> EvalStack;
+  for (unsigned i = N; i >= 2; --i) {
+    unsigned Semi = Info[i].IDom;
+    for (typename InvTraits::ChildIteratorType CI = InvTraits::child_begin(
+             Vertex[i]), E = InvTraits::child_end(Vertex[i]); CI != E; ++CI) {
+      typename DenseMap<NodeType*, unsigned>::const_iterator PI =
+          NodeToNum.find(*CI);
+      if (PI == NodeToNum.end())  // Only if this predecessor is reachable!
+        continue;
+      unsigned SemiU = Info[SemiNCAEval(Info, PI->second, i + 1,
+                                        EvalStack)].Semi;
+      if (SemiU < Semi)
+        Semi = SemiU;
+    }
+    Info[i].Semi = Semi;
+  }
+
+  // Step #3: The immediate dominator of a vertex is the nearest common
+  // ancestor of its DFS parent and its semidominator in the dominator tree
+  // built so far.  Vertices are visited in DFS order, so the immediate
+  // dominators of all ancestors are final.
+  for (unsigned i = 2; i <= N; ++i) {
+    unsigned WIDom = Info[i].IDom;
+    while (WIDom > Info[i].Semi)
+      WIDom = Info[WIDom].IDom;
+    Info[i].IDom = WIDom;
+  }
+
+  if (DT.Roots.empty()) return;
+
+  // Build the tree as Calculate does.  The root node is the virtual exit if
+  // there are several exits or an infinite loop; a single real exit is then
+  // only added below it once some block is dominated by it.
+  NodeType* Root = !MultipleRoots ? DT.Roots[0] : nullptr;
+  DT.DomTreeNodes[Root] = DT.RootNode = new TreeNode(Root, nullptr);
+
+  std::vector<TreeNode*> Nodes(N + 1);
+  if (N >= 1 && Vertex[1] == Root)
+    Nodes[1] = DT.RootNode;
+  for (unsigned i = 2; i <= N; ++i) {
+    unsigned IDomNum = Info[i].IDom;
+    TreeNode *IDomNode = Nodes[IDomNum];
+    if (!IDomNode) {
+      assert(IDomNum == 1 && "Dominator not visited before its children!");
+      IDomNode = DT.RootNode->addChild(new TreeNode(Vertex[1], DT.RootNode));
+      DT.DomTreeNodes[Vertex[1]] = Nodes[1] = IDomNode;
+    }
+    TreeNode *C = new TreeNode(Vertex[i], IDomNode);
+    DT.DomTreeNodes[Vertex[i]] = Nodes[i] = IDomNode->addChild(C);
+  }
+
+  // Free temporary memory left by recalculate().
+  DT.IDoms.clear();
+  DT.Info.clear();
+  std::vector<NodeType*>().swap(DT.Vertex);
+
+  DT.updateDFSNumbers();
+}
+
 template<class FuncT, class NodeT>
 void Calculate(DominatorTreeBase<typename GraphTraits<NodeT>::NodeType>& DT,
                FuncT& F) {
+  if (DomTreeUseSemiNCA) {
+    CalculateSemiNCA<FuncT, NodeT>(DT, F);
+    return;
+  }
+
   typedef GraphTraits<NodeT> GraphT;
 
   unsigned N = 0;
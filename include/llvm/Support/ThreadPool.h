@@ -0,0 +1,87 @@
+//===-- llvm/Support/ThreadPool.h - A pool of worker threads ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a simple pool of threads that run tasks from a shared
+// queue.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include <functional>
+#include <queue>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace llvm {
+
+/// \brief A pool of threads that run tasks from a shared queue.
+///
+/// Tasks are run in the order they were queued, but may finish in any order.
+/// When LLVM is built without thread support, tasks are run on the calling
+/// thread by wait().
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+
+  /// \brief Create a pool with \p ThreadCount threads.  Zero means one per
+  /// hardware thread.
+  explicit ThreadPool(unsigned ThreadCount = 0);
+
+  /// \brief Wait for the queued tasks to finish and join the threads.
+  ~ThreadPool();
+
+  /// \brief Queue \p Task to be run by one of the threads.
+  void async(TaskTy Task);
+
+  /// \brief Block until every queued task has finished.
+  void wait();
+
+  /// \brief The number of threads tasks may run on.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+  /// \brief The number of hardware threads, or 1 if it can't be determined.
+  static unsigned getHardwareThreadCount();
+
+private:
+  ThreadPool(const ThreadPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const ThreadPool &) LLVM_DELETED_FUNCTION;
+
+  unsigned ThreadCount;
+  std::queue<TaskTy> Tasks;
+
+#if LLVM_ENABLE_THREADS
+  void runWorker();
+
+  std::vector<std::thread> Threads;
+
+  /// Guards Tasks, ActiveTasks and Stopping.
+  std::mutex QueueLock;
+  std::condition_variable QueueCondition;
+  std::condition_variable CompletionCondition;
+
+  /// The number of tasks being run by a worker.
+  unsigned ActiveTasks;
+
+  /// Set by the destructor to tell the workers to exit.
+  bool Stopping;
+#endif
+};
+
+} // End llvm namespace
+
+#endif
@@ -55,7 +55,9 @@ struct Inliner : public CallGraphSCCPass {
   /// Calculate the inline threshold for given Caller. This threshold is lower
   /// if the caller is marked with OptimizeForSize and -inline-threshold is not
   /// given on the comand line. It is higher if the callee is marked with the
-  /// inlinehint attribute.
+  /// inlinehint attribute. While an SCC is visited, it is also higher for call
+  /// sites that the profile of the caller shows to be hot, and lower for cold
+  /// ones.
   ///
   unsigned getInlineThreshold(CallSite CS) const;
 
@@ -64,6 +66,10 @@ struct Inliner : public CallGraphSCCPass {
   /// returned is greater than the current inline threshold, the call site is
   /// not inlined.
   ///
+  /// While an SCC is visited, the costs are cached and only recomputed once
+  /// the call site, its caller or its callee has changed, so the cost must
+  /// not depend on anything else.
+  ///
   virtual InlineCost getInlineCost(CallSite CS) = 0;
 
   /// removeDeadFunctions - Remove dead functions.
@@ -75,12 +81,18 @@ struct Inliner : public CallGraphSCCPass {
   bool removeDeadFunctions(CallGraph &CG, bool AlwaysInlineOnly = false);
 
 private:
+  class CostCache;
+
   // InlineThreshold - Cache the value here for easy access.
   unsigned InlineThreshold;
 
   // InsertLifetime - Insert @llvm.lifetime intrinsics.
   bool InsertLifetime;
 
+  // Costs - The costs and profiles cached for the SCC being visited, or null
+  // outside of runOnSCC.
+  CostCache *Costs;
+
   /// shouldInline - Return true if the inliner should attempt to
   /// inline at the given CallSite.
   bool shouldInline(CallSite CS);
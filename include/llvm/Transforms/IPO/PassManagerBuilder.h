@@ -145,8 +145,9 @@ private:
 public:
   /// populateFunctionPassManager - This fills in the function pass manager,
   /// which is expected to be run on each function immediately as it is
-  /// generated.  The idea is to reduce the size of the IR in memory.
-  void populateFunctionPassManager(FunctionPassManager &FPM);
+  /// generated.  The idea is to reduce the size of the IR in memory.  Only
+  /// function passes are added to \p FPM.
+  void populateFunctionPassManager(PassManagerBase &FPM);
 
   /// populateModulePassManager - This sets up the primary pass manager.
   void populateModulePassManager(PassManagerBase &MPM);
@@ -55,6 +55,8 @@ void llvm::initializeAnalysis(PassRegistry &Registry) {
   initializeLoopInfoPass(Registry);
   initializeMemDepPrinterPass(Registry);
   initializeMemoryDependenceAnalysisPass(Registry);
+  initializeMemorySSAPass(Registry);
+  initializeMemorySSAWalkerPrinterPass(Registry);
   initializeModuleDebugInfoPrinterPass(Registry);
   initializePostDominatorTreePass(Registry);
   initializeRegionInfoPassPass(Registry);
@@ -35,7 +35,9 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include <algorithm>
@@ -52,6 +54,25 @@ const unsigned MaxNumPhiBBsValueReachabilityCheck = 20;
 // depth otherwise the algorithm in aliasGEP will assert.
 static const unsigned MaxLookupSearchDepth = 6;
 
+/// Keep underlying objects, decomposed GEPs and alias results across queries.
+/// Cached information is dropped as soon as any value it was derived from is
+/// deleted or RAUW'd, or when queries move on to another function.  Operands
+/// that are rewritten in place and new uses that capture a pointer are not
+/// noticed, so this is only safe for clients that don't do either between
+/// queries.
+static cl::opt<bool>
+PersistentCache("basicaa-persistent-cache", cl::Hidden, cl::init(false),
+                cl::desc("Cache BasicAA query results across alias() calls "
+                         "until an analyzed value is deleted or replaced"));
+
+/// Bound the number of alias results kept by -basicaa-persistent-cache, so
+/// that clients that never repeat a query don't pay for a huge table.
+static cl::opt<unsigned>
+PersistentCacheSize("basicaa-persistent-cache-size", cl::Hidden,
+                    cl::init(16384),
+                    cl::desc("Maximum number of alias results kept by "
+                             "-basicaa-persistent-cache"));
+
 //===----------------------------------------------------------------------===//
 // Useful predicates
 //===----------------------------------------------------------------------===//
@@ -278,13 +299,21 @@ static Value *GetLinearExpression(Value *V, APInt &Scale, APInt &Offset,
 static const Value *
 DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
                        SmallVectorImpl<VariableGEPIndex> &VarIndices,
-                       bool &MaxLookupReached, const DataLayout *DL) {
+                       bool &MaxLookupReached, const DataLayout *DL,
+                       SmallVectorImpl<const Value *> *Visited = nullptr) {
   // Limit recursion depth to limit compile time in crazy cases.
   unsigned MaxLookup = MaxLookupSearchDepth;
   MaxLookupReached = false;
 
   BaseOffs = 0;
   do {
+    // Record the values the result depends on, for callers that cache it.
+    if (Visited) {
+      Visited->push_back(V);
+      if (const User *U = dyn_cast<User>(V))
+        Visited->append(U->op_begin(), U->op_end());
+    }
+
     // See if this is a bitcast or GEP.
     const Operator *Op = dyn_cast<Operator>(V);
     if (!Op) {
@@ -415,7 +444,6 @@ DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
 // BasicAliasAnalysis Pass
 //===----------------------------------------------------------------------===//
 
-#ifndef NDEBUG
 static const Function *getParent(const Value *V) {
   if (const Instruction *inst = dyn_cast<Instruction>(V))
     return inst->getParent()->getParent();
@@ -426,6 +454,7 @@ static const Function *getParent(const Value *V) {
   return nullptr;
 }
 
+#ifndef NDEBUG
 static bool notDifferentParent(const Value *O1, const Value *O2) {
 
   const Function *F1 = getParent(O1);
@@ -439,7 +468,8 @@ namespace {
   /// BasicAliasAnalysis - This is the primary alias analysis implementation.
   struct BasicAliasAnalysis : public ImmutablePass, public AliasAnalysis {
     static char ID; // Class identification, replacement for typeinfo
-    BasicAliasAnalysis() : ImmutablePass(ID) {
+    BasicAliasAnalysis()
+        : ImmutablePass(ID), CacheFunction(nullptr), NumAliasChecks(0) {
       initializeBasicAliasAnalysisPass(*PassRegistry::getPassRegistry());
     }
 
@@ -456,14 +486,43 @@ namespace {
       assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
+      LocPair Locs(LocA, LocB);
+      if (PersistentCache) {
+        if (LocA.Ptr > LocB.Ptr)
+          std::swap(Locs.first, Locs.second);
+        const Function *F = getParent(LocA.Ptr);
+        if (!F)
+          F = getParent(LocB.Ptr);
+        if (F && F != CacheFunction) {
+          clearPersistentCache();
+          CacheFunction = F;
+        }
+        PersistentAliasCacheTy::iterator I = PersistentAliasCache.find(Locs);
+        if (I != PersistentAliasCache.end())
+          return I->second;
+      }
+
+      NumAliasChecks = 0;
       AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.AATags,
                                      LocB.Ptr, LocB.Size, LocB.AATags);
+      // Queries that didn't recurse into further alias checks are cheaper to
+      // repeat than to keep.
+      bool Recursed = NumAliasChecks > 1;
       // AliasCache rarely has more than 1 or 2 elements, always use
       // shrink_and_clear so it quickly returns to the inline capacity of the
       // SmallDenseMap if it ever grows larger.
       // FIXME: This should really be shrink_to_inline_capacity_and_clear().
       AliasCache.shrink_and_clear();
       VisitedPhiBBs.clear();
+
+      // Only the final result of a query is kept; the entries of AliasCache
+      // may have been computed under the speculative assumptions of aliasPHI.
+      if (PersistentCache && Recursed &&
+          PersistentAliasCache.size() < PersistentCacheSize) {
+        getUnderlyingObjectCached(LocA.Ptr);
+        getUnderlyingObjectCached(LocB.Ptr);
+        PersistentAliasCache[Locs] = Alias;
+      }
       return Alias;
     }
 
@@ -522,6 +581,70 @@ namespace {
     // Visited - Track instructions visited by pointsToConstantMemory.
     SmallPtrSet<const Value*, 16> Visited;
 
+    /// DecomposedGEP - A cached result of DecomposeGEPExpression.
+    struct DecomposedGEP {
+      const Value *Base;
+      int64_t Offset;
+      SmallVector<VariableGEPIndex, 4> VarIndices;
+      bool MaxLookupReached;
+    };
+
+    /// CacheVH - Drops the persistent caches when the value it tracks is
+    /// deleted or replaced, since cached results may have been derived from
+    /// it.
+    class CacheVH : public CallbackVH {
+      BasicAliasAnalysis *AA;
+
+      void deleted() override { AA->clearPersistentCache(); }
+      void allUsesReplacedWith(Value *) override {
+        AA->clearPersistentCache();
+      }
+
+    public:
+      CacheVH(const Value *V, BasicAliasAnalysis *AA)
+          : CallbackVH(const_cast<Value *>(V)), AA(AA) {}
+    };
+
+    // The caches enabled by -basicaa-persistent-cache.  They only ever hold
+    // information about CacheFunction and the globals it refers to.
+    typedef DenseMap<LocPair, AliasResult> PersistentAliasCacheTy;
+    PersistentAliasCacheTy PersistentAliasCache;
+    DenseMap<const Value *, const Value *> UnderlyingObjectCache;
+    DenseMap<const Value *, DecomposedGEP> DecomposedGEPCache;
+    DenseMap<const Value *, CacheVH> TrackedValues;
+    const Function *CacheFunction;
+
+    // NumAliasChecks - The number of aliasCheck calls made by the current
+    // query.
+    unsigned NumAliasChecks;
+
+    /// clearPersistentCache - Forget everything cached across queries.  This
+    /// may be called from a CacheVH, which is destroyed by it.
+    void clearPersistentCache() {
+      PersistentAliasCache.clear();
+      UnderlyingObjectCache.clear();
+      DecomposedGEPCache.clear();
+      TrackedValues.clear();
+      CacheFunction = nullptr;
+    }
+
+    /// trackValue - Make sure cached results derived from V are dropped when
+    /// V is deleted or replaced.
+    void trackValue(const Value *V) {
+      if (!TrackedValues.count(V))
+        TrackedValues.insert(std::make_pair(V, CacheVH(V, this)));
+    }
+
+    /// getUnderlyingObjectCached - GetUnderlyingObject with the search depth
+    /// DecomposeGEPExpression expects, cached with -basicaa-persistent-cache.
+    const Value *getUnderlyingObjectCached(const Value *V);
+
+    /// decomposeGEPCached - DecomposeGEPExpression, cached with
+    /// -basicaa-persistent-cache.
+    const Value *decomposeGEPCached(const Value *V, int64_t &BaseOffs,
+                                    SmallVectorImpl<VariableGEPIndex> &VarIndices,
+                                    bool &MaxLookupReached);
+
     /// \brief Check whether two Values can be considered equivalent.
     ///
     /// In addition to pointer equivalence of \p V1 and \p V2 this checks
@@ -906,11 +1029,11 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
         bool GEP2MaxLookupReached;
         SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
         const Value *GEP2BasePtr =
-          DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
-                                 GEP2MaxLookupReached, DL);
+          decomposeGEPCached(GEP2, GEP2BaseOffset, GEP2VariableIndices,
+                             GEP2MaxLookupReached);
         const Value *GEP1BasePtr =
-          DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                                 GEP1MaxLookupReached, DL);
+          decomposeGEPCached(GEP1, GEP1BaseOffset, GEP1VariableIndices,
+                             GEP1MaxLookupReached);
         // DecomposeGEPExpression and GetUnderlyingObject should return the
         // same result except when DecomposeGEPExpression has no DataLayout.
         if (GEP1BasePtr != UnderlyingV1 || GEP2BasePtr != UnderlyingV2) {
@@ -938,15 +1061,15 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     // exactly, see if the computed offset from the common pointer tells us
     // about the relation of the resulting pointer.
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                             GEP1MaxLookupReached, DL);
+      decomposeGEPCached(GEP1, GEP1BaseOffset, GEP1VariableIndices,
+                         GEP1MaxLookupReached);
 
     int64_t GEP2BaseOffset;
     bool GEP2MaxLookupReached;
     SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
     const Value *GEP2BasePtr =
-      DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
-                             GEP2MaxLookupReached, DL);
+      decomposeGEPCached(GEP2, GEP2BaseOffset, GEP2VariableIndices,
+                         GEP2MaxLookupReached);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -984,8 +1107,8 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
       return R;
 
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                             GEP1MaxLookupReached, DL);
+      decomposeGEPCached(GEP1, GEP1BaseOffset, GEP1VariableIndices,
+                         GEP1MaxLookupReached);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -1204,6 +1327,8 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
                                AAMDNodes V1AAInfo,
                                const Value *V2, uint64_t V2Size,
                                AAMDNodes V2AAInfo) {
+  ++NumAliasChecks;
+
   // If either of the memory references is empty, it doesn't matter what the
   // pointer values are.
   if (V1Size == 0 || V2Size == 0)
@@ -1226,8 +1351,8 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
     return NoAlias;  // Scalars cannot alias each other
 
   // Figure out what objects these things are pointing to if we can.
-  const Value *O1 = GetUnderlyingObject(V1, DL, MaxLookupSearchDepth);
-  const Value *O2 = GetUnderlyingObject(V2, DL, MaxLookupSearchDepth);
+  const Value *O1 = getUnderlyingObjectCached(V1);
+  const Value *O2 = getUnderlyingObjectCached(V2);
 
   // Null values in the default address space don't point to any object, so they
   // don't alias any other pointer.
@@ -1341,6 +1466,63 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   return AliasCache[Locs] = Result;
 }
 
+const Value *BasicAliasAnalysis::getUnderlyingObjectCached(const Value *V) {
+  if (!PersistentCache)
+    return GetUnderlyingObject(V, DL, MaxLookupSearchDepth);
+
+  DenseMap<const Value *, const Value *>::iterator I =
+      UnderlyingObjectCache.find(V);
+  if (I != UnderlyingObjectCache.end())
+    return I->second;
+
+  // Take one step at a time, so that each value on the way and its operands
+  // can be tracked.
+  const Value *Object = V;
+  for (unsigned Count = 0; ; ++Count) {
+    trackValue(Object);
+    if (const User *U = dyn_cast<User>(Object))
+      for (User::const_op_iterator OI = U->op_begin(), OE = U->op_end();
+           OI != OE; ++OI)
+        trackValue(*OI);
+    if (Count == MaxLookupSearchDepth)
+      break;
+    const Value *Next = GetUnderlyingObject(Object, DL, 1);
+    if (Next == Object)
+      break;
+    Object = Next;
+  }
+  UnderlyingObjectCache[V] = Object;
+  return Object;
+}
+
+const Value *BasicAliasAnalysis::decomposeGEPCached(
+    const Value *V, int64_t &BaseOffs,
+    SmallVectorImpl<VariableGEPIndex> &VarIndices, bool &MaxLookupReached) {
+  if (!PersistentCache)
+    return DecomposeGEPExpression(V, BaseOffs, VarIndices, MaxLookupReached,
+                                  DL);
+
+  DenseMap<const Value *, DecomposedGEP>::iterator I =
+      DecomposedGEPCache.find(V);
+  if (I == DecomposedGEPCache.end()) {
+    SmallVector<const Value *, 16> Visited;
+    DecomposedGEP D;
+    D.Base = DecomposeGEPExpression(V, D.Offset, D.VarIndices,
+                                    D.MaxLookupReached, DL, &Visited);
+    for (unsigned i = 0, e = Visited.size(); i != e; ++i)
+      trackValue(Visited[i]);
+    for (unsigned i = 0, e = D.VarIndices.size(); i != e; ++i)
+      trackValue(D.VarIndices[i].V);
+    I = DecomposedGEPCache.insert(std::make_pair(V, D)).first;
+  }
+
+  const DecomposedGEP &D = I->second;
+  BaseOffs = D.Offset;
+  VarIndices.append(D.VarIndices.begin(), D.VarIndices.end());
+  MaxLookupReached = D.MaxLookupReached;
+  return D.Base;
+}
+
 bool BasicAliasAnalysis::isValueEqualInPotentialCycles(const Value *V,
                                                        const Value *V2) {
   if (V != V2)
@@ -488,10 +488,15 @@ void BranchProbabilityInfo::getAnalysisUsage(AnalysisUsage &AU) const {
 }
 
 bool BranchProbabilityInfo::runOnFunction(Function &F) {
+  calculate(F, getAnalysis<LoopInfo>());
+  return false;
+}
+
+void BranchProbabilityInfo::calculate(Function &F, LoopInfo &LoopI) {
   DEBUG(dbgs() << "---- Branch Probability Info : " << F.getName()
                << " ----\n\n");
   LastF = &F; // Store the last function we ran on for printing.
-  LI = &getAnalysis<LoopInfo>();
+  LI = &LoopI;
   assert(PostDominatedByUnreachable.empty());
   assert(PostDominatedByColdCall.empty());
 
@@ -520,7 +525,6 @@ bool BranchProbabilityInfo::runOnFunction(Function &F) {
 
   PostDominatedByUnreachable.clear();
   PostDominatedByColdCall.clear();
-  return false;
 }
 
 void BranchProbabilityInfo::print(raw_ostream &OS, const Module *) const {
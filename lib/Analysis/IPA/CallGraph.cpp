@@ -12,10 +12,18 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 using namespace llvm;
 
+static cl::opt<unsigned>
+CallGraphThreads("callgraph-threads", cl::init(1), cl::Hidden,
+                 cl::desc("Number of threads used to find the calls in "
+                          "function bodies when building the call graph"));
+
 //===----------------------------------------------------------------------===//
 // Implementations of the CallGraph class methods.
 //
@@ -23,9 +31,45 @@ using namespace llvm;
 CallGraph::CallGraph(Module &M)
     : M(M), Root(nullptr), ExternalCallingNode(getOrInsertFunction(nullptr)),
       CallsExternalNode(new CallGraphNode(nullptr)) {
-  // Add every function to the call graph.
-  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
-    addToCallGraph(I);
+  // Give every function a node first, so that nothing changes while the
+  // calls are found.  Nodes is a flat copy of the function map that is
+  // cheaper to look callees up in.
+  std::vector<Function *> Functions;
+  DenseMap<const Function *, CallGraphNode *> Nodes;
+  Nodes.resize(M.size());
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    Nodes[I] = getOrInsertFunction(I);
+    Functions.push_back(I);
+  }
+
+  // Find the calls in each function body, on several threads if asked to.
+  std::vector<std::vector<CallEdgeTy> > Calls(Functions.size());
+  unsigned NumThreads = std::min<unsigned>(CallGraphThreads, Functions.size());
+  if (NumThreads > 1) {
+    ThreadPool Pool(NumThreads);
+    // Hand out a few chunks per thread so one large function doesn't leave
+    // the other threads idle.
+    size_t ChunkSize = (Functions.size() + NumThreads * 8 - 1) /
+                       (NumThreads * 8);
+    for (size_t Begin = 0; Begin < Functions.size(); Begin += ChunkSize) {
+      size_t End = std::min(Begin + ChunkSize, Functions.size());
+      Pool.async([this, &Functions, &Nodes, &Calls, Begin, End] {
+        for (size_t i = Begin; i != End; ++i)
+          findCalls(Functions[i], Nodes, Calls[i]);
+      });
+    }
+    Pool.wait();
+  } else {
+    for (size_t i = 0, e = Functions.size(); i != e; ++i)
+      findCalls(Functions[i], Nodes, Calls[i]);
+  }
+
+  // Add the edges in module order, so the graph is the same however many
+  // threads found the calls.
+  for (size_t i = 0, e = Functions.size(); i != e; ++i) {
+    addToCallGraph(Functions[i], Calls[i]);
+    std::vector<CallEdgeTy>().swap(Calls[i]);
+  }
 
   // If we didn't find a main function, use the external call graph node
   if (!Root)
@@ -49,7 +93,30 @@ CallGraph::~CallGraph() {
     delete I->second;
 }
 
-void CallGraph::addToCallGraph(Function *F) {
+void CallGraph::findCalls(
+    Function *F, const DenseMap<const Function *, CallGraphNode *> &Nodes,
+    std::vector<CallEdgeTy> &Calls) const {
+  for (Function::iterator BB = F->begin(), BBE = F->end(); BB != BBE; ++BB)
+    for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
+         ++II) {
+      CallSite CS(cast<Value>(II));
+      if (!CS)
+        continue;
+      const Function *Callee = CS.getCalledFunction();
+      if (!Callee) {
+        // Indirect calls of intrinsics are not allowed so no need to check.
+        Calls.push_back(CallEdgeTy(II, CallsExternalNode));
+      } else if (!Callee->isIntrinsic()) {
+        DenseMap<const Function *, CallGraphNode *>::const_iterator I =
+          Nodes.find(Callee);
+        assert(I != Nodes.end() && "Callee has no call graph node!");
+        Calls.push_back(CallEdgeTy(II, I->second));
+      }
+    }
+}
+
+void CallGraph::addToCallGraph(Function *F,
+                               const std::vector<CallEdgeTy> &Calls) {
   CallGraphNode *Node = getOrInsertFunction(F);
 
   // If this function has external linkage, anything could call it.
@@ -74,20 +141,12 @@ void CallGraph::addToCallGraph(Function *F) {
   if (F->isDeclaration() && !F->isIntrinsic())
     Node->addCalledFunction(CallSite(), CallsExternalNode);
 
-  // Look for calls by this function.
-  for (Function::iterator BB = F->begin(), BBE = F->end(); BB != BBE; ++BB)
-    for (BasicBlock::iterator II = BB->begin(), IE = BB->end(); II != IE;
-         ++II) {
-      CallSite CS(cast<Value>(II));
-      if (CS) {
-        const Function *Callee = CS.getCalledFunction();
-        if (!Callee)
-          // Indirect calls of intrinsics are not allowed so no need to check.
-          Node->addCalledFunction(CS, CallsExternalNode);
-        else if (!Callee->isIntrinsic())
-          Node->addCalledFunction(CS, getOrInsertFunction(Callee));
-      }
-    }
+  // Link the node to the functions it calls.  Growing the edge list moves
+  // the value handles in it, so reserve the space up front.
+  Node->CalledFunctions.reserve(Node->CalledFunctions.size() + Calls.size());
+  for (std::vector<CallEdgeTy>::const_iterator I = Calls.begin(),
+       E = Calls.end(); I != E; ++I)
+    Node->addCalledFunction(CallSite(I->first), I->second);
 }
 
 void CallGraph::print(raw_ostream &OS) const {
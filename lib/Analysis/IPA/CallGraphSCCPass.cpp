@@ -125,6 +125,11 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
       TimeRegion PassTimer(getPassTimer(CGSP));
       Changed = CGSP->runOnSCC(CurSCC);
     }
+
+    // SCC passes may rewrite, create or delete any function they can reach,
+    // so their changes can't be attributed to a single function.
+    if (Changed)
+      TPM->getChangeTracker().moduleChanged();
     
     // After the CGSCCPass is done, when assertions are enabled, use
     // RefreshCallGraph to verify that the callgraph was correctly updated.
@@ -431,6 +436,8 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
 bool CGPassManager::runOnModule(Module &M) {
   CallGraph &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
   bool Changed = doInitialization(CG);
+  if (Changed)
+    TPM->getChangeTracker().moduleChanged();
   
   // Walk the callgraph in bottom-up SCC order.
   scc_iterator<CallGraph*> CGI = scc_begin(&CG);
@@ -473,7 +480,10 @@ bool CGPassManager::runOnModule(Module &M) {
       MaxSCCIterations = Iteration;
     
   }
-  Changed |= doFinalization(CG);
+  if (doFinalization(CG)) {
+    TPM->getChangeTracker().moduleChanged();
+    Changed = true;
+  }
   return Changed;
 }
 
@@ -0,0 +1,105 @@
+//===- CallGraphSCCSchedule.cpp - Dependencies between call graph SCCs ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the CallGraphSCCSchedule class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/CallGraphSCCSchedule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+CallGraphSCCSchedule::CallGraphSCCSchedule(CallGraph &CG)
+    : NumLevels(0), MaxLevelWidth(0) {
+  DenseMap<CallGraphNode *, unsigned> SCCOf;
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
+    unsigned Idx = SCCs.size();
+    SCCs.push_back(SCCInfo());
+    SCCInfo &SCC = SCCs.back();
+    SCC.Nodes.append(I->begin(), I->end());
+    SCC.Level = 0;
+    SCC.Pending = 0;
+    for (unsigned i = 0, e = SCC.Nodes.size(); i != e; ++i)
+      SCCOf[SCC.Nodes[i]] = Idx;
+  }
+
+  // Callees are visited before their callers, so each SCC's callees already
+  // have their levels.  LastCaller avoids recording an edge twice.
+  std::vector<unsigned> LastCaller(SCCs.size(), ~0U);
+  std::vector<unsigned> LevelWidth;
+  for (unsigned Idx = 0, e = SCCs.size(); Idx != e; ++Idx) {
+    SCCInfo &SCC = SCCs[Idx];
+    for (unsigned i = 0, ie = SCC.Nodes.size(); i != ie; ++i)
+      for (CallGraphNode::iterator CI = SCC.Nodes[i]->begin(),
+           CE = SCC.Nodes[i]->end(); CI != CE; ++CI) {
+        DenseMap<CallGraphNode *, unsigned>::iterator It =
+          SCCOf.find(CI->second);
+        assert(It != SCCOf.end() && "Callee was not visited!");
+        unsigned Callee = It->second;
+        if (Callee == Idx || LastCaller[Callee] == Idx)
+          continue;
+        assert(Callee < Idx && "Callee visited after its caller!");
+        LastCaller[Callee] = Idx;
+        SCC.Callees.push_back(Callee);
+        SCCs[Callee].Callers.push_back(Idx);
+        SCC.Level = std::max(SCC.Level, SCCs[Callee].Level + 1);
+      }
+
+    if (SCC.Level >= LevelWidth.size())
+      LevelWidth.resize(SCC.Level + 1);
+    ++LevelWidth[SCC.Level];
+  }
+
+  NumLevels = LevelWidth.size();
+  for (unsigned i = 0; i != NumLevels; ++i)
+    MaxLevelWidth = std::max(MaxLevelWidth, LevelWidth[i]);
+}
+
+void CallGraphSCCSchedule::reset(SmallVectorImpl<unsigned> &Ready) {
+  for (unsigned Idx = 0, e = SCCs.size(); Idx != e; ++Idx) {
+    SCCs[Idx].Pending = SCCs[Idx].Callees.size();
+    if (!SCCs[Idx].Pending)
+      Ready.push_back(Idx);
+  }
+}
+
+void CallGraphSCCSchedule::finish(unsigned I,
+                                  SmallVectorImpl<unsigned> &Ready) {
+  assert(SCCs[I].Pending == 0 && "SCC finished before its callees!");
+  ArrayRef<unsigned> Callers = SCCs[I].Callers;
+  for (unsigned i = 0, e = Callers.size(); i != e; ++i)
+    if (--SCCs[Callers[i]].Pending == 0)
+      Ready.push_back(Callers[i]);
+}
+
+void CallGraphSCCSchedule::print(raw_ostream &OS) const {
+  OS << "Call graph SCC schedule: " << SCCs.size() << " SCCs in " << NumLevels
+     << " levels, at most " << MaxLevelWidth << " in one level\n";
+  for (unsigned Idx = 0, e = SCCs.size(); Idx != e; ++Idx) {
+    const SCCInfo &SCC = SCCs[Idx];
+    OS << "SCC #" << Idx << " level " << SCC.Level << ":";
+    for (unsigned i = 0, ie = SCC.Nodes.size(); i != ie; ++i) {
+      OS << ' ';
+      if (Function *F = SCC.Nodes[i]->getFunction())
+        OS << F->getName();
+      else
+        OS << "<external node>";
+    }
+    if (!SCC.Callees.empty()) {
+      OS << "; calls";
+      for (unsigned i = 0, ie = SCC.Callees.size(); i != ie; ++i)
+        OS << " #" << SCC.Callees[i];
+    }
+    OS << '\n';
+  }
+}
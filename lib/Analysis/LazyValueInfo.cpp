@@ -13,8 +13,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/LazyValueInfo.h"
-#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CFG.h"
@@ -25,16 +28,29 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLibraryInfo.h"
-#include <map>
+#include <memory>
 #include <stack>
 using namespace llvm;
 using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumCacheClears, "Number of times the cache was over its limit");
+
+// The cache is only cleared between queries, so a single query can take it
+// past the limit.  A limit below the number of entries one query needs makes
+// every query start from an empty cache.
+static cl::opt<unsigned>
+LVIMaxCacheEntries("lvi-max-cache-entries", cl::init(0), cl::Hidden,
+                   cl::desc("Clear the lazy value info cache between queries "
+                            "once it holds more than this many (value, block) "
+                            "entries (0 = no limit)"));
+
 char LazyValueInfo::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfo, "lazy-value-info",
                 "Lazy Value Information Analysis", false, true)
@@ -124,6 +140,18 @@ public:
            "Cannot get the constant-range of a non-constant-range!");
     return Range;
   }
+
+  /// Profile - Identify the value for interning.  Only the parts that the
+  /// tag makes meaningful are included.
+  void Profile(FoldingSetNodeID &ID) const {
+    ID.AddInteger(Tag);
+    if (isConstant() || isNotConstant())
+      ID.AddPointer(Val);
+    if (isConstantRange()) {
+      Range.getLower().Profile(ID);
+      Range.getUpper().Profile(ID);
+    }
+  }
   
   /// markOverdefined - Return true if this is a change in status.
   bool markOverdefined() {
@@ -296,11 +324,14 @@ raw_ostream &operator<<(raw_ostream &OS, const LVILatticeVal &Val) {
 
 namespace {
   /// LVIValueHandle - A callback value handle updates the cache when
-  /// values are erased.
+  /// values are erased.  It also records the blocks the value has cache
+  /// entries in, so that dropping the value doesn't have to scan the whole
+  /// cache.
   class LazyValueInfoCache;
   struct LVIValueHandle : public CallbackVH {
     LazyValueInfoCache *Parent;
-      
+    SmallPtrSet<BasicBlock *, 4> Blocks;
+
     LVIValueHandle(Value *V, LazyValueInfoCache *P)
       : CallbackVH(V), Parent(P) { }
 
@@ -312,27 +343,40 @@ namespace {
 }
 
 namespace { 
+  /// InternedLatticeVal - A uniqued LVILatticeVal.  Most cache entries are
+  /// overdefined or share a handful of constants and ranges, so the cache
+  /// stores pointers to these rather than a ConstantRange per entry.
+  struct InternedLatticeVal : public FoldingSetNode {
+    LVILatticeVal Val;
+
+    explicit InternedLatticeVal(const LVILatticeVal &V) : Val(V) {}
+    void Profile(FoldingSetNodeID &ID) const { Val.Profile(ID); }
+  };
+
   /// LazyValueInfoCache - This is the cache kept by LazyValueInfo which
   /// maintains information about queries across the clients' queries.
   class LazyValueInfoCache {
-    /// ValueCacheEntryTy - This is all of the cached block information for
-    /// exactly one Value*.  The entries are sorted by the BasicBlock* of the
-    /// entries, allowing us to do a lookup with a binary search.
-    typedef std::map<AssertingVH<BasicBlock>, LVILatticeVal> ValueCacheEntryTy;
-
-    /// ValueCache - This is all of the cached information for all values,
-    /// mapped from Value* to key information.
-    std::map<LVIValueHandle, ValueCacheEntryTy> ValueCache;
-    
-    /// OverDefinedCache - This tracks, on a per-block basis, the set of 
-    /// values that are over-defined at the end of that block.  This is required
-    /// for cache updating.
-    typedef std::pair<AssertingVH<BasicBlock>, Value*> OverDefinedPairTy;
-    DenseSet<OverDefinedPairTy> OverDefinedCache;
+    /// BlockCacheEntryTy - This is all of the cached information for exactly
+    /// one block: the lattice value of each value at the end of the block.
+    typedef SmallDenseMap<Value *, const LVILatticeVal *, 4> BlockCacheEntryTy;
+
+    /// BlockCache - This is all of the cached information for all blocks.
+    /// Keeping the entries of a block together makes erasing a block or
+    /// clearing a block's overdefined values after edge threading
+    /// proportional to the number of values cached for that block.  A value
+    /// is overdefined at the end of a block exactly when its entry is.
+    DenseMap<AssertingVH<BasicBlock>, BlockCacheEntryTy> BlockCache;
+
+    /// ValueHandles - The handle for each value that has entries in
+    /// BlockCache.
+    DenseMap<Value *, std::unique_ptr<LVIValueHandle> > ValueHandles;
 
-    /// SeenBlocks - Keep track of all blocks that we have ever seen, so we
-    /// don't spend time removing unused blocks from our caches.
-    DenseSet<AssertingVH<BasicBlock> > SeenBlocks;
+    /// NumEntries - The number of (value, block) entries in BlockCache.
+    unsigned NumEntries;
+
+    /// InternedVals - The distinct lattice values BlockCache points to.
+    FoldingSet<InternedLatticeVal> InternedVals;
+    SpecificBumpPtrAllocator<InternedLatticeVal> InternedValAllocator;
 
     /// BlockValueStack - This stack holds the state of the value solver
     /// during a query.  It basically emulates the callstack of the naive
@@ -340,37 +384,31 @@ namespace {
     std::stack<std::pair<BasicBlock*, Value*> > BlockValueStack;
     
     friend struct LVIValueHandle;
-    
-    /// OverDefinedCacheUpdater - A helper object that ensures that the
-    /// OverDefinedCache is updated whenever solveBlockValue returns.
-    struct OverDefinedCacheUpdater {
-      LazyValueInfoCache *Parent;
-      Value *Val;
-      BasicBlock *BB;
-      LVILatticeVal &BBLV;
-      
-      OverDefinedCacheUpdater(Value *V, BasicBlock *B, LVILatticeVal &LV,
-                       LazyValueInfoCache *P)
-        : Parent(P), Val(V), BB(B), BBLV(LV) { }
-      
-      bool markResult(bool changed) { 
-        if (changed && BBLV.isOverdefined())
-          Parent->OverDefinedCache.insert(std::make_pair(BB, Val));
-        return changed;
-      }
-    };
-    
-
 
     LVILatticeVal getBlockValue(Value *Val, BasicBlock *BB);
     bool getEdgeValue(Value *V, BasicBlock *F, BasicBlock *T,
                       LVILatticeVal &Result);
     bool hasBlockValue(Value *Val, BasicBlock *BB);
 
+    /// intern - Return the uniqued copy of LV.
+    const LVILatticeVal *intern(const LVILatticeVal &LV);
+
+    /// insertBlockValue - Set the cached value of Val at the end of BB.
+    void insertBlockValue(Value *Val, BasicBlock *BB,
+                          const LVILatticeVal &Result);
+
+    /// eraseValue - Drop all cache entries for V.
+    void eraseValue(Value *V);
+
+    /// enforceCacheLimit - Empty the cache if it has grown past
+    /// -lvi-max-cache-entries.  Only called between queries.
+    void enforceCacheLimit();
+
     // These methods process one work item and may add more. A false value
     // returned means that the work item was not completely processed and must
     // be revisited after going through the new items.
     bool solveBlockValue(Value *Val, BasicBlock *BB);
+    bool solveBlockValueImpl(LVILatticeVal &BBLV, Value *Val, BasicBlock *BB);
     bool solveBlockValueNonLocal(LVILatticeVal &BBLV,
                                  Value *Val, BasicBlock *BB);
     bool solveBlockValuePHINode(LVILatticeVal &BBLV,
@@ -379,12 +417,10 @@ namespace {
                                       Instruction *BBI, BasicBlock *BB);
 
     void solve();
-    
-    ValueCacheEntryTy &lookup(Value *V) {
-      return ValueCache[LVIValueHandle(V, this)];
-    }
 
   public:
+    LazyValueInfoCache() : NumEntries(0) {}
+
     /// getValueInBlock - This is the query interface to determine the lattice
     /// value for the specified Value* at the end of the specified block.
     LVILatticeVal getValueInBlock(Value *V, BasicBlock *BB);
@@ -404,55 +440,96 @@ namespace {
     
     /// clear - Empty the cache.
     void clear() {
-      SeenBlocks.clear();
-      ValueCache.clear();
-      OverDefinedCache.clear();
+      BlockCache.clear();
+      ValueHandles.clear();
+      NumEntries = 0;
+      InternedVals.clear();
+      InternedValAllocator.DestroyAll();
     }
   };
 } // end anonymous namespace
 
 void LVIValueHandle::deleted() {
-  typedef std::pair<AssertingVH<BasicBlock>, Value*> OverDefinedPairTy;
-  
-  SmallVector<OverDefinedPairTy, 4> ToErase;
-  for (DenseSet<OverDefinedPairTy>::iterator 
-       I = Parent->OverDefinedCache.begin(),
-       E = Parent->OverDefinedCache.end();
-       I != E; ++I) {
-    if (I->second == getValPtr())
-      ToErase.push_back(*I);
+  // This erases the handle, so it MUST be the last use of *this.
+  Parent->eraseValue(getValPtr());
+}
+
+void LazyValueInfoCache::eraseValue(Value *V) {
+  DenseMap<Value *, std::unique_ptr<LVIValueHandle> >::iterator HI =
+    ValueHandles.find(V);
+  if (HI == ValueHandles.end())
+    return;
+
+  LVIValueHandle &Handle = *HI->second;
+  for (SmallPtrSetImpl<BasicBlock *>::iterator I = Handle.Blocks.begin(),
+       E = Handle.Blocks.end(); I != E; ++I) {
+    DenseMap<AssertingVH<BasicBlock>, BlockCacheEntryTy>::iterator BI =
+      BlockCache.find(*I);
+    assert(BI != BlockCache.end() && "Value handle has a stale block!");
+    BI->second.erase(V);
+    --NumEntries;
   }
 
-  for (SmallVectorImpl<OverDefinedPairTy>::iterator I = ToErase.begin(),
-       E = ToErase.end(); I != E; ++I)
-    Parent->OverDefinedCache.erase(*I);
-  
-  // This erasure deallocates *this, so it MUST happen after we're done
-  // using any and all members of *this.
-  Parent->ValueCache.erase(*this);
+  // This erasure deallocates the handle, which may be the caller.
+  ValueHandles.erase(HI);
 }
 
 void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
   // Shortcut if we have never seen this block.
-  DenseSet<AssertingVH<BasicBlock> >::iterator I = SeenBlocks.find(BB);
-  if (I == SeenBlocks.end())
+  DenseMap<AssertingVH<BasicBlock>, BlockCacheEntryTy>::iterator I =
+    BlockCache.find(BB);
+  if (I == BlockCache.end())
     return;
-  SeenBlocks.erase(I);
 
-  SmallVector<OverDefinedPairTy, 4> ToErase;
-  for (DenseSet<OverDefinedPairTy>::iterator  I = OverDefinedCache.begin(),
-       E = OverDefinedCache.end(); I != E; ++I) {
-    if (I->first == BB)
-      ToErase.push_back(*I);
+  for (BlockCacheEntryTy::iterator VI = I->second.begin(),
+       VE = I->second.end(); VI != VE; ++VI) {
+    DenseMap<Value *, std::unique_ptr<LVIValueHandle> >::iterator HI =
+      ValueHandles.find(VI->first);
+    assert(HI != ValueHandles.end() && "Cached value has no handle!");
+    HI->second->Blocks.erase(BB);
+    if (HI->second->Blocks.empty())
+      ValueHandles.erase(HI);
+  }
+  NumEntries -= I->second.size();
+  BlockCache.erase(I);
+}
+
+const LVILatticeVal *LazyValueInfoCache::intern(const LVILatticeVal &LV) {
+  FoldingSetNodeID ID;
+  LV.Profile(ID);
+  void *IP = nullptr;
+  if (InternedLatticeVal *N = InternedVals.FindNodeOrInsertPos(ID, IP))
+    return &N->Val;
+  InternedLatticeVal *N =
+    new (InternedValAllocator.Allocate()) InternedLatticeVal(LV);
+  InternedVals.InsertNode(N, IP);
+  return &N->Val;
+}
+
+void LazyValueInfoCache::insertBlockValue(Value *Val, BasicBlock *BB,
+                                          const LVILatticeVal &Result) {
+  const LVILatticeVal *Interned = intern(Result);
+  BlockCacheEntryTy &Entry = BlockCache[BB];
+  std::pair<BlockCacheEntryTy::iterator, bool> Ins =
+    Entry.insert(std::make_pair(Val, Interned));
+  if (!Ins.second) {
+    Ins.first->second = Interned;
+    return;
   }
 
-  for (SmallVectorImpl<OverDefinedPairTy>::iterator I = ToErase.begin(),
-       E = ToErase.end(); I != E; ++I)
-    OverDefinedCache.erase(*I);
+  ++NumEntries;
+  std::unique_ptr<LVIValueHandle> &Handle = ValueHandles[Val];
+  if (!Handle)
+    Handle.reset(new LVIValueHandle(Val, this));
+  Handle->Blocks.insert(BB);
+}
 
-  for (std::map<LVIValueHandle, ValueCacheEntryTy>::iterator
-       I = ValueCache.begin(), E = ValueCache.end(); I != E; ++I)
-    I->second.erase(BB);
+void LazyValueInfoCache::enforceCacheLimit() {
+  if (!LVIMaxCacheEntries || NumEntries <= LVIMaxCacheEntries)
+    return;
+  DEBUG(dbgs() << "LVI cache has " << NumEntries << " entries; clearing\n");
+  ++NumCacheClears;
+  clear();
 }
 
 void LazyValueInfoCache::solve() {
@@ -470,11 +547,10 @@ bool LazyValueInfoCache::hasBlockValue(Value *Val, BasicBlock *BB) {
   if (isa<Constant>(Val))
     return true;
 
-  LVIValueHandle ValHandle(Val, this);
-  std::map<LVIValueHandle, ValueCacheEntryTy>::iterator I =
-    ValueCache.find(ValHandle);
-  if (I == ValueCache.end()) return false;
-  return I->second.count(BB);
+  DenseMap<AssertingVH<BasicBlock>, BlockCacheEntryTy>::iterator I =
+    BlockCache.find(BB);
+  if (I == BlockCache.end()) return false;
+  return I->second.count(Val);
 }
 
 LVILatticeVal LazyValueInfoCache::getBlockValue(Value *Val, BasicBlock *BB) {
@@ -482,24 +558,20 @@ LVILatticeVal LazyValueInfoCache::getBlockValue(Value *Val, BasicBlock *BB) {
   if (Constant *VC = dyn_cast<Constant>(Val))
     return LVILatticeVal::get(VC);
 
-  SeenBlocks.insert(BB);
-  return lookup(Val)[BB];
+  DenseMap<AssertingVH<BasicBlock>, BlockCacheEntryTy>::iterator I =
+    BlockCache.find(BB);
+  if (I == BlockCache.end())
+    return LVILatticeVal();
+  BlockCacheEntryTy::iterator VI = I->second.find(Val);
+  if (VI == I->second.end())
+    return LVILatticeVal();
+  return *VI->second;
 }
 
 bool LazyValueInfoCache::solveBlockValue(Value *Val, BasicBlock *BB) {
   if (isa<Constant>(Val))
     return true;
 
-  ValueCacheEntryTy &Cache = lookup(Val);
-  SeenBlocks.insert(BB);
-  LVILatticeVal &BBLV = Cache[BB];
-  
-  // OverDefinedCacheUpdater is a helper object that will update
-  // the OverDefinedCache for us when this method exits.  Make sure to
-  // call markResult on it as we exist, passing a bool to indicate if the
-  // cache needs updating, i.e. if we have solve a new value or not.
-  OverDefinedCacheUpdater ODCacheUpdater(Val, BB, BBLV, this);
-
   // Once this BB is encountered, Val's value for this BB will not be Undefined
   // any longer. When we encounter this BB again, if Val's value is Overdefined,
   // we need to compute its value again.
@@ -515,45 +587,47 @@ bool LazyValueInfoCache::solveBlockValue(Value *Val, BasicBlock *BB) {
   // BB2. So we should have to follow data flow propagation algorithm to get the
   // value on edge BB1->BB2 propagated to BB2, and finally %v on BB2 has a
   // constant range describing a negative value.
-
+  LVILatticeVal BBLV = getBlockValue(Val, BB);
   if (!BBLV.isUndefined() && !BBLV.isOverdefined()) {
     DEBUG(dbgs() << "  reuse BB '" << BB->getName() << "' val=" << BBLV <<'\n');
-    
-    // Since we're reusing a cached value here, we don't need to update the 
-    // OverDefinedCahce.  The cache will have been properly updated 
-    // whenever the cached value was inserted.
-    ODCacheUpdater.markResult(false);
     return true;
   }
 
   // Otherwise, this is the first time we're seeing this block.  Reset the
   // lattice value to overdefined, so that cycles will terminate and be
   // conservatively correct.
+  //
+  // The result is computed into a local rather than a reference into the
+  // cache, since solving may add entries and move the existing ones.
   BBLV.markOverdefined();
-  
+  insertBlockValue(Val, BB, BBLV);
+  bool Solved = solveBlockValueImpl(BBLV, Val, BB);
+  insertBlockValue(Val, BB, BBLV);
+  return Solved;
+}
+
+bool LazyValueInfoCache::solveBlockValueImpl(LVILatticeVal &BBLV,
+                                             Value *Val, BasicBlock *BB) {
   Instruction *BBI = dyn_cast<Instruction>(Val);
-  if (!BBI || BBI->getParent() != BB) {
-    return ODCacheUpdater.markResult(solveBlockValueNonLocal(BBLV, Val, BB));
-  }
+  if (!BBI || BBI->getParent() != BB)
+    return solveBlockValueNonLocal(BBLV, Val, BB);
 
-  if (PHINode *PN = dyn_cast<PHINode>(BBI)) {
-    return ODCacheUpdater.markResult(solveBlockValuePHINode(BBLV, PN, BB));
-  }
+  if (PHINode *PN = dyn_cast<PHINode>(BBI))
+    return solveBlockValuePHINode(BBLV, PN, BB);
 
   if (AllocaInst *AI = dyn_cast<AllocaInst>(BBI)) {
     BBLV = LVILatticeVal::getNot(ConstantPointerNull::get(AI->getType()));
-    return ODCacheUpdater.markResult(true);
+    return true;
   }
 
   // We can only analyze the definitions of certain classes of instructions
   // (integral binops and casts at the moment), so bail if this isn't one.
-  LVILatticeVal Result;
   if ((!isa<BinaryOperator>(BBI) && !isa<CastInst>(BBI)) ||
      !BBI->getType()->isIntegerTy()) {
     DEBUG(dbgs() << " compute BB '" << BB->getName()
                  << "' - overdefined because inst def found.\n");
     BBLV.markOverdefined();
-    return ODCacheUpdater.markResult(true);
+    return true;
   }
 
   // FIXME: We're currently limited to binops with a constant RHS.  This should
@@ -564,10 +638,10 @@ bool LazyValueInfoCache::solveBlockValue(Value *Val, BasicBlock *BB) {
                  << "' - overdefined because inst def found.\n");
 
     BBLV.markOverdefined();
-    return ODCacheUpdater.markResult(true);
+    return true;
   }
 
-  return ODCacheUpdater.markResult(solveBlockValueConstantRange(BBLV, BBI, BB));
+  return solveBlockValueConstantRange(BBLV, BBI, BB);
 }
 
 static bool InstructionDereferencesPointer(Instruction *I, Value *Ptr) {
@@ -932,6 +1006,7 @@ LVILatticeVal LazyValueInfoCache::getValueInBlock(Value *V, BasicBlock *BB) {
   BlockValueStack.push(std::make_pair(BB, V));
   solve();
   LVILatticeVal Result = getBlockValue(V, BB);
+  enforceCacheLimit();
 
   DEBUG(dbgs() << "  Result = " << Result << "\n");
   return Result;
@@ -949,6 +1024,7 @@ getValueOnEdge(Value *V, BasicBlock *FromBB, BasicBlock *ToBB) {
     (void)WasFastQuery;
     assert(WasFastQuery && "More work to do after problem solved?");
   }
+  enforceCacheLimit();
 
   DEBUG(dbgs() << "  Result = " << Result << "\n");
   return Result;
@@ -966,16 +1042,20 @@ void LazyValueInfoCache::threadEdge(BasicBlock *PredBB, BasicBlock *OldSucc,
   // for all values that were marked overdefined in OldSucc, and for those same
   // values in any successor of OldSucc (except NewSucc) in which they were
   // also marked overdefined.
+  DenseMap<AssertingVH<BasicBlock>, BlockCacheEntryTy>::iterator OI =
+    BlockCache.find(OldSucc);
+  if (OI == BlockCache.end())
+    return;
+
+  SmallVector<Value *, 8> ClearSet;
+  for (BlockCacheEntryTy::iterator I = OI->second.begin(),
+       E = OI->second.end(); I != E; ++I)
+    if (I->second->isOverdefined())
+      ClearSet.push_back(I->first);
+
   std::vector<BasicBlock*> worklist;
   worklist.push_back(OldSucc);
-  
-  DenseSet<Value*> ClearSet;
-  for (DenseSet<OverDefinedPairTy>::iterator I = OverDefinedCache.begin(),
-       E = OverDefinedCache.end(); I != E; ++I) {
-    if (I->first == OldSucc)
-      ClearSet.insert(I->second);
-  }
-  
+
   // Use a worklist to perform a depth-first search of OldSucc's successors.
   // NOTE: We do not need a visited list since any blocks we have already
   // visited will have had their overdefined markers cleared already, and we
@@ -986,22 +1066,27 @@ void LazyValueInfoCache::threadEdge(BasicBlock *PredBB, BasicBlock *OldSucc,
     
     // Skip blocks only accessible through NewSucc.
     if (ToUpdate == NewSucc) continue;
+
+    DenseMap<AssertingVH<BasicBlock>, BlockCacheEntryTy>::iterator BI =
+      BlockCache.find(ToUpdate);
+    if (BI == BlockCache.end()) continue;
     
     bool changed = false;
-    for (DenseSet<Value*>::iterator I = ClearSet.begin(), E = ClearSet.end();
-         I != E; ++I) {
+    for (SmallVectorImpl<Value *>::iterator I = ClearSet.begin(),
+         E = ClearSet.end(); I != E; ++I) {
       // If a value was marked overdefined in OldSucc, and is here too...
-      DenseSet<OverDefinedPairTy>::iterator OI =
-        OverDefinedCache.find(std::make_pair(ToUpdate, *I));
-      if (OI == OverDefinedCache.end()) continue;
-
-      // Remove it from the caches.
-      ValueCacheEntryTy &Entry = ValueCache[LVIValueHandle(*I, this)];
-      ValueCacheEntryTy::iterator CI = Entry.find(ToUpdate);
-
-      assert(CI != Entry.end() && "Couldn't find entry to update?");
-      Entry.erase(CI);
-      OverDefinedCache.erase(OI);
+      BlockCacheEntryTy::iterator CI = BI->second.find(*I);
+      if (CI == BI->second.end() || !CI->second->isOverdefined()) continue;
+
+      // Remove it from the cache.
+      BI->second.erase(CI);
+      --NumEntries;
+      DenseMap<Value *, std::unique_ptr<LVIValueHandle> >::iterator HI =
+        ValueHandles.find(*I);
+      assert(HI != ValueHandles.end() && "Cached value has no handle!");
+      HI->second->Blocks.erase(ToUpdate);
+      if (HI->second->Blocks.empty())
+        ValueHandles.erase(HI);
 
       // If we removed anything, then we potentially need to update 
       // blocks successors too.
@@ -699,6 +699,41 @@ void LoopInfo::verifyAnalysis() const {
     assert(Loops.count(I->second) && "orphaned loop");
     assert(I->second->contains(I->first) && "orphaned block");
   }
+
+#ifndef NDEBUG
+  // Transformations update LoopInfo in place rather than recomputing it.
+  // Check that the result matches what recomputing would give.
+  if (LI.BBMap.empty())
+    return;
+  Function &F = *LI.BBMap.begin()->first->getParent();
+  DominatorTree DT;
+  DT.recalculate(F);
+  LoopInfoBase<BasicBlock, Loop> Fresh;
+  Fresh.Analyze(DT);
+
+  unsigned NumFreshLoops = 0;
+  SmallVector<const Loop *, 8> Worklist(Fresh.begin(), Fresh.end());
+  while (!Worklist.empty()) {
+    const Loop *FreshL = Worklist.pop_back_val();
+    Worklist.append(FreshL->begin(), FreshL->end());
+    ++NumFreshLoops;
+
+    const Loop *L = getLoopFor(FreshL->getHeader());
+    assert(L && L->getHeader() == FreshL->getHeader() &&
+           "Loop missing from LoopInfo");
+    assert((L->getParentLoop() ? L->getParentLoop()->getHeader() : nullptr) ==
+           (FreshL->getParentLoop() ? FreshL->getParentLoop()->getHeader()
+                                    : nullptr) &&
+           "Loop has the wrong parent");
+    assert(L->getNumBlocks() == FreshL->getNumBlocks() &&
+           L->getSubLoops().size() == FreshL->getSubLoops().size() &&
+           "Loop has the wrong blocks or subloops");
+    for (Loop::block_iterator BI = FreshL->block_begin(),
+           BE = FreshL->block_end(); BI != BE; ++BI)
+      assert(L->contains(*BI) && "Loop has the wrong blocks");
+  }
+  assert(NumFreshLoops == Loops.size() && "LoopInfo has extra loops");
+#endif
 }
 
 void LoopInfo::getAnalysisUsage(AnalysisUsage &AU) const {
@@ -114,6 +114,10 @@ void LPPassManager::insertLoopIntoQueue(Loop *L) {
   // Insert L into loop queue
   if (L == CurrentLoop)
     redoLoop(L);
+  else if (CurrentLoop && L->getParentLoop() == CurrentLoop)
+    // The current loop is at the back of the queue and its subloops have
+    // been visited already.  Visit L once the current loop is done.
+    LQ.insert(std::prev(LQ.end()), L);
   else if (!L->getParentLoop())
     // This is top level loop.
     LQ.push_front(L);
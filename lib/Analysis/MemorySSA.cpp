@@ -0,0 +1,575 @@
+//===- MemorySSA.cpp - Memory SSA form ------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file builds the MemorySSA form of a function and implements the clobber
+// walker.  Construction is the usual SSA construction for a single variable:
+// MemoryPhis are placed at the iterated dominance frontier of the blocks
+// containing MemoryDefs, and a walk over the dominator tree links each access
+// to the version of memory reaching it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/AssemblyAnnotationWriter.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "memoryssa"
+
+STATISTIC(NumMemoryPhis, "Number of MemoryPhis created");
+STATISTIC(NumClobberQueries, "Number of clobber queries");
+STATISTIC(NumClobberCacheHits, "Number of clobber queries answered from cache");
+STATISTIC(NumWalkLimitHits, "Number of clobber walks cut off by the limit");
+
+// The maximum number of accesses a single clobber query steps over.  When it
+// is reached, the walk stops and answers with the access it got to, which is
+// always a correct, if imprecise, clobber.
+static cl::opt<unsigned>
+WalkLimit("memoryssa-walk-limit", cl::init(500), cl::Hidden,
+          cl::desc("The maximum number of memory accesses a MemorySSA "
+                   "clobber query visits (default = 500)"));
+
+static cl::opt<bool>
+VerifyMemorySSA("verify-memoryssa", cl::init(false), cl::Hidden,
+                cl::desc("Verify MemorySSA after building it"));
+
+//===----------------------------------------------------------------------===//
+// MemoryAccess printing
+//===----------------------------------------------------------------------===//
+
+void MemoryAccess::printAsOperand(raw_ostream &OS) const {
+  if (const MemoryDef *Def = dyn_cast<MemoryDef>(this)) {
+    if (Def->getID() == 0)
+      OS << "liveOnEntry";
+    else
+      OS << Def->getID();
+  } else if (const MemoryPhi *Phi = dyn_cast<MemoryPhi>(this)) {
+    OS << Phi->getID();
+  } else {
+    llvm_unreachable("A MemoryUse is never used!");
+  }
+}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << "\n";
+}
+
+void MemoryUse::print(raw_ostream &OS) const {
+  OS << "MemoryUse(";
+  getDefiningAccess()->printAsOperand(OS);
+  OS << ')';
+}
+
+void MemoryDef::print(raw_ostream &OS) const {
+  printAsOperand(OS);
+  OS << " = MemoryDef(";
+  if (MemoryAccess *DMA = getDefiningAccess())
+    DMA->printAsOperand(OS);
+  else
+    OS << "liveOnEntry";
+  OS << ')';
+}
+
+void MemoryPhi::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryPhi(";
+  for (unsigned i = 0, e = getNumIncomingValues(); i != e; ++i) {
+    if (i)
+      OS << ',';
+    OS << '{';
+    getIncomingBlock(i)->printAsOperand(OS, false);
+    OS << ',';
+    getIncomingValue(i)->printAsOperand(OS);
+    OS << '}';
+  }
+  OS << ')';
+}
+
+namespace {
+/// MemorySSAAnnotatedWriter - Print the memory accesses of a function as
+/// comments above the instructions and blocks they belong to.  If Clobbers is
+/// set, also print the clobbering access of each instruction in it.
+class MemorySSAAnnotatedWriter : public AssemblyAnnotationWriter {
+  const MemorySSA *MSSA;
+  const DenseMap<const Instruction *, MemoryAccess *> *Clobbers;
+
+public:
+  MemorySSAAnnotatedWriter(
+      const MemorySSA *MSSA,
+      const DenseMap<const Instruction *, MemoryAccess *> *Clobbers = nullptr)
+      : MSSA(MSSA), Clobbers(Clobbers) {}
+
+  void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                formatted_raw_ostream &OS) override {
+    if (MemoryPhi *Phi = MSSA->getMemoryAccess(BB))
+      OS << "; " << *Phi << '\n';
+  }
+
+  void emitInstructionAnnot(const Instruction *I,
+                            formatted_raw_ostream &OS) override {
+    MemoryUseOrDef *MA = MSSA->getMemoryAccess(I);
+    if (!MA)
+      return;
+    OS << "; " << *MA;
+    if (Clobbers) {
+      if (MemoryAccess *Clobber = Clobbers->lookup(I)) {
+        OS << " clobbered by ";
+        Clobber->printAsOperand(OS);
+      }
+    }
+    OS << '\n';
+  }
+};
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA construction
+//===----------------------------------------------------------------------===//
+
+char MemorySSA::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSA, "memoryssa", "Memory SSA", false, true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSA, "memoryssa", "Memory SSA", false, true)
+
+MemorySSA::MemorySSA() : FunctionPass(ID), AA(nullptr), DT(nullptr),
+                         F(nullptr) {
+  initializeMemorySSAPass(*PassRegistry::getPassRegistry());
+}
+
+MemorySSA::~MemorySSA() {}
+
+void MemorySSA::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+  AU.addRequiredTransitive<AliasAnalysis>();
+  AU.addRequiredTransitive<DominatorTreeWrapperPass>();
+}
+
+void MemorySSA::releaseMemory() {
+  CachedClobbers.clear();
+  PhiOfBlock.clear();
+  AccessOfInst.clear();
+  Accesses.clear();
+  LiveOnEntryDef.reset();
+  F = nullptr;
+}
+
+bool MemorySSA::runOnFunction(Function &Fn) {
+  F = &Fn;
+  AA = &getAnalysis<AliasAnalysis>();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  buildMemorySSA(Fn);
+  if (VerifyMemorySSA)
+    verifyMemorySSA();
+  return false;
+}
+
+/// renameBlock - Link the accesses in BB to the version of memory reaching
+/// them, given that IncomingVal reaches the top of BB, and add the version
+/// leaving BB to the MemoryPhis of its successors.  Returns the version
+/// leaving BB.
+MemoryAccess *MemorySSA::renameBlock(BasicBlock *BB,
+                                     MemoryAccess *IncomingVal) {
+  if (MemoryPhi *Phi = PhiOfBlock.lookup(BB))
+    IncomingVal = Phi;
+
+  for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+    MemoryUseOrDef *MA = AccessOfInst.lookup(I);
+    if (!MA)
+      continue;
+    MA->setDefiningAccess(IncomingVal);
+    if (isa<MemoryDef>(MA))
+      IncomingVal = MA;
+  }
+
+  for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI)
+    if (MemoryPhi *Phi = PhiOfBlock.lookup(*SI))
+      Phi->addIncoming(IncomingVal, BB);
+
+  return IncomingVal;
+}
+
+void MemorySSA::buildMemorySSA(Function &Fn) {
+  LiveOnEntryDef.reset(new MemoryDef(nullptr, nullptr, 0));
+
+  // Find the reachable blocks that define a new version of memory.
+  SmallVector<BasicBlock *, 32> Worklist;
+  for (Function::iterator BB = Fn.begin(), E = Fn.end(); BB != E; ++BB) {
+    if (!DT->isReachableFromEntry(BB))
+      continue;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+      if (I->mayWriteToMemory()) {
+        Worklist.push_back(BB);
+        break;
+      }
+  }
+
+  // Compute the dominance frontier of each reachable block.  A join point B
+  // is in the frontier of every block on the dominator tree path from each of
+  // its predecessors up to, but not including, the immediate dominator of B.
+  DenseMap<BasicBlock *, SmallVector<BasicBlock *, 4> > Frontier;
+  for (Function::iterator BB = Fn.begin(), E = Fn.end(); BB != E; ++BB) {
+    DomTreeNode *Node = DT->getNode(BB);
+    if (!Node || !Node->getIDom())
+      continue;
+    BasicBlock *IDom = Node->getIDom()->getBlock();
+    for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE;
+         ++PI) {
+      BasicBlock *Runner = *PI;
+      if (!DT->isReachableFromEntry(Runner))
+        continue;
+      while (Runner != IDom) {
+        SmallVectorImpl<BasicBlock *> &RunnerDF = Frontier[Runner];
+        if (RunnerDF.empty() || RunnerDF.back() != BB)
+          RunnerDF.push_back(BB);
+        Runner = DT->getNode(Runner)->getIDom()->getBlock();
+      }
+    }
+  }
+
+  // Place MemoryPhis at the iterated dominance frontier of the defining
+  // blocks.  A MemoryPhi is itself a definition, so its block is added to the
+  // worklist too.
+  SmallPtrSet<BasicBlock *, 32> PhiBlocks;
+  SmallPtrSet<BasicBlock *, 32> Queued(Worklist.begin(), Worklist.end());
+  while (!Worklist.empty()) {
+    BasicBlock *BB = Worklist.pop_back_val();
+    DenseMap<BasicBlock *, SmallVector<BasicBlock *, 4> >::iterator It =
+        Frontier.find(BB);
+    if (It == Frontier.end())
+      continue;
+    for (unsigned i = 0, e = It->second.size(); i != e; ++i) {
+      BasicBlock *Join = It->second[i];
+      if (PhiBlocks.insert(Join) && Queued.insert(Join))
+        Worklist.push_back(Join);
+    }
+  }
+
+  // Create the accesses, numbering the definitions in layout order.
+  unsigned NextID = 1;
+  for (Function::iterator BB = Fn.begin(), E = Fn.end(); BB != E; ++BB) {
+    if (PhiBlocks.count(BB)) {
+      MemoryPhi *Phi = new MemoryPhi(BB, NextID++);
+      Accesses.push_back(std::unique_ptr<MemoryAccess>(Phi));
+      PhiOfBlock[BB] = Phi;
+      ++NumMemoryPhis;
+    }
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      MemoryUseOrDef *MA;
+      if (I->mayWriteToMemory())
+        MA = new MemoryDef(I, BB, NextID++);
+      else if (I->mayReadFromMemory())
+        MA = new MemoryUse(I, BB);
+      else
+        continue;
+      Accesses.push_back(std::unique_ptr<MemoryAccess>(MA));
+      AccessOfInst[I] = MA;
+    }
+  }
+
+  // Link the accesses with a preorder walk of the dominator tree.  Each stack
+  // entry holds the version of memory leaving its block.
+  struct RenameFrame {
+    DomTreeNode *Node;
+    DomTreeNode::iterator ChildIt;
+    MemoryAccess *Outgoing;
+  };
+  SmallVector<RenameFrame, 32> Stack;
+  DomTreeNode *Root = DT->getRootNode();
+  RenameFrame RootFrame = { Root, Root->begin(),
+                            renameBlock(Root->getBlock(),
+                                        LiveOnEntryDef.get()) };
+  Stack.push_back(RootFrame);
+  while (!Stack.empty()) {
+    RenameFrame &Top = Stack.back();
+    if (Top.ChildIt == Top.Node->end()) {
+      Stack.pop_back();
+      continue;
+    }
+    DomTreeNode *Child = *Top.ChildIt++;
+    RenameFrame ChildFrame = { Child, Child->begin(),
+                               renameBlock(Child->getBlock(), Top.Outgoing) };
+    Stack.push_back(ChildFrame);
+  }
+
+  // Nothing reaches the accesses in unreachable blocks; use liveOnEntry so
+  // that every MemoryUse and MemoryDef has a defining access.
+  for (Function::iterator BB = Fn.begin(), E = Fn.end(); BB != E; ++BB) {
+    if (DT->isReachableFromEntry(BB))
+      continue;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+      if (MemoryUseOrDef *MA = AccessOfInst.lookup(I))
+        MA->setDefiningAccess(LiveOnEntryDef.get());
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Queries
+//===----------------------------------------------------------------------===//
+
+bool MemorySSA::dominates(const MemoryAccess *Dominator,
+                          const MemoryAccess *Dominatee) const {
+  if (Dominator == Dominatee || isLiveOnEntryDef(Dominator))
+    return true;
+  if (isLiveOnEntryDef(Dominatee))
+    return false;
+
+  BasicBlock *DominatorBB = Dominator->getBlock();
+  BasicBlock *DominateeBB = Dominatee->getBlock();
+  if (!DT->isReachableFromEntry(DominateeBB))
+    return true;
+  if (DominatorBB != DominateeBB)
+    return DT->dominates(DominatorBB, DominateeBB);
+
+  // Within a block, the MemoryPhi comes first and the other accesses follow
+  // the order of their instructions.
+  if (isa<MemoryPhi>(Dominator))
+    return true;
+  if (isa<MemoryPhi>(Dominatee))
+    return false;
+  const Instruction *DominateeInst =
+      cast<MemoryUseOrDef>(Dominatee)->getMemoryInst();
+  BasicBlock::const_iterator I =
+      cast<MemoryUseOrDef>(Dominator)->getMemoryInst();
+  for (BasicBlock::const_iterator E = DominatorBB->end(); I != E; ++I)
+    if (&*I == DominateeInst)
+      return true;
+  return false;
+}
+
+/// walkToClobber - Return the nearest access at or above MA that may modify
+/// Loc.  PhiState holds the MemoryPhis the walk is inside; reaching one of
+/// them again means the path went around a cycle without meeting a clobber,
+/// which says nothing about the result, and is reported by returning null.
+/// Depth is the number of MemoryPhis in PhiState.
+///
+/// A result for a MemoryPhi that relied on such a cycle through an enclosing
+/// MemoryPhi only holds if that MemoryPhi ends up with the same result, so it
+/// is not cached.  MinDepthHit is lowered to the depth of the outermost
+/// MemoryPhi the walk cycled back to, so that callers can tell.  Budget is
+/// the number of accesses the walk may still step over.
+MemoryAccess *MemorySSA::walkToClobber(MemoryAccess *MA,
+                                       const AliasAnalysis::Location &Loc,
+                                       PhiWalkStateTy &PhiState,
+                                       unsigned Depth, unsigned &MinDepthHit,
+                                       unsigned &Budget) {
+  while (true) {
+    if (isLiveOnEntryDef(MA))
+      return MA;
+
+    if (Budget == 0) {
+      ++NumWalkLimitHits;
+      return MA;
+    }
+    --Budget;
+
+    if (MemoryDef *Def = dyn_cast<MemoryDef>(MA)) {
+      if (AA->getModRefInfo(Def->getMemoryInst(), Loc) & AliasAnalysis::Mod)
+        return Def;
+      MA = Def->getDefiningAccess();
+      continue;
+    }
+
+    MemoryPhi *Phi = cast<MemoryPhi>(MA);
+    DenseMap<std::pair<MemoryAccess *, AliasAnalysis::Location>,
+             MemoryAccess *>::iterator CI =
+        CachedClobbers.find(std::make_pair(Phi, Loc));
+    if (CI != CachedClobbers.end())
+      return CI->second;
+
+    std::pair<PhiWalkStateTy::iterator, bool> Inserted =
+        PhiState.insert(std::make_pair(Phi, Depth));
+    if (!Inserted.second) {
+      MinDepthHit = std::min(MinDepthHit, Inserted.first->second);
+      return nullptr;
+    }
+
+    // The clobber above a MemoryPhi is the clobber above all of its incoming
+    // values if they agree, and the MemoryPhi itself if they don't.
+    unsigned LocalMinDepth = ~0U;
+    MemoryAccess *Result = nullptr;
+    for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i) {
+      MemoryAccess *IncomingClobber =
+          walkToClobber(Phi->getIncomingValue(i), Loc, PhiState, Depth + 1,
+                        LocalMinDepth, Budget);
+      if (!IncomingClobber || IncomingClobber == Result)
+        continue;
+      if (Result) {
+        Result = Phi;
+        break;
+      }
+      Result = IncomingClobber;
+    }
+    PhiState.erase(Phi);
+
+    // Answering with the MemoryPhi itself is always correct.
+    if (Result != Phi && LocalMinDepth < Depth) {
+      MinDepthHit = std::min(MinDepthHit, LocalMinDepth);
+      return Result;
+    }
+    if (!Result)
+      Result = Phi;
+    CachedClobbers[std::make_pair(Phi, Loc)] = Result;
+    return Result;
+  }
+}
+
+MemoryAccess *
+MemorySSA::getClobberingMemoryAccess(MemoryAccess *Start,
+                                     const AliasAnalysis::Location &Loc) {
+  ++NumClobberQueries;
+  std::pair<MemoryAccess *, AliasAnalysis::Location> Key(Start, Loc);
+  DenseMap<std::pair<MemoryAccess *, AliasAnalysis::Location>,
+           MemoryAccess *>::iterator CI = CachedClobbers.find(Key);
+  if (CI != CachedClobbers.end()) {
+    ++NumClobberCacheHits;
+    return CI->second;
+  }
+
+  PhiWalkStateTy PhiState;
+  unsigned MinDepthHit = ~0U;
+  unsigned Budget = WalkLimit;
+  MemoryAccess *Result =
+      walkToClobber(Start, Loc, PhiState, 0, MinDepthHit, Budget);
+  assert(Result && "Walk from the top level can't be tentative!");
+  CachedClobbers[Key] = Result;
+  return Result;
+}
+
+MemoryAccess *MemorySSA::getClobberingMemoryAccess(const Instruction *I) {
+  MemoryUseOrDef *MA = getMemoryAccess(I);
+  if (!MA)
+    return nullptr;
+
+  // Only simple loads and stores have a single location to look for.
+  AliasAnalysis::Location Loc;
+  if (const LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    if (!LI->isSimple())
+      return MA->getDefiningAccess();
+    Loc = AA->getLocation(LI);
+  } else if (const StoreInst *SI = dyn_cast<StoreInst>(I)) {
+    if (!SI->isSimple())
+      return MA->getDefiningAccess();
+    Loc = AA->getLocation(SI);
+  } else {
+    return MA->getDefiningAccess();
+  }
+  return getClobberingMemoryAccess(MA->getDefiningAccess(), Loc);
+}
+
+//===----------------------------------------------------------------------===//
+// Verification and printing
+//===----------------------------------------------------------------------===//
+
+static bool hasUser(const MemoryAccess *MA, const MemoryAccess *User) {
+  return std::find(MA->user_begin(), MA->user_end(), User) != MA->user_end();
+}
+
+void MemorySSA::verifyMemorySSA() const {
+  for (unsigned i = 0, e = Accesses.size(); i != e; ++i) {
+    const MemoryAccess *MA = Accesses[i].get();
+    if (const MemoryUseOrDef *UD = dyn_cast<MemoryUseOrDef>(MA)) {
+      const MemoryAccess *DMA = UD->getDefiningAccess();
+      if (!DMA || DMA == UD || !dominates(DMA, UD))
+        report_fatal_error("MemorySSA: defining access does not dominate "
+                           "its use");
+      if (!hasUser(DMA, UD))
+        report_fatal_error("MemorySSA: access missing from the users of its "
+                           "defining access");
+      continue;
+    }
+
+    // The incoming value for a predecessor has to reach the end of it.
+    const MemoryPhi *Phi = cast<MemoryPhi>(MA);
+    for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i) {
+      const MemoryAccess *In = Phi->getIncomingValue(i);
+      if (!isLiveOnEntryDef(In) &&
+          !DT->dominates(In->getBlock(), Phi->getIncomingBlock(i)))
+        report_fatal_error("MemorySSA: incoming value does not dominate the "
+                           "incoming block");
+      if (!hasUser(In, Phi))
+        report_fatal_error("MemorySSA: MemoryPhi missing from the users of "
+                           "its incoming value");
+    }
+  }
+}
+
+void MemorySSA::print(raw_ostream &OS, const Module *) const {
+  if (!F)
+    return;
+  MemorySSAAnnotatedWriter Writer(this);
+  F->print(OS, &Writer);
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWalkerPrinter
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// MemorySSAWalkerPrinter - Print the MemorySSA form together with the
+/// clobbering access of every memory instruction, for testing the walker.
+class MemorySSAWalkerPrinter : public FunctionPass {
+  const Function *F;
+  const MemorySSA *MSSA;
+  DenseMap<const Instruction *, MemoryAccess *> Clobbers;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  MemorySSAWalkerPrinter() : FunctionPass(ID), F(nullptr), MSSA(nullptr) {
+    initializeMemorySSAWalkerPrinterPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &Fn) override {
+    F = &Fn;
+    MemorySSA &M = getAnalysis<MemorySSA>();
+    MSSA = &M;
+    for (Function::iterator BB = Fn.begin(), E = Fn.end(); BB != E; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+           ++I)
+        if (MemoryAccess *Clobber = M.getClobberingMemoryAccess(I))
+          Clobbers[I] = Clobber;
+    return false;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+    AU.addRequiredTransitive<MemorySSA>();
+  }
+
+  void print(raw_ostream &OS, const Module *) const override {
+    if (!F)
+      return;
+    MemorySSAAnnotatedWriter Writer(MSSA, &Clobbers);
+    F->print(OS, &Writer);
+  }
+
+  void releaseMemory() override {
+    Clobbers.clear();
+    F = nullptr;
+  }
+};
+}
+
+char MemorySSAWalkerPrinter::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSAWalkerPrinter, "print-memoryssa-walker",
+                      "Print MemorySSA clobbering accesses", false, true)
+INITIALIZE_PASS_DEPENDENCY(MemorySSA)
+INITIALIZE_PASS_END(MemorySSAWalkerPrinter, "print-memoryssa-walker",
+                    "Print MemorySSA clobbering accesses", false, true)
@@ -98,6 +98,16 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumDepthLimitHits,
+          "Number of values left unanalyzed by the expression depth limit");
+STATISTIC(NumBECountDepthLimitHits,
+          "Number of backedge-taken counts not computed due to the depth "
+          "limit");
+STATISTIC(NumCacheCompactions, "Number of SCEV cache compactions");
+STATISTIC(NumCacheEntriesDropped,
+          "Number of SCEV cache entries dropped by compaction");
+STATISTIC(MaxFunctionMemoryKB,
+          "Largest SCEV memory use of a function, in kilobytes");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -106,6 +116,33 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+// Analyzing a value recursively analyzes its operands.  On long chains of
+// arithmetic this takes a lot of time and stack; beyond this depth the
+// operand is treated as an opaque SCEVUnknown instead.  Zero means no limit.
+static cl::opt<unsigned>
+MaxCreateDepth("scalar-evolution-max-expr-depth", cl::Hidden, cl::init(0),
+               cl::desc("Maximum depth of nested values ScalarEvolution "
+                        "analyzes at once (0 = unlimited)"));
+
+// Computing a backedge-taken count may need the counts of the loops before
+// it, so a long sequence of loops is walked recursively.  A count computed
+// while the limit cut off a nested one can be weaker, and it is cached, so
+// the results depend on the order of the queries.  Zero means no limit.
+static cl::opt<unsigned>
+MaxBECountDepth("scalar-evolution-max-trip-count-depth", cl::Hidden,
+                cl::init(0),
+                cl::desc("Maximum number of backedge-taken count computations "
+                         "ScalarEvolution nests (0 = unlimited)"));
+
+// The ranges, dispositions and values at scopes memoized for intermediate
+// expressions are never used again once the expression that needed them has
+// been built.  When these caches hold more entries than this, they are
+// compacted before the next query.  Zero disables compaction.
+static cl::opt<unsigned>
+CacheBudget("scalar-evolution-cache-budget", cl::Hidden, cl::init(0),
+            cl::desc("Compact ScalarEvolution's caches when they hold more "
+                     "than this many entries (0 = never)"));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -2843,6 +2880,10 @@ bool ScalarEvolution::checkValidity(const SCEV *S) const {
 const SCEV *ScalarEvolution::getSCEV(Value *V) {
   assert(isSCEVable(V->getType()) && "Value is not SCEVable!");
 
+  if (CacheBudget && !ActiveComputations &&
+      getNumCacheEntries() > CacheBudget)
+    compactCaches();
+
   ValueExprMapType::iterator I = ValueExprMap.find_as(V);
   if (I != ValueExprMap.end()) {
     const SCEV *S = I->second;
@@ -2851,7 +2892,19 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
     else
       ValueExprMap.erase(I);
   }
+
+  // Don't record the result of giving up, so that a query that starts closer
+  // to V can still analyze it.
+  if (MaxCreateDepth && CreateSCEVDepth >= MaxCreateDepth) {
+    ++NumDepthLimitHits;
+    return getUnknown(V);
+  }
+
+  ++ActiveComputations;
+  ++CreateSCEVDepth;
   const SCEV *S = createSCEV(V);
+  --CreateSCEVDepth;
+  --ActiveComputations;
 
   // The process of creating a SCEV for V may have caused other SCEVs
   // to have been created, so it's necessary to insert the new entry
@@ -4201,10 +4254,24 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   if (!Pair.second)
     return Pair.first->second;
 
+  // Computing a backedge-taken count may need the counts of the loops before
+  // it, to prove that the loop is entered.  Give up beyond the depth limit,
+  // without recording the result, rather than walk a long sequence of loops
+  // recursively.
+  if (MaxBECountDepth && BECountDepth >= MaxBECountDepth) {
+    ++NumBECountDepthLimitHits;
+    BackedgeTakenCounts.erase(Pair.first);
+    return UnknownBackedgeTakenInfo;
+  }
+
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
   // must be cleared in this scope.
+  ++ActiveComputations;
+  ++BECountDepth;
   BackedgeTakenInfo Result = ComputeBackedgeTakenCount(L);
+  --BECountDepth;
+  --ActiveComputations;
 
   if (Result.getExact(this) != getCouldNotCompute()) {
     assert(isLoopInvariant(Result.getExact(this), L) &&
@@ -4401,6 +4468,20 @@ bool ScalarEvolution::BackedgeTakenInfo::hasOperand(const SCEV *S,
   return false;
 }
 
+void ScalarEvolution::BackedgeTakenInfo::getCountExprs(
+    SmallVectorImpl<const SCEV *> &Exprs, ScalarEvolution *SE) const {
+  if (Max && Max != SE->getCouldNotCompute())
+    Exprs.push_back(Max);
+
+  if (!ExitNotTaken.ExitingBlock)
+    return;
+
+  for (const ExitNotTakenInfo *ENT = &ExitNotTaken;
+       ENT != nullptr; ENT = ENT->getNextExit())
+    if (ENT->ExactNotTaken != SE->getCouldNotCompute())
+      Exprs.push_back(ENT->ExactNotTaken);
+}
+
 /// Allocate memory for BackedgeTakenInfo and copy the not-taken count of each
 /// computable exit into a persistent ExitNotTakenInfo array.
 ScalarEvolution::BackedgeTakenInfo::BackedgeTakenInfo(
@@ -5250,7 +5331,9 @@ const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
   }
   Values.push_back(std::make_pair(L, static_cast<const SCEV *>(nullptr)));
   // Otherwise compute it.
+  ++ActiveComputations;
   const SCEV *C = computeSCEVAtScope(V, L);
+  --ActiveComputations;
   SmallVector<std::pair<const Loop *, const SCEV *>, 2> &Values2 = ValuesAtScopes[V];
   for (unsigned u = Values2.size(); u > 0; u--) {
     if (Values2[u - 1].first == L) {
@@ -7632,7 +7715,9 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 
 ScalarEvolution::ScalarEvolution()
   : FunctionPass(ID), ValuesAtScopes(64), LoopDispositions(64),
-    BlockDispositions(64), FirstUnknown(nullptr) {
+    BlockDispositions(64), ActiveComputations(0), CreateSCEVDepth(0),
+    BECountDepth(0),
+    FirstUnknown(nullptr) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
 
@@ -7647,6 +7732,10 @@ bool ScalarEvolution::runOnFunction(Function &F) {
 }
 
 void ScalarEvolution::releaseMemory() {
+  size_t MemoryKB = getMemoryUsage() / 1024;
+  if (MemoryKB > MaxFunctionMemoryKB)
+    MaxFunctionMemoryKB = MemoryKB;
+
   // Iterate through all the SCEVUnknown instances and call their
   // destructors, so that they release their references to their values.
   for (SCEVUnknown *U = FirstUnknown; U; U = U->Next)
@@ -7676,6 +7765,76 @@ void ScalarEvolution::releaseMemory() {
   SCEVAllocator.Reset();
 }
 
+size_t ScalarEvolution::getMemoryUsage() const {
+  // Out-of-line storage of the cached SmallVectors and ConstantRanges, and of
+  // BackedgeTakenInfos with several exits, is not counted.
+  return SCEVAllocator.getTotalMemory() + ValueExprMap.getMemorySize() +
+         BackedgeTakenCounts.getMemorySize() +
+         ConstantEvolutionLoopExitValue.getMemorySize() +
+         ValuesAtScopes.getMemorySize() + LoopDispositions.getMemorySize() +
+         BlockDispositions.getMemorySize() + UnsignedRanges.getMemorySize() +
+         SignedRanges.getMemorySize();
+}
+
+unsigned ScalarEvolution::getNumCacheEntries() const {
+  return ValuesAtScopes.size() + LoopDispositions.size() +
+         BlockDispositions.size() + UnsignedRanges.size() +
+         SignedRanges.size();
+}
+
+namespace {
+/// CollectSCEVs - Add the nodes of the expressions visited to a set.
+struct CollectSCEVs {
+  SmallPtrSetImpl<const SCEV *> &Reached;
+  CollectSCEVs(SmallPtrSetImpl<const SCEV *> &Reached) : Reached(Reached) {}
+
+  bool follow(const SCEV *S) { return Reached.insert(S); }
+  bool isDone() const { return false; }
+};
+}
+
+/// compactSCEVMap - Rebuild Map with only the entries for SCEVs in Live, so
+/// that its table shrinks too.  Returns the number of entries dropped.
+template <typename MapTy>
+static unsigned compactSCEVMap(MapTy &Map,
+                               const SmallPtrSetImpl<const SCEV *> &Live) {
+  MapTy Kept;
+  for (typename MapTy::iterator I = Map.begin(), E = Map.end(); I != E; ++I)
+    if (Live.count(I->first))
+      Kept.insert(*I);
+  unsigned Dropped = Map.size() - Kept.size();
+  Map.swap(Kept);
+  return Dropped;
+}
+
+void ScalarEvolution::compactCaches() {
+  assert(!ActiveComputations && "Compacting caches that are in use!");
+
+  SmallVector<const SCEV *, 64> Roots;
+  for (ValueExprMapType::iterator I = ValueExprMap.begin(),
+         E = ValueExprMap.end(); I != E; ++I)
+    Roots.push_back(I->second);
+  for (DenseMap<const Loop *, BackedgeTakenInfo>::iterator
+         I = BackedgeTakenCounts.begin(), E = BackedgeTakenCounts.end();
+       I != E; ++I)
+    I->second.getCountExprs(Roots, this);
+
+  SmallPtrSet<const SCEV *, 256> Live;
+  CollectSCEVs Collector(Live);
+  for (unsigned i = 0, e = Roots.size(); i != e; ++i)
+    visitAll(Roots[i], Collector);
+
+  unsigned Dropped = compactSCEVMap(ValuesAtScopes, Live) +
+                     compactSCEVMap(LoopDispositions, Live) +
+                     compactSCEVMap(BlockDispositions, Live) +
+                     compactSCEVMap(UnsignedRanges, Live) +
+                     compactSCEVMap(SignedRanges, Live);
+  ++NumCacheCompactions;
+  NumCacheEntriesDropped += Dropped;
+  DEBUG(dbgs() << "SCEV: compacted caches, dropped " << Dropped
+               << " entries\n");
+}
+
 void ScalarEvolution::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
   AU.addRequiredTransitive<LoopInfo>();
@@ -7777,7 +7936,9 @@ ScalarEvolution::getLoopDisposition(const SCEV *S, const Loop *L) {
       return Values[u].second;
   }
   Values.push_back(std::make_pair(L, LoopVariant));
+  ++ActiveComputations;
   LoopDisposition D = computeLoopDisposition(S, L);
+  --ActiveComputations;
   SmallVector<std::pair<const Loop *, LoopDisposition>, 2> &Values2 = LoopDispositions[S];
   for (unsigned u = Values2.size(); u > 0; u--) {
     if (Values2[u - 1].first == L) {
@@ -7883,7 +8044,9 @@ ScalarEvolution::getBlockDisposition(const SCEV *S, const BasicBlock *BB) {
       return Values[u].second;
   }
   Values.push_back(std::make_pair(BB, DoesNotDominateBlock));
+  ++ActiveComputations;
   BlockDisposition D = computeBlockDisposition(S, BB);
+  --ActiveComputations;
   SmallVector<std::pair<const BasicBlock *, BlockDisposition>, 2> &Values2 = BlockDispositions[S];
   for (unsigned u = Values2.size(); u > 0; u--) {
     if (Values2[u - 1].first == BB) {
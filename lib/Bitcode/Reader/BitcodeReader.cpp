@@ -69,6 +69,8 @@ void BitcodeReader::FreeState() {
   std::vector<Type*>().swap(TypeList);
   ValueList.clear();
   MDValueList.clear();
+  std::vector<LazyMDRecord>().swap(LazyMDRecords);
+  std::vector<LazyMDRecord>().swap(LazyNamedMDRecords);
   std::vector<Comdat *>().swap(ComdatList);
 
   std::vector<AttributeSet>().swap(MAttributes);
@@ -1033,6 +1035,65 @@ std::error_code BitcodeReader::ParseValueSymbolTable() {
   }
 }
 
+/// ParseMetadataValue - Create the node or string described by a
+/// METADATA_NODE, METADATA_FN_NODE or METADATA_STRING record and assign it to
+/// metadata slot ID.
+std::error_code
+BitcodeReader::ParseMetadataValue(unsigned Code,
+                                  SmallVectorImpl<uint64_t> &Record,
+                                  unsigned ID) {
+  switch (Code) {
+  default:
+    llvm_unreachable("Not a metadata value record!");
+  case bitc::METADATA_FN_NODE:
+  case bitc::METADATA_NODE: {
+    if (Record.size() % 2 == 1)
+      return Error(BitcodeError::InvalidRecord);
+
+    unsigned Size = Record.size();
+    SmallVector<Value*, 8> Elts;
+    for (unsigned i = 0; i != Size; i += 2) {
+      Type *Ty = getTypeByID(Record[i]);
+      if (!Ty)
+        return Error(BitcodeError::InvalidRecord);
+      if (Ty->isMetadataTy())
+        Elts.push_back(getMDValueFwdRef(Record[i+1]));
+      else if (!Ty->isVoidTy())
+        Elts.push_back(ValueList.getValueFwdRef(Record[i+1], Ty));
+      else
+        Elts.push_back(nullptr);
+    }
+    Value *V = MDNode::getWhenValsUnresolved(Context, Elts,
+                                             Code == bitc::METADATA_FN_NODE);
+    MDValueList.AssignValue(V, ID);
+    return std::error_code();
+  }
+  case bitc::METADATA_STRING: {
+    std::string String(Record.begin(), Record.end());
+    llvm::UpgradeMDStringConstant(String);
+    Value *V = MDString::get(Context, String);
+    MDValueList.AssignValue(V, ID);
+    return std::error_code();
+  }
+  }
+}
+
+/// ParseMetadataKind - Map the bitcode's custom MDKind ID in a METADATA_KIND
+/// record to the module's.
+std::error_code
+BitcodeReader::ParseMetadataKind(SmallVectorImpl<uint64_t> &Record) {
+  if (Record.size() < 2)
+    return Error(BitcodeError::InvalidRecord);
+
+  unsigned Kind = Record[0];
+  SmallString<8> Name(Record.begin()+1, Record.end());
+
+  unsigned NewKind = TheModule->getMDKindID(Name.str());
+  if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
+    return Error(BitcodeError::ConflictingMETADATA_KINDRecords);
+  return std::error_code();
+}
+
 std::error_code BitcodeReader::ParseMetadata() {
   unsigned NextMDValueNo = MDValueList.size();
 
@@ -1056,7 +1117,6 @@ std::error_code BitcodeReader::ParseMetadata() {
       break;
     }
 
-    bool IsFunctionLocal = false;
     // Read a record.
     Record.clear();
     unsigned Code = Stream.readRecord(Entry.ID, Record);
@@ -1077,7 +1137,7 @@ std::error_code BitcodeReader::ParseMetadata() {
       unsigned Size = Record.size();
       NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
       for (unsigned i = 0; i != Size; ++i) {
-        MDNode *MD = dyn_cast_or_null<MDNode>(MDValueList.getValueFwdRef(Record[i]));
+        MDNode *MD = dyn_cast_or_null<MDNode>(getMDValueFwdRef(Record[i]));
         if (!MD)
           return Error(BitcodeError::InvalidRecord);
         NMD->addOperand(MD);
@@ -1085,51 +1145,131 @@ std::error_code BitcodeReader::ParseMetadata() {
       break;
     }
     case bitc::METADATA_FN_NODE:
-      IsFunctionLocal = true;
-      // fall-through
-    case bitc::METADATA_NODE: {
-      if (Record.size() % 2 == 1)
-        return Error(BitcodeError::InvalidRecord);
+    case bitc::METADATA_NODE:
+    case bitc::METADATA_STRING:
+      if (std::error_code EC = ParseMetadataValue(Code, Record,
+                                                  NextMDValueNo++))
+        return EC;
+      break;
+    case bitc::METADATA_KIND:
+      if (std::error_code EC = ParseMetadataKind(Record))
+        return EC;
+      break;
+    }
+  }
+}
 
-      unsigned Size = Record.size();
-      SmallVector<Value*, 8> Elts;
-      for (unsigned i = 0; i != Size; i += 2) {
-        Type *Ty = getTypeByID(Record[i]);
-        if (!Ty)
-          return Error(BitcodeError::InvalidRecord);
-        if (Ty->isMetadataTy())
-          Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
-        else if (!Ty->isVoidTy())
-          Elts.push_back(ValueList.getValueFwdRef(Record[i+1], Ty));
-        else
-          Elts.push_back(nullptr);
+/// IndexMetadata - Record where each node, string and named metadata record
+/// of the module-level METADATA_BLOCK at the current position lives, without
+/// creating any metadata.  Kind records are still processed eagerly because
+/// instruction attachments need them.  If any record was deferred,
+/// MDIndexCursor is left inside the block.
+std::error_code BitcodeReader::IndexMetadata() {
+  bool Deferred = false;
+  unsigned NextMDValueNo = MDValueList.size();
+
+  BitstreamCursor Cursor = Stream;
+  if (Cursor.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+    return Error(BitcodeError::InvalidRecord);
+
+  SmallVector<uint64_t, 64> Record;
+  while (1) {
+    // Don't pop the block at its end: deferred records are read back through
+    // this cursor and need the block's abbreviations.
+    BitstreamEntry Entry =
+        Cursor.advanceSkippingSubblocks(BitstreamCursor::AF_DontPopBlockAtEnd);
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error(BitcodeError::MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      if (Deferred) {
+        MDIndexCursor = Cursor;
+        HasLazyMetadataBlock = true;
+        // Make room for every module-level ID so that function-local metadata
+        // is numbered after them.
+        if (MDValueList.size() < NextMDValueNo)
+          MDValueList.resize(NextMDValueNo);
       }
-      Value *V = MDNode::getWhenValsUnresolved(Context, Elts, IsFunctionLocal);
-      IsFunctionLocal = false;
-      MDValueList.AssignValue(V, NextMDValueNo++);
+      // Step the main stream over the block.
+      if (Stream.SkipBlock())
+        return Error(BitcodeError::MalformedBlock);
+      return std::error_code();
+    case BitstreamEntry::Record:
       break;
     }
-    case bitc::METADATA_STRING: {
-      std::string String(Record.begin(), Record.end());
-      llvm::UpgradeMDStringConstant(String);
-      Value *V = MDString::get(Context, String);
-      MDValueList.AssignValue(V, NextMDValueNo++);
+
+    uint64_t BitNo = Cursor.GetCurrentBitNo();
+    Record.clear();
+    unsigned Code = Cursor.readRecord(Entry.ID, Record);
+    switch (Code) {
+    default:  // Default behavior: ignore.
+      break;
+    case bitc::METADATA_NAME: {
+      LazyNamedMDRecords.push_back(LazyMDRecord(BitNo, Entry.ID));
+      Deferred = true;
+      // METADATA_NAME is always followed by METADATA_NAMED_NODE.
+      Cursor.skipRecord(Cursor.ReadCode());
       break;
     }
-    case bitc::METADATA_KIND: {
-      if (Record.size() < 2)
-        return Error(BitcodeError::InvalidRecord);
+    case bitc::METADATA_FN_NODE:
+    case bitc::METADATA_NODE:
+    case bitc::METADATA_STRING:
+      if (LazyMDRecords.size() <= NextMDValueNo)
+        LazyMDRecords.resize(NextMDValueNo + 1);
+      LazyMDRecords[NextMDValueNo++] = LazyMDRecord(BitNo, Entry.ID);
+      Deferred = true;
+      break;
+    case bitc::METADATA_KIND:
+      if (std::error_code EC = ParseMetadataKind(Record))
+        return EC;
+      break;
+    }
+  }
+}
+
+/// getMDValueFwdRef - Return the metadata with the specified ID, creating a
+/// placeholder if it has not been read yet.  If the ID names a deferred
+/// module-level record, it is loaded (along with anything it references)
+/// before returning, unless a lazy load is already in progress, in which case
+/// it is queued.
+Value *BitcodeReader::getMDValueFwdRef(unsigned ID) {
+  bool NeedsLoad = ID < LazyMDRecords.size() && LazyMDRecords[ID].BitNo &&
+                   !MDValueList[ID];
+  Value *V = MDValueList.getValueFwdRef(ID);
+  if (!NeedsLoad)
+    return V;
+
+  PendingMDLoads.push_back(ID);
+  if (IsLoadingLazyMetadata)
+    return V;
+  if (loadPendingMetadata())
+    return nullptr;
+  return MDValueList[ID];
+}
 
-      unsigned Kind = Record[0];
-      SmallString<8> Name(Record.begin()+1, Record.end());
+/// loadPendingMetadata - Parse the deferred records for every queued
+/// placeholder, including any deferred records they in turn reference.
+std::error_code BitcodeReader::loadPendingMetadata() {
+  assert(!IsLoadingLazyMetadata && "Recursive lazy metadata load");
+  IsLoadingLazyMetadata = true;
 
-      unsigned NewKind = TheModule->getMDKindID(Name.str());
-      if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
-        return Error(BitcodeError::ConflictingMETADATA_KINDRecords);
+  std::error_code EC;
+  SmallVector<uint64_t, 64> Record;
+  while (!PendingMDLoads.empty()) {
+    unsigned ID = PendingMDLoads.pop_back_val();
+    LazyMDRecord R = LazyMDRecords[ID];
+    MDIndexCursor.JumpToBit(R.BitNo);
+    Record.clear();
+    unsigned Code = MDIndexCursor.readRecord(R.AbbrevID, Record);
+    if ((EC = ParseMetadataValue(Code, Record, ID)))
       break;
-    }
-    }
   }
+
+  PendingMDLoads.clear();
+  IsLoadingLazyMetadata = false;
+  return EC;
 }
 
 /// decodeSignRotatedValue - Decode a signed value stored with the sign bit in
@@ -1822,6 +1962,13 @@ std::error_code BitcodeReader::ParseModule(bool Resume) {
           return EC;
         break;
       case bitc::METADATA_BLOCK_ID:
+        // Only one block can be deferred, since MDIndexCursor stays inside
+        // it.  The writer puts all module-level nodes in a single block.
+        if (LazyLoadMetadata && !HasLazyMetadataBlock) {
+          if (std::error_code EC = IndexMetadata())
+            return EC;
+          break;
+        }
         if (std::error_code EC = ParseMetadata())
           return EC;
         break;
@@ -2299,8 +2446,10 @@ std::error_code BitcodeReader::ParseMetadataAttachment() {
           MDKindMap.find(Kind);
         if (I == MDKindMap.end())
           return Error(BitcodeError::InvalidID);
-        Value *Node = MDValueList.getValueFwdRef(Record[i+1]);
-        Inst->setMetadata(I->second, cast<MDNode>(Node));
+        MDNode *Node = dyn_cast_or_null<MDNode>(getMDValueFwdRef(Record[i+1]));
+        if (!Node)
+          return Error(BitcodeError::InvalidRecord);
+        Inst->setMetadata(I->second, Node);
         if (I->second == LLVMContext::MD_tbaa)
           InstsWithTBAATag.push_back(Inst);
       }
@@ -2449,8 +2598,16 @@ std::error_code BitcodeReader::ParseFunctionBody(Function *F) {
       unsigned ScopeID = Record[2], IAID = Record[3];
 
       MDNode *Scope = nullptr, *IA = nullptr;
-      if (ScopeID) Scope = cast<MDNode>(MDValueList.getValueFwdRef(ScopeID-1));
-      if (IAID)    IA = cast<MDNode>(MDValueList.getValueFwdRef(IAID-1));
+      if (ScopeID) {
+        Scope = dyn_cast_or_null<MDNode>(getMDValueFwdRef(ScopeID-1));
+        if (!Scope)
+          return Error(BitcodeError::InvalidRecord);
+      }
+      if (IAID) {
+        IA = dyn_cast_or_null<MDNode>(getMDValueFwdRef(IAID-1));
+        if (!IA)
+          return Error(BitcodeError::InvalidRecord);
+      }
       LastLoc = DebugLoc::get(Line, Col, Scope, IA);
       I->setDebugLoc(LastLoc);
       I = nullptr;
@@ -3348,10 +3505,40 @@ void BitcodeReader::Dematerialize(GlobalValue *GV) {
   F->deleteBody();
 }
 
+std::error_code BitcodeReader::materializeMetadata() {
+  SmallVector<uint64_t, 64> Record;
+  for (const LazyMDRecord &R : LazyNamedMDRecords) {
+    MDIndexCursor.JumpToBit(R.BitNo);
+    Record.clear();
+    unsigned Code = MDIndexCursor.readRecord(R.AbbrevID, Record);
+    assert(Code == bitc::METADATA_NAME && "Expected a named metadata record");
+    (void)Code;
+    SmallString<8> Name(Record.begin(), Record.end());
+
+    // METADATA_NAME is always followed by METADATA_NAMED_NODE.
+    Record.clear();
+    Code = MDIndexCursor.readRecord(MDIndexCursor.ReadCode(), Record);
+    assert(Code == bitc::METADATA_NAMED_NODE); (void)Code;
+
+    NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
+    for (unsigned i = 0, e = Record.size(); i != e; ++i) {
+      MDNode *MD = dyn_cast_or_null<MDNode>(getMDValueFwdRef(Record[i]));
+      if (!MD)
+        return Error(BitcodeError::InvalidRecord);
+      NMD->addOperand(MD);
+    }
+  }
+  LazyNamedMDRecords.clear();
+  return std::error_code();
+}
+
 std::error_code BitcodeReader::MaterializeModule(Module *M) {
   assert(M == TheModule &&
          "Can only Materialize the Module this BitcodeReader is attached to.");
 
+  if (std::error_code EC = materializeMetadata())
+    return EC;
+
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
@@ -3519,11 +3706,16 @@ const std::error_category &llvm::BitcodeErrorCategory() {
 ///
 /// \param[in] WillMaterializeAll Set to \c true if the caller promises to
 /// materialize everything -- in particular, if this isn't truly lazy.
+///
+/// \param[in] ShouldLazyLoadMetadata Set to \c true to index module-level
+/// metadata rather than parse it.
 static ErrorOr<Module *>
 getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &Buffer,
-                         LLVMContext &Context, bool WillMaterializeAll) {
+                         LLVMContext &Context, bool WillMaterializeAll,
+                         bool ShouldLazyLoadMetadata = false) {
   Module *M = new Module(Buffer->getBufferIdentifier(), Context);
   BitcodeReader *R = new BitcodeReader(Buffer.get(), Context);
+  R->setLazyLoadMetadata(ShouldLazyLoadMetadata);
   M->setMaterializer(R);
 
   auto cleanupOnError = [&](std::error_code EC) {
@@ -3546,8 +3738,9 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &Buffer,
 
 ErrorOr<Module *>
 llvm::getLazyBitcodeModule(std::unique_ptr<MemoryBuffer> &Buffer,
-                           LLVMContext &Context) {
-  return getLazyBitcodeModuleImpl(Buffer, Context, false);
+                           LLVMContext &Context, bool ShouldLazyLoadMetadata) {
+  return getLazyBitcodeModuleImpl(Buffer, Context, false,
+                                  ShouldLazyLoadMetadata);
 }
 
 Module *llvm::getStreamedBitcodeModule(const std::string &name,
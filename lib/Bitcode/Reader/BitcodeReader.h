@@ -140,6 +140,40 @@ class BitcodeReader : public GVMaterializer {
   std::vector<Comdat *> ComdatList;
   SmallVector<Instruction *, 64> InstructionList;
 
+  /// Location of a module-level metadata record whose parsing has been
+  /// deferred: the bit just past its abbreviation ID, and the abbreviation ID
+  /// itself.  A BitNo of zero means the record was not deferred.
+  struct LazyMDRecord {
+    uint64_t BitNo;
+    unsigned AbbrevID;
+    LazyMDRecord() : BitNo(0), AbbrevID(0) {}
+    LazyMDRecord(uint64_t BitNo, unsigned AbbrevID)
+        : BitNo(BitNo), AbbrevID(AbbrevID) {}
+  };
+
+  /// True if module-level metadata should be indexed rather than parsed, and
+  /// only materialized when something references it.
+  bool LazyLoadMetadata;
+
+  /// Cursor left inside the module-level METADATA_BLOCK when metadata is
+  /// loaded lazily, so that the block's abbreviations stay in scope for
+  /// deferred records.
+  BitstreamCursor MDIndexCursor;
+
+  /// Deferred metadata node and string records, indexed by metadata ID.
+  std::vector<LazyMDRecord> LazyMDRecords;
+
+  /// Deferred METADATA_NAME records, each followed by a METADATA_NAMED_NODE.
+  std::vector<LazyMDRecord> LazyNamedMDRecords;
+
+  /// Metadata IDs that have a placeholder but whose record is not loaded yet.
+  SmallVector<unsigned, 16> PendingMDLoads;
+  bool IsLoadingLazyMetadata;
+
+  /// True once a METADATA_BLOCK has been deferred; any later ones are parsed
+  /// eagerly.
+  bool HasLazyMetadataBlock;
+
   std::vector<std::pair<GlobalVariable*, unsigned> > GlobalInits;
   std::vector<std::pair<GlobalAlias*, unsigned> > AliasInits;
   std::vector<std::pair<Function*, unsigned> > FunctionPrefixes;
@@ -208,13 +242,15 @@ public:
   explicit BitcodeReader(MemoryBuffer *buffer, LLVMContext &C)
       : Context(C), TheModule(nullptr), Buffer(buffer), LazyStreamer(nullptr),
         NextUnreadBit(0), SeenValueSymbolTable(false), ValueList(C),
-        MDValueList(C), SeenFirstFunctionBody(false), UseRelativeIDs(false),
-        WillMaterializeAllForwardRefs(false) {}
+        MDValueList(C), LazyLoadMetadata(false), IsLoadingLazyMetadata(false),
+        HasLazyMetadataBlock(false), SeenFirstFunctionBody(false),
+        UseRelativeIDs(false), WillMaterializeAllForwardRefs(false) {}
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
       : Context(C), TheModule(nullptr), Buffer(nullptr), LazyStreamer(streamer),
         NextUnreadBit(0), SeenValueSymbolTable(false), ValueList(C),
-        MDValueList(C), SeenFirstFunctionBody(false), UseRelativeIDs(false),
-        WillMaterializeAllForwardRefs(false) {}
+        MDValueList(C), LazyLoadMetadata(false), IsLoadingLazyMetadata(false),
+        HasLazyMetadataBlock(false), SeenFirstFunctionBody(false),
+        UseRelativeIDs(false), WillMaterializeAllForwardRefs(false) {}
   ~BitcodeReader() { FreeState(); }
 
   std::error_code materializeForwardReferencedFunctions();
@@ -227,8 +263,14 @@ public:
   bool isDematerializable(const GlobalValue *GV) const override;
   std::error_code Materialize(GlobalValue *GV) override;
   std::error_code MaterializeModule(Module *M) override;
+  std::error_code materializeMetadata() override;
   void Dematerialize(GlobalValue *GV) override;
 
+  /// Index module-level metadata instead of parsing it, and materialize
+  /// individual records only when they are referenced.  Must be called before
+  /// ParseBitcodeInto.
+  void setLazyLoadMetadata(bool Lazy) { LazyLoadMetadata = Lazy; }
+
   /// @brief Main interface to parsing a bitcode buffer.
   /// @returns true if an error occurred.
   std::error_code ParseBitcodeInto(Module *M);
@@ -243,13 +285,14 @@ private:
   Type *getTypeByID(unsigned ID);
   Value *getFnValueByID(unsigned ID, Type *Ty) {
     if (Ty && Ty->isMetadataTy())
-      return MDValueList.getValueFwdRef(ID);
+      return getMDValueFwdRef(ID);
     return ValueList.getValueFwdRef(ID, Ty);
   }
   BasicBlock *getBasicBlock(unsigned ID) const {
     if (ID >= FunctionBBs.size()) return nullptr; // Invalid ID
     return FunctionBBs[ID];
   }
+  Value *getMDValueFwdRef(unsigned ID);
   AttributeSet getAttributes(unsigned i) const {
     if (i-1 < MAttributes.size())
       return MAttributes[i-1];
@@ -336,6 +379,12 @@ private:
   std::error_code GlobalCleanup();
   std::error_code ResolveGlobalAndAliasInits();
   std::error_code ParseMetadata();
+  std::error_code ParseMetadataValue(unsigned Code,
+                                     SmallVectorImpl<uint64_t> &Record,
+                                     unsigned ID);
+  std::error_code ParseMetadataKind(SmallVectorImpl<uint64_t> &Record);
+  std::error_code IndexMetadata();
+  std::error_code loadPendingMetadata();
   std::error_code ParseMetadataAttachment();
   ErrorOr<std::string> parseModuleTriple();
   std::error_code ParseUseLists();
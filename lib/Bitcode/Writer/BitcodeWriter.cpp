@@ -19,6 +19,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
@@ -29,10 +30,16 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cctype>
 #include <map>
 using namespace llvm;
 
+static cl::opt<bool>
+TuneAbbrevs("bitcode-tune-abbrevs", cl::Hidden, cl::init(false),
+            cl::desc("Pick the operand widths of the standard bitcode "
+                     "abbreviations from per-module statistics"));
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -1709,8 +1716,131 @@ static void WriteFunction(const Function &F, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+namespace {
+/// VBR chunk widths used for the variable-sized operands of the standard
+/// abbreviations.  The defaults are the historical hard-coded widths.
+struct AbbrevOperandWidths {
+  unsigned ConstInteger;
+  unsigned LoadPtr;
+  unsigned BinopLHS;
+  unsigned BinopRHS;
+  unsigned CastOp;
+  unsigned RetVal;
+
+  AbbrevOperandWidths()
+      : ConstInteger(8), LoadPtr(6), BinopLHS(6), BinopRHS(6), CastOp(6),
+        RetVal(6) {}
+};
+
+/// Histogram of the number of significant bits in the values written for one
+/// abbreviated operand.
+class OperandWidthHistogram {
+  uint64_t Counts[65];
+
+public:
+  OperandWidthHistogram() { std::fill(Counts, Counts + 65, 0); }
+
+  void add(uint64_t V) { ++Counts[V ? Log2_64(V) + 1 : 0]; }
+
+  /// Return the VBR chunk width that encodes the recorded values in the
+  /// fewest bits, or Default if nothing was recorded or it is as good.
+  unsigned getBestVBRWidth(unsigned Default) const {
+    unsigned Best = Default;
+    uint64_t BestCost = getVBRCost(Default);
+    for (unsigned Width = 2; Width <= 32; ++Width) {
+      uint64_t Cost = getVBRCost(Width);
+      if (Cost < BestCost) {
+        Best = Width;
+        BestCost = Cost;
+      }
+    }
+    return Best;
+  }
+
+private:
+  uint64_t getVBRCost(unsigned Width) const {
+    uint64_t Cost = 0;
+    for (unsigned Bits = 0; Bits != 65; ++Bits) {
+      uint64_t Chunks = std::max(1u, (Bits + Width - 2) / (Width - 1));
+      Cost += Counts[Bits] * Chunks * Width;
+    }
+    return Cost;
+  }
+};
+} // end anonymous namespace
+
+/// tuneAbbrevOperandWidths - Walk the module the way the writer will and
+/// record the values that end up in the variable-width operands of the
+/// standard abbreviations, then pick the cheapest VBR width for each.  The
+/// abbreviations are self-describing, so readers need no changes.
+static AbbrevOperandWidths tuneAbbrevOperandWidths(const Module &M,
+                                                   ValueEnumerator &VE) {
+  OperandWidthHistogram ConstInteger, LoadPtr, BinopLHS, BinopRHS, CastOp,
+      RetVal;
+
+  auto addConstants = [&](unsigned FirstVal, unsigned LastVal) {
+    const ValueEnumerator::ValueList &Vals = VE.getValues();
+    for (unsigned i = FirstVal; i != LastVal; ++i) {
+      const ConstantInt *IV = dyn_cast<ConstantInt>(Vals[i].first);
+      if (!IV || IV->isNullValue() || IV->getBitWidth() > 64)
+        continue;
+      // Same sign-rotated encoding as emitSignedInt64.
+      uint64_t V = IV->getSExtValue();
+      ConstInteger.add((int64_t)V >= 0 ? V << 1 : (-V << 1) | 1);
+    }
+  };
+  addConstants(0, VE.getValues().size());
+
+  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    VE.incorporateFunction(*F);
+
+    unsigned CstStart, CstEnd;
+    VE.getFunctionConstantRange(CstStart, CstEnd);
+    addConstants(CstStart, CstEnd);
+
+    // Mirror the relative operand encoding in WriteInstruction.  Operands
+    // that are forward references never use the abbreviations.
+    unsigned InstID = CstEnd;
+    for (const_inst_iterator I = inst_begin(*F), IE = inst_end(*F); I != IE;
+         ++I) {
+      const Value *Op0 = I->getNumOperands() ? I->getOperand(0) : nullptr;
+      if (Op0 && VE.getValueID(Op0) < InstID) {
+        unsigned Rel0 = InstID - VE.getValueID(Op0);
+        if (isa<CastInst>(*I)) {
+          CastOp.add(Rel0);
+        } else if (isa<BinaryOperator>(*I)) {
+          BinopLHS.add(Rel0);
+          BinopRHS.add(InstID - VE.getValueID(I->getOperand(1)));
+        } else if (const LoadInst *LI = dyn_cast<LoadInst>(&*I)) {
+          if (!LI->isAtomic())
+            LoadPtr.add(Rel0);
+        } else if (isa<ReturnInst>(*I) && I->getNumOperands() == 1) {
+          RetVal.add(Rel0);
+        }
+      }
+
+      if (!I->getType()->isVoidTy())
+        ++InstID;
+    }
+    VE.purgeFunction();
+  }
+
+  AbbrevOperandWidths Widths;
+  Widths.ConstInteger = ConstInteger.getBestVBRWidth(Widths.ConstInteger);
+  Widths.LoadPtr = LoadPtr.getBestVBRWidth(Widths.LoadPtr);
+  Widths.BinopLHS = BinopLHS.getBestVBRWidth(Widths.BinopLHS);
+  Widths.BinopRHS = BinopRHS.getBestVBRWidth(Widths.BinopRHS);
+  Widths.CastOp = CastOp.getBestVBRWidth(Widths.CastOp);
+  Widths.RetVal = RetVal.getBestVBRWidth(Widths.RetVal);
+  return Widths;
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
-static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
+static void WriteBlockInfo(const ValueEnumerator &VE,
+                           const AbbrevOperandWidths &Widths,
+                           BitstreamWriter &Stream) {
   // We only want to emit block info records for blocks that have multiple
   // instances: CONSTANTS_BLOCK, FUNCTION_BLOCK and VALUE_SYMTAB_BLOCK.
   // Other blocks can define their abbrevs inline.
@@ -1773,7 +1903,7 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   { // INTEGER abbrev for CONSTANTS_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::CST_CODE_INTEGER));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.ConstInteger));
     if (Stream.EmitBlockInfoAbbrev(bitc::CONSTANTS_BLOCK_ID,
                                    Abbv) != CONSTANTS_INTEGER_ABBREV)
       llvm_unreachable("Unexpected abbrev ordering!");
@@ -1804,7 +1934,7 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   { // INST_LOAD abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_LOAD));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Ptr
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.LoadPtr)); // Ptr
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 4)); // Align
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1)); // volatile
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
@@ -1814,8 +1944,8 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   { // INST_BINOP abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_BINOP));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // LHS
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // RHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.BinopLHS)); // LHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.BinopRHS)); // RHS
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 4)); // opc
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
                                    Abbv) != FUNCTION_INST_BINOP_ABBREV)
@@ -1824,8 +1954,8 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   { // INST_BINOP_FLAGS abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_BINOP));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // LHS
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // RHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.BinopLHS)); // LHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.BinopRHS)); // RHS
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 4)); // opc
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 7)); // flags
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
@@ -1835,7 +1965,7 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   { // INST_CAST abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_CAST));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));    // OpVal
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.CastOp)); // OpVal
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed,       // dest ty
                               Log2_32_Ceil(VE.getTypes().size()+1)));
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 4));  // opc
@@ -1854,7 +1984,7 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   { // INST_RET abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_RET));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // ValID
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Widths.RetVal)); // ValID
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
                                    Abbv) != FUNCTION_INST_RET_VAL_ABBREV)
       llvm_unreachable("Unexpected abbrev ordering!");
@@ -1883,7 +2013,10 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   ValueEnumerator VE(M);
 
   // Emit blockinfo, which defines the standard abbreviations etc.
-  WriteBlockInfo(VE, Stream);
+  AbbrevOperandWidths Widths;
+  if (TuneAbbrevs)
+    Widths = tuneAbbrevOperandWidths(*M, VE);
+  WriteBlockInfo(VE, Widths, Stream);
 
   // Emit information about attribute groups.
   WriteAttributeGroupTable(VE, Stream);
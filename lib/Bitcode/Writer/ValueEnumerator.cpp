@@ -651,8 +651,9 @@ void ValueEnumerator::EnumerateOperandType(const Value *V) {
 
   if (const Constant *C = dyn_cast<Constant>(V)) {
     // If this constant is already enumerated, ignore it, we know its type must
-    // be enumerated.
-    if (ValueMap.count(V)) return;
+    // be enumerated.  Constants that share operands would otherwise be walked
+    // once per path to them.
+    if (ValueMap.count(V) || !OperandTypesEnumerated.insert(C)) return;
 
     // This constant may have operands, make sure to enumerate the types in
     // them.
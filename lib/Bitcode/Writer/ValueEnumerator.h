@@ -15,6 +15,7 @@
 #define LLVM_LIB_BITCODE_WRITER_VALUEENUMERATOR_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/UniqueVector.h"
 #include "llvm/IR/Attributes.h"
@@ -25,6 +26,7 @@ namespace llvm {
 
 class Type;
 class Value;
+class Constant;
 class Instruction;
 class BasicBlock;
 class Comdat;
@@ -55,6 +57,9 @@ private:
   ValueMapType ValueMap;
   ValueList Values;
 
+  /// The constants not enumerated yet whose operand types have been.
+  SmallPtrSet<const Constant *, 16> OperandTypesEnumerated;
+
   typedef UniqueVector<const Comdat *> ComdatSetType;
   ComdatSetType Comdats;
 
@@ -117,6 +117,11 @@ public:
                               unsigned Index) const override;
   unsigned getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
                            unsigned AddressSpace) const override;
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor,
+                                      ArrayRef<unsigned> Indices,
+                                      unsigned Alignment,
+                                      unsigned AddressSpace) const override;
   unsigned getIntrinsicInstrCost(Intrinsic::ID, Type *RetTy,
                                  ArrayRef<Type*> Tys) const override;
   unsigned getNumberOfParts(Type *Tp) const override;
@@ -533,6 +538,65 @@ unsigned BasicTTI::getMemoryOpCost(unsigned Opcode, Type *Src,
   return Cost;
 }
 
+unsigned BasicTTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const {
+  VectorType *VT = dyn_cast<VectorType>(VecTy);
+  assert(VT && "Expect a vector type for interleaved memory op");
+
+  unsigned NumElts = VT->getNumElements();
+  assert(Factor > 1 && NumElts % Factor == 0 && "Invalid interleave factor");
+
+  unsigned NumSubElts = NumElts / Factor;
+  VectorType *SubVT = VectorType::get(VT->getElementType(), NumSubElts);
+
+  // Firstly, the cost of load/store operation.
+  unsigned Cost = TopTTI->getMemoryOpCost(Opcode, VecTy, Alignment,
+                                          AddressSpace);
+
+  // Then plus the cost of interleave operation.  Without a better idea of
+  // what the target does with the shuffles, assume each of them is split up
+  // into element extracts and inserts.
+  if (Opcode == Instruction::Load) {
+    // The interleave cost is similar to extract sub vectors' elements
+    // from the wide vector, and insert them into sub vectors.
+    //
+    // E.g. An interleaved load of factor 2 (with one member of index 0):
+    //      %vec = load <8 x i32>, <8 x i32>* %ptr
+    //      %v0 = shuffle %vec, undef, <0, 2, 4, 6>         ; Index 0
+    // The cost is estimated as extract elements at 0, 2, 4, 6 from the
+    // <8 x i32> vector and insert them into a <4 x i32> vector.
+    for (unsigned Index : Indices) {
+      assert(Index < Factor && "Invalid index for interleaved memory op");
+      for (unsigned i = 0; i < NumSubElts; i++) {
+        Cost += TopTTI->getVectorInstrCost(Instruction::ExtractElement, VT,
+                                           Index + i * Factor);
+        Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement, SubVT,
+                                           i);
+      }
+    }
+    return Cost;
+  }
+
+  // The interleave cost is extract all elements from sub vectors, and
+  // insert them into the wide vector.
+  //
+  // E.g. An interleaved store of factor 2:
+  //      %v0_v1 = shuffle %v0, %v1, <0, 4, 1, 5, 2, 6, 3, 7>
+  //      store <8 x i32> %interleaved.vec, <8 x i32>* %ptr
+  // The cost is estimated as extract all elements from both <4 x i32>
+  // vectors and insert into the <8 x i32> vector.
+  for (unsigned i = 0; i < NumSubElts; i++)
+    Cost += Factor * TopTTI->getVectorInstrCost(Instruction::ExtractElement,
+                                                SubVT, i);
+  for (unsigned i = 0; i < NumElts; i++)
+    Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement, VT, i);
+
+  return Cost;
+}
+
 unsigned BasicTTI::getIntrinsicInstrCost(Intrinsic::ID IID, Type *RetTy,
                                          ArrayRef<Type *> Tys) const {
   unsigned ISD = 0;
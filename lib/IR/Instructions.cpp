@@ -106,7 +106,7 @@ Use *PHINode::allocHungoffUses(unsigned N) const {
   Use *Begin = static_cast<Use*>(::operator new(size));
   Use *End = Begin + N;
   (void) new(End) Use::UserRef(const_cast<PHINode*>(this), 1);
-  return Use::initTags(Begin, End);
+  return Use::initTags(Begin, End, const_cast<PHINode*>(this));
 }
 
 // removeIncomingValue - Remove an incoming value.  This is useful if a
@@ -190,23 +190,62 @@ struct FunctionTypeKeyInfo {
   }
 };
 
-// Provide a FoldingSetTrait::Equals specialization for MDNode that can use a
-// shortcut to avoid comparing all operands.
-template<> struct FoldingSetTrait<MDNode> : DefaultFoldingSetTrait<MDNode> {
-  static bool Equals(const MDNode &X, const FoldingSetNodeID &ID,
-                     unsigned IDHash, FoldingSetNodeID &TempID) {
-    assert(!X.isNotUniqued() && "Non-uniqued MDNode in FoldingSet?");
-    // First, check if the cached hashes match.  If they don't we can skip the
-    // expensive operand walk.
-    if (X.Hash != IDHash)
-      return false;
+/// MDNodeKeyInfo - DenseMapInfo for uniqued MDNodes.
+///
+/// The hash of a node is the sum of the hashes of its (position, operand)
+/// pairs.  This lets MDNode::replaceOperand update the hash of a node in
+/// constant time rather than rehashing every operand, which is what makes
+/// resolving forward references in large debug info graphs expensive.  Nodes
+/// cache their hash, so lookups only walk the operands on a hash match.
+struct MDNodeKeyInfo {
+  struct KeyTy {
+    ArrayRef<Value *> Ops;
+    const MDNode *N;
+    unsigned Hash;
+    KeyTy(ArrayRef<Value *> Ops)
+        : Ops(Ops), N(nullptr), Hash(calculateHash(Ops)) {}
+    KeyTy(const MDNode *N) : N(N), Hash(N->Hash) {}
+    unsigned getNumOperands() const {
+      return N ? N->getNumOperands() : Ops.size();
+    }
+    Value *getOperand(unsigned I) const {
+      return N ? N->getOperand(I) : Ops[I];
+    }
+  };
+
+  static unsigned getOperandHash(unsigned I, const Value *V) {
+    return hash_combine(I, V);
+  }
+  static unsigned calculateHash(ArrayRef<Value *> Ops) {
+    unsigned Hash = 0;
+    for (unsigned I = 0, E = Ops.size(); I != E; ++I)
+      Hash += getOperandHash(I, Ops[I]);
+    return Hash;
+  }
 
-    // If they match we have to compare the operands.
-    X.Profile(TempID);
-    return TempID == ID;
+  static inline MDNode *getEmptyKey() {
+    return DenseMapInfo<MDNode *>::getEmptyKey();
   }
-  static unsigned ComputeHash(const MDNode &X, FoldingSetNodeID &) {
-    return X.Hash; // Return cached hash.
+  static inline MDNode *getTombstoneKey() {
+    return DenseMapInfo<MDNode *>::getTombstoneKey();
+  }
+  static unsigned getHashValue(const KeyTy &Key) { return Key.Hash; }
+  static unsigned getHashValue(const MDNode *N) { return N->Hash; }
+  static bool isEqual(const KeyTy &LHS, const MDNode *RHS) {
+    if (RHS == getEmptyKey() || RHS == getTombstoneKey())
+      return false;
+    if (LHS.N == RHS)
+      return true;
+    if (LHS.Hash != RHS->Hash ||
+        LHS.getNumOperands() != RHS->getNumOperands())
+      return false;
+    for (unsigned I = 0, E = RHS->getNumOperands(); I != E; ++I)
+      if (LHS.getOperand(I) != RHS->getOperand(I))
+        return false;
+    return true;
+  }
+  static bool isEqual(const MDNode *LHS, const MDNode *RHS) {
+    return LHS == RHS;
   }
 };
 
@@ -262,7 +301,8 @@ public:
 
   StringMap<Value*> MDStringCache;
 
-  FoldingSet<MDNode> MDNodeSet;
+  typedef DenseMap<MDNode *, bool, MDNodeKeyInfo> MDNodeMapTy;
+  MDNodeMapTy MDNodeSet;
 
   // MDNodes may be uniqued or not uniqued.  When they're not uniqued, they
   // aren't in the MDNodeSet, but they're still shared between objects, so no
@@ -1545,8 +1545,10 @@ bool FPPassManager::runOnFunction(Function &F) {
     }
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(FP, MODIFICATION_MSG, ON_FUNCTION_MSG, F.getName());
+      TPM->getChangeTracker().functionChanged(F);
+    }
     dumpPreservedSet(FP);
 
     verifyPreservedAnalysis(FP);
@@ -1579,7 +1581,10 @@ bool FPPassManager::doFinalization(Module &M) {
   bool Changed = false;
 
   for (int Index = getNumContainedPasses() - 1; Index >= 0; --Index)
-    Changed |= getContainedPass(Index)->doFinalization(M);
+    if (getContainedPass(Index)->doFinalization(M)) {
+      TPM->getChangeTracker().moduleChanged();
+      Changed = true;
+    }
 
   return Changed;
 }
@@ -1606,6 +1611,9 @@ MPPassManager::runOnModule(Module &M) {
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index)
     Changed |= getContainedPass(Index)->doInitialization(M);
 
+  if (Changed)
+    TPM->getChangeTracker().moduleChanged();
+
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
     ModulePass *MP = getContainedPass(Index);
     bool LocalChanged = false;
@@ -1623,9 +1631,14 @@ MPPassManager::runOnModule(Module &M) {
     }
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(MP, MODIFICATION_MSG, ON_MODULE_MSG,
                    M.getModuleIdentifier());
+      // Nested pass managers report the changes made by their own passes at
+      // a finer granularity; anything else may have touched the whole module.
+      if (!MP->getAsPMDataManager())
+        TPM->getChangeTracker().moduleChanged();
+    }
     dumpPreservedSet(MP);
 
     verifyPreservedAnalysis(MP);
@@ -1636,7 +1649,10 @@ MPPassManager::runOnModule(Module &M) {
 
   // Finalize module passes
   for (int Index = getNumContainedPasses() - 1; Index >= 0; --Index)
-    Changed |= getContainedPass(Index)->doFinalization(M);
+    if (getContainedPass(Index)->doFinalization(M)) {
+      TPM->getChangeTracker().moduleChanged();
+      Changed = true;
+    }
 
   // Finalize on-the-fly passes
   for (std::map<Pass *, FunctionPassManagerImpl *>::iterator
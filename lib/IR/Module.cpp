@@ -413,6 +413,12 @@ std::error_code Module::materializeAll() {
   return Materializer->MaterializeModule(this);
 }
 
+std::error_code Module::materializeMetadata() {
+  if (!Materializer)
+    return std::error_code();
+  return Materializer->materializeMetadata();
+}
+
 std::error_code Module::materializeAllPermanently() {
   if (std::error_code EC = materializeAll())
     return EC;
@@ -38,12 +38,14 @@ void Use::swap(Use &RHS) {
   }
 }
 
+#if !LLVM_ENABLE_USE_USER_POINTERS
 User *Use::getUser() const {
   const Use *End = getImpliedUser();
   const UserRef *ref = reinterpret_cast<const UserRef *>(End);
   return ref->getInt() ? ref->getPointer()
                        : reinterpret_cast<User *>(const_cast<Use *>(End));
 }
+#endif
 
 unsigned Use::getOperandNo() const {
   return this - getUser()->op_begin();
@@ -84,6 +86,15 @@ Use *Use::initTags(Use *const Start, Use *Stop) {
   return Start;
 }
 
+Use *Use::initTags(Use *Start, Use *Stop, User *U) {
+  initTags(Start, Stop);
+#if LLVM_ENABLE_USE_USER_POINTERS
+  for (Use *I = Start; I != Stop; ++I)
+    I->Parent = U;
+#endif
+  return Start;
+}
+
 void Use::zap(Use *Start, const Use *Stop, bool del) {
   while (Start != Stop)
     (--Stop)->~Use();
@@ -49,7 +49,7 @@ Use *User::allocHungoffUses(unsigned N) const {
   Use *Begin = static_cast<Use*>(::operator new(size));
   Use *End = Begin + N;
   (void) new(End) Use::UserRef(const_cast<User*>(this), 1);
-  return Use::initTags(Begin, End);
+  return Use::initTags(Begin, End, const_cast<User*>(this));
 }
 
 //===----------------------------------------------------------------------===//
@@ -63,7 +63,7 @@ void *User::operator new(size_t s, unsigned Us) {
   User *Obj = reinterpret_cast<User*>(End);
   Obj->OperandList = Start;
   Obj->NumOperands = Us;
-  Use::initTags(Start, End);
+  Use::initTags(Start, End, Obj);
   return Obj;
 }
 
@@ -50,6 +50,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/CallSite.h"
@@ -65,6 +66,7 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
@@ -77,8 +79,29 @@
 #include <cstdarg>
 using namespace llvm;
 
+#define DEBUG_TYPE "verify"
+
+STATISTIC(NumFunctionsVerified, "Number of functions verified");
+STATISTIC(NumFunctionsSkipped,
+          "Number of unmodified functions skipped by incremental verification");
+
 static cl::opt<bool> VerifyDebugInfo("verify-debug-info", cl::init(false));
 
+static cl::opt<bool> VerifyIncremental(
+    "verify-incremental", cl::init(false),
+    cl::desc("Only re-verify functions that a pass has reported as modified "
+             "since they were last verified"));
+
+/// \brief Return the change tracker of the pass manager running \p P if
+/// incremental verification is enabled, or null otherwise.
+static PMChangeTracker *getIncrementalTracker(Pass &P) {
+  if (!VerifyIncremental || !P.getResolver())
+    return nullptr;
+  PMTopLevelManager *TPM =
+      P.getResolver()->getPMDataManager().getTopLevelManager();
+  return TPM ? &TPM->getChangeTracker() : nullptr;
+}
+
 namespace {
 struct VerifierSupport {
   raw_ostream &OS;
@@ -2639,15 +2662,34 @@ struct VerifierLegacyPass : public FunctionPass {
   }
 
   bool runOnFunction(Function &F) override {
-    if (!V.verify(F) && FatalErrors)
-      report_fatal_error("Broken function found, compilation aborted!");
+    PMChangeTracker *Tracker = getIncrementalTracker(*this);
+    if (Tracker && Tracker->isVerified(F)) {
+      ++NumFunctionsSkipped;
+      return false;
+    }
+
+    ++NumFunctionsVerified;
+    if (!V.verify(F)) {
+      if (FatalErrors)
+        report_fatal_error("Broken function found, compilation aborted!");
+    } else if (Tracker) {
+      Tracker->markVerified(F);
+    }
 
     return false;
   }
 
   bool doFinalization(Module &M) override {
-    if (!V.verify(M) && FatalErrors)
-      report_fatal_error("Broken module found, compilation aborted!");
+    PMChangeTracker *Tracker = getIncrementalTracker(*this);
+    if (Tracker && Tracker->isModuleVerified(&ID))
+      return false;
+
+    if (!V.verify(M)) {
+      if (FatalErrors)
+        report_fatal_error("Broken module found, compilation aborted!");
+    } else if (Tracker) {
+      Tracker->markModuleVerified(&ID);
+    }
 
     return false;
   }
@@ -2671,8 +2713,16 @@ struct DebugInfoVerifierLegacyPass : public ModulePass {
   }
 
   bool runOnModule(Module &M) override {
-    if (!V.verify(M) && FatalErrors)
-      report_fatal_error("Broken debug info found, compilation aborted!");
+    PMChangeTracker *Tracker = getIncrementalTracker(*this);
+    if (Tracker && Tracker->isModuleVerified(&ID))
+      return false;
+
+    if (!V.verify(M)) {
+      if (FatalErrors)
+        report_fatal_error("Broken debug info found, compilation aborted!");
+    } else if (Tracker) {
+      Tracker->markModuleVerified(&ID);
+    }
 
     return false;
   }
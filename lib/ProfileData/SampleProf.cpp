@@ -0,0 +1,77 @@
+//=-- SampleProf.cpp - Sample profiling format support --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains common definitions used in the reading and writing of
+// sample profile data.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::sampleprof;
+
+namespace {
+class SampleProfErrorCategoryType : public std::error_category {
+  const char *name() const LLVM_NOEXCEPT override { return "llvm.sampleprof"; }
+  std::string message(int IE) const override {
+    sampleprof_error E = static_cast<sampleprof_error>(IE);
+    switch (E) {
+    case sampleprof_error::success:
+      return "Success";
+    case sampleprof_error::bad_magic:
+      return "Invalid file format (bad magic)";
+    case sampleprof_error::unsupported_version:
+      return "Unsupported format version";
+    case sampleprof_error::unsupported_hash_type:
+      return "Unsupported hash function";
+    case sampleprof_error::truncated:
+      return "Truncated profile data";
+    case sampleprof_error::malformed:
+      return "Malformed profile data";
+    }
+    llvm_unreachable("A value of sampleprof_error has no message.");
+  }
+};
+}
+
+const std::error_category &llvm::sampleprof_category() {
+  static SampleProfErrorCategoryType C;
+  return C;
+}
+
+/// \brief Print the samples collected for a function on stream \p OS.
+///
+/// The lines are printed in order of line offset and discriminator, so the
+/// output does not depend on how the samples were stored.
+void FunctionSamples::print(raw_ostream &OS) const {
+  OS << TotalSamples << ", " << TotalHeadSamples << ", " << BodySamples.size()
+     << " sampled lines\n";
+  std::vector<std::pair<std::pair<int, unsigned>, unsigned>> Lines;
+  Lines.reserve(BodySamples.size());
+  for (const auto &I : BodySamples)
+    Lines.push_back(std::make_pair(
+        std::make_pair(I.first.LineOffset, I.first.Discriminator), I.second));
+  std::sort(Lines.begin(), Lines.end());
+  for (const auto &L : Lines)
+    OS << "\tline offset: " << L.first.first
+       << ", discriminator: " << L.first.second
+       << ", number of samples: " << L.second << "\n";
+  OS << "\n";
+}
+
+void FunctionSamples::merge(const FunctionSamples &Other) {
+  addTotalSamples(Other.TotalSamples);
+  addHeadSamples(Other.TotalHeadSamples);
+  for (const auto &I : Other.BodySamples)
+    addBodySamples(I.first.LineOffset, I.first.Discriminator, I.second);
+}
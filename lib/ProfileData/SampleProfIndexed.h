@@ -0,0 +1,72 @@
+//=-- SampleProfIndexed.h - Indexed sample profile format ---------*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Shared header for the binary sample profile reader and writer.
+//
+// A binary sample profile starts with a header of four little-endian 64-bit
+// words: the magic number, the format version, the hash function used by the
+// index, and the offset of the index's bucket table.  The rest of the file is
+// an on-disk hash table keyed by function name.  The data for each function is
+// a sequence of little-endian 32-bit words: its total samples, its head
+// samples and its number of sampled lines, followed by a (line offset,
+// discriminator, samples) triple for each line.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_PROFILEDATA_SAMPLEPROFINDEXED_H
+#define LLVM_LIB_PROFILEDATA_SAMPLEPROFINDEXED_H
+
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MD5.h"
+
+namespace llvm {
+
+namespace IndexedSampleProf {
+enum class HashT : uint32_t {
+  MD5,
+
+  Last = MD5
+};
+
+static inline uint64_t MD5Hash(StringRef Str) {
+  MD5 Hash;
+  Hash.update(Str);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  // Return the least significant 8 bytes. Our MD5 implementation returns the
+  // result in little endian, so we may need to swap bytes.
+  using namespace llvm::support;
+  return endian::read<uint64_t, little, unaligned>(Result);
+}
+
+static inline uint64_t ComputeHash(HashT Type, StringRef K) {
+  switch (Type) {
+  case HashT::MD5:
+    return IndexedSampleProf::MD5Hash(K);
+  }
+  llvm_unreachable("Unhandled hash type");
+}
+
+const uint64_t Magic = 0x8173666f72706cff; // "\xfflprofs\x81"
+const uint64_t Version = 1;
+const HashT HashType = HashT::MD5;
+
+/// The size of the header, in bytes.
+const uint64_t HeaderSize = 4 * sizeof(uint64_t);
+
+/// The size of the fixed part of a function's data, in bytes.
+const uint64_t FunctionHeaderSize = 3 * sizeof(uint32_t);
+
+/// The size of the data for each sampled line, in bytes.
+const uint64_t LineSize = 3 * sizeof(uint32_t);
+}
+
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,440 @@
+//=-- SampleProfReader.cpp - Read sample profiles ---------------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the class that reads sample profiles, in either the
+// text or the binary format.  Every error is reported as a
+// DiagnosticInfoSampleProfile on the reader's context, and returned as an
+// error code.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+#include "SampleProfIndexed.h"
+
+using namespace llvm;
+using namespace llvm::sampleprof;
+
+/// \brief Print the function profile for \p FName on stream \p OS.
+///
+/// \param OS Stream to emit the output to.
+/// \param FName Name of the function to print.
+void SampleProfileReader::printFunctionProfile(raw_ostream &OS,
+                                               StringRef FName) {
+  OS << "Function: " << FName << ": ";
+  Profiles[FName].print(OS);
+}
+
+/// \brief Print all the function profiles read so far on stream \p OS, in
+/// order of function name.
+void SampleProfileReader::print(raw_ostream &OS) {
+  std::vector<StringRef> Names;
+  Names.reserve(Profiles.size());
+  for (StringMap<FunctionSamples>::const_iterator I = Profiles.begin(),
+                                                  E = Profiles.end();
+       I != E; ++I)
+    Names.push_back(I->getKey());
+  std::sort(Names.begin(), Names.end());
+  for (StringRef Name : Names)
+    printFunctionProfile(OS, Name);
+}
+
+/// \brief Dump all the function profiles read so far.
+void SampleProfileReader::dump() { print(dbgs()); }
+
+void SampleProfileReader::reportParseError(int64_t LineNumber,
+                                           Twine Msg) const {
+  Ctx.diagnose(DiagnosticInfoSampleProfile(Buffer->getBufferIdentifier(),
+                                           LineNumber, Msg));
+}
+
+/// \brief Consume a non-empty sequence of decimal digits from the front of
+/// \p S and store its value in \p Result.
+///
+/// \returns true if \p S did not start with a number that fits in an
+/// unsigned.
+static bool consumeUnsigned(StringRef &S, unsigned &Result) {
+  size_t Len = 0;
+  while (Len < S.size() && isdigit(S[Len]))
+    ++Len;
+  if (Len == 0 || S.substr(0, Len).getAsInteger(10, Result))
+    return true;
+  S = S.substr(Len);
+  return false;
+}
+
+/// \brief Parse a function header: 'mangled_name:NUM:NUM'.
+///
+/// Note that for function identifiers we are actually expecting
+/// mangled names, but we may not always get them. This happens when
+/// the compiler decides not to emit the function (e.g., it was inlined
+/// and removed). In this case, the binary will not have the linkage
+/// name for the function, so the profiler will emit the function's
+/// unmangled name, which may contain characters like ':' and '>' in its
+/// name (member functions, templates, etc).
+///
+/// The only requirement we place on the identifier, then, is that it
+/// should not begin with a number.
+///
+/// \returns true if \p Line is not a valid function header.
+static bool parseFunctionHeader(StringRef Line, StringRef &FName,
+                                unsigned &NumSamples,
+                                unsigned &NumHeadSamples) {
+  size_t HeadPos = Line.rfind(':');
+  if (HeadPos == StringRef::npos)
+    return true;
+  size_t TotalPos = Line.rfind(':', HeadPos);
+  if (TotalPos == StringRef::npos || TotalPos == 0 || isdigit(Line[0]))
+    return true;
+
+  FName = Line.substr(0, TotalPos);
+  StringRef Total = Line.slice(TotalPos + 1, HeadPos);
+  StringRef Head = Line.substr(HeadPos + 1);
+  return consumeUnsigned(Total, NumSamples) || !Total.empty() ||
+         consumeUnsigned(Head, NumHeadSamples) || !Head.empty();
+}
+
+/// \brief Parse a sampled line: 'NUM[.NUM]: NUM[ mangled_name:NUM]*'.
+///
+/// \returns true if \p Line is not a valid sampled line.
+static bool parseSampleLine(StringRef Line, unsigned &LineOffset,
+                            unsigned &Discriminator, unsigned &NumSamples) {
+  Discriminator = 0;
+  if (consumeUnsigned(Line, LineOffset))
+    return true;
+  if (Line.startswith(".")) {
+    Line = Line.substr(1);
+    if (!Line.empty() && isdigit(Line[0]) &&
+        consumeUnsigned(Line, Discriminator))
+      return true;
+  }
+  if (!Line.startswith(": "))
+    return true;
+  Line = Line.substr(2);
+
+  // FIXME: Handle called targets (in the rest of the line).
+  return consumeUnsigned(Line, NumSamples);
+}
+
+/// \brief Load samples from a text file.
+///
+/// The file contains a list of samples for every function executed at
+/// runtime. Each function profile has the following format:
+///
+///    function1:total_samples:total_head_samples
+///    offset1[.discriminator]: number_of_samples [fn1:num fn2:num ... ]
+///    offset2[.discriminator]: number_of_samples [fn3:num fn4:num ... ]
+///    ...
+///    offsetN[.discriminator]: number_of_samples [fn5:num fn6:num ... ]
+///
+/// Function names must be mangled in order for the profile loader to
+/// match them in the current translation unit. The two numbers in the
+/// function header specify how many total samples were accumulated in
+/// the function (first number), and the total number of samples accumulated
+/// at the prologue of the function (second number). This head sample
+/// count provides an indicator of how frequent is the function invoked.
+///
+/// Each sampled line may contain several items. Some are optional
+/// (marked below):
+///
+/// a- Source line offset. This number represents the line number
+///    in the function where the sample was collected. The line number
+///    is always relative to the line where symbol of the function
+///    is defined. So, if the function has its header at line 280,
+///    the offset 13 is at line 293 in the file.
+///
+/// b- [OPTIONAL] Discriminator. This is used if the sampled program
+///    was compiled with DWARF discriminator support
+///    (http://wiki.dwarfstd.org/index.php?title=Path_Discriminators)
+///
+/// c- Number of samples. This is the number of samples collected by
+///    the profiler at this source location.
+///
+/// d- [OPTIONAL] Potential call targets and samples. If present, this
+///    line contains a call instruction. This models both direct and
+///    indirect calls. Each called target is listed together with the
+///    number of samples. For example,
+///
+///    130: 7  foo:3  bar:2  baz:7
+///
+///    The above means that at relative line offset 130 there is a
+///    call instruction that calls one of foo(), bar() and baz(). With
+///    baz() being the relatively more frequent call target.
+///
+///    FIXME: This is currently unhandled, but it has a lot of
+///           potential for aiding the inliner.
+///
+///
+/// Since this is a flat profile, a function that shows up more than
+/// once gets all its samples aggregated across all its instances.
+///
+/// FIXME: flat profiles are too imprecise to provide good optimization
+///        opportunities. Convert them to context-sensitive profile.
+///
+/// This textual representation is useful to generate unit tests and
+/// for debugging purposes, but it should not be used to generate
+/// profiles for large programs, as the representation is extremely
+/// inefficient.  Use llvm-profdata to convert it to the binary format.
+///
+/// \returns sampleprof_error::success if the file was loaded successfully.
+std::error_code SampleProfileReaderText::readHeader() {
+  line_iterator LineIt(*Buffer, '#');
+
+  // Read the profile of each function. Since each function may be
+  // mentioned more than once, and we are collecting flat profiles,
+  // accumulate samples as we parse them.
+  while (!LineIt.is_at_eof()) {
+    // Read the header of each function.
+    StringRef FName;
+    unsigned NumSamples, NumHeadSamples;
+    if (parseFunctionHeader(*LineIt, FName, NumSamples, NumHeadSamples)) {
+      reportParseError(LineIt.line_number(),
+                       "Expected 'mangled_name:NUM:NUM', found " + *LineIt);
+      return sampleprof_error::malformed;
+    }
+    FunctionSamples &FProfile = Profiles[FName];
+    FProfile.addTotalSamples(NumSamples);
+    FProfile.addHeadSamples(NumHeadSamples);
+    ++LineIt;
+
+    // Now read the body. The body of the function ends when we reach
+    // EOF or when we see the start of the next function.
+    while (!LineIt.is_at_eof() && isdigit((*LineIt)[0])) {
+      unsigned LineOffset, Discriminator, NumSamples;
+      if (parseSampleLine(*LineIt, LineOffset, Discriminator, NumSamples)) {
+        reportParseError(
+            LineIt.line_number(),
+            "Expected 'NUM[.NUM]: NUM[ mangled_name:NUM]*', found " + *LineIt);
+        return sampleprof_error::malformed;
+      }
+
+      // When dealing with instruction weights, we use the value
+      // zero to indicate the absence of a sample. If we read an
+      // actual zero from the profile file, return it as 1 to
+      // avoid the confusion later on.
+      if (NumSamples == 0)
+        NumSamples = 1;
+      FProfile.addBodySamples(LineOffset, Discriminator, NumSamples);
+      ++LineIt;
+    }
+  }
+
+  return sampleprof_error::success;
+}
+
+SampleProfLookupTrait::hash_value_type
+SampleProfLookupTrait::ComputeHash(StringRef K) {
+  return IndexedSampleProf::ComputeHash(HashType, K);
+}
+
+bool SampleProfileReaderBinary::hasFormat(const MemoryBuffer &Buffer) {
+  if (Buffer.getBufferSize() < 8)
+    return false;
+  using namespace support;
+  uint64_t Magic =
+      endian::read<uint64_t, little, aligned>(Buffer.getBufferStart());
+  return Magic == IndexedSampleProf::Magic;
+}
+
+/// \brief Check that every bucket and entry of the on-disk hash table lies
+/// within the file.
+///
+/// The entries are stored bucket by bucket between \p Payload and the bucket
+/// table at \p Buckets.  Each bucket's item count, and each entry's hash,
+/// lengths, key and data, must end before the bucket table; together the
+/// buckets must hold \p NumEntries entries.  Each non-empty slot of the
+/// bucket table must be the offset from \p Base of one of those buckets.
+/// After this, neither lookups nor iteration read outside the buffer.
+static std::error_code validateIndex(const unsigned char *Base,
+                                     const unsigned char *Payload,
+                                     const unsigned char *Buckets,
+                                     uint64_t NumBuckets,
+                                     uint64_t NumEntries) {
+  using namespace support;
+  typedef SampleProfLookupTrait::offset_type offset_type;
+  typedef SampleProfLookupTrait::hash_value_type hash_value_type;
+  const uint64_t ItemHeaderSize =
+      sizeof(hash_value_type) + 2 * sizeof(offset_type);
+
+  // Walk the payload the way the data iterator does, recording where each
+  // bucket starts.  The buckets are written in order, so the offsets are
+  // sorted.
+  std::vector<uint64_t> BucketOffsets;
+  const unsigned char *Cur = Payload;
+  uint64_t NumItems = 0;
+  while (NumItems < NumEntries) {
+    if ((uint64_t)(Buckets - Cur) < sizeof(uint16_t))
+      return sampleprof_error::truncated;
+    BucketOffsets.push_back(Cur - Base);
+    uint16_t Len = endian::readNext<uint16_t, little, unaligned>(Cur);
+    if (Len == 0 || Len > NumEntries - NumItems)
+      return sampleprof_error::malformed;
+    NumItems += Len;
+    for (uint16_t I = 0; I != Len; ++I) {
+      if ((uint64_t)(Buckets - Cur) < ItemHeaderSize)
+        return sampleprof_error::truncated;
+      Cur += sizeof(hash_value_type);
+      std::pair<offset_type, offset_type> L =
+          SampleProfLookupTrait::ReadKeyDataLength(Cur);
+      uint64_t Left = Buckets - Cur;
+      if (L.first > Left || L.second > Left - L.first)
+        return sampleprof_error::truncated;
+      Cur += L.first + L.second;
+    }
+  }
+
+  const unsigned char *Slot = Buckets + 2 * sizeof(offset_type);
+  for (uint64_t I = 0; I != NumBuckets; ++I) {
+    offset_type Offset = endian::readNext<offset_type, little, unaligned>(Slot);
+    if (Offset && !std::binary_search(BucketOffsets.begin(),
+                                      BucketOffsets.end(), Offset))
+      return sampleprof_error::malformed;
+  }
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderBinary::readHeader() {
+  const unsigned char *Start =
+      (const unsigned char *)Buffer->getBufferStart();
+  const unsigned char *Cur = Start;
+  uint64_t Size = Buffer->getBufferSize();
+  std::error_code EC;
+  if (Size < IndexedSampleProf::HeaderSize)
+    EC = sampleprof_error::truncated;
+
+  using namespace support;
+  uint64_t HashType = 0, HashOffset = 0;
+  if (!EC) {
+    // Check the magic number and the version.
+    uint64_t Magic = endian::readNext<uint64_t, little, unaligned>(Cur);
+    uint64_t Version = endian::readNext<uint64_t, little, unaligned>(Cur);
+    HashType = endian::readNext<uint64_t, little, unaligned>(Cur);
+    HashOffset = endian::readNext<uint64_t, little, unaligned>(Cur);
+    if (Magic != IndexedSampleProf::Magic)
+      EC = sampleprof_error::bad_magic;
+    else if (Version > IndexedSampleProf::Version)
+      EC = sampleprof_error::unsupported_version;
+    else if (HashType > static_cast<uint64_t>(IndexedSampleProf::HashT::Last))
+      EC = sampleprof_error::unsupported_hash_type;
+    else if (HashOffset < IndexedSampleProf::HeaderSize || HashOffset % 4 ||
+             HashOffset > Size || Size - HashOffset < 2 * sizeof(uint64_t))
+      EC = sampleprof_error::truncated;
+  }
+
+  if (!EC) {
+    // The bucket table starts with the number of buckets, which must be a
+    // power of two, and the number of entries.
+    const unsigned char *Buckets = Start + HashOffset;
+    uint64_t NumBuckets = endian::read<uint64_t, little, unaligned>(Buckets);
+    if (NumBuckets == 0 || (NumBuckets & (NumBuckets - 1)))
+      EC = sampleprof_error::malformed;
+    else if ((Size - HashOffset) / sizeof(uint64_t) - 2 < NumBuckets)
+      EC = sampleprof_error::truncated;
+    else
+      EC = validateIndex(
+          Start, Cur, Buckets, NumBuckets,
+          endian::read<uint64_t, little, unaligned>(Buckets + sizeof(uint64_t)));
+  }
+
+  if (EC) {
+    reportParseError(0, EC.message());
+    return EC;
+  }
+
+  // The rest of the file is an on disk hash table.
+  Index.reset(SampleProfReaderIndex::Create(
+      Start + HashOffset, Cur, Start,
+      SampleProfLookupTrait(static_cast<IndexedSampleProf::HashT>(HashType))));
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderBinary::readFunction(
+    const SampleProfLookupTrait::data_type &Data, FunctionSamples &Samples) {
+  using namespace support;
+  const unsigned char *Cur = Data.Data;
+  if (Data.Size < IndexedSampleProf::FunctionHeaderSize)
+    return sampleprof_error::malformed;
+  uint32_t NumSamples = endian::readNext<uint32_t, little, unaligned>(Cur);
+  uint32_t NumHeadSamples = endian::readNext<uint32_t, little, unaligned>(Cur);
+  uint32_t NumLines = endian::readNext<uint32_t, little, unaligned>(Cur);
+  if (Data.Size != IndexedSampleProf::FunctionHeaderSize +
+                       NumLines * IndexedSampleProf::LineSize)
+    return sampleprof_error::malformed;
+
+  Samples.addTotalSamples(NumSamples);
+  Samples.addHeadSamples(NumHeadSamples);
+  for (uint32_t I = 0; I != NumLines; ++I) {
+    uint32_t LineOffset = endian::readNext<uint32_t, little, unaligned>(Cur);
+    uint32_t Discriminator = endian::readNext<uint32_t, little, unaligned>(Cur);
+    uint32_t LineSamples = endian::readNext<uint32_t, little, unaligned>(Cur);
+    if (LineOffset > INT32_MAX)
+      return sampleprof_error::malformed;
+    Samples.addBodySamples(LineOffset, Discriminator, LineSamples);
+  }
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderBinary::read() {
+  for (const auto &Data : Index->data()) {
+    if (Profiles.count(Data.Name))
+      continue;
+    if (std::error_code EC = readFunction(Data, Profiles[Data.Name])) {
+      reportParseError(0, Data.Name + ": " + EC.message());
+      return EC;
+    }
+  }
+  return sampleprof_error::success;
+}
+
+FunctionSamples *SampleProfileReaderBinary::getSamplesFor(StringRef FName) {
+  auto I = Profiles.find(FName);
+  if (I != Profiles.end())
+    return &I->second;
+
+  auto Data = Index->find(FName);
+  if (Data == Index->end())
+    return nullptr;
+
+  FunctionSamples &Samples = Profiles[FName];
+  if (std::error_code EC = readFunction(*Data, Samples)) {
+    reportParseError(0, FName + ": " + EC.message());
+    Profiles.erase(FName);
+    return nullptr;
+  }
+  return &Samples;
+}
+
+std::error_code
+SampleProfileReader::create(StringRef Filename,
+                            std::unique_ptr<SampleProfileReader> &Result,
+                            LLVMContext &C) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFileOrSTDIN(Filename);
+  if (std::error_code EC = BufferOrErr.getError()) {
+    std::string Name(Filename), Msg(EC.message());
+    C.diagnose(DiagnosticInfoSampleProfile(Name.c_str(), Msg));
+    return EC;
+  }
+
+  std::unique_ptr<MemoryBuffer> Buffer = std::move(BufferOrErr.get());
+  if (SampleProfileReaderBinary::hasFormat(*Buffer))
+    Result.reset(new SampleProfileReaderBinary(std::move(Buffer), C));
+  else
+    Result.reset(new SampleProfileReaderText(std::move(Buffer), C));
+
+  return Result->readHeader();
+}
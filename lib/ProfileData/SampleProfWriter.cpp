@@ -0,0 +1,141 @@
+//=-- SampleProfWriter.cpp - Write sample profiles --------------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the class that writes sample profiles, in either the
+// text or the binary format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/OnDiskHashTable.h"
+#include <algorithm>
+#include <vector>
+
+#include "SampleProfIndexed.h"
+
+using namespace llvm;
+using namespace llvm::sampleprof;
+
+namespace {
+/// A sampled line: its line offset and discriminator, and its samples.
+typedef std::pair<std::pair<int, unsigned>, unsigned> SampledLine;
+
+/// Return the sampled lines of \p Samples sorted by location.
+std::vector<SampledLine> getSortedLines(const FunctionSamples &Samples) {
+  std::vector<SampledLine> Lines;
+  Lines.reserve(Samples.getBodySamples().size());
+  for (const auto &I : Samples.getBodySamples())
+    Lines.push_back(std::make_pair(
+        std::make_pair(I.first.LineOffset, I.first.Discriminator), I.second));
+  std::sort(Lines.begin(), Lines.end());
+  return Lines;
+}
+
+class SampleProfRecordTrait {
+public:
+  typedef StringRef key_type;
+  typedef StringRef key_type_ref;
+
+  typedef const FunctionSamples *data_type;
+  typedef const FunctionSamples *data_type_ref;
+
+  typedef uint64_t hash_value_type;
+  typedef uint64_t offset_type;
+
+  static hash_value_type ComputeHash(key_type_ref K) {
+    return IndexedSampleProf::ComputeHash(IndexedSampleProf::HashType, K);
+  }
+
+  static std::pair<offset_type, offset_type>
+  EmitKeyDataLength(raw_ostream &Out, key_type_ref K, data_type_ref V) {
+    using namespace llvm::support;
+    endian::Writer<little> LE(Out);
+
+    offset_type N = K.size();
+    LE.write<offset_type>(N);
+
+    offset_type M = IndexedSampleProf::FunctionHeaderSize +
+                    V->getBodySamples().size() * IndexedSampleProf::LineSize;
+    LE.write<offset_type>(M);
+
+    return std::make_pair(N, M);
+  }
+
+  static void EmitKey(raw_ostream &Out, key_type_ref K, offset_type N) {
+    Out.write(K.data(), N);
+  }
+
+  static void EmitData(raw_ostream &Out, key_type_ref, data_type_ref V,
+                       offset_type) {
+    using namespace llvm::support;
+    endian::Writer<little> LE(Out);
+
+    LE.write<uint32_t>(V->getTotalSamples());
+    LE.write<uint32_t>(V->getHeadSamples());
+    LE.write<uint32_t>(V->getBodySamples().size());
+    for (const SampledLine &L : getSortedLines(*V)) {
+      LE.write<uint32_t>(L.first.first);
+      LE.write<uint32_t>(L.first.second);
+      LE.write<uint32_t>(L.second);
+    }
+  }
+};
+}
+
+void SampleProfileWriter::addFunctionSamples(StringRef FName,
+                                             const FunctionSamples &Samples) {
+  Profiles[FName].merge(Samples);
+}
+
+void SampleProfileWriter::writeText(raw_ostream &OS) {
+  std::vector<StringRef> Names;
+  Names.reserve(Profiles.size());
+  for (const auto &I : Profiles)
+    Names.push_back(I.getKey());
+  std::sort(Names.begin(), Names.end());
+
+  for (StringRef Name : Names) {
+    const FunctionSamples &Samples = Profiles.find(Name)->getValue();
+    OS << Name << ":" << Samples.getTotalSamples() << ":"
+       << Samples.getHeadSamples() << "\n";
+    for (const SampledLine &L : getSortedLines(Samples)) {
+      OS << L.first.first;
+      if (L.first.second)
+        OS << "." << L.first.second;
+      OS << ": " << L.second << "\n";
+    }
+  }
+}
+
+void SampleProfileWriter::writeBinary(raw_fd_ostream &OS) {
+  OnDiskChainedHashTableGenerator<SampleProfRecordTrait> Generator;
+
+  // Populate the hash table generator.
+  for (const auto &I : Profiles)
+    Generator.insert(I.getKey(), &I.getValue());
+
+  using namespace llvm::support;
+  endian::Writer<little> LE(OS);
+
+  // Write the header.
+  LE.write<uint64_t>(IndexedSampleProf::Magic);
+  LE.write<uint64_t>(IndexedSampleProf::Version);
+  LE.write<uint64_t>(static_cast<uint64_t>(IndexedSampleProf::HashType));
+
+  // Save a space to write the hash table start location.
+  uint64_t HashTableStartLoc = OS.tell();
+  LE.write<uint64_t>(0);
+  // Write the hash table.
+  uint64_t HashTableStart = Generator.Emit(OS);
+
+  // Go back and fill in the hash table start.
+  OS.seek(HashTableStartLoc);
+  LE.write<uint64_t>(HashTableStart);
+}
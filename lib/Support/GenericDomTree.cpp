@@ -0,0 +1,25 @@
+//===- GenericDomTree.cpp - Generic dominator tree options ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the command line options shared by all instantiations of
+// the generic dominator tree construction in GenericDomTreeConstruction.h.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/GenericDomTree.h"
+using namespace llvm;
+
+/// DomTreeUseSemiNCA - Build dominator trees with Semi-NCA.
+bool llvm::DomTreeUseSemiNCA = false;
+
+static cl::opt<bool, true>
+UseSemiNCA("dom-tree-semi-nca", cl::Hidden, cl::location(DomTreeUseSemiNCA),
+           cl::desc("Build dominator trees with the Semi-NCA algorithm "
+                    "instead of Lengauer-Tarjan"));
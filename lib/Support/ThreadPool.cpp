@@ -0,0 +1,104 @@
+//===-- llvm/Support/ThreadPool.cpp - A pool of worker threads ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+
+using namespace llvm;
+
+unsigned ThreadPool::getHardwareThreadCount() {
+#if LLVM_ENABLE_THREADS
+  if (unsigned N = std::thread::hardware_concurrency())
+    return N;
+#endif
+  return 1;
+}
+
+#if LLVM_ENABLE_THREADS
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : ThreadCount(ThreadCount ? ThreadCount : getHardwareThreadCount()),
+      ActiveTasks(0), Stopping(false) {
+  Threads.reserve(this->ThreadCount);
+  for (unsigned i = 0; i != this->ThreadCount; ++i)
+    Threads.push_back(std::thread(&ThreadPool::runWorker, this));
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    std::unique_lock<std::mutex> Lock(QueueLock);
+    Stopping = true;
+  }
+  QueueCondition.notify_all();
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    Threads[i].join();
+}
+
+void ThreadPool::runWorker() {
+  while (true) {
+    TaskTy Task;
+    {
+      std::unique_lock<std::mutex> Lock(QueueLock);
+      while (!Stopping && Tasks.empty())
+        QueueCondition.wait(Lock);
+      if (Tasks.empty())
+        return;
+      Task = std::move(Tasks.front());
+      Tasks.pop();
+      ++ActiveTasks;
+    }
+
+    Task();
+
+    bool Done;
+    {
+      std::unique_lock<std::mutex> Lock(QueueLock);
+      --ActiveTasks;
+      Done = ActiveTasks == 0 && Tasks.empty();
+    }
+    if (Done)
+      CompletionCondition.notify_all();
+  }
+}
+
+void ThreadPool::async(TaskTy Task) {
+  {
+    std::unique_lock<std::mutex> Lock(QueueLock);
+    Tasks.push(std::move(Task));
+  }
+  QueueCondition.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> Lock(QueueLock);
+  while (ActiveTasks != 0 || !Tasks.empty())
+    CompletionCondition.wait(Lock);
+}
+
+#else // LLVM_ENABLE_THREADS
+
+ThreadPool::ThreadPool(unsigned ThreadCount) : ThreadCount(1) {}
+
+ThreadPool::~ThreadPool() { wait(); }
+
+void ThreadPool::async(TaskTy Task) { Tasks.push(std::move(Task)); }
+
+void ThreadPool::wait() {
+  while (!Tasks.empty()) {
+    TaskTy Task = std::move(Tasks.front());
+    Tasks.pop();
+    Task();
+  }
+}
+
+#endif // LLVM_ENABLE_THREADS
@@ -96,6 +96,11 @@ public:
                               unsigned Index) const override;
   unsigned getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
                            unsigned AddressSpace) const override;
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor,
+                                      ArrayRef<unsigned> Indices,
+                                      unsigned Alignment,
+                                      unsigned AddressSpace) const override;
 
   unsigned getAddressComputationCost(Type *PtrTy,
                                      bool IsComplex) const override;
@@ -844,6 +849,153 @@ unsigned X86TTI::getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
   return Cost;
 }
 
+unsigned X86TTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                            unsigned Factor,
+                                            ArrayRef<unsigned> Indices,
+                                            unsigned Alignment,
+                                            unsigned AddressSpace) const {
+  VectorType *VT = cast<VectorType>(VecTy);
+  unsigned NumSubElts = VT->getNumElements() / Factor;
+  Type *SubTy = VectorType::get(VT->getElementType(), NumSubElts);
+
+  // The tables are only for loads of all the members of the group.
+  if (Opcode == Instruction::Load && Indices.size() != Factor)
+    return TargetTransformInfo::getInterleavedMemoryOpCost(
+        Opcode, VecTy, Factor, Indices, Alignment, AddressSpace);
+
+  // The number of shuffle instructions we emit to split a wide vector into
+  // Factor members of a legal type (the key), or to interleave them into it.
+  // Any combination not listed is split up into element extracts and
+  // inserts.  With AVX the wide vector of a load is often a legal 256-bit
+  // type, and splitting it again is more expensive than with SSE.
+  static const CostTblEntry<MVT::SimpleValueType> SSE2Factor2Tbl[] = {
+    { ISD::LOAD,  MVT::v2f64,  2 }, // unpcklpd + unpckhpd
+    { ISD::LOAD,  MVT::v2i64,  2 }, // punpcklqdq + punpckhqdq
+    { ISD::LOAD,  MVT::v4f32,  2 }, // 2x shufps
+    { ISD::LOAD,  MVT::v4i32,  2 }, // 2x shufps
+    { ISD::STORE, MVT::v2f64,  2 }, // unpcklpd + unpckhpd
+    { ISD::STORE, MVT::v2i64,  2 }, // punpcklqdq + punpckhqdq
+    { ISD::STORE, MVT::v4f32,  2 }, // unpcklps + unpckhps
+    { ISD::STORE, MVT::v4i32,  2 }, // punpckldq + punpckhdq
+    { ISD::STORE, MVT::v8i16,  2 }, // punpcklwd + punpckhwd
+    { ISD::STORE, MVT::v16i8,  2 }, // punpcklbw + punpckhbw
+  };
+
+  static const CostTblEntry<MVT::SimpleValueType> SSE2Factor3Tbl[] = {
+    { ISD::LOAD,  MVT::v2f64,  3 },
+    { ISD::LOAD,  MVT::v2i64,  3 },
+    { ISD::LOAD,  MVT::v4f32, 18 },
+    { ISD::STORE, MVT::v2f64,  3 },
+    { ISD::STORE, MVT::v2i64,  3 },
+    { ISD::STORE, MVT::v4f32, 18 },
+  };
+
+  static const CostTblEntry<MVT::SimpleValueType> SSE2Factor4Tbl[] = {
+    { ISD::LOAD,  MVT::v2f64,  4 },
+    { ISD::LOAD,  MVT::v2i64,  4 },
+    { ISD::LOAD,  MVT::v4f32, 24 },
+    { ISD::STORE, MVT::v2f64,  4 },
+    { ISD::STORE, MVT::v2i64,  4 },
+    { ISD::STORE, MVT::v4f32, 24 },
+  };
+
+  static const CostTblEntry<MVT::SimpleValueType> SSSE3Factor2Tbl[] = {
+    { ISD::LOAD,  MVT::v8i16,  6 }, // 4x pshufb + 2x punpcklqdq
+    { ISD::LOAD,  MVT::v16i8,  6 }, // 4x pshufb + 2x punpcklqdq
+  };
+
+  static const CostTblEntry<MVT::SimpleValueType> AVXFactor2Tbl[] = {
+    { ISD::LOAD,  MVT::v2f64,  4 },
+    { ISD::LOAD,  MVT::v4f32, 12 },
+    { ISD::LOAD,  MVT::v4f64,  8 },
+    { ISD::STORE, MVT::v2f64,  2 }, // vunpcklpd + vunpckhpd
+    { ISD::STORE, MVT::v2i64,  2 }, // vpunpcklqdq + vpunpckhqdq
+    { ISD::STORE, MVT::v4f32,  2 }, // vunpcklps + vunpckhps
+    { ISD::STORE, MVT::v4i32,  2 }, // vpunpckldq + vpunpckhdq
+    { ISD::STORE, MVT::v8i16,  2 }, // vpunpcklwd + vpunpckhwd
+    { ISD::STORE, MVT::v16i8,  2 }, // vpunpcklbw + vpunpckhbw
+    { ISD::STORE, MVT::v4f64,  4 }, // 2x vunpck + 2x vperm2f128
+    { ISD::STORE, MVT::v4i64,  4 },
+    { ISD::STORE, MVT::v8f32,  4 }, // 2x vunpck + 2x vperm2f128
+    { ISD::STORE, MVT::v8i32,  4 },
+  };
+
+  static const CostTblEntry<MVT::SimpleValueType> AVXFactor3Tbl[] = {
+    { ISD::LOAD,  MVT::v2f64,  6 },
+    { ISD::LOAD,  MVT::v4f32, 18 },
+    { ISD::STORE, MVT::v2f64,  3 },
+    { ISD::STORE, MVT::v2i64,  3 },
+    { ISD::STORE, MVT::v4f32, 18 },
+  };
+
+  static const CostTblEntry<MVT::SimpleValueType> AVXFactor4Tbl[] = {
+    { ISD::LOAD,  MVT::v2f64,  8 },
+    { ISD::LOAD,  MVT::v4f32, 24 },
+    { ISD::STORE, MVT::v2f64,  4 },
+    { ISD::STORE, MVT::v2i64,  4 },
+    { ISD::STORE, MVT::v4f32, 24 },
+  };
+
+  static const CostTblEntry<MVT::SimpleValueType> AVX2Factor2Tbl[] = {
+    { ISD::LOAD,  MVT::v4f64,  8 },
+    { ISD::LOAD,  MVT::v4i64,  8 },
+    { ISD::LOAD,  MVT::v8f32,  8 },
+    { ISD::LOAD,  MVT::v8i32,  8 },
+    { ISD::STORE, MVT::v4f64,  8 },
+    { ISD::STORE, MVT::v4i64,  8 },
+    { ISD::STORE, MVT::v8f32,  8 },
+    { ISD::STORE, MVT::v8i32,  8 },
+  };
+
+  std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(SubTy);
+  int ISD = Opcode == Instruction::Load ? ISD::LOAD : ISD::STORE;
+  MVT MTy = LT.second;
+
+  // Only members that legalize into whole vectors can use the tables.
+  if (SubTy->getPrimitiveSizeInBits() != LT.first * MTy.getSizeInBits())
+    return TargetTransformInfo::getInterleavedMemoryOpCost(
+        Opcode, VecTy, Factor, Indices, Alignment, AddressSpace);
+
+  int Idx = -1;
+  unsigned ShuffleCost = 0;
+  if (ST->hasAVX2() && Factor == 2 &&
+      (Idx = CostTableLookup(AVX2Factor2Tbl, ISD, MTy)) != -1)
+    ShuffleCost = AVX2Factor2Tbl[Idx].Cost;
+  else if (ST->hasAVX()) {
+    if (Factor == 2 && (Idx = CostTableLookup(AVXFactor2Tbl, ISD, MTy)) != -1)
+      ShuffleCost = AVXFactor2Tbl[Idx].Cost;
+    else if (Factor == 3 &&
+             (Idx = CostTableLookup(AVXFactor3Tbl, ISD, MTy)) != -1)
+      ShuffleCost = AVXFactor3Tbl[Idx].Cost;
+    else if (Factor == 4 &&
+             (Idx = CostTableLookup(AVXFactor4Tbl, ISD, MTy)) != -1)
+      ShuffleCost = AVXFactor4Tbl[Idx].Cost;
+  } else if (ST->hasSSE2()) {
+    if (ST->hasSSSE3() && Factor == 2 &&
+        (Idx = CostTableLookup(SSSE3Factor2Tbl, ISD, MTy)) != -1)
+      ShuffleCost = SSSE3Factor2Tbl[Idx].Cost;
+    else if (Factor == 2 &&
+             (Idx = CostTableLookup(SSE2Factor2Tbl, ISD, MTy)) != -1)
+      ShuffleCost = SSE2Factor2Tbl[Idx].Cost;
+    else if (Factor == 3 &&
+             (Idx = CostTableLookup(SSE2Factor3Tbl, ISD, MTy)) != -1)
+      ShuffleCost = SSE2Factor3Tbl[Idx].Cost;
+    else if (Factor == 4 &&
+             (Idx = CostTableLookup(SSE2Factor4Tbl, ISD, MTy)) != -1)
+      ShuffleCost = SSE2Factor4Tbl[Idx].Cost;
+  }
+
+  if (Idx == -1)
+    return TargetTransformInfo::getInterleavedMemoryOpCost(
+        Opcode, VecTy, Factor, Indices, Alignment, AddressSpace);
+
+  // The wide vector is loaded or stored as Factor member-sized pieces, which
+  // also covers factors that do not give a power-of-two wide vector.
+  unsigned MemCost =
+      Factor * getMemoryOpCost(Opcode, SubTy, Alignment, AddressSpace);
+  return MemCost + LT.first * ShuffleCost;
+}
+
 unsigned X86TTI::getAddressComputationCost(Type *Ty, bool IsComplex) const {
   // Address computations in vectorized code with non-consecutive addresses will
   // likely result in more instructions compared to scalar code where the
@@ -14,18 +14,24 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/IPO/InlinerPass.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/InlineCost.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -43,6 +49,7 @@ STATISTIC(NumMergedAllocas, "Number of allocas merged together");
 // to inline a function A into B, we analyze the callers of B in order to see
 // if those would be more profitable and blocked inline steps.
 STATISTIC(NumCallerCallersAnalyzed, "Number of caller-callers analyzed");
+STATISTIC(NumCachedCosts, "Number of inline costs reused, not recomputed");
 
 static cl::opt<int>
 InlineLimit("inline-threshold", cl::Hidden, cl::init(225), cl::ZeroOrMore,
@@ -59,16 +66,40 @@ static cl::opt<int>
 ColdThreshold("inlinecold-threshold", cl::Hidden, cl::init(225),
               cl::desc("Threshold for inlining functions with cold attribute"));
 
+// The profile of a caller, as given by its branch weights, tells which of its
+// call sites are hot or cold.
+static cl::opt<int>
+HotThreshold("inlinehot-threshold", cl::Hidden, cl::init(325),
+             cl::desc("Threshold for inlining at hot call sites"));
+
+static cl::opt<int>
+ColdCallSiteThreshold("inlinecold-callsite-threshold", cl::Hidden,
+                      cl::init(45),
+                      cl::desc("Threshold for inlining at cold call sites"));
+
+static cl::opt<unsigned>
+HotCallSiteFreq("inlinehot-callsite-freq", cl::Hidden, cl::init(16),
+                cl::desc("Minimum frequency of a hot call site, as a multiple "
+                         "of the frequency of the caller's entry"));
+
+static cl::opt<unsigned>
+ColdCallSiteFreq("inlinecold-callsite-freq", cl::Hidden, cl::init(2),
+                 cl::desc("Maximum frequency of a cold call site, as a "
+                          "percentage of the frequency of the caller's entry"));
+
 // Threshold to use when optsize is specified (and there is no -inline-limit).
 const int OptSizeThreshold = 75;
 
+static const char *const TimerGroupName = "Function Inlining";
+
 Inliner::Inliner(char &ID) 
-  : CallGraphSCCPass(ID), InlineThreshold(InlineLimit), InsertLifetime(true) {}
+  : CallGraphSCCPass(ID), InlineThreshold(InlineLimit), InsertLifetime(true),
+    Costs(nullptr) {}
 
 Inliner::Inliner(char &ID, int Threshold, bool InsertLifetime)
   : CallGraphSCCPass(ID), InlineThreshold(InlineLimit.getNumOccurrences() > 0 ?
                                           InlineLimit : Threshold),
-    InsertLifetime(InsertLifetime) {}
+    InsertLifetime(InsertLifetime), Costs(nullptr) {}
 
 /// getAnalysisUsage - For this class, we declare that we require and preserve
 /// the call graph.  If the derived class implements this method, it should
@@ -261,6 +292,248 @@ static bool InlineCallIfPossible(CallSite CS, InlineFunctionInfo &IFI,
   return true;
 }
 
+namespace {
+/// CallContext - Everything the cost of inlining a call site depends on.
+///
+/// The inliner only changes the functions of the SCC being visited, so a
+/// count of the changes made to a callee stands in for its body.  A callee
+/// which calls through a function pointer may also be charged for the body of
+/// the function pointed to; changing a function whose address is taken bumps
+/// the epoch, which stands in for the bodies of all of them.
+struct CallContext {
+  Function *Caller;
+  Function *Callee;
+  unsigned CalleeChanges;
+  unsigned Epoch;
+  AttributeSet CallAttrs;
+  AttributeSet CallerAttrs;
+  SmallVector<Value *, 4> Args;
+  bool CalleeHasOneUse;
+  bool CallerIsRecursive;
+  bool FollowedByUnreachable;
+  bool IsHot;
+  bool IsCold;
+
+  bool operator==(const CallContext &RHS) const {
+    return Caller == RHS.Caller && Callee == RHS.Callee &&
+           CalleeChanges == RHS.CalleeChanges && Epoch == RHS.Epoch &&
+           CallAttrs == RHS.CallAttrs && CallerAttrs == RHS.CallerAttrs &&
+           Args == RHS.Args && CalleeHasOneUse == RHS.CalleeHasOneUse &&
+           CallerIsRecursive == RHS.CallerIsRecursive &&
+           FollowedByUnreachable == RHS.FollowedByUnreachable &&
+           IsHot == RHS.IsHot && IsCold == RHS.IsCold;
+  }
+};
+
+struct CachedCost {
+  CallContext Context;
+  InlineCost IC;
+
+  CachedCost(const CallContext &Context, InlineCost IC)
+    : Context(Context), IC(IC) {}
+};
+
+/// FunctionState - What the cost cache knows about a function: how many times
+/// it has been changed, whether it calls itself and which of its blocks its
+/// profile shows to be hot or cold, as of the last check.
+struct FunctionState {
+  unsigned Changes;
+  unsigned RecursionChecked;
+  unsigned ProfileChecked;
+  bool IsRecursive;
+  SmallPtrSet<const BasicBlock *, 8> HotBlocks;
+  SmallPtrSet<const BasicBlock *, 8> ColdBlocks;
+
+  FunctionState()
+    : Changes(0), RecursionChecked(~0U), ProfileChecked(~0U),
+      IsRecursive(false) {}
+};
+} // end anonymous namespace
+
+/// CostCache - Remembers the inline costs computed while an SCC is visited,
+/// so that a call site looked at again, either because an earlier pass over
+/// the call sites inlined something or because it calls the caller of another
+/// candidate, is only analyzed again once something it depends on changed.
+class Inliner::CostCache {
+  Inliner &Policy;
+  DenseMap<Instruction *, CachedCost> Costs;
+  DenseMap<Function *, FunctionState> Functions;
+  unsigned Epoch;
+
+  bool isRecursive(Function *F);
+  FunctionState &getProfile(Function *F);
+
+public:
+  explicit CostCache(Inliner &Policy) : Policy(Policy), Epoch(0) {}
+
+  /// getInlineCost - Return the cost of inlining CS, analyzing it only if its
+  /// context changed since the last time.
+  InlineCost getInlineCost(CallSite CS);
+
+  /// isHotCallSite - Return true if the profile of the caller shows CS to be
+  /// executed much more often than the caller.
+  bool isHotCallSite(CallSite CS) {
+    return getProfile(CS.getCaller()).HotBlocks.count(
+        CS.getInstruction()->getParent());
+  }
+
+  /// isColdCallSite - Return true if the profile of the caller shows CS to be
+  /// executed much less often than the caller.
+  bool isColdCallSite(CallSite CS) {
+    return getProfile(CS.getCaller()).ColdBlocks.count(
+        CS.getInstruction()->getParent());
+  }
+
+  /// functionChanged - Note that the body of F has been changed.
+  void functionChanged(Function *F) {
+    ++Functions[F].Changes;
+    if (F->hasAddressTaken())
+      ++Epoch;
+  }
+};
+
+/// isRecursive - Return true if F has a call site which uses F, the way the
+/// inline cost analysis checks whether the caller is recursive.
+bool Inliner::CostCache::isRecursive(Function *F) {
+  FunctionState &State = Functions[F];
+  if (State.RecursionChecked == State.Changes)
+    return State.IsRecursive;
+
+  State.RecursionChecked = State.Changes;
+  State.IsRecursive = false;
+  for (User *U : F->users()) {
+    CallSite Site(U);
+    if (Site && Site.getInstruction()->getParent()->getParent() == F) {
+      State.IsRecursive = true;
+      break;
+    }
+  }
+  return State.IsRecursive;
+}
+
+/// isUnweightedBranch - Return true if BB ends in a branch with more than one
+/// successor and no branch weights.
+static bool isUnweightedBranch(const BasicBlock *BB) {
+  const TerminatorInst *TI = BB->getTerminator();
+  return TI->getNumSuccessors() > 1 && !TI->getMetadata(LLVMContext::MD_prof);
+}
+
+/// hasWeightedTripCounts - Return true if L and every loop containing it have
+/// branch weights on all of their exits and latches, so that the number of
+/// times their bodies run is known rather than estimated.
+static bool hasWeightedTripCounts(const Loop *L,
+                                  DenseMap<const Loop *, bool> &Known) {
+  if (!L)
+    return false;
+  DenseMap<const Loop *, bool>::iterator It = Known.find(L);
+  if (It != Known.end())
+    return It->second;
+
+  bool Weighted = !L->getParentLoop() ||
+                  hasWeightedTripCounts(L->getParentLoop(), Known);
+  SmallVector<BasicBlock *, 4> Latches;
+  L->getLoopLatches(Latches);
+  for (Loop::block_iterator I = L->block_begin(), E = L->block_end();
+       Weighted && I != E; ++I)
+    if (isUnweightedBranch(*I) &&
+        (L->isLoopExiting(*I) ||
+         std::find(Latches.begin(), Latches.end(), *I) != Latches.end()))
+      Weighted = false;
+  Known[L] = Weighted;
+  return Weighted;
+}
+
+/// getProfile - Return the state of F, with the hot and cold blocks of F up to
+/// date.  The frequency of the blocks is compared to that of the entry block,
+/// so that hot and cold call sites can be told apart without knowing how often
+/// F itself is called.  Only frequencies that come from branch weights are
+/// trusted, since static estimates would change inlining everywhere: blocks
+/// are hot or cold only if every branch in F has weights, as it does with an
+/// instrumentation profile.  Otherwise, a block can still be hot if all of the
+/// loops containing it have weights on their exits and latches.  A lone
+/// __builtin_expect therefore does not make the rest of F hot or cold.
+FunctionState &Inliner::CostCache::getProfile(Function *F) {
+  FunctionState &State = Functions[F];
+  if (State.ProfileChecked == State.Changes)
+    return State;
+
+  State.ProfileChecked = State.Changes;
+  State.HotBlocks.clear();
+  State.ColdBlocks.clear();
+  bool HasWeights = false, AllWeighted = true;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    if (isUnweightedBranch(BB))
+      AllWeighted = false;
+    else if (BB->getTerminator()->getMetadata(LLVMContext::MD_prof))
+      HasWeights = true;
+  }
+  if (!HasWeights)
+    return State;
+
+  DominatorTree DT;
+  DT.recalculate(*F);
+  LoopInfo LI;
+  LI.getBase().Analyze(DT);
+  BranchProbabilityInfo BPI;
+  BPI.calculate(*F, LI);
+  BlockFrequencyInfo BFI;
+  BFI.calculate(*F, BPI, LI);
+
+  uint64_t EntryFreq = BFI.getEntryFreq();
+  BlockFrequency ColdFreq = BlockFrequency(EntryFreq) *
+      BranchProbability(std::min(ColdCallSiteFreq.getValue(), 100U), 100);
+  DenseMap<const Loop *, bool> WeightedLoops;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    if (!AllWeighted &&
+        !hasWeightedTripCounts(LI.getLoopFor(BB), WeightedLoops))
+      continue;
+    BlockFrequency Freq = BFI.getBlockFreq(BB);
+    if (HotCallSiteFreq && Freq.getFrequency() / HotCallSiteFreq >= EntryFreq)
+      State.HotBlocks.insert(BB);
+    else if (AllWeighted && Freq < ColdFreq)
+      State.ColdBlocks.insert(BB);
+  }
+  return State;
+}
+
+InlineCost Inliner::CostCache::getInlineCost(CallSite CS) {
+  Instruction *I = CS.getInstruction();
+  CallContext Context;
+  Context.Caller = CS.getCaller();
+  Context.Callee = CS.getCalledFunction();
+  Context.CalleeChanges =
+      Context.Callee ? Functions[Context.Callee].Changes : 0;
+  Context.Epoch = Epoch;
+  Context.CallAttrs = CS.getAttributes();
+  Context.CallerAttrs = Context.Caller->getAttributes();
+  Context.Args.append(CS.arg_begin(), CS.arg_end());
+  Context.CalleeHasOneUse = Context.Callee && Context.Callee->hasOneUse();
+  Context.CallerIsRecursive = isRecursive(Context.Caller);
+  if (InvokeInst *II = dyn_cast<InvokeInst>(I))
+    Context.FollowedByUnreachable =
+        isa<UnreachableInst>(II->getNormalDest()->begin());
+  else
+    Context.FollowedByUnreachable =
+        isa<UnreachableInst>(std::next(BasicBlock::iterator(I)));
+  Context.IsHot = isHotCallSite(CS);
+  Context.IsCold = isColdCallSite(CS);
+
+  DenseMap<Instruction *, CachedCost>::iterator It = Costs.find(I);
+  if (It != Costs.end()) {
+    if (It->second.Context == Context) {
+      ++NumCachedCosts;
+      return It->second.IC;
+    }
+    Costs.erase(It);
+  }
+
+  NamedRegionTimer T("Inline Cost Analysis", TimerGroupName,
+                     TimePassesIsEnabled);
+  InlineCost IC = Policy.getInlineCost(CS);
+  Costs.insert(std::make_pair(I, CachedCost(Context, IC)));
+  return IC;
+}
+
 unsigned Inliner::getInlineThreshold(CallSite CS) const {
   int thres = InlineThreshold; // -inline-threshold or else selected by
                                // overall opt level
@@ -281,11 +554,23 @@ unsigned Inliner::getInlineThreshold(CallSite CS) const {
   bool InlineHint = Callee && !Callee->isDeclaration() &&
     Callee->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
                                          Attribute::InlineHint);
-  if (InlineHint && HintThreshold > thres
-      && !Caller->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
-                                               Attribute::MinSize))
+  bool MinSize = Caller->getAttributes().hasAttribute(
+      AttributeSet::FunctionIndex, Attribute::MinSize);
+  if (InlineHint && HintThreshold > thres && !MinSize)
     thres = HintThreshold;
 
+  // Listen to the profile of the caller, raising the threshold for hot call
+  // sites as for the inlinehint attribute, and lowering it for cold ones.  As
+  // for the cold attribute, -inline-threshold overrides the defaults.
+  if (Costs && (InlineLimit.getNumOccurrences() == 0 ||
+                HotThreshold.getNumOccurrences() > 0) &&
+      HotThreshold > thres && !MinSize && Costs->isHotCallSite(CS))
+    thres = HotThreshold;
+  if (Costs && (InlineLimit.getNumOccurrences() == 0 ||
+                ColdCallSiteThreshold.getNumOccurrences() > 0) &&
+      ColdCallSiteThreshold < thres && Costs->isColdCallSite(CS))
+    thres = ColdCallSiteThreshold;
+
   // Listen to the cold attribute when it would decrease the threshold.
   bool ColdCallee = Callee && !Callee->isDeclaration() &&
     Callee->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
@@ -311,7 +596,7 @@ static void emitAnalysis(CallSite CS, const Twine &Msg) {
 /// shouldInline - Return true if the inliner should attempt to inline
 /// at the given CallSite.
 bool Inliner::shouldInline(CallSite CS) {
-  InlineCost IC = getInlineCost(CS);
+  InlineCost IC = Costs->getInlineCost(CS);
   
   if (IC.isAlways()) {
     DEBUG(dbgs() << "    Inlining: cost=always"
@@ -376,7 +661,7 @@ bool Inliner::shouldInline(CallSite CS) {
         continue;
       }
 
-      InlineCost IC2 = getInlineCost(CS2);
+      InlineCost IC2 = Costs->getInlineCost(CS2);
       ++NumCallerCallersAnalyzed;
       if (!IC2) {
         callerWillBeRemoved = false;
@@ -501,6 +786,8 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
   
   InlinedArrayAllocasTy InlinedArrayAllocas;
   InlineFunctionInfo InlineInfo(&CG, DL);
+  CostCache SCCCosts(*this);
+  Costs = &SCCCosts;
   
   // Now that we have all of the call sites, loop over them and inline them if
   // it looks profitable to do so.
@@ -526,6 +813,7 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
         // Update the call graph by deleting the edge from Callee to Caller.
         CG[Caller]->removeCallEdgeFor(CS);
         CS.getInstruction()->eraseFromParent();
+        Costs->functionChanged(Caller);
         ++NumCallsDeleted;
       } else {
         // We can only inline direct calls to non-declarations.
@@ -557,14 +845,20 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
         }
 
         // Attempt to inline the function.
-        if (!InlineCallIfPossible(CS, InlineInfo, InlinedArrayAllocas,
-                                  InlineHistoryID, InsertLifetime, DL)) {
+        bool Inlined;
+        {
+          NamedRegionTimer T("Inlining", TimerGroupName, TimePassesIsEnabled);
+          Inlined = InlineCallIfPossible(CS, InlineInfo, InlinedArrayAllocas,
+                                         InlineHistoryID, InsertLifetime, DL);
+        }
+        if (!Inlined) {
           emitOptimizationRemarkMissed(CallerCtx, DEBUG_TYPE, *Caller, DLoc,
                                        Twine(Callee->getName() +
                                              " will not be inlined into " +
                                              Caller->getName()));
           continue;
         }
+        Costs->functionChanged(Caller);
         ++NumInlined;
 
         // Report the inline decision.
@@ -627,6 +921,7 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
     }
   } while (LocalChange);
 
+  Costs = nullptr;
   return Changed;
 }
 
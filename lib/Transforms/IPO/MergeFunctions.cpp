@@ -27,6 +27,10 @@
 // -- We define Function* container class with custom "operator<" (FunctionPtr).
 // -- "FunctionPtr" instances are stored in std::set collection, so every
 //    std::set::insert operation will give you result in log(N) time.
+// -- Each FunctionPtr also carries a cheap structural hash of its function
+//    (see functionHash). The tree is ordered by the hash first, so the full
+//    comparison only runs between functions with the same hash, and functions
+//    whose hash is unique in the module are never inserted at all.
 //
 // When a match is found the functions are folded. If both functions are
 // overridable, we move the functionality into a new internal function and
@@ -84,6 +88,7 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
@@ -102,6 +107,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <vector>
 using namespace llvm;
 
@@ -111,6 +117,8 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumUniqueHashes,
+          "Number of functions skipped because their hash is unique");
 
 static cl::opt<unsigned> NumFunctionsForSanityCheck(
     "mergefunc-sanity",
@@ -392,15 +400,52 @@ private:
   DenseMap<const Value*, int> sn_mapL, sn_mapR;
 };
 
+typedef uint64_t FunctionHash;
+
+/// Hash the parts of a function that FunctionComparator::compare() requires
+/// to be identical: whether it is variadic, its number of arguments, and the
+/// opcodes of its instructions in the order of the same CFG walk.  Functions
+/// that compare equal always have the same hash.  None of these properties
+/// change when MergeFunctions rewrites calls, so neither does the hash.
+static FunctionHash functionHash(const Function &F) {
+  hash_code H = hash_combine(F.isVarArg(), F.arg_size());
+
+  SmallVector<const BasicBlock *, 8> BBs;
+  SmallSet<const BasicBlock *, 128> VisitedBBs;
+  BBs.push_back(&F.getEntryBlock());
+  VisitedBBs.insert(BBs[0]);
+  while (!BBs.empty()) {
+    const BasicBlock *BB = BBs.pop_back_val();
+    // Mark the start of each block, so that the shape of the CFG matters and
+    // not just the sequence of opcodes.
+    H = hash_combine(H, 45798);
+    for (const Instruction &I : *BB)
+      H = hash_combine(H, I.getOpcode());
+
+    const TerminatorInst *Term = BB->getTerminator();
+    for (unsigned i = 0, e = Term->getNumSuccessors(); i != e; ++i)
+      if (VisitedBBs.insert(Term->getSuccessor(i)))
+        BBs.push_back(Term->getSuccessor(i));
+  }
+  return H;
+}
+
 class FunctionPtr {
   AssertingVH<Function> F;
   const DataLayout *DL;
+  FunctionHash Hash;
 
 public:
-  FunctionPtr(Function *F, const DataLayout *DL) : F(F), DL(DL) {}
+  FunctionPtr(Function *F, const DataLayout *DL)
+      : F(F), DL(DL), Hash(functionHash(*F)) {}
   Function *getFunc() const { return F; }
+  FunctionHash getHash() const { return Hash; }
   void release() { F = 0; }
   bool operator<(const FunctionPtr &RHS) const {
+    // Order by hash first: it is much cheaper than the full comparison, and
+    // functions with different hashes are never equal.
+    if (Hash != RHS.Hash)
+      return Hash < RHS.Hash;
     return (FunctionComparator(DL, F, RHS.getFunc()).compare()) == -1;
   }
 };
@@ -1215,9 +1260,28 @@ bool MergeFunctions::runOnModule(Module &M) {
   DataLayoutPass *DLP = getAnalysisIfAvailable<DataLayoutPass>();
   DL = DLP ? &DLP->getDataLayout() : nullptr;
 
+  // A function can only be merged with one that has the same hash, so only
+  // queue functions whose hash is shared with another.  Keep them in module
+  // order, which decides which of two equal functions is kept.
+  std::vector<std::pair<Function *, FunctionHash>> HashedFuncs;
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
     if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage())
-      Deferred.push_back(WeakVH(I));
+      HashedFuncs.push_back(std::make_pair(I, functionHash(*I)));
+  }
+
+  std::vector<FunctionHash> Hashes;
+  Hashes.reserve(HashedFuncs.size());
+  for (unsigned i = 0, e = HashedFuncs.size(); i != e; ++i)
+    Hashes.push_back(HashedFuncs[i].second);
+  std::sort(Hashes.begin(), Hashes.end());
+
+  for (unsigned i = 0, e = HashedFuncs.size(); i != e; ++i) {
+    auto Range = std::equal_range(Hashes.begin(), Hashes.end(),
+                                  HashedFuncs[i].second);
+    if (Range.second - Range.first > 1)
+      Deferred.push_back(WeakVH(HashedFuncs[i].first));
+    else
+      ++NumUniqueHashes;
   }
 
   do {
@@ -43,16 +43,20 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/SSAUpdater.h"
+#include <algorithm>
 #include <vector>
 using namespace llvm;
 using namespace PatternMatch;
 
 #define DEBUG_TYPE "gvn"
 
+static const char *const TimerGroupName = "Global Value Numbering";
+
 STATISTIC(NumGVNInstr,  "Number of instructions deleted");
 STATISTIC(NumGVNLoad,   "Number of loads deleted");
 STATISTIC(NumGVNPRE,    "Number of instructions PRE'd");
@@ -60,11 +64,29 @@ STATISTIC(NumGVNBlocks, "Number of blocks merged");
 STATISTIC(NumGVNSimpl,  "Number of instructions simplified");
 STATISTIC(NumGVNEqProp, "Number of equalities propagated");
 STATISTIC(NumPRELoad,   "Number of loads PRE'd");
+STATISTIC(NumPRESkipped, "Number of functions too large for PRE");
+STATISTIC(NumLoadsSkipped, "Number of non-local loads skipped for compile time");
 
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
 
+// Functions with more blocks than this are not PRE'd: PRE looks at the
+// predecessors of every block and reruns until nothing changes.
+static cl::opt<unsigned>
+MaxPREBlocks("gvn-max-pre-blocks", cl::Hidden, cl::init(10000),
+             cl::desc("Skip PRE in functions with more basic blocks than this "
+                      "(default = 10000)"));
+
+// Each non-local load asks memdep for its dependencies in all predecessor
+// blocks.  On large functions with many loads this goes quadratic, so stop
+// looking at non-local loads once their dependencies add up to this many.
+static cl::opt<unsigned>
+MaxNonLocalLoadDeps("gvn-max-nonlocal-load-deps", cl::Hidden,
+                    cl::init(500000),
+                    cl::desc("Max total number of non-local load dependencies "
+                             "looked at per function (default = 500000)"));
+
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
 MaxRecurseDepth("max-recurse-depth", cl::Hidden, cl::init(1000), cl::ZeroOrMore,
@@ -78,46 +100,64 @@ MaxRecurseDepth("max-recurse-depth", cl::Hidden, cl::init(1000), cl::ZeroOrMore,
 /// as an efficient mechanism to determine the expression-wise equivalence of
 /// two values.
 namespace {
+  /// Expression - An opcode, type and list of operand value numbers.  The
+  /// operand list is not owned: while an expression is being looked up it
+  /// points into a buffer of the caller, and once it is a key of the
+  /// ValueTable it points into the table's allocator.  The hash is computed
+  /// once, by finalize, so growing the table does not rehash the operands.
   struct Expression {
     uint32_t opcode;
+    unsigned hash;
     Type *type;
-    SmallVector<uint32_t, 4> varargs;
-
-    Expression(uint32_t o = ~2U) : opcode(o) { }
+    const uint32_t *varargs;
+    unsigned numargs;
+
+    Expression(uint32_t o = ~2U)
+        : opcode(o), hash(0), type(nullptr), varargs(nullptr), numargs(0) { }
+
+    /// finalize - Point the expression at the operands in Args and compute
+    /// its hash.
+    void finalize(ArrayRef<uint32_t> Args) {
+      varargs = Args.data();
+      numargs = Args.size();
+      hash = static_cast<unsigned>(
+          hash_combine(opcode, type,
+                       hash_combine_range(Args.begin(), Args.end())));
+    }
 
     bool operator==(const Expression &other) const {
       if (opcode != other.opcode)
         return false;
       if (opcode == ~0U || opcode == ~1U)
         return true;
-      if (type != other.type)
-        return false;
-      if (varargs != other.varargs)
+      if (hash != other.hash || type != other.type ||
+          numargs != other.numargs)
         return false;
-      return true;
-    }
-
-    friend hash_code hash_value(const Expression &Value) {
-      return hash_combine(Value.opcode, Value.type,
-                          hash_combine_range(Value.varargs.begin(),
-                                             Value.varargs.end()));
+      return std::equal(varargs, varargs + numargs, other.varargs);
     }
   };
 
   class ValueTable {
     DenseMap<Value*, uint32_t> valueNumbering;
     DenseMap<Expression, uint32_t> expressionNumbering;
+    /// ExpressionAllocator - Holds the operand lists of the expressions in
+    /// expressionNumbering.
+    BumpPtrAllocator ExpressionAllocator;
     AliasAnalysis *AA;
     MemoryDependenceAnalysis *MD;
     DominatorTree *DT;
 
     uint32_t nextValueNumber;
 
-    Expression create_expression(Instruction* I);
+    Expression create_expression(Instruction* I,
+                                 SmallVectorImpl<uint32_t> &Args);
     Expression create_cmp_expression(unsigned Opcode,
                                      CmpInst::Predicate Predicate,
-                                     Value *LHS, Value *RHS);
-    Expression create_extractvalue_expression(ExtractValueInst* EI);
+                                     Value *LHS, Value *RHS,
+                                     SmallVectorImpl<uint32_t> &Args);
+    Expression create_extractvalue_expression(ExtractValueInst* EI,
+                                              SmallVectorImpl<uint32_t> &Args);
+    uint32_t lookup_or_add_expression(const Expression &E);
     uint32_t lookup_or_add_call(CallInst* C);
   public:
     ValueTable() : nextValueNumber(1) { }
@@ -147,9 +187,8 @@ template <> struct DenseMapInfo<Expression> {
     return ~1U;
   }
 
-  static unsigned getHashValue(const Expression e) {
-    using llvm::hash_value;
-    return static_cast<unsigned>(hash_value(e));
+  static unsigned getHashValue(const Expression &e) {
+    return e.hash;
   }
   static bool isEqual(const Expression &LHS, const Expression &RHS) {
     return LHS == RHS;
@@ -162,60 +201,66 @@ template <> struct DenseMapInfo<Expression> {
 //                     ValueTable Internal Functions
 //===----------------------------------------------------------------------===//
 
-Expression ValueTable::create_expression(Instruction *I) {
+Expression ValueTable::create_expression(Instruction *I,
+                                         SmallVectorImpl<uint32_t> &Args) {
   Expression e;
   e.type = I->getType();
   e.opcode = I->getOpcode();
   for (Instruction::op_iterator OI = I->op_begin(), OE = I->op_end();
        OI != OE; ++OI)
-    e.varargs.push_back(lookup_or_add(*OI));
+    Args.push_back(lookup_or_add(*OI));
   if (I->isCommutative()) {
     // Ensure that commutative instructions that only differ by a permutation
     // of their operands get the same value number by sorting the operand value
     // numbers.  Since all commutative instructions have two operands it is more
     // efficient to sort by hand rather than using, say, std::sort.
     assert(I->getNumOperands() == 2 && "Unsupported commutative instruction!");
-    if (e.varargs[0] > e.varargs[1])
-      std::swap(e.varargs[0], e.varargs[1]);
+    if (Args[0] > Args[1])
+      std::swap(Args[0], Args[1]);
   }
 
   if (CmpInst *C = dyn_cast<CmpInst>(I)) {
     // Sort the operand value numbers so x<y and y>x get the same value number.
     CmpInst::Predicate Predicate = C->getPredicate();
-    if (e.varargs[0] > e.varargs[1]) {
-      std::swap(e.varargs[0], e.varargs[1]);
+    if (Args[0] > Args[1]) {
+      std::swap(Args[0], Args[1]);
       Predicate = CmpInst::getSwappedPredicate(Predicate);
     }
     e.opcode = (C->getOpcode() << 8) | Predicate;
   } else if (InsertValueInst *E = dyn_cast<InsertValueInst>(I)) {
     for (InsertValueInst::idx_iterator II = E->idx_begin(), IE = E->idx_end();
          II != IE; ++II)
-      e.varargs.push_back(*II);
+      Args.push_back(*II);
   }
 
+  e.finalize(Args);
   return e;
 }
 
 Expression ValueTable::create_cmp_expression(unsigned Opcode,
                                              CmpInst::Predicate Predicate,
-                                             Value *LHS, Value *RHS) {
+                                             Value *LHS, Value *RHS,
+                                             SmallVectorImpl<uint32_t> &Args) {
   assert((Opcode == Instruction::ICmp || Opcode == Instruction::FCmp) &&
          "Not a comparison!");
   Expression e;
   e.type = CmpInst::makeCmpResultType(LHS->getType());
-  e.varargs.push_back(lookup_or_add(LHS));
-  e.varargs.push_back(lookup_or_add(RHS));
+  Args.push_back(lookup_or_add(LHS));
+  Args.push_back(lookup_or_add(RHS));
 
   // Sort the operand value numbers so x<y and y>x get the same value number.
-  if (e.varargs[0] > e.varargs[1]) {
-    std::swap(e.varargs[0], e.varargs[1]);
+  if (Args[0] > Args[1]) {
+    std::swap(Args[0], Args[1]);
     Predicate = CmpInst::getSwappedPredicate(Predicate);
   }
   e.opcode = (Opcode << 8) | Predicate;
+  e.finalize(Args);
   return e;
 }
 
-Expression ValueTable::create_extractvalue_expression(ExtractValueInst *EI) {
+Expression
+ValueTable::create_extractvalue_expression(ExtractValueInst *EI,
+                                           SmallVectorImpl<uint32_t> &Args) {
   assert(EI && "Not an ExtractValueInst?");
   Expression e;
   e.type = EI->getType();
@@ -247,8 +292,9 @@ Expression ValueTable::create_extractvalue_expression(ExtractValueInst *EI) {
       // Intrinsic recognized. Grab its args to finish building the expression.
       assert(I->getNumArgOperands() == 2 &&
              "Expect two args for recognised intrinsics.");
-      e.varargs.push_back(lookup_or_add(I->getArgOperand(0)));
-      e.varargs.push_back(lookup_or_add(I->getArgOperand(1)));
+      Args.push_back(lookup_or_add(I->getArgOperand(0)));
+      Args.push_back(lookup_or_add(I->getArgOperand(1)));
+      e.finalize(Args);
       return e;
     }
   }
@@ -258,12 +304,13 @@ Expression ValueTable::create_extractvalue_expression(ExtractValueInst *EI) {
   e.opcode = EI->getOpcode();
   for (Instruction::op_iterator OI = EI->op_begin(), OE = EI->op_end();
        OI != OE; ++OI)
-    e.varargs.push_back(lookup_or_add(*OI));
+    Args.push_back(lookup_or_add(*OI));
 
   for (ExtractValueInst::idx_iterator II = EI->idx_begin(), IE = EI->idx_end();
          II != IE; ++II)
-    e.varargs.push_back(*II);
+    Args.push_back(*II);
 
+  e.finalize(Args);
   return e;
 }
 
@@ -276,23 +323,40 @@ void ValueTable::add(Value *V, uint32_t num) {
   valueNumbering.insert(std::make_pair(V, num));
 }
 
+/// lookup_or_add_expression - Returns the value number of the expression E,
+/// assigning it a new number if it did not have one before.  The operands of
+/// a new expression are copied into the table.
+uint32_t ValueTable::lookup_or_add_expression(const Expression &E) {
+  DenseMap<Expression, uint32_t>::iterator EI = expressionNumbering.find(E);
+  if (EI != expressionNumbering.end())
+    return EI->second;
+
+  Expression Key = E;
+  uint32_t *Args = ExpressionAllocator.Allocate<uint32_t>(E.numargs);
+  std::copy(E.varargs, E.varargs + E.numargs, Args);
+  Key.varargs = Args;
+  expressionNumbering.insert(std::make_pair(Key, nextValueNumber));
+  return nextValueNumber++;
+}
+
 uint32_t ValueTable::lookup_or_add_call(CallInst *C) {
   if (AA->doesNotAccessMemory(C)) {
-    Expression exp = create_expression(C);
-    uint32_t &e = expressionNumbering[exp];
-    if (!e) e = nextValueNumber++;
+    SmallVector<uint32_t, 8> Args;
+    uint32_t e = lookup_or_add_expression(create_expression(C, Args));
     valueNumbering[C] = e;
     return e;
   } else if (AA->onlyReadsMemory(C)) {
-    Expression exp = create_expression(C);
-    uint32_t &e = expressionNumbering[exp];
-    if (!e) {
-      e = nextValueNumber++;
+    SmallVector<uint32_t, 8> Args;
+    Expression exp = create_expression(C, Args);
+    DenseMap<Expression, uint32_t>::iterator EI =
+        expressionNumbering.find(exp);
+    if (EI == expressionNumbering.end()) {
+      uint32_t e = lookup_or_add_expression(exp);
       valueNumbering[C] = e;
       return e;
     }
     if (!MD) {
-      e = nextValueNumber++;
+      uint32_t e = EI->second = nextValueNumber++;
       valueNumbering[C] = e;
       return e;
     }
@@ -398,6 +462,7 @@ uint32_t ValueTable::lookup_or_add(Value *V) {
   }
 
   Instruction* I = cast<Instruction>(V);
+  SmallVector<uint32_t, 4> Args;
   Expression exp;
   switch (I->getOpcode()) {
     case Instruction::Call:
@@ -440,18 +505,17 @@ uint32_t ValueTable::lookup_or_add(Value *V) {
     case Instruction::ShuffleVector:
     case Instruction::InsertValue:
     case Instruction::GetElementPtr:
-      exp = create_expression(I);
+      exp = create_expression(I, Args);
       break;
     case Instruction::ExtractValue:
-      exp = create_extractvalue_expression(cast<ExtractValueInst>(I));
+      exp = create_extractvalue_expression(cast<ExtractValueInst>(I), Args);
       break;
     default:
       valueNumbering[V] = nextValueNumber;
       return nextValueNumber++;
   }
 
-  uint32_t& e = expressionNumbering[exp];
-  if (!e) e = nextValueNumber++;
+  uint32_t e = lookup_or_add_expression(exp);
   valueNumbering[V] = e;
   return e;
 }
@@ -471,16 +535,16 @@ uint32_t ValueTable::lookup(Value *V) const {
 uint32_t ValueTable::lookup_or_add_cmp(unsigned Opcode,
                                        CmpInst::Predicate Predicate,
                                        Value *LHS, Value *RHS) {
-  Expression exp = create_cmp_expression(Opcode, Predicate, LHS, RHS);
-  uint32_t& e = expressionNumbering[exp];
-  if (!e) e = nextValueNumber++;
-  return e;
+  SmallVector<uint32_t, 2> Args;
+  return lookup_or_add_expression(
+      create_cmp_expression(Opcode, Predicate, LHS, RHS, Args));
 }
 
 /// clear - Remove all entries from the ValueTable.
 void ValueTable::clear() {
   valueNumbering.clear();
   expressionNumbering.clear();
+  ExpressionAllocator.Reset();
   nextValueNumber = 1;
 }
 
@@ -607,6 +671,12 @@ namespace {
 
     SmallVector<Instruction*, 8> InstrsToErase;
 
+    /// SkipPRE - Set for functions too large to PRE.
+    bool SkipPRE;
+    /// NonLocalLoadDeps - The number of dependencies of the non-local loads
+    /// looked at so far in this function.
+    unsigned NonLocalLoadDeps;
+
     typedef SmallVector<NonLocalDepResult, 64> LoadDepVect;
     typedef SmallVector<AvailableValueInBlock, 64> AvailValInBlkVect;
     typedef SmallVector<BasicBlock*, 64> UnavailBlkVect;
@@ -1701,6 +1771,13 @@ bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
 /// processNonLocalLoad - Attempt to eliminate a load whose dependencies are
 /// non-local by performing PHI construction.
 bool GVN::processNonLocalLoad(LoadInst *LI) {
+  // If the loads looked at so far had too many dependencies, give up on the
+  // rest of the function.
+  if (NonLocalLoadDeps > MaxNonLocalLoadDeps) {
+    ++NumLoadsSkipped;
+    return false;
+  }
+
   // Step 1: Find the non-local dependencies of the load.
   LoadDepVect Deps;
   AliasAnalysis::Location Loc = VN.getAliasAnalysis()->getLocation(LI);
@@ -1710,6 +1787,7 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
   // dependencies, this load isn't worth worrying about.  Optimizing
   // it will be too expensive.
   unsigned NumDeps = Deps.size();
+  NonLocalLoadDeps += NumDeps;
   if (NumDeps > 100)
     return false;
 
@@ -1757,7 +1835,7 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
   }
 
   // Step 4: Eliminate partial redundancy.
-  if (!EnablePRE || !EnableLoadPRE)
+  if (!EnablePRE || !EnableLoadPRE || SkipPRE)
     return false;
 
   return PerformLoadPRE(LI, ValuesPerBlock, UnavailableBlocks);
@@ -2340,24 +2418,37 @@ bool GVN::runOnFunction(Function& F) {
 
   // Merge unconditional branches, allowing PRE to catch more
   // optimization opportunities.
-  for (Function::iterator FI = F.begin(), FE = F.end(); FI != FE; ) {
-    BasicBlock *BB = FI++;
+  {
+    NamedRegionTimer T("Block Merging", TimerGroupName, TimePassesIsEnabled);
+    for (Function::iterator FI = F.begin(), FE = F.end(); FI != FE; ) {
+      BasicBlock *BB = FI++;
 
-    bool removedBlock = MergeBlockIntoPredecessor(BB, this);
-    if (removedBlock) ++NumGVNBlocks;
+      bool removedBlock = MergeBlockIntoPredecessor(BB, this);
+      if (removedBlock) ++NumGVNBlocks;
 
-    Changed |= removedBlock;
+      Changed |= removedBlock;
+    }
   }
 
-  unsigned Iteration = 0;
-  while (ShouldContinue) {
-    DEBUG(dbgs() << "GVN iteration: " << Iteration << "\n");
-    ShouldContinue = iterateOnFunction(F);
-    Changed |= ShouldContinue;
-    ++Iteration;
+  SkipPRE = F.size() > MaxPREBlocks;
+  if (SkipPRE)
+    ++NumPRESkipped;
+  NonLocalLoadDeps = 0;
+
+  {
+    NamedRegionTimer T("Value Numbering", TimerGroupName,
+                       TimePassesIsEnabled);
+    unsigned Iteration = 0;
+    while (ShouldContinue) {
+      DEBUG(dbgs() << "GVN iteration: " << Iteration << "\n");
+      ShouldContinue = iterateOnFunction(F);
+      Changed |= ShouldContinue;
+      ++Iteration;
+    }
   }
 
-  if (EnablePRE) {
+  if (EnablePRE && !SkipPRE) {
+    NamedRegionTimer T("Scalar PRE", TimerGroupName, TimePassesIsEnabled);
     // Fabricate val-num for dead-code in order to suppress assertion in
     // performPRE().
     assignValNumForDeadCode();
@@ -237,10 +237,8 @@ bool LoopDeletion::runOnLoop(Loop *L, LPPassManager &LPM) {
   // Finally, the blocks from loopinfo.  This has to happen late because
   // otherwise our loop iterators won't work.
   LoopInfo &loopInfo = getAnalysis<LoopInfo>();
-  SmallPtrSet<BasicBlock*, 8> blocks;
-  blocks.insert(L->block_begin(), L->block_end());
-  for (BasicBlock *BB : blocks)
-    loopInfo.removeBlock(BB);
+  SmallVector<BasicBlock *, 8> blocks(L->block_begin(), L->block_end());
+  loopInfo.removeBlocks(blocks);
 
   // The last step is to inform the loop pass manager that we've
   // eliminated this loop.
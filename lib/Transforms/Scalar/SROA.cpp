@@ -75,6 +75,7 @@ STATISTIC(NumPromoted, "Number of allocas promoted to SSA values");
 STATISTIC(NumLoadsSpeculated, "Number of loads speculated to allow promotion");
 STATISTIC(NumDeleted, "Number of instructions deleted");
 STATISTIC(NumVectorized, "Number of vectorized aggregates");
+STATISTIC(NumTooManySlices, "Number of allocas with too many slices to split");
 
 /// Hidden option to force the pass to not use DomTree and mem2reg, instead
 /// forming SSA values through the SSAUpdater infrastructure.
@@ -91,6 +92,12 @@ static cl::opt<bool> SROARandomShuffleSlices("sroa-random-shuffle-slices",
 static cl::opt<bool> SROAStrictInbounds("sroa-strict-inbounds",
                                         cl::init(false), cl::Hidden);
 
+/// Hidden option to bound the number of slices built for one alloca. An alloca
+/// with more slices than this is not split, only promoted if it can be as a
+/// whole.
+static cl::opt<unsigned> SROAMaxAllocaSlices("sroa-max-alloca-slices",
+                                             cl::init(16384), cl::Hidden);
+
 namespace {
 /// \brief A custom IRBuilder inserter which prefixes all names if they are
 /// preserved.
@@ -213,7 +220,11 @@ namespace {
 class AllocaSlices {
 public:
   /// \brief Construct the slices of a particular alloca.
-  AllocaSlices(const DataLayout &DL, AllocaInst &AI);
+  ///
+  /// The slices are built in \p Storage, which is cleared first. This lets the
+  /// memory for them be reused from one alloca to the next.
+  AllocaSlices(const DataLayout &DL, AllocaInst &AI,
+               SmallVectorImpl<Slice> &Storage);
 
   /// \brief Test whether a pointer to the allocation escapes our analysis.
   ///
@@ -221,6 +232,12 @@ public:
   /// ignored.
   bool isEscaped() const { return PointerEscapingInstr; }
 
+  /// \brief Test whether building the slices was given up because there were
+  /// more than -sroa-max-alloca-slices of them.
+  ///
+  /// If this is true, isEscaped() is true as well.
+  bool hasTooManySlices() const { return TooManySlices; }
+
   /// \brief Support for iterating over the slices.
   /// @{
   typedef SmallVectorImpl<Slice>::iterator iterator;
@@ -284,13 +301,16 @@ private:
   /// alloca. This will be null if the alloca slices are analyzed successfully.
   Instruction *PointerEscapingInstr;
 
+  /// \brief Whether the builder stopped because there were too many slices.
+  bool TooManySlices;
+
   /// \brief The slices of the alloca.
   ///
   /// We store a vector of the slices formed by uses of the alloca here. This
   /// vector is sorted by increasing begin offset, and then the unsplittable
   /// slices before the splittable ones. See the Slice inner class for more
   /// details.
-  SmallVector<Slice, 8> Slices;
+  SmallVectorImpl<Slice> &Slices;
 
   /// \brief Instructions which will become dead if we rewrite the alloca.
   ///
@@ -393,6 +413,13 @@ private:
       EndOffset = AllocSize;
     }
 
+    // Give up on allocas with so many slices that building and sorting them
+    // would take too much time and memory.
+    if (S.Slices.size() >= SROAMaxAllocaSlices) {
+      S.TooManySlices = true;
+      return PI.setAborted(&I);
+    }
+
     S.Slices.push_back(Slice(BeginOffset, EndOffset, U, IsSplittable));
   }
 
@@ -720,12 +747,14 @@ private:
   }
 };
 
-AllocaSlices::AllocaSlices(const DataLayout &DL, AllocaInst &AI)
+AllocaSlices::AllocaSlices(const DataLayout &DL, AllocaInst &AI,
+                           SmallVectorImpl<Slice> &Storage)
     :
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
       AI(AI),
 #endif
-      PointerEscapingInstr(nullptr) {
+      PointerEscapingInstr(nullptr), TooManySlices(false), Slices(Storage) {
+  Slices.clear();
   SliceBuilder PB(DL, AI, *this);
   SliceBuilder::PtrInfo PtrI = PB.visitPtr(AI);
   if (PtrI.isEscaped() || PtrI.isAborted()) {
@@ -774,6 +803,12 @@ void AllocaSlices::printUse(raw_ostream &OS, const_iterator I,
 }
 
 void AllocaSlices::print(raw_ostream &OS) const {
+  if (TooManySlices) {
+    OS << "Too many slices for alloca: " << AI << "\n"
+       << "  Stopped at:\n"
+       << "  " << *PointerEscapingInstr << "\n";
+    return;
+  }
   if (PointerEscapingInstr) {
     OS << "Can't analyze slices for alloca: " << AI << "\n"
        << "  A pointer to this alloca escaped by:\n"
@@ -952,6 +987,10 @@ class SROA : public FunctionPass {
   /// \brief A collection of alloca instructions we can directly promote.
   std::vector<AllocaInst *> PromotableAllocas;
 
+  /// \brief Storage for the slices of the alloca being split, kept so that its
+  /// memory is reused for the next one.
+  SmallVector<Slice, 16> SliceStorage;
+
   /// \brief A worklist of PHIs to speculate prior to promoting allocas.
   ///
   /// All of these PHIs have been checked for the safety of speculation and by
@@ -3448,8 +3487,18 @@ bool SROA::runOnAlloca(AllocaInst &AI) {
   Changed |= AggRewriter.rewrite(AI);
 
   // Build the slices using a recursive instruction-visiting builder.
-  AllocaSlices S(*DL, AI);
+  AllocaSlices S(*DL, AI, SliceStorage);
   DEBUG(S.print(dbgs()));
+  if (S.hasTooManySlices()) {
+    // Fall back to promoting the alloca as a whole when that is possible.
+    DEBUG(dbgs() << "  Too many slices, not splitting the alloca\n");
+    ++NumTooManySlices;
+    if (isAllocaPromotable(&AI) &&
+        std::find(PromotableAllocas.begin(), PromotableAllocas.end(), &AI) ==
+            PromotableAllocas.end())
+      PromotableAllocas.push_back(&AI);
+    return Changed;
+  }
   if (S.isEscaped())
     return Changed;
 
@@ -300,6 +300,7 @@ bool llvm::UnrollLoop(Loop *L, unsigned Count, unsigned TripCount,
 
   for (unsigned It = 1; It != Count; ++It) {
     std::vector<BasicBlock*> NewBlocks;
+    DenseMap<Loop *, Loop *> NewLoops;
 
     for (LoopBlocksDFS::RPOIterator BB = BlockBegin; BB != BlockEnd; ++BB) {
       ValueToValueMapTy VMap;
@@ -325,7 +326,24 @@ bool llvm::UnrollLoop(Loop *L, unsigned Count, unsigned TripCount,
            VI != VE; ++VI)
         LastValueMap[VI->first] = VI->second;
 
-      L->addBasicBlockToLoop(New, LI->getBase());
+      // The copies of the subloops of L are loops too.  A loop's header is
+      // the first of its blocks in RPO.
+      Loop *OldLoop = LI->getLoopFor(*BB);
+      if (OldLoop != L) {
+        Loop *&NewLoop = NewLoops[OldLoop];
+        if (!NewLoop) {
+          NewLoop = new Loop();
+          Loop *OldParent = OldLoop->getParentLoop();
+          Loop *NewParent = OldParent == L ? L : NewLoops[OldParent];
+          // Let the remaining loop passes visit the copy as well.
+          if (LPM)
+            LPM->insertLoop(NewLoop, NewParent);
+          else
+            NewParent->addChildLoop(NewLoop);
+        }
+        NewLoop->addBasicBlockToLoop(New, LI->getBase());
+      } else
+        L->addBasicBlockToLoop(New, LI->getBase());
 
       // Add phi entries for newly created values to all exit blocks.
       for (succ_iterator SI = succ_begin(*BB), SE = succ_end(*BB);
@@ -127,7 +127,9 @@ static void ConnectProlog(Loop *L, Value *TripCount, unsigned Count,
 }
 
 /// Create a clone of the blocks in a loop and connect them together.
-/// This function doesn't create a clone of the loop structure.
+/// This function doesn't create a clone of the loop structure, but the
+/// subloops of \p L are cloned and added to LoopInfo and to the queue of
+/// \p LPM.
 ///
 /// There are two value maps that are defined and used.  VMap is
 /// for the values in the current loop instance.  LVMap contains
@@ -142,7 +144,7 @@ static void CloneLoopBlocks(Loop *L,
                             LoopBlocksDFS &LoopBlocks,
                             ValueToValueMapTy &VMap,
                             ValueToValueMapTy &LVMap,
-                            LoopInfo *LI) {
+                            LoopInfo *LI, LPPassManager *LPM) {
 
   BasicBlock *Preheader = L->getLoopPreheader();
   BasicBlock *Header = L->getHeader();
@@ -150,13 +152,27 @@ static void CloneLoopBlocks(Loop *L,
   Function *F = Header->getParent();
   LoopBlocksDFS::RPOIterator BlockBegin = LoopBlocks.beginRPO();
   LoopBlocksDFS::RPOIterator BlockEnd = LoopBlocks.endRPO();
+  DenseMap<Loop *, Loop *> NewLoops;
   // For each block in the original loop, create a new copy,
   // and update the value map with the newly created values.
   for (LoopBlocksDFS::RPOIterator BB = BlockBegin; BB != BlockEnd; ++BB) {
     BasicBlock *NewBB = CloneBasicBlock(*BB, VMap, ".unr", F);
     NewBlocks.push_back(NewBB);
 
-    if (Loop *ParentLoop = L->getParentLoop())
+    // The copy of L is not a loop, but the copies of its subloops are.  The
+    // blocks are visited in RPO, so a loop's header comes first.
+    Loop *OldLoop = LI->getLoopFor(*BB);
+    if (OldLoop != L) {
+      Loop *&NewLoop = NewLoops[OldLoop];
+      if (!NewLoop) {
+        NewLoop = new Loop();
+        Loop *OldParent = OldLoop->getParentLoop();
+        Loop *NewParent = OldParent == L ? L->getParentLoop()
+                                         : NewLoops[OldParent];
+        LPM->insertLoop(NewLoop, NewParent);
+      }
+      NewLoop->addBasicBlockToLoop(NewBB, LI->getBase());
+    } else if (Loop *ParentLoop = L->getParentLoop())
       ParentLoop->addBasicBlockToLoop(NewBB, LI->getBase());
 
     VMap[*BB] = NewBB;
@@ -321,7 +337,7 @@ bool llvm::UnrollRuntimeLoopProlog(Loop *L, unsigned Count, LoopInfo *LI,
     // Clone all the basic blocks in the loop, but we don't clone the loop
     // This function adds the appropriate CFG connections.
     CloneLoopBlocks(L, (leftOverIters == Count-1), LastLoopBB, PEnd, NewBlocks,
-                    LoopBlocks, VMap, LVMap, LI);
+                    LoopBlocks, VMap, LVMap, LI, LPM);
     LastLoopBB = cast<BasicBlock>(VMap[Latch]);
 
     // Insert the cloned blocks into function just before the original loop
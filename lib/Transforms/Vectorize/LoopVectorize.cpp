@@ -209,6 +209,24 @@ static cl::opt<unsigned> MaxNestedScalarReductionUF(
     cl::desc("The maximum unroll factor to use when unrolling a scalar "
              "reduction in a nested loop."));
 
+/// This enables vectorizing groups of strided accesses that between them
+/// cover every element, such as A[2*i] and A[2*i+1], into a wide load or store
+/// and shufflevectors instead of scalarizing them.
+static cl::opt<bool> EnableInterleavedMemAccesses(
+    "enable-interleaved-mem-accesses", cl::init(false), cl::Hidden,
+    cl::desc("Enable vectorization of interleaved memory accesses"));
+
+static cl::opt<unsigned> MaxInterleaveGroupFactor(
+    "max-interleave-group-factor", cl::init(8), cl::Hidden,
+    cl::desc("The maximum stride, in elements, of an interleaved access "
+             "group."));
+
+static cl::opt<bool> EnableOuterLoopVectorization(
+    "enable-outer-loop-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Vectorize outer loops marked with llvm.loop.vectorize.enable "
+             "whose inner loop runs the same number of times in each "
+             "iteration"));
+
 namespace {
 
 // Forward declarations.
@@ -326,6 +344,11 @@ protected:
   /// A helper function to vectorize a single BB within the innermost loop.
   void vectorizeBlockInLoop(BasicBlock *BB, PhiVector *PV);
 
+  /// Vectorize the loop \p L nested in an outer loop. All of the lanes run
+  /// the same number of iterations, so the inner loop is rebuilt in the vector
+  /// body with its inductions kept scalar and its other values widened.
+  void vectorizeInnerLoop(Loop *L, PhiVector *PV);
+
   /// Vectorize a single PHINode in a block. This method handles the induction
   /// variable canonicalization. It supports both VF = 1 for unrolled loops and
   /// arbitrary length vectors.
@@ -346,6 +369,10 @@ protected:
   /// Vectorize Load and Store instructions,
   virtual void vectorizeMemoryInstruction(Instruction *Instr);
 
+  /// Vectorize the interleaved access group \p Instr is a member of, when
+  /// visiting the member the group's wide access is emitted at.
+  void vectorizeInterleaveGroup(Instruction *Instr);
+
   /// Create a broadcast instruction. This method generates a broadcast
   /// instruction (shuffle) for loop invariant values and for the induction
   /// value. If this is the induction variable then we extend it to N, N+1, ...
@@ -557,6 +584,70 @@ static void propagateMetadata(SmallVectorImpl<Value *> &To, const Instruction *F
       propagateMetadata(I, From);
 }
 
+/// \brief Propagate the known metadata that all of the instructions in \p From
+/// agree on to \p To.
+static void propagateMetadata(Instruction *To, ArrayRef<Instruction *> From) {
+  propagateMetadata(To, From[0]);
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> Metadata;
+  To->getAllMetadataOtherThanDebugLoc(Metadata);
+  for (auto M : Metadata)
+    for (Instruction *I : From.slice(1))
+      if (I->getMetadata(M.first) != M.second) {
+        To->setMetadata(M.first, nullptr);
+        break;
+      }
+}
+
+/// \brief A group of loads or stores in one block of the loop that, between
+/// them, access every element of an interleaved array. For example the real
+/// and imaginary parts of an array of complex numbers:
+///
+///   for (i = 0; i < N; ++i) {
+///     Re = A[2*i];      // Member of index 0
+///     Im = A[2*i + 1];  // Member of index 1
+///   }
+///
+/// Rather than scalarizing the members, the group is vectorized as one wide
+/// load (or store) of VF * Factor elements and shufflevectors that pick the
+/// members out of it (or interleave them into it).
+class InterleaveGroup {
+public:
+  InterleaveGroup(ArrayRef<Instruction *> Members, Instruction *InsertPos)
+      : Members(Members.begin(), Members.end()), InsertPos(InsertPos) {}
+
+  /// \returns the number of members, which is also their stride in elements.
+  unsigned getFactor() const { return Members.size(); }
+
+  /// \returns the member that accesses the element at \p Index modulo the
+  /// factor.
+  Instruction *getMember(unsigned Index) const { return Members[Index]; }
+
+  /// \returns the index of the member \p I.
+  unsigned getIndex(Instruction *I) const {
+    for (unsigned i = 0, e = Members.size(); i != e; ++i)
+      if (Members[i] == I)
+        return i;
+    llvm_unreachable("Instruction is not a member of the group");
+  }
+
+  /// \returns the member at which the wide access is emitted: the first load
+  /// of a load group, or the last store of a store group.
+  Instruction *getInsertPos() const { return InsertPos; }
+
+  /// \returns the alignment of the wide access, which starts where the member
+  /// of index 0 does.
+  unsigned getAlignment() const {
+    if (LoadInst *LI = dyn_cast<LoadInst>(Members[0]))
+      return LI->getAlignment();
+    return cast<StoreInst>(Members[0])->getAlignment();
+  }
+
+private:
+  SmallVector<Instruction *, 4> Members;
+  Instruction *InsertPos;
+};
+
 /// LoopVectorizationLegality checks if it is legal to vectorize a loop, and
 /// to what vectorization factor.
 /// This class does not look at the profitability of vectorization, only the
@@ -581,7 +672,8 @@ public:
                             AliasAnalysis *AA, Function *F)
       : NumLoads(0), NumStores(0), NumPredStores(0), TheLoop(L), SE(SE), DL(DL),
         DT(DT), TLI(TLI), AA(AA), TheFunction(F), Induction(nullptr),
-        WidestIndTy(nullptr), HasFunNoNaNAttr(false), MaxSafeDepDistBytes(-1U) {
+        WidestIndTy(nullptr), InnerLoop(nullptr), HasFunNoNaNAttr(false),
+        MaxSafeDepDistBytes(-1U) {
   }
 
   /// This enum represents the kinds of reductions that we support.
@@ -595,7 +687,8 @@ public:
     RK_IntegerMinMax, ///< Min/max implemented in terms of select(cmp()).
     RK_FloatAdd,    ///< Sum of floats.
     RK_FloatMult,   ///< Product of floats.
-    RK_FloatMinMax  ///< Min/max implemented in terms of select(cmp()).
+    RK_FloatMinMax, ///< Min/max implemented in terms of select(cmp()).
+    RK_MinMaxIndex  ///< Index of the first min/max of another reduction.
   };
 
   /// This enum represents the kinds of inductions that we support.
@@ -621,11 +714,12 @@ public:
   /// This struct holds information about reduction variables.
   struct ReductionDescriptor {
     ReductionDescriptor() : StartValue(nullptr), LoopExitInstr(nullptr),
-      Kind(RK_NoReduction), MinMaxKind(MRK_Invalid) {}
+      Kind(RK_NoReduction), MinMaxKind(MRK_Invalid), MinMaxPhi(nullptr) {}
 
     ReductionDescriptor(Value *Start, Instruction *Exit, ReductionKind K,
-                        MinMaxReductionKind MK)
-        : StartValue(Start), LoopExitInstr(Exit), Kind(K), MinMaxKind(MK) {}
+                        MinMaxReductionKind MK, PHINode *MinMax = nullptr)
+        : StartValue(Start), LoopExitInstr(Exit), Kind(K), MinMaxKind(MK),
+          MinMaxPhi(MinMax) {}
 
     // The starting value of the reduction.
     // It does not have to be zero!
@@ -634,8 +728,11 @@ public:
     Instruction *LoopExitInstr;
     // The kind of the reduction.
     ReductionKind Kind;
-    // If this a min/max reduction the kind of reduction.
+    // If this a min/max reduction the kind of reduction. For an index
+    // reduction, MRK_SIntMin or MRK_UIntMin depending on how indices compare.
     MinMaxReductionKind MinMaxKind;
+    // For an index reduction, the min/max reduction whose position it tracks.
+    PHINode *MinMaxPhi;
   };
 
   /// This POD struct holds information about a potential reduction operation.
@@ -727,6 +824,16 @@ public:
   /// Returns the widest induction type.
   Type *getWidestInductionType() { return WidestIndTy; }
 
+  /// Returns the loop nested in an outer loop that is vectorized, or null if
+  /// the loop is innermost.
+  Loop *getInnerLoop() { return InnerLoop; }
+
+  /// Returns the step of \p Phi if it is an induction of the inner loop that
+  /// takes the same value in all lanes, or null.
+  const SCEV *getInnerInductionStep(PHINode *Phi) {
+    return InnerInductions.lookup(Phi);
+  }
+
   /// Returns True if V is an induction variable in this loop.
   bool isInductionVariable(const Value *V);
 
@@ -766,6 +873,15 @@ public:
   }
   SmallPtrSet<Value *, 8>::iterator strides_end() { return StrideSet.end(); }
 
+  /// Returns the interleaved access group that \p I is a member of, or null.
+  const InterleaveGroup *getInterleaveGroup(Instruction *I) const {
+    DenseMap<Instruction *, unsigned>::const_iterator It =
+        InterleaveGroupMap.find(I);
+    if (It == InterleaveGroupMap.end())
+      return nullptr;
+    return &InterleaveGroups[It->second];
+  }
+
 private:
   /// Check if a single basic block loop is vectorizable.
   /// At this point we know that this is a loop with a constant trip count
@@ -782,9 +898,30 @@ private:
   /// transformation.
   bool canVectorizeWithIfConvert();
 
+  /// Return true if this outer loop can be vectorized with its inner loop
+  /// kept as a loop in the vector body. The inner loop must run the same
+  /// number of times for all lanes, and the rest of the loop must not branch.
+  bool canVectorizeOuterLoop();
+
+  /// Return true if running the iterations of this outer loop in lockstep
+  /// keeps the order of the memory accesses \p MemInsts that can depend on
+  /// each other. Each store must write a different address in each lane,
+  /// the same one throughout the inner loop, and any other access that may
+  /// alias it must go through the same pointer.
+  bool canVectorizeOuterLoopMemory(ArrayRef<Instruction *> MemInsts);
+
+  /// Returns the SCEV of \p V without the recurrences of the loops nested in
+  /// TheLoop whose step is invariant in TheLoop. These do not make the
+  /// lanes differ.
+  const SCEV *getOuterSCEV(Value *V);
+
   /// Collect the variables that need to stay uniform after vectorization.
   void collectLoopUniforms();
 
+  /// Find the groups of strided loads and stores that can be vectorized as
+  /// one wide access each. See InterleaveGroup.
+  void analyzeInterleaving();
+
   /// Return true if all of the instructions in the block can be speculatively
   /// executed. \p SafePtrs is a list of addresses that are known to be legal
   /// and we know that we can read from them without segfault.
@@ -793,6 +930,12 @@ private:
   /// Returns True, if 'Phi' is the kind of reduction variable for type
   /// 'Kind'. If this is a reduction variable, it adds it to ReductionList.
   bool AddReductionVar(PHINode *Phi, ReductionKind Kind);
+  /// Returns true if 'Phi' records the induction value at which a min/max
+  /// reduction of the loop was last updated, as in
+  ///   if (a[i] > Max) { Max = a[i]; Idx = i; }
+  /// If so, it adds it to ReductionList. The min/max reduction itself is
+  /// checked once all the phis of the loop header are classified.
+  bool AddMinMaxIndexVar(PHINode *Phi);
   /// Returns a struct describing if the instruction 'I' can be a reduction
   /// variable of type 'Kind'. If the reduction is a min/max pattern of
   /// select(icmp()) this function advances the instruction pointer 'I' from the
@@ -852,6 +995,10 @@ private:
   InductionList Inductions;
   /// Holds the widest induction type encountered.
   Type *WidestIndTy;
+  /// The inner loop when vectorizing an outer loop.
+  Loop *InnerLoop;
+  /// The inductions of the inner loop that stay scalar, with their steps.
+  DenseMap<PHINode *, const SCEV *> InnerInductions;
 
   /// Allowed outside users. This holds the reduction
   /// vars which can be accessed from outside the loop.
@@ -869,6 +1016,11 @@ private:
 
   ValueToValueMap Strides;
   SmallPtrSet<Value *, 8> StrideSet;
+
+  /// Holds the interleaved access groups, and maps each of their members to
+  /// the index of its group.
+  SmallVector<InterleaveGroup, 4> InterleaveGroups;
+  DenseMap<Instruction *, unsigned> InterleaveGroupMap;
 };
 
 /// LoopVectorizationCostModel - estimates the expected speedups due to
@@ -898,6 +1050,11 @@ public:
   /// possible.
   VectorizationFactor selectVectorizationFactor(bool OptForSize);
 
+  /// \return The vectorization factor of an outer loop: the width requested
+  /// by the user, or else as many lanes of the widest type as fit in a vector
+  /// register.
+  unsigned selectOuterLoopVectorizationFactor();
+
   /// \return The size (in bits) of the widest type in the code that
   /// needs to be vectorized. We ignore values that remain scalar such as
   /// 64 bit loop indices.
@@ -1160,6 +1317,14 @@ static void addInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
   if (L.empty())
     return V.push_back(&L);
 
+  // Outer loops that the user asked to vectorize are tried first, before
+  // their inner loop.
+  if (EnableOuterLoopVectorization && L.getSubLoops().size() == 1 &&
+      L.getSubLoops()[0]->empty() &&
+      LoopVectorizeHints(&L, true).getForce() ==
+          LoopVectorizeHints::FK_Enabled)
+    return V.push_back(&L);
+
   for (Loop *InnerL : L)
     addInnerLoop(*InnerL, V);
 }
@@ -1228,8 +1393,15 @@ struct LoopVectorize : public FunctionPass {
 
     // Now walk the identified inner loops.
     bool Changed = false;
-    while (!Worklist.empty())
-      Changed |= processLoop(Worklist.pop_back_val());
+    while (!Worklist.empty()) {
+      Loop *L = Worklist.pop_back_val();
+      if (L->empty())
+        Changed |= processLoop(L);
+      else if (processOuterLoop(L))
+        Changed = true;
+      else
+        Changed |= processLoop(L->getSubLoops()[0]);
+    }
 
     // Process each loop nest in the function.
     return Changed;
@@ -1404,6 +1576,53 @@ struct LoopVectorize : public FunctionPass {
     return true;
   }
 
+  /// Vectorize the outer loop \p L, which has a single inner loop and is
+  /// marked with llvm.loop.vectorize.enable.
+  bool processOuterLoop(Loop *L) {
+    DEBUG(dbgs() << "\nLV: Checking an outer loop in \""
+                 << L->getHeader()->getParent()->getName() << "\" from "
+                 << getDebugLocString(L) << "\n");
+
+    LoopVectorizeHints Hints(L, true);
+    Function *F = L->getHeader()->getParent();
+    if (Hints.getWidth() == 1) {
+      DEBUG(dbgs() << "LV: Not vectorizing: Disabled/already vectorized.\n");
+      return false;
+    }
+
+    LoopVectorizationLegality LVL(L, SE, DL, DT, TLI, AA, F);
+    if (!LVL.canVectorize()) {
+      DEBUG(dbgs() << "LV: Not vectorizing outer loop: Cannot prove "
+                      "legality.\n");
+      return false;
+    }
+
+    if (F->hasFnAttribute(Attribute::NoImplicitFloat)) {
+      DEBUG(dbgs() << "LV: Can't vectorize when the NoImplicitFloat"
+            "attribute is used.\n");
+      return false;
+    }
+
+    LoopVectorizationCostModel CM(L, SE, LI, &LVL, *TTI, DL, TLI, F, &Hints);
+    unsigned VF = CM.selectOuterLoopVectorizationFactor();
+    DEBUG(dbgs() << "LV: Found a vectorizable outer loop (" << VF << ")\n");
+    if (VF == 1)
+      return false;
+
+    InnerLoopVectorizer LB(L, SE, LI, DT, DL, TLI, VF, 1);
+    LB.vectorize(&LVL);
+    ++LoopsVectorized;
+
+    emitOptimizationRemark(F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
+                           Twine("vectorized outer loop (vectorization "
+                                 "factor: ") + Twine(VF) + ")");
+
+    Hints.setAlreadyVectorized(L);
+
+    DEBUG(verifyFunction(*L->getHeader()->getParent()));
+    return true;
+  }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequiredID(LoopSimplifyID);
     AU.addRequiredID(LCSSAID);
@@ -1587,7 +1806,7 @@ int LoopVectorizationLegality::isConsecutivePtr(Value *Ptr) {
 
     // Make sure that all of the index operands are loop invariant.
     for (unsigned i = 1; i < NumOperands; ++i)
-      if (!SE->isLoopInvariant(SE->getSCEV(Gep->getOperand(i)), TheLoop))
+      if (!isUniform(Gep->getOperand(i)))
         return 0;
 
     InductionInfo II = Inductions[Phi];
@@ -1602,15 +1821,14 @@ int LoopVectorizationLegality::isConsecutivePtr(Value *Ptr) {
   // Check that all of the gep indices are uniform except for our induction
   // operand.
   for (unsigned i = 0; i != NumOperands; ++i)
-    if (i != InductionOperand &&
-        !SE->isLoopInvariant(SE->getSCEV(Gep->getOperand(i)), TheLoop))
+    if (i != InductionOperand && !isUniform(Gep->getOperand(i)))
       return 0;
 
   // We can emit wide load/stores only if the last non-zero index is the
   // induction variable.
   const SCEV *Last = nullptr;
   if (!Strides.count(Gep))
-    Last = SE->getSCEV(Gep->getOperand(InductionOperand));
+    Last = getOuterSCEV(Gep->getOperand(InductionOperand));
   else {
     // Because of the multiplication by a stride we can have a s/zext cast.
     // We are going to replace this stride by 1 so the cast is safe to ignore.
@@ -1643,8 +1861,20 @@ int LoopVectorizationLegality::isConsecutivePtr(Value *Ptr) {
   return 0;
 }
 
+const SCEV *LoopVectorizationLegality::getOuterSCEV(Value *V) {
+  const SCEV *S = SE->getSCEV(V);
+  while (const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(S)) {
+    if (AR->getLoop() == TheLoop || !TheLoop->contains(AR->getLoop()) ||
+        !AR->isAffine() ||
+        !SE->isLoopInvariant(AR->getStepRecurrence(*SE), TheLoop))
+      break;
+    S = AR->getStart();
+  }
+  return S;
+}
+
 bool LoopVectorizationLegality::isUniform(Value *V) {
-  return (SE->isLoopInvariant(SE->getSCEV(V), TheLoop));
+  return (SE->isLoopInvariant(getOuterSCEV(V), TheLoop));
 }
 
 InnerLoopVectorizer::VectorParts&
@@ -1677,6 +1907,142 @@ Value *InnerLoopVectorizer::reverseVector(Value *Vec) {
                                      "reverse");
 }
 
+/// \brief Returns the mask that picks every \p Stride'th of \p VF elements,
+/// starting at \p Start: <Start, Start + Stride, ..., Start + (VF-1) * Stride>.
+static Constant *getStrideMask(IRBuilder<> &Builder, unsigned Start,
+                               unsigned Stride, unsigned VF) {
+  SmallVector<Constant *, 16> Mask;
+  for (unsigned i = 0; i < VF; ++i)
+    Mask.push_back(Builder.getInt32(Start + i * Stride));
+  return ConstantVector::get(Mask);
+}
+
+/// \brief Returns the mask that interleaves \p NumVecs vectors of \p VF
+/// elements that have been concatenated:
+/// <0, VF, 2*VF, ..., 1, VF+1, 2*VF+1, ...>.
+static Constant *getInterleaveMask(IRBuilder<> &Builder, unsigned VF,
+                                   unsigned NumVecs) {
+  SmallVector<Constant *, 16> Mask;
+  for (unsigned i = 0; i < VF; ++i)
+    for (unsigned j = 0; j < NumVecs; ++j)
+      Mask.push_back(Builder.getInt32(j * VF + i));
+  return ConstantVector::get(Mask);
+}
+
+/// \brief Concatenate two vectors. The second may be shorter than the first,
+/// in which case it is padded with undef first.
+static Value *concatenateTwoVectors(IRBuilder<> &Builder, Value *V1,
+                                    Value *V2) {
+  unsigned NumElts1 = V1->getType()->getVectorNumElements();
+  unsigned NumElts2 = V2->getType()->getVectorNumElements();
+  assert(NumElts1 >= NumElts2 && "Unexpected vector lengths");
+
+  if (NumElts1 > NumElts2) {
+    SmallVector<Constant *, 16> ExtMask;
+    for (unsigned i = 0; i < NumElts1; ++i)
+      ExtMask.push_back(i < NumElts2 ? cast<Constant>(Builder.getInt32(i))
+                                     : UndefValue::get(Builder.getInt32Ty()));
+    V2 = Builder.CreateShuffleVector(V2, UndefValue::get(V2->getType()),
+                                     ConstantVector::get(ExtMask));
+  }
+
+  SmallVector<Constant *, 16> Mask;
+  for (unsigned i = 0; i < NumElts1 + NumElts2; ++i)
+    Mask.push_back(Builder.getInt32(i));
+  return Builder.CreateShuffleVector(V1, V2, ConstantVector::get(Mask));
+}
+
+/// \brief Concatenate the vectors in \p Vecs, which all have the same type,
+/// pairwise into one.
+static Value *concatenateVectors(IRBuilder<> &Builder, ArrayRef<Value *> Vecs) {
+  SmallVector<Value *, 8> List(Vecs.begin(), Vecs.end());
+  while (List.size() > 1) {
+    SmallVector<Value *, 8> Next;
+    for (unsigned i = 0; i + 1 < List.size(); i += 2)
+      Next.push_back(concatenateTwoVectors(Builder, List[i], List[i + 1]));
+    if (List.size() % 2)
+      Next.push_back(List.back());
+    List.swap(Next);
+  }
+  return List[0];
+}
+
+void InnerLoopVectorizer::vectorizeInterleaveGroup(Instruction *Instr) {
+  const InterleaveGroup *Group = Legal->getInterleaveGroup(Instr);
+  assert(Group && "Not a member of an interleaved access group");
+
+  // The other members are vectorized along with the insert position.
+  if (Instr != Group->getInsertPos())
+    return;
+
+  LoadInst *LI = dyn_cast<LoadInst>(Instr);
+  StoreInst *SI = dyn_cast<StoreInst>(Instr);
+  Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+  Type *ScalarTy = LI ? LI->getType() : SI->getValueOperand()->getType();
+  unsigned Factor = Group->getFactor();
+  Type *VecTy = VectorType::get(ScalarTy, VF * Factor);
+  unsigned AddressSpace = Ptr->getType()->getPointerAddressSpace();
+  unsigned Alignment = Group->getAlignment();
+  if (!Alignment)
+    Alignment = DL->getABITypeAlignment(ScalarTy);
+
+  SmallVector<Instruction *, 8> Members;
+  for (unsigned i = 0; i < Factor; ++i)
+    Members.push_back(Group->getMember(i));
+
+  // The wide access starts at the member of index 0, so step back from the
+  // address the insert position accesses in lane 0.
+  setDebugLocFromInst(Builder, Ptr);
+  VectorParts &PtrParts = getVectorValue(Ptr);
+  int Index = Group->getIndex(Instr);
+  SmallVector<Value *, 2> NewPtrs;
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    Value *NewPtr =
+        Builder.CreateExtractElement(PtrParts[Part], Builder.getInt32(0));
+    if (Index)
+      NewPtr = Builder.CreateGEP(NewPtr, Builder.getInt32(-Index));
+    NewPtrs.push_back(
+        Builder.CreateBitCast(NewPtr, VecTy->getPointerTo(AddressSpace)));
+  }
+
+  // Handle loads: member i takes the elements i, i + Factor, i + 2 * Factor,
+  // ... of the wide vector.
+  if (LI) {
+    setDebugLocFromInst(Builder, LI);
+    for (unsigned Part = 0; Part < UF; ++Part) {
+      LoadInst *NewLI =
+          Builder.CreateAlignedLoad(NewPtrs[Part], Alignment, "wide.vec");
+      propagateMetadata(NewLI, Members);
+
+      for (unsigned i = 0; i < Factor; ++i) {
+        Value *StridedVec = Builder.CreateShuffleVector(
+            NewLI, UndefValue::get(VecTy), getStrideMask(Builder, i, Factor, VF),
+            "strided.vec");
+        WidenMap.get(Members[i])[Part] = StridedVec;
+      }
+    }
+    return;
+  }
+
+  // Handle stores: concatenate the values of the members and interleave them.
+  setDebugLocFromInst(Builder, SI);
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    SmallVector<Value *, 8> StoredVecs;
+    for (unsigned i = 0; i < Factor; ++i) {
+      Value *StoredVal = cast<StoreInst>(Members[i])->getValueOperand();
+      StoredVecs.push_back(getVectorValue(StoredVal)[Part]);
+    }
+
+    Value *WideVec = concatenateVectors(Builder, StoredVecs);
+    Value *IVec = Builder.CreateShuffleVector(
+        WideVec, UndefValue::get(VecTy), getInterleaveMask(Builder, VF, Factor),
+        "interleaved.vec");
+    StoreInst *NewSI =
+        Builder.CreateAlignedStore(IVec, NewPtrs[Part], Alignment);
+    propagateMetadata(NewSI, Members);
+  }
+}
+
 void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
   // Attempt to issue a wide load.
   LoadInst *LI = dyn_cast<LoadInst>(Instr);
@@ -1702,17 +2068,38 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
   if (ScalarAllocatedSize != VectorElementSize)
     return scalarizeInstruction(Instr);
 
+  if (Legal->getInterleaveGroup(Instr))
+    return vectorizeInterleaveGroup(Instr);
+
   // If the pointer is loop invariant or if it is non-consecutive,
   // scalarize the load.
   int ConsecutiveStride = Legal->isConsecutivePtr(Ptr);
   bool Reverse = ConsecutiveStride < 0;
-  bool UniformLoad = LI && Legal->isUniform(Ptr);
-  if (!ConsecutiveStride || UniformLoad)
+  // When vectorizing an outer loop, a load that is invariant in the outer
+  // loop is loaded once per part and broadcast.
+  bool UniformLoad = LI && Legal->getInnerLoop() && Legal->isUniform(Ptr);
+  if (!ConsecutiveStride && !UniformLoad)
     return scalarizeInstruction(Instr);
 
   Constant *Zero = Builder.getInt32(0);
   VectorParts &Entry = WidenMap.get(Instr);
 
+  // All of the lanes load the same value, so load it once and broadcast it.
+  if (UniformLoad) {
+    setDebugLocFromInst(Builder, LI);
+    Instruction *PtrInst = dyn_cast<Instruction>(Ptr);
+    for (unsigned Part = 0; Part < UF; ++Part) {
+      Value *Addr = Ptr;
+      if (PtrInst && OrigLoop->contains(PtrInst))
+        Addr = Builder.CreateExtractElement(getVectorValue(Ptr)[Part], Zero);
+      LoadInst *NewLI = Builder.CreateAlignedLoad(Addr, Alignment,
+                                                  LI->getName() + ".uniform");
+      propagateMetadata(NewLI, LI);
+      Entry[Part] = getBroadcastInstrs(NewLI);
+    }
+    return;
+  }
+
   // Handle consecutive loads/stores.
   GetElementPtrInst *Gep = dyn_cast<GetElementPtrInst>(Ptr);
   if (Gep && Legal->isInductionVariable(Gep->getPointerOperand())) {
@@ -1728,8 +2115,8 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
     Ptr = Builder.Insert(Gep2);
   } else if (Gep) {
     setDebugLocFromInst(Builder, Gep);
-    assert(SE->isLoopInvariant(SE->getSCEV(Gep->getPointerOperand()),
-                               OrigLoop) && "Base ptr must be invariant");
+    assert(Legal->isUniform(Gep->getPointerOperand()) &&
+           "Base ptr must be invariant");
 
     // The last index does not have to be the induction. It can be
     // consecutive and be a function of the index. For example A[I+1];
@@ -1745,8 +2132,7 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
       // Update last index or loop invariant instruction anchored in loop.
       if (i == InductionOperand ||
           (GepOperandInst && OrigLoop->contains(GepOperandInst))) {
-        assert((i == InductionOperand ||
-               SE->isLoopInvariant(SE->getSCEV(GepOperandInst), OrigLoop)) &&
+        assert((i == InductionOperand || Legal->isUniform(GepOperandInst)) &&
                "Must be last index or loop invariant");
 
         VectorParts &GEPParts = getVectorValue(GepOperand);
@@ -2552,6 +2938,8 @@ getReductionBinOp(LoopVectorizationLegality::ReductionKind Kind) {
       return Instruction::ICmp;
     case LoopVectorizationLegality::RK_FloatMinMax:
       return Instruction::FCmp;
+    case LoopVectorizationLegality::RK_MinMaxIndex:
+      return Instruction::ICmp;
     default:
       llvm_unreachable("Unknown reduction operation");
   }
@@ -2697,9 +3085,14 @@ void InnerLoopVectorizer::vectorizeLoop() {
   DFS.perform(LI);
 
   // Vectorize all of the blocks in the original loop.
+  Loop *InnerLp = Legal->getInnerLoop();
   for (LoopBlocksDFS::RPOIterator bb = DFS.beginRPO(),
-       be = DFS.endRPO(); bb != be; ++bb)
-    vectorizeBlockInLoop(*bb, &RdxPHIsToFix);
+       be = DFS.endRPO(); bb != be; ++bb) {
+    if (InnerLp && *bb == InnerLp->getHeader())
+      vectorizeInnerLoop(InnerLp, &RdxPHIsToFix);
+    else
+      vectorizeBlockInLoop(*bb, &RdxPHIsToFix);
+  }
 
   // At this point every instruction in the original loop is widened to
   // a vector form. We are almost done. Now, we need to fix the PHI nodes
@@ -2707,6 +3100,15 @@ void InnerLoopVectorizer::vectorizeLoop() {
   // not want to introduce cycles. Notice that the remaining PHI nodes
   // that we need to fix are reduction variables.
 
+  // Index reductions are reduced after the min/max they follow, whose vector
+  // and reduced values are kept here.
+  std::stable_partition(RdxPHIsToFix.begin(), RdxPHIsToFix.end(),
+                        [&](PHINode *P) {
+    return (*Legal->getReductionVars())[P].Kind !=
+           LoopVectorizationLegality::RK_MinMaxIndex;
+  });
+  DenseMap<PHINode *, std::pair<VectorParts, Value *> > MinMaxResults;
+
   // Create the 'reduced' values for each of the induction vars.
   // The reduced values are the vector values that we scalarize and combine
   // after the loop is finished.
@@ -2738,7 +3140,8 @@ void InnerLoopVectorizer::vectorizeLoop() {
     Value *Identity;
     Value *VectorStart;
     if (RdxDesc.Kind == LoopVectorizationLegality::RK_IntegerMinMax ||
-        RdxDesc.Kind == LoopVectorizationLegality::RK_FloatMinMax) {
+        RdxDesc.Kind == LoopVectorizationLegality::RK_FloatMinMax ||
+        RdxDesc.Kind == LoopVectorizationLegality::RK_MinMaxIndex) {
       // MinMax reduction have the start value as their identify.
       if (VF == 1) {
         VectorStart = Identity = RdxDesc.StartValue;
@@ -2808,6 +3211,37 @@ void InnerLoopVectorizer::vectorizeLoop() {
       RdxParts.push_back(NewPhi);
     }
 
+    // An index reduction only keeps the lanes that hold the final min/max,
+    // and then takes the least of their indices.
+    if (RdxDesc.Kind == LoopVectorizationLegality::RK_MinMaxIndex) {
+      // The reduced min/max is computed below the phis.
+      Builder.SetInsertPoint(LoopMiddleBlock->getTerminator());
+      assert(MinMaxResults.count(RdxDesc.MinMaxPhi) &&
+             "Min/max reduced after its index");
+      std::pair<VectorParts, Value *> &MinMax =
+          MinMaxResults[RdxDesc.MinMaxPhi];
+      Value *Final = MinMax.second;
+      IntegerType *IdxTy = cast<IntegerType>(RdxPhi->getType());
+      Value *None = ConstantInt::get(
+          IdxTy, RdxDesc.MinMaxKind == LoopVectorizationLegality::MRK_SIntMin
+                     ? APInt::getSignedMaxValue(IdxTy->getBitWidth())
+                     : APInt::getMaxValue(IdxTy->getBitWidth()));
+      if (VF > 1) {
+        Final = Builder.CreateVectorSplat(VF, Final, "minmax.splat");
+        None = Builder.CreateVectorSplat(VF, None);
+      }
+      for (unsigned part = 0; part < UF; ++part) {
+        Value *IsMinMax =
+            Final->getType()->isFPOrFPVectorTy()
+                ? Builder.CreateFCmpOEQ(MinMax.first[part], Final,
+                                        "rdx.idx.cmp")
+                : Builder.CreateICmpEQ(MinMax.first[part], Final,
+                                       "rdx.idx.cmp");
+        RdxParts[part] = Builder.CreateSelect(IsMinMax, RdxParts[part], None,
+                                              "rdx.idx.select");
+      }
+    }
+
     // Reduce all of the unrolled parts into a single vector.
     Value *ReducedPartRdx = RdxParts[0];
     unsigned Op = getReductionBinOp(RdxDesc.Kind);
@@ -2859,6 +3293,10 @@ void InnerLoopVectorizer::vectorizeLoop() {
                                                     Builder.getInt32(0));
     }
 
+    if (RdxDesc.Kind == LoopVectorizationLegality::RK_IntegerMinMax ||
+        RdxDesc.Kind == LoopVectorizationLegality::RK_FloatMinMax)
+      MinMaxResults[RdxPhi] = std::make_pair(RdxParts, ReducedPartRdx);
+
     // Create a phi node that merges control-flow from the backedge-taken check
     // block and the middle block.
     PHINode *BCBlockPhi = PHINode::Create(RdxPhi->getType(), 2, "bc.merge.rdx",
@@ -2979,6 +3417,18 @@ void InnerLoopVectorizer::widenPHIInstruction(Instruction *PN,
                                               InnerLoopVectorizer::VectorParts &Entry,
                                               unsigned UF, unsigned VF, PhiVector *PV) {
   PHINode* P = cast<PHINode>(PN);
+  // The phis of an inner loop are created by vectorizeInnerLoop, and the
+  // values that leave it need no select.
+  if (Loop *InnerLp = Legal->getInnerLoop()) {
+    if (P->getParent() == InnerLp->getHeader())
+      return;
+    if (P->getNumIncomingValues() == 1 &&
+        InnerLp->contains(P->getIncomingBlock(0))) {
+      Entry = getVectorValue(P->getIncomingValue(0));
+      return;
+    }
+  }
+
   // Handle reduction variables:
   if (Legal->getReductionVars()->count(P)) {
     for (unsigned part = 0; part < UF; ++part) {
@@ -3343,6 +3793,109 @@ void InnerLoopVectorizer::vectorizeBlockInLoop(BasicBlock *BB, PhiVector *PV) {
   }// end of for_each instr.
 }
 
+void InnerLoopVectorizer::vectorizeInnerLoop(Loop *L, PhiVector *PV) {
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  Constant *Zero = Builder.getInt32(0);
+
+  // The start values are computed before entering the new inner loop.
+  SmallVector<VectorParts, 4> Starts;
+  for (BasicBlock::iterator it = Header->begin(); isa<PHINode>(it); ++it) {
+    PHINode *P = cast<PHINode>(it);
+    Value *Start = P->getIncomingValueForBlock(Preheader);
+    VectorParts Parts(UF, Start);
+    Instruction *StartInst = dyn_cast<Instruction>(Start);
+    if (!Legal->getInnerInductionStep(P))
+      Parts = getVectorValue(Start);
+    else if (StartInst && OrigLoop->contains(StartInst)) {
+      // All of the lanes start from the same value.
+      Parts[0] = getVectorValue(Start)[0];
+      if (VF > 1)
+        Parts[0] = Builder.CreateExtractElement(Parts[0], Zero);
+    }
+    Starts.push_back(Parts);
+  }
+
+  // The loop bounds are the same in all of the lanes.
+  SCEVExpander Exp(*SE, "induction");
+  Instruction *Loc = LoopVectorPreHeader->getTerminator();
+  const SCEV *BackedgeCount = SE->getBackedgeTakenCount(L);
+  Value *Count = Exp.expandCodeFor(BackedgeCount, BackedgeCount->getType(), Loc);
+
+  // Split the vector body to hold the new inner loop.
+  Instruction *InsertPt = Builder.GetInsertPoint();
+  BasicBlock *Entry = InsertPt->getParent();
+  BasicBlock *Body = Entry->splitBasicBlock(InsertPt, "inner.vec.body");
+  Loop *VectorLp = LI->getLoopFor(Entry);
+  Loop *InnerLp = new Loop();
+  VectorLp->addChildLoop(InnerLp);
+  InnerLp->addBasicBlockToLoop(Body, LI->getBase());
+  LoopVectorBody.push_back(Body);
+  Builder.SetInsertPoint(InsertPt);
+
+  PHINode *Counter = PHINode::Create(Count->getType(), 2, "inner.index",
+                                     Body->getFirstNonPHI());
+  Counter->addIncoming(ConstantInt::get(Count->getType(), 0), Entry);
+
+  SmallVector<PHINode *, 4> NewPhis;
+  unsigned Idx = 0;
+  for (BasicBlock::iterator it = Header->begin(); isa<PHINode>(it);
+       ++it, ++Idx) {
+    PHINode *P = cast<PHINode>(it);
+    VectorParts &Parts = WidenMap.get(P);
+    if (Legal->getInnerInductionStep(P)) {
+      PHINode *NewPhi = PHINode::Create(P->getType(), 2, P->getName(),
+                                        Body->getFirstNonPHI());
+      NewPhi->addIncoming(Starts[Idx][0], Entry);
+      NewPhis.push_back(NewPhi);
+      WidenMap.splat(P, getBroadcastInstrs(NewPhi));
+      continue;
+    }
+    Type *VecTy = VF == 1 ? P->getType() : VectorType::get(P->getType(), VF);
+    for (unsigned Part = 0; Part < UF; ++Part) {
+      PHINode *NewPhi = PHINode::Create(VecTy, 2, "vec.phi",
+                                        Body->getFirstNonPHI());
+      NewPhi->addIncoming(Starts[Idx][Part], Entry);
+      NewPhis.push_back(NewPhi);
+      Parts[Part] = NewPhi;
+    }
+  }
+
+  vectorizeBlockInLoop(Header, PV);
+
+  // Step the inductions and count the iterations.
+  SmallVector<Value *, 4> Nexts;
+  for (BasicBlock::iterator it = Header->begin(); isa<PHINode>(it); ++it) {
+    PHINode *P = cast<PHINode>(it);
+    if (const SCEV *Step = Legal->getInnerInductionStep(P)) {
+      Value *StepV = Exp.expandCodeFor(Step, P->getType(), Loc);
+      Nexts.push_back(Builder.CreateAdd(NewPhis[Nexts.size()], StepV,
+                                        P->getName() + ".next"));
+      continue;
+    }
+    VectorParts &Next = getVectorValue(P->getIncomingValueForBlock(Header));
+    for (unsigned Part = 0; Part < UF; ++Part)
+      Nexts.push_back(Next[Part]);
+  }
+  Value *CountNext = Builder.CreateAdd(Counter,
+                                       ConstantInt::get(Count->getType(), 1),
+                                       "inner.index.next");
+  Value *Done = Builder.CreateICmpEQ(Counter, Count, "inner.done");
+
+  // Close the inner loop, and continue with the rest of the vector body.
+  InsertPt = Builder.GetInsertPoint();
+  BasicBlock *Exit = Body->splitBasicBlock(InsertPt, "inner.vec.exit");
+  ReplaceInstWithInst(Body->getTerminator(),
+                      BranchInst::Create(Exit, Body, Done));
+  VectorLp->addBasicBlockToLoop(Exit, LI->getBase());
+  LoopVectorBody.push_back(Exit);
+  Builder.SetInsertPoint(InsertPt);
+
+  Counter->addIncoming(CountNext, Body);
+  for (unsigned i = 0, e = NewPhis.size(); i != e; ++i)
+    NewPhis[i]->addIncoming(Nexts[i], Body);
+}
+
 void InnerLoopVectorizer::updateAnalysis() {
   // Forget the original basic block.
   SE->forgetLoop(OrigLoop);
@@ -3356,15 +3909,18 @@ void InnerLoopVectorizer::updateAnalysis() {
   DT->addNewBlock(LoopVectorPreHeader, LoopBypassBlocks.back());
 
   // Due to if predication of stores we might create a sequence of "if(pred)
-  // a[i] = ...;  " blocks.
-  for (unsigned i = 0, e = LoopVectorBody.size(); i != e; ++i) {
-    if (i == 0)
-      DT->addNewBlock(LoopVectorBody[0], LoopVectorPreHeader);
-    else if (isPredicatedBlock(i)) {
-      DT->addNewBlock(LoopVectorBody[i], LoopVectorBody[i-1]);
-    } else {
-      DT->addNewBlock(LoopVectorBody[i], LoopVectorBody[i-2]);
+  // a[i] = ...;  " blocks, and an inner loop adds a body and an exit block.
+  // Each block is dominated by the predecessors that come before it.
+  DT->addNewBlock(LoopVectorBody[0], LoopVectorPreHeader);
+  for (unsigned i = 1, e = LoopVectorBody.size(); i != e; ++i) {
+    BasicBlock *IDom = nullptr;
+    for (pred_iterator PI = pred_begin(LoopVectorBody[i]),
+         PE = pred_end(LoopVectorBody[i]); PI != PE; ++PI) {
+      if (!DT->getNode(*PI))
+        continue;
+      IDom = IDom ? DT->findNearestCommonDominator(IDom, *PI) : *PI;
     }
+    DT->addNewBlock(LoopVectorBody[i], IDom);
   }
 
   DT->addNewBlock(LoopMiddleBlock, LoopBypassBlocks[1]);
@@ -3459,8 +4015,8 @@ bool LoopVectorizationLegality::canVectorize() {
     return false;
   }
 
-  // We can only vectorize innermost loops.
-  if (TheLoop->getSubLoopsVector().size()) {
+  // We can only vectorize innermost loops, unless outer loops are enabled.
+  if (TheLoop->getSubLoopsVector().size() && !EnableOuterLoopVectorization) {
     emitAnalysis(Report() << "loop is not the innermost loop");
     return false;
   }
@@ -3483,6 +4039,9 @@ bool LoopVectorizationLegality::canVectorize() {
   DEBUG(dbgs() << "LV: Found a loop: " <<
         TheLoop->getHeader()->getName() << '\n');
 
+  if (!TheLoop->empty())
+    return canVectorizeOuterLoop();
+
   // Check if we can if-convert non-single-bb loops.
   unsigned NumBlocks = TheLoop->getNumBlocks();
   if (NumBlocks != 1 && !canVectorizeWithIfConvert()) {
@@ -3510,6 +4069,9 @@ bool LoopVectorizationLegality::canVectorize() {
     return false;
   }
 
+  // Find the strided accesses that can be vectorized together.
+  analyzeInterleaving();
+
   // Collect all of the variables that remain uniform after vectorization.
   collectLoopUniforms();
 
@@ -3562,6 +4124,206 @@ static bool hasOutsideLoopUser(const Loop *TheLoop, Instruction *Inst,
   return false;
 }
 
+bool LoopVectorizationLegality::canVectorizeOuterLoop() {
+  const std::vector<Loop *> &SubLoops = TheLoop->getSubLoops();
+  Loop *Inner = SubLoops.size() == 1 ? SubLoops[0] : nullptr;
+  if (!Inner || !Inner->empty() || Inner->getNumBlocks() != 1 ||
+      !Inner->getLoopPreheader() || !Inner->getExitBlock() ||
+      Inner->getExitingBlock() != Inner->getHeader() ||
+      Inner->contains(TheLoop->getLoopLatch())) {
+    emitAnalysis(Report() << "inner loop control flow is not understood by "
+                             "vectorizer");
+    return false;
+  }
+
+  const SCEV *ExitCount = SE->getBackedgeTakenCount(TheLoop);
+  if (ExitCount == SE->getCouldNotCompute()) {
+    emitAnalysis(Report() << "could not determine number of loop iterations");
+    return false;
+  }
+
+  // All of the lanes run the inner loop the same number of times.
+  const SCEV *InnerCount = SE->getBackedgeTakenCount(Inner);
+  if (InnerCount == SE->getCouldNotCompute() ||
+      !SE->isLoopInvariant(InnerCount, TheLoop)) {
+    emitAnalysis(Report() << "inner loop trip count is not the same in each "
+                             "iteration");
+    DEBUG(dbgs() << "LV: Inner loop trip count varies.\n");
+    return false;
+  }
+
+  BasicBlock *PreHeader = TheLoop->getLoopPreheader();
+  BasicBlock *Header = TheLoop->getHeader();
+  SmallVector<Instruction *, 8> MemInsts;
+  for (Loop::block_iterator bb = TheLoop->block_begin(),
+       be = TheLoop->block_end(); bb != be; ++bb) {
+    // Apart from the inner loop, only the latch may branch.
+    BranchInst *Br = dyn_cast<BranchInst>((*bb)->getTerminator());
+    if (!Br || (Br->isConditional() && !Inner->contains(*bb) &&
+                *bb != TheLoop->getLoopLatch())) {
+      emitAnalysis(Report(Br) << "control flow not understood by vectorizer");
+      return false;
+    }
+
+    for (BasicBlock::iterator it = (*bb)->begin(), e = (*bb)->end(); it != e;
+         ++it) {
+      if (PHINode *Phi = dyn_cast<PHINode>(it)) {
+        Type *PhiTy = Phi->getType();
+        if (!PhiTy->isIntegerTy() && !PhiTy->isFloatingPointTy() &&
+            !PhiTy->isPointerTy()) {
+          emitAnalysis(Report(it)
+                       << "loop control flow is not understood by vectorizer");
+          return false;
+        }
+
+        // The outer loop may only have inductions.
+        if (*bb == Header) {
+          InductionKind IK = isInductionVariable(Phi);
+          if (IK == IK_NoInduction) {
+            emitAnalysis(Report(it) << "value could not be identified as an "
+                                       "induction variable");
+            return false;
+          }
+          if (!WidestIndTy)
+            WidestIndTy = convertPointerToIntegerType(*DL, PhiTy);
+          else
+            WidestIndTy = getWiderType(*DL, PhiTy, WidestIndTy);
+          if (IK == IK_IntInduction && (!Induction || PhiTy == WidestIndTy))
+            Induction = Phi;
+          Inductions[Phi] = InductionInfo(
+              Phi->getIncomingValueForBlock(PreHeader), IK);
+          continue;
+        }
+
+        // The phis of the inner loop are widened, except for the inductions
+        // that take the same value in all lanes.
+        if (*bb == Inner->getHeader()) {
+          const SCEVAddRecExpr *AR = PhiTy->isIntegerTy() ?
+              dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Phi)) : nullptr;
+          if (AR && AR->getLoop() == Inner &&
+              AR->isAffine() && SE->isLoopInvariant(AR->getStart(), TheLoop) &&
+              SE->isLoopInvariant(AR->getStepRecurrence(*SE), TheLoop))
+            InnerInductions[Phi] = AR->getStepRecurrence(*SE);
+          continue;
+        }
+
+        // The values that leave the inner loop.
+        if (Phi->getNumIncomingValues() == 1 &&
+            Inner->contains(Phi->getIncomingBlock(0)))
+          continue;
+
+        emitAnalysis(Report(it) << "control flow not understood by vectorizer");
+        return false;
+      }
+
+      // Calls are handled as in innermost loops.
+      CallInst *CI = dyn_cast<CallInst>(it);
+      if (CI && !getIntrinsicIDForCall(CI, TLI) && !isa<DbgInfoIntrinsic>(CI)) {
+        emitAnalysis(Report(it) << "call instruction cannot be vectorized");
+        return false;
+      }
+      if (CI &&
+          hasVectorInstrinsicScalarOpd(getIntrinsicIDForCall(CI, TLI), 1) &&
+          !SE->isLoopInvariant(SE->getSCEV(CI->getOperand(1)), TheLoop)) {
+        emitAnalysis(Report(it) << "intrinsic instruction cannot be vectorized");
+        return false;
+      }
+
+      if ((!VectorType::isValidElementType(it->getType()) &&
+           !it->getType()->isVoidTy()) || isa<ExtractElementInst>(it)) {
+        emitAnalysis(Report(it)
+                     << "instruction return type cannot be vectorized");
+        return false;
+      }
+
+      if (LoadInst *Ld = dyn_cast<LoadInst>(it)) {
+        if (!Ld->isSimple()) {
+          emitAnalysis(Report(Ld) << "read with atomic ordering or volatile "
+                                     "read");
+          return false;
+        }
+        MemInsts.push_back(Ld);
+        ++NumLoads;
+      }
+
+      // The lanes cannot all store to the same address.
+      if (StoreInst *St = dyn_cast<StoreInst>(it)) {
+        if (!St->isSimple() ||
+            !VectorType::isValidElementType(
+                St->getValueOperand()->getType())) {
+          emitAnalysis(Report(St) << "store instruction cannot be vectorized");
+          return false;
+        }
+        if (isUniform(St->getPointerOperand())) {
+          emitAnalysis(Report(St) << "write to a loop invariant address "
+                                     "could not be vectorized");
+          return false;
+        }
+        MemInsts.push_back(St);
+        ++NumStores;
+      }
+
+      if (hasOutsideLoopUser(TheLoop, it, AllowedExit)) {
+        emitAnalysis(Report(it) << "value cannot be used outside the loop");
+        return false;
+      }
+    }
+  }
+
+  if (!Induction) {
+    emitAnalysis(Report() << "loop induction variable could not be "
+                             "identified");
+    return false;
+  }
+
+  if (!TheLoop->isAnnotatedParallel() &&
+      !canVectorizeOuterLoopMemory(MemInsts)) {
+    emitAnalysis(Report() << "cannot prove that the iterations of the outer "
+                             "loop are independent");
+    return false;
+  }
+
+  InnerLoop = Inner;
+  collectLoopUniforms();
+
+  DEBUG(dbgs() << "LV: We can vectorize this outer loop!\n");
+  return true;
+}
+
+bool LoopVectorizationLegality::canVectorizeOuterLoopMemory(
+    ArrayRef<Instruction *> MemInsts) {
+  Loop *Inner = TheLoop->getSubLoops()[0];
+  for (unsigned i = 0, e = MemInsts.size(); i != e; ++i) {
+    StoreInst *St = dyn_cast<StoreInst>(MemInsts[i]);
+    if (!St)
+      continue;
+
+    // Stores that are not uniform are consecutive in the outer loop here.
+    Value *Ptr = St->getPointerOperand();
+    if (!isConsecutivePtr(Ptr) ||
+        !SE->isLoopInvariant(SE->getSCEV(Ptr), Inner)) {
+      DEBUG(dbgs() << "LV: Outer loop store is not consecutive: " << *St
+                   << "\n");
+      return false;
+    }
+
+    for (unsigned j = 0; j != e; ++j) {
+      LoadInst *Ld = dyn_cast<LoadInst>(MemInsts[j]);
+      Value *OtherPtr = Ld ? Ld->getPointerOperand()
+                           : cast<StoreInst>(MemInsts[j])->getPointerOperand();
+      if (OtherPtr == Ptr)
+        continue;
+      if (AA->alias(Ptr, AliasAnalysis::UnknownSize, OtherPtr,
+                    AliasAnalysis::UnknownSize) != AliasAnalysis::NoAlias) {
+        DEBUG(dbgs() << "LV: Outer loop store may alias: " << *St << " and "
+                     << *MemInsts[j] << "\n");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 bool LoopVectorizationLegality::canVectorizeInstrs() {
   BasicBlock *PreHeader = TheLoop->getLoopPreheader();
   BasicBlock *Header = TheLoop->getHeader();
@@ -3686,6 +4448,11 @@ bool LoopVectorizationLegality::canVectorizeInstrs() {
                 "\n");
           continue;
         }
+        if (AddMinMaxIndexVar(Phi)) {
+          DEBUG(dbgs() << "LV: Found a MINMAX index reduction PHI."<< *Phi <<
+                "\n");
+          continue;
+        }
 
         emitAnalysis(Report(it) << "value that could not be identified as "
                                    "reduction is used outside the loop");
@@ -3759,6 +4526,26 @@ bool LoopVectorizationLegality::canVectorizeInstrs() {
     }
   }
 
+  // An index reduction is only valid if its min/max is a reduction too.
+  for (ReductionList::iterator I = Reductions.begin(), E = Reductions.end();
+       I != E; ++I) {
+    if (I->second.Kind != RK_MinMaxIndex)
+      continue;
+    ReductionList::iterator MinMax = Reductions.find(I->second.MinMaxPhi);
+    if (MinMax == Reductions.end() ||
+        (MinMax->second.Kind != RK_IntegerMinMax &&
+         MinMax->second.Kind != RK_FloatMinMax) ||
+        MinMax->second.LoopExitInstr !=
+            I->second.MinMaxPhi->getIncomingValueForBlock(
+                TheLoop->getLoopLatch())) {
+      emitAnalysis(Report(I->first)
+                   << "value that could not be identified as "
+                      "reduction is used outside the loop");
+      DEBUG(dbgs() << "LV: Found an unidentified PHI."<< *I->first <<"\n");
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -3905,13 +4692,22 @@ void LoopVectorizationLegality::collectLoopUniforms() {
 
   // Also add all consecutive pointer values; these values will be uniform
   // after vectorization (and subsequent cleanup) and, until revectorization is
-  // supported, all dependencies must also be uniform.
+  // supported, all dependencies must also be uniform. The same goes for the
+  // pointers of interleaved accesses, of which only the first lane is used.
   for (Loop::block_iterator B = TheLoop->block_begin(),
        BE = TheLoop->block_end(); B != BE; ++B)
     for (BasicBlock::iterator I = (*B)->begin(), IE = (*B)->end();
-         I != IE; ++I)
+         I != IE; ++I) {
       if (I->getType()->isPointerTy() && isConsecutivePtr(I))
         Worklist.insert(Worklist.end(), I->op_begin(), I->op_end());
+      if (getInterleaveGroup(I)) {
+        Value *Ptr = isa<LoadInst>(I) ? cast<LoadInst>(I)->getPointerOperand()
+                                      : cast<StoreInst>(I)->getPointerOperand();
+        if (Instruction *PtrInst = dyn_cast<Instruction>(Ptr))
+          Worklist.insert(Worklist.end(), PtrInst->op_begin(),
+                          PtrInst->op_end());
+      }
+    }
 
   while (Worklist.size()) {
     Instruction *I = dyn_cast<Instruction>(Worklist.back());
@@ -3931,6 +4727,139 @@ void LoopVectorizationLegality::collectLoopUniforms() {
   }
 }
 
+void LoopVectorizationLegality::analyzeInterleaving() {
+  if (!EnableInterleavedMemAccesses)
+    return;
+
+  /// A load or store with a constant stride of more than one element.
+  struct StridedAccess {
+    Instruction *I;
+    const SCEV *Start;
+    Type *EltTy;
+    uint64_t Factor;
+  };
+
+  for (Loop::block_iterator BI = TheLoop->block_begin(),
+       BE = TheLoop->block_end(); BI != BE; ++BI) {
+    // We can't emit a wide access for members that are predicated.
+    if (blockNeedsPredication(*BI))
+      continue;
+
+    SmallVector<StridedAccess, 8> Accesses;
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end(); I != E;
+         ++I) {
+      LoadInst *LI = dyn_cast<LoadInst>(I);
+      StoreInst *SI = dyn_cast<StoreInst>(I);
+      if (!LI && !SI)
+        continue;
+      if (LI ? !LI->isSimple() : !SI->isSimple())
+        continue;
+
+      Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+      Type *EltTy = Ptr->getType()->getPointerElementType();
+      if (!VectorType::isValidElementType(EltTy))
+        continue;
+      uint64_t EltSize = DL->getTypeAllocSize(EltTy);
+      if (!EltSize || EltSize != DL->getTypeStoreSize(EltTy))
+        continue;
+      if (isConsecutivePtr(Ptr) || isUniform(Ptr))
+        continue;
+
+      const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr));
+      if (!AR || AR->getLoop() != TheLoop || !AR->isAffine())
+        continue;
+      const SCEVConstant *Step =
+          dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+      if (!Step || Step->getValue()->getValue().getMinSignedBits() > 64)
+        continue;
+      int64_t StepVal = Step->getValue()->getSExtValue();
+      if (StepVal <= 0 || StepVal % EltSize)
+        continue;
+      uint64_t Factor = StepVal / EltSize;
+      if (Factor < 2 || Factor > MaxInterleaveGroupFactor)
+        continue;
+
+      StridedAccess Access = { I, AR->getStart(), EltTy, Factor };
+      Accesses.push_back(Access);
+    }
+
+    // Try to form a group around each access that is not in one yet, from the
+    // accesses after it that are of the same kind and less than a stride
+    // away.
+    for (unsigned i = 0, e = Accesses.size(); i != e; ++i) {
+      const StridedAccess &A = Accesses[i];
+      if (InterleaveGroupMap.count(A.I))
+        continue;
+      bool IsLoad = isa<LoadInst>(A.I);
+      int64_t Factor = A.Factor;
+      int64_t EltSize = DL->getTypeAllocSize(A.EltTy);
+
+      SmallVector<std::pair<int64_t, Instruction *>, 8> Candidates;
+      int64_t MinOffset = 0;
+      Instruction *Last = A.I;
+      for (unsigned j = i; j != e; ++j) {
+        const StridedAccess &B = Accesses[j];
+        if (InterleaveGroupMap.count(B.I) || isa<LoadInst>(B.I) != IsLoad ||
+            B.EltTy != A.EltTy || (int64_t)B.Factor != Factor ||
+            B.Start->getType() != A.Start->getType())
+          continue;
+        const SCEVConstant *Dist =
+            dyn_cast<SCEVConstant>(SE->getMinusSCEV(B.Start, A.Start));
+        if (!Dist || Dist->getValue()->getValue().getMinSignedBits() > 64)
+          continue;
+        int64_t Offset = Dist->getValue()->getSExtValue();
+        if (Offset % EltSize)
+          continue;
+        Offset /= EltSize;
+        if (Offset <= -Factor || Offset >= Factor)
+          continue;
+        Candidates.push_back(std::make_pair(Offset, B.I));
+        MinOffset = std::min(MinOffset, Offset);
+        Last = B.I;
+      }
+
+      // The members must access each of Factor consecutive elements once, so
+      // that the wide access touches no memory the loop does not.
+      if (Candidates.size() != (uint64_t)Factor)
+        continue;
+      SmallVector<Instruction *, 8> Members(Factor, nullptr);
+      bool IsFull = true;
+      for (unsigned k = 0; k != Candidates.size(); ++k) {
+        int64_t Index = Candidates[k].first - MinOffset;
+        if (Index >= Factor || Members[Index]) {
+          IsFull = false;
+          break;
+        }
+        Members[Index] = Candidates[k].second;
+      }
+      if (!IsFull)
+        continue;
+
+      // The loads are moved up to the first member and the stores down to the
+      // last one, so no other access in between may conflict with them.
+      SmallPtrSet<Instruction *, 8> MemberSet(Members.begin(), Members.end());
+      bool IsSafe = true;
+      for (BasicBlock::iterator I = A.I, E = Last; I != E; ++I) {
+        if (MemberSet.count(I))
+          continue;
+        if (IsLoad ? I->mayWriteToMemory() : I->mayReadOrWriteMemory()) {
+          IsSafe = false;
+          break;
+        }
+      }
+      if (!IsSafe)
+        continue;
+
+      Instruction *InsertPos = IsLoad ? A.I : Last;
+      DEBUG(dbgs() << "LV: Found an interleaved access group of factor "
+                   << Factor << " at" << *InsertPos << "\n");
+      InterleaveGroups.push_back(InterleaveGroup(Members, InsertPos));
+      for (unsigned k = 0; k != Members.size(); ++k)
+        InterleaveGroupMap[Members[k]] = InterleaveGroups.size() - 1;
+    }
+  }
+}
+
 namespace {
 /// \brief Analyses memory accesses in a loop.
 ///
@@ -4352,6 +5281,40 @@ static bool isInBoundsGep(Value *Ptr) {
   return false;
 }
 
+/// \brief Check whether the pointer \p Ptr, which is an inbounds GEP, cannot
+/// wrap because its only variable index is computed without signed wrap from
+/// an induction that does not wrap, like A[2*i] and A[2*i + 1].
+static bool isNoWrapGEPIndex(Value *Ptr, ScalarEvolution *SE, const Loop *Lp) {
+  GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(Ptr);
+  if (!GEP)
+    return false;
+
+  Value *Index = nullptr;
+  for (User::op_iterator I = GEP->idx_begin(), E = GEP->idx_end(); I != E; ++I)
+    if (!isa<ConstantInt>(*I)) {
+      if (Index)
+        return false;
+      Index = *I;
+    }
+
+  // Look through an 'or' of low bits that are known to be zero, which is how
+  // 2*i + 1 usually ends up.
+  Instruction *IndexInst = dyn_cast_or_null<Instruction>(Index);
+  if (IndexInst && IndexInst->getOpcode() == Instruction::Or &&
+      isa<ConstantInt>(IndexInst->getOperand(1)) &&
+      isa<SCEVAddRecExpr>(SE->getSCEV(IndexInst)))
+    IndexInst = dyn_cast<Instruction>(IndexInst->getOperand(0));
+
+  OverflowingBinaryOperator *OBO =
+      dyn_cast_or_null<OverflowingBinaryOperator>(IndexInst);
+  if (!OBO || !OBO->hasNoSignedWrap() || !isa<ConstantInt>(OBO->getOperand(1)))
+    return false;
+
+  const SCEVAddRecExpr *OpAR =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(OBO->getOperand(0)));
+  return OpAR && OpAR->getLoop() == Lp && OpAR->getNoWrapFlags(SCEV::FlagNSW);
+}
+
 /// \brief Check whether the access through \p Ptr has a constant stride.
 static int isStridedPtr(ScalarEvolution *SE, const DataLayout *DL, Value *Ptr,
                         const Loop *Lp, ValueToValueMap &StridesMap) {
@@ -4389,7 +5352,9 @@ static int isStridedPtr(ScalarEvolution *SE, const DataLayout *DL, Value *Ptr,
   // to access the pointer value "0" which is undefined behavior in address
   // space 0, therefore we can also vectorize this case.
   bool IsInBoundsGEP = isInBoundsGep(Ptr);
-  bool IsNoWrapAddRec = AR->getNoWrapFlags(SCEV::NoWrapMask);
+  bool IsNoWrapAddRec = AR->getNoWrapFlags(SCEV::NoWrapMask) ||
+                        (EnableInterleavedMemAccesses && IsInBoundsGEP &&
+                         isNoWrapGEPIndex(Ptr, SE, Lp));
   bool IsInAddressSpaceZero = PtrTy->getAddressSpace() == 0;
   if (!IsNoWrapAddRec && !IsInBoundsGEP && !IsInAddressSpaceZero) {
     DEBUG(dbgs() << "LV: Bad stride - Pointer may wrap in the address space "
@@ -4536,6 +5501,21 @@ bool MemoryDepChecker::isDependent(const MemAccessInfo &A, unsigned AIdx,
   Type *BTy = BPtr->getType()->getPointerElementType();
   unsigned TypeByteSize = DL->getTypeAllocSize(ATy);
 
+  // Accesses of the same type and a stride of several elements never touch
+  // the same memory if their distance is not a multiple of the stride, like
+  // the real and imaginary parts A[2*i] and A[2*i+1] of complex numbers.
+  // This is only used along with interleaved access groups.
+  int64_t Stride = std::abs(StrideAPtr);
+  if (EnableInterleavedMemAccesses && Stride > 1 && ATy == BTy &&
+      C->getValue()->getValue().getMinSignedBits() <= 64) {
+    int64_t Distance = C->getValue()->getSExtValue();
+    if (Distance % TypeByteSize == 0 &&
+        (Distance / (int64_t)TypeByteSize) % Stride != 0) {
+      DEBUG(dbgs() << "LV: Strided accesses never overlap: NoDep\n");
+      return false;
+    }
+  }
+
   // Negative distances are not plausible dependencies.
   const APInt &Val = C->getValue()->getValue();
   if (Val.isNegative()) {
@@ -4940,6 +5920,11 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
   //  to make sure we only see exactly the two instructions.
   unsigned NumCmpSelectPatternInst = 0;
   ReductionInstDesc ReduxDesc(false, nullptr);
+  bool IsMinMax = Kind == RK_IntegerMinMax || Kind == RK_FloatMinMax;
+
+  // The compare of a min/max pattern may also choose the value of the index
+  // reductions that follow it.
+  bool HasIndexUsers = false;
 
   SmallPtrSet<Instruction *, 8> VisitedInsts;
   SmallVector<Instruction *, 8> Worklist;
@@ -4989,7 +5974,8 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
       return false;
 
     // A reduction operation must only have one use of the reduction value.
-    if (!IsAPhi && Kind != RK_IntegerMinMax && Kind != RK_FloatMinMax &&
+    // The select of a conditional reduction chooses between two of them.
+    if (!IsAPhi && !IsMinMax && !isa<SelectInst>(Cur) &&
         hasMultipleUsesOf(Cur, VisitedInsts))
       return false;
 
@@ -5035,16 +6021,24 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
         continue;
       }
 
+      // Selects other than the one of the min/max pattern are not part of
+      // this reduction.
+      if (isa<CmpInst>(Cur) && UI != ReduxDesc.PatternLastInst) {
+        HasIndexUsers = true;
+        continue;
+      }
+
       // Process instructions only once (termination). Each reduction cycle
-      // value must only be used once, except by phi nodes and min/max
-      // reductions which are represented as a cmp followed by a select.
+      // value must only be used once, except by phi nodes, by the select of
+      // a conditional reduction, and by min/max reductions which are
+      // represented as a cmp followed by a select.
       ReductionInstDesc IgnoredVal(false, nullptr);
       if (VisitedInsts.insert(UI)) {
         if (isa<PHINode>(UI))
           PHIs.push_back(UI);
         else
           NonPHIs.push_back(UI);
-      } else if (!isa<PHINode>(UI) &&
+      } else if (!isa<PHINode>(UI) && !(!IsMinMax && isa<SelectInst>(UI)) &&
                  ((!isa<FCmpInst>(UI) &&
                    !isa<ICmpInst>(UI) &&
                    !isa<SelectInst>(UI)) ||
@@ -5061,10 +6055,25 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
 
   // This means we have seen one but not the other instruction of the
   // pattern or more than just a select and cmp.
-  if ((Kind == RK_IntegerMinMax || Kind == RK_FloatMinMax) &&
-      NumCmpSelectPatternInst != 2)
+  if (IsMinMax && NumCmpSelectPatternInst != 2)
     return false;
 
+  // A conditional reduction selects either the updated or the previous value
+  // of the reduction, as in "Sum = C ? Sum + X : Sum". The condition must not
+  // depend on the reduction.
+  if (!IsMinMax)
+    for (Instruction *I : VisitedInsts)
+      if (SelectInst *Sel = dyn_cast<SelectInst>(I))
+        if (VisitedInsts.count(dyn_cast<Instruction>(Sel->getCondition())) ||
+            !VisitedInsts.count(dyn_cast<Instruction>(Sel->getTrueValue())) ||
+            !VisitedInsts.count(dyn_cast<Instruction>(Sel->getFalseValue())))
+          return false;
+
+  // A min/max that is only used to find its index does not leave the loop.
+  if (!ExitInstruction && HasIndexUsers)
+    ExitInstruction = dyn_cast<Instruction>(
+        Phi->getIncomingValueForBlock(TheLoop->getLoopLatch()));
+
   if (!FoundStartPHI || !FoundReduxOp || !ExitInstruction)
     return false;
 
@@ -5084,6 +6093,131 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
   return true;
 }
 
+bool LoopVectorizationLegality::AddMinMaxIndexVar(PHINode *Phi) {
+  if (Phi->getNumIncomingValues() != 2 ||
+      Phi->getParent() != TheLoop->getHeader() ||
+      !Phi->getType()->isIntegerTy())
+    return false;
+
+  // The index is only updated by a select: Idx = C ? I : Idx.
+  Value *Start = Phi->getIncomingValueForBlock(TheLoop->getLoopPreheader());
+  SelectInst *Sel = dyn_cast<SelectInst>(
+      Phi->getIncomingValueForBlock(TheLoop->getLoopLatch()));
+  if (!Sel || !Phi->hasOneUse() || *Phi->user_begin() != Sel)
+    return false;
+
+  // The select feeds the phi and has a single user outside of the loop.
+  Instruction *ExitUser = nullptr;
+  for (User *U : Sel->users()) {
+    Instruction *UI = cast<Instruction>(U);
+    if (UI == Phi)
+      continue;
+    if (TheLoop->contains(UI) || ExitUser)
+      return false;
+    ExitUser = UI;
+  }
+  if (!ExitUser)
+    return false;
+
+  bool NewIsTrue = Sel->getFalseValue() == Phi;
+  if (!NewIsTrue && Sel->getTrueValue() != Phi)
+    return false;
+  Value *NewIdx = NewIsTrue ? Sel->getTrueValue() : Sel->getFalseValue();
+
+  // Later iterations must have greater indices, so that the first position of
+  // the min/max is the least index among the vector lanes that hold it. The
+  // index may be the truncation of a wider induction that fits in it.
+  unsigned Bits = Phi->getType()->getIntegerBitWidth();
+  Value *WideIdx = NewIdx;
+  if (TruncInst *Trunc = dyn_cast<TruncInst>(NewIdx))
+    WideIdx = Trunc->getOperand(0);
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(WideIdx));
+  if (!AR || AR->getLoop() != TheLoop)
+    return false;
+  const SCEVConstant *Step =
+      dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  if (!Step || !Step->getValue()->getValue().isStrictlyPositive())
+    return false;
+  ConstantRange SRange = SE->getSignedRange(AR);
+  ConstantRange URange = SE->getUnsignedRange(AR);
+  MinMaxReductionKind IdxKind;
+  if (AR->getNoWrapFlags(SCEV::FlagNSW) &&
+      SRange.getSignedMin().getMinSignedBits() <= Bits &&
+      SRange.getSignedMax().getMinSignedBits() <= Bits)
+    IdxKind = MRK_SIntMin;
+  else if ((AR->getNoWrapFlags(SCEV::FlagNUW) ||
+            (AR->getNoWrapFlags(SCEV::FlagNSW) &&
+             SRange.getSignedMin().isNonNegative())) &&
+           URange.getUnsignedMax().getActiveBits() <= Bits)
+    IdxKind = MRK_UIntMin;
+  else
+    return false;
+
+  // The condition compares the min/max with a new value X, and the min/max
+  // takes X exactly when the index is updated.
+  CmpInst *Cmp = dyn_cast<CmpInst>(Sel->getCondition());
+  if (!Cmp)
+    return false;
+  PHINode *MinMaxPhi = dyn_cast<PHINode>(Cmp->getOperand(0));
+  Value *X = Cmp->getOperand(1);
+  CmpInst::Predicate Pred = Cmp->getSwappedPredicate();
+  if (!MinMaxPhi || MinMaxPhi->getParent() != TheLoop->getHeader()) {
+    MinMaxPhi = dyn_cast<PHINode>(Cmp->getOperand(1));
+    X = Cmp->getOperand(0);
+    Pred = Cmp->getPredicate();
+  }
+  if (!MinMaxPhi || MinMaxPhi == Phi ||
+      MinMaxPhi->getParent() != TheLoop->getHeader() ||
+      MinMaxPhi->getNumIncomingValues() != 2)
+    return false;
+  SelectInst *MinMaxSel = dyn_cast<SelectInst>(
+      MinMaxPhi->getIncomingValueForBlock(TheLoop->getLoopLatch()));
+  if (!MinMaxSel || MinMaxSel->getCondition() != Cmp ||
+      (NewIsTrue ? MinMaxSel->getTrueValue() : MinMaxSel->getFalseValue()) !=
+          X)
+    return false;
+
+  // The min/max must only be replaced by a strictly smaller or greater value,
+  // or a later position of an equal one would overwrite the index.
+  if (!NewIsTrue)
+    Pred = CmpInst::getInversePredicate(Pred);
+  switch (Pred) {
+  case CmpInst::ICMP_SGT: case CmpInst::ICMP_SLT:
+  case CmpInst::ICMP_UGT: case CmpInst::ICMP_ULT:
+  case CmpInst::FCMP_OGT: case CmpInst::FCMP_OLT:
+  case CmpInst::FCMP_UGT: case CmpInst::FCMP_ULT:
+    break;
+  default:
+    return false;
+  }
+
+  AllowedExit.insert(Sel);
+  Reductions[Phi] = ReductionDescriptor(Start, Sel, RK_MinMaxIndex, IdxKind,
+                                        MinMaxPhi);
+  return true;
+}
+
+/// Returns the select that \p Cmp forms a min/max pattern with. Apart from
+/// it, \p Cmp may only be the condition of other selects, which is the case
+/// when the min/max has index reductions.
+static SelectInst *getMinMaxSelect(Instruction *Cmp) {
+  SelectInst *MinMax = nullptr;
+  for (User *U : Cmp->users()) {
+    SelectInst *Select = dyn_cast<SelectInst>(U);
+    if (!Select || Select->getCondition() != Cmp ||
+        Select->getTrueValue() == Cmp || Select->getFalseValue() == Cmp)
+      return nullptr;
+    Value *L = Cmp->getOperand(0), *R = Cmp->getOperand(1);
+    Value *T = Select->getTrueValue(), *F = Select->getFalseValue();
+    if ((T == L && F == R) || (T == R && F == L)) {
+      if (MinMax)
+        return nullptr;
+      MinMax = Select;
+    }
+  }
+  return MinMax;
+}
+
 /// Returns true if the instruction is a Select(ICmp(X, Y), X, Y) instruction
 /// pattern corresponding to a min(X, Y) or max(X, Y).
 LoopVectorizationLegality::ReductionInstDesc
@@ -5098,7 +6232,7 @@ LoopVectorizationLegality::isMinMaxSelectCmpPattern(Instruction *I,
   // We must handle the select(cmp()) as a single instruction. Advance to the
   // select.
   if ((Cmp = dyn_cast<ICmpInst>(I)) || (Cmp = dyn_cast<FCmpInst>(I))) {
-    if (!Cmp->hasOneUse() || !(Select = dyn_cast<SelectInst>(*I->user_begin())))
+    if (!(Select = getMinMaxSelect(Cmp)))
       return ReductionInstDesc(false, I);
     return ReductionInstDesc(Select, Prev.MinMaxKind);
   }
@@ -5109,7 +6243,7 @@ LoopVectorizationLegality::isMinMaxSelectCmpPattern(Instruction *I,
   if (!(Cmp = dyn_cast<ICmpInst>(I->getOperand(0))) &&
       !(Cmp = dyn_cast<FCmpInst>(I->getOperand(0))))
     return ReductionInstDesc(false, I);
-  if (!Cmp->hasOneUse())
+  if (getMinMaxSelect(Cmp) != Select)
     return ReductionInstDesc(false, I);
 
   Value *CmpLeft;
@@ -5166,9 +6300,14 @@ LoopVectorizationLegality::isReductionInstr(Instruction *I,
   case Instruction::FSub:
   case Instruction::FAdd:
     return ReductionInstDesc(Kind == RK_FloatAdd && FastMath, I);
+  case Instruction::Select:
+    // The select of a conditional reduction. AddReductionVar checks that it
+    // chooses between two values of the reduction.
+    if (Kind != RK_IntegerMinMax && Kind != RK_FloatMinMax)
+      return ReductionInstDesc(true, I);
+    // Fall through.
   case Instruction::FCmp:
   case Instruction::ICmp:
-  case Instruction::Select:
     if (Kind != RK_IntegerMinMax &&
         (!HasFunNoNaNAttr || Kind != RK_FloatMinMax))
       return ReductionInstDesc(false, I);
@@ -5389,6 +6528,13 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
   return Factor;
 }
 
+unsigned LoopVectorizationCostModel::selectOuterLoopVectorizationFactor() {
+  if (Hints->getWidth())
+    return Hints->getWidth();
+  unsigned WidestRegister = TTI.getRegisterBitWidth(true);
+  return std::max(1u, WidestRegister / getWidestType());
+}
+
 unsigned LoopVectorizationCostModel::getWidestType() {
   unsigned MaxWidth = 8;
 
@@ -5898,6 +7044,22 @@ LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
       return TTI.getAddressComputationCost(VectorTy) +
         TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
 
+    // Interleaved access groups are one wide access plus shuffles, which we
+    // charge to the member the wide access is emitted at.
+    if (const InterleaveGroup *Group = Legal->getInterleaveGroup(I)) {
+      if (I != Group->getInsertPos())
+        return 0;
+
+      unsigned Factor = Group->getFactor();
+      Type *WideVecTy = VectorType::get(ValTy, VF * Factor);
+      SmallVector<unsigned, 8> Indices;
+      for (unsigned i = 0; i < Factor; ++i)
+        Indices.push_back(i);
+      return TTI.getInterleavedMemoryOpCost(I->getOpcode(), WideVecTy, Factor,
+                                            Indices, Group->getAlignment(),
+                                            AS);
+    }
+
     // Scalarized loads/stores.
     int ConsecutiveStride = Legal->isConsecutivePtr(Ptr);
     bool Reverse = ConsecutiveStride < 0;
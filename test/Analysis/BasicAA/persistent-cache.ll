@@ -0,0 +1,26 @@
+; RUN: opt < %s -basicaa -gvn -ipsccp -gvn -S | FileCheck %s
+; RUN: opt < %s -basicaa -basicaa-persistent-cache -gvn -ipsccp -gvn -S | FileCheck %s
+
+; The first GVN finds that %g may alias %b.  IPSCCP then replaces the select
+; %g is based on with %a, which must drop the cached result so that the second
+; GVN can forward the stored value.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; CHECK-LABEL: @f(
+; CHECK: store i32 1
+; CHECK: store i32 2
+; CHECK: ret i32 1
+define internal i32 @f(i1 %c, i32* noalias %a, i32* noalias %b) {
+  %p = select i1 %c, i32* %a, i32* %b
+  %g = getelementptr inbounds i32* %p, i64 1
+  store i32 1, i32* %g
+  store i32 2, i32* %b
+  %v = load i32* %g
+  ret i32 %v
+}
+
+define i32 @main(i32* noalias %a, i32* noalias %b) {
+  %r = call i32 @f(i1 true, i32* %a, i32* %b)
+  ret i32 %r
+}
@@ -0,0 +1,44 @@
+; RUN: opt < %s -print-callgraph-scc-schedule -disable-output 2>&1 | FileCheck %s
+
+; @leaf1 and @leaf2 call nothing, so they are independent.  @r1 and @r2 are
+; one SCC.  @top waits for everything it calls, and the external node, which
+; calls @top, comes last.
+
+; CHECK: Call graph SCC schedule: 6 SCCs in 4 levels, at most 2 in one level
+; CHECK-DAG: SCC #[[LEAF1:[0-9]+]] level 0: leaf1{{$}}
+; CHECK-DAG: SCC #[[LEAF2:[0-9]+]] level 0: leaf2{{$}}
+; CHECK-DAG: SCC #[[R:[0-9]+]] level 1: r{{[12]}} r{{[12]}}; calls #[[LEAF1]]{{$}}
+; CHECK-DAG: SCC #[[MID:[0-9]+]] level 1: mid; calls #[[LEAF2]]{{$}}
+; CHECK-DAG: SCC #[[TOP:[0-9]+]] level 2: top; calls #[[MID]] #[[R]] #[[LEAF2]]{{$}}
+; CHECK-DAG: SCC #{{[0-9]+}} level 3: <external node>; calls #[[TOP]]{{$}}
+
+define internal void @leaf1() {
+  ret void
+}
+
+define internal void @leaf2() {
+  ret void
+}
+
+define internal void @r1() {
+  call void @r2()
+  call void @leaf1()
+  ret void
+}
+
+define internal void @r2() {
+  call void @r1()
+  ret void
+}
+
+define internal void @mid() {
+  call void @leaf2()
+  ret void
+}
+
+define void @top() {
+  call void @mid()
+  call void @r1()
+  call void @leaf2()
+  ret void
+}
@@ -0,0 +1,52 @@
+; RUN: opt < %s -print-callgraph -disable-output 2> %t
+; RUN: FileCheck %s --check-prefix=A < %t
+; RUN: FileCheck %s --check-prefix=B < %t
+; RUN: FileCheck %s --check-prefix=C < %t
+; RUN: opt < %s -print-callgraph -callgraph-threads=3 -disable-output 2> %t
+; RUN: FileCheck %s --check-prefix=A < %t
+; RUN: FileCheck %s --check-prefix=B < %t
+; RUN: FileCheck %s --check-prefix=C < %t
+
+; Finding the calls on several threads builds the same call graph, with the
+; edges of each node in instruction order.
+
+declare void @ext()
+
+define void @a() {
+  call void @b()
+  call void @ext()
+  call void @c()
+  call void @b()
+  ret void
+}
+
+define internal void @b() {
+  call void @c()
+  ret void
+}
+
+define internal void @c() {
+  %f = load void ()** @fp
+  call void %f()
+  call void @a()
+  ret void
+}
+
+define internal void @d() {
+  ret void
+}
+
+@fp = global void ()* @d
+
+; A: Call graph node for function: 'a'
+; A-NEXT: calls function 'b'
+; A-NEXT: calls function 'ext'
+; A-NEXT: calls function 'c'
+; A-NEXT: calls function 'b'
+
+; B: Call graph node for function: 'b'
+; B-NEXT: calls function 'c'
+
+; C: Call graph node for function: 'c'
+; C-NEXT: calls external node
+; C-NEXT: calls function 'a'
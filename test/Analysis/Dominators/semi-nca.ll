@@ -0,0 +1,54 @@
+; RUN: opt < %s -domtree -analyze | FileCheck %s -check-prefix=DOM
+; RUN: opt < %s -domtree -analyze -dom-tree-semi-nca | FileCheck %s -check-prefix=DOM
+; RUN: opt < %s -postdomtree -analyze | FileCheck %s -check-prefix=POSTDOM
+; RUN: opt < %s -postdomtree -analyze -dom-tree-semi-nca | FileCheck %s -check-prefix=POSTDOM
+
+; Both dominator tree builders must agree.  The cycle a -> b -> c -> a is
+; entered at both a and c, so c's semidominator is not its immediate
+; dominator.
+
+define void @f(i32 %x) {
+entry:
+  switch i32 %x, label %a [
+    i32 1, label %c
+    i32 2, label %loop
+  ]
+a:
+  br label %b
+b:
+  switch i32 %x, label %c [
+    i32 1, label %exit1
+  ]
+c:
+  switch i32 %x, label %a [
+    i32 1, label %d
+  ]
+d:
+  br label %exit2
+loop:
+  br label %loop
+exit1:
+  ret void
+exit2:
+  ret void
+}
+
+; DOM: Inorder Dominator Tree:
+; DOM-NEXT: [1] %entry {0,15}
+; DOM-NEXT:   [2] %a {1,6}
+; DOM-NEXT:     [3] %b {2,5}
+; DOM-NEXT:       [4] %exit1 {3,4}
+; DOM-NEXT:   [2] %c {7,12}
+; DOM-NEXT:     [3] %d {8,11}
+; DOM-NEXT:       [4] %exit2 {9,10}
+; DOM-NEXT:   [2] %loop {13,14}
+
+; POSTDOM: Inorder PostDominator Tree:
+; POSTDOM-NEXT: [1]  <<exit node>> {0,15}
+; POSTDOM-NEXT:   [2] %exit1 {1,2}
+; POSTDOM-NEXT:   [2] %b {3,6}
+; POSTDOM-NEXT:     [3] %a {4,5}
+; POSTDOM-NEXT:   [2] %c {7,8}
+; POSTDOM-NEXT:   [2] %entry {9,10}
+; POSTDOM-NEXT:   [2] %exit2 {11,14}
+; POSTDOM-NEXT:     [3] %d {12,13}
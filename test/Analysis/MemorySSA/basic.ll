@@ -0,0 +1,84 @@
+; RUN: opt < %s -basicaa -memoryssa -verify-memoryssa -analyze | FileCheck %s
+
+; Straight-line code: each store defines a new version of memory and each
+; load uses the version that reaches it.
+define i32 @straight(i32* %a, i32* %b) {
+; CHECK-LABEL: define i32 @straight(
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 0, i32* %a
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 1, i32* %b
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: %x = load i32* %a
+entry:
+  store i32 0, i32* %a
+  store i32 1, i32* %b
+  %x = load i32* %a
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; A join after a store on one side gets a MemoryPhi.
+define i32 @diamond(i1 %c, i32* %a) {
+; CHECK-LABEL: define i32 @diamond(
+; CHECK: then:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK: join:
+; CHECK: ; 2 = MemoryPhi({%then,1},{%else,liveOnEntry})
+; CHECK-NEXT: ; MemoryUse(2)
+; CHECK-NEXT: %x = load i32* %a
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %a
+  br label %join
+
+else:
+  br label %join
+
+join:
+  %x = load i32* %a
+  ret i32 %x
+}
+
+; A loop header gets a MemoryPhi for the store in the loop body.
+define void @loop(i32* %a, i32 %n) {
+; CHECK-LABEL: define void @loop(
+; CHECK: header:
+; CHECK: ; 1 = MemoryPhi({%entry,liveOnEntry},{%header,2})
+; CHECK: ; MemoryUse(1)
+; CHECK-NEXT: %v = load i32* %a
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 %v.next, i32* %a
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %header ]
+  %v = load i32* %a
+  %v.next = add i32 %v, 1
+  store i32 %v.next, i32* %a
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  ret void
+}
+
+; Accesses in unreachable code are defined by liveOnEntry.
+define i32 @unreachable(i32* %a) {
+; CHECK-LABEL: define i32 @unreachable(
+; CHECK: dead:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK: ; MemoryUse(liveOnEntry)
+; CHECK-NEXT: %x = load i32* %a
+entry:
+  ret i32 0
+
+dead:
+  store i32 1, i32* %a
+  %x = load i32* %a
+  ret i32 %x
+}
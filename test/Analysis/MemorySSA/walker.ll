@@ -0,0 +1,102 @@
+; RUN: opt < %s -basicaa -print-memoryssa-walker -verify-memoryssa -analyze | FileCheck %s
+
+; The store to the noalias %b doesn't clobber %a.
+define i32 @skip_noalias(i32* %a, i32* noalias %b) {
+; CHECK-LABEL: define i32 @skip_noalias(
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK: ; 2 = MemoryDef(1) clobbered by liveOnEntry
+; CHECK: ; MemoryUse(2) clobbered by 1
+; CHECK-NEXT: %x = load i32* %a
+entry:
+  store i32 0, i32* %a
+  store i32 1, i32* %b
+  %x = load i32* %a
+  ret i32 %x
+}
+
+; A store on one side of a diamond that doesn't alias the load is walked
+; through the MemoryPhi.
+define i32 @through_phi(i1 %c, i32* noalias %a, i32* noalias %b) {
+; CHECK-LABEL: define i32 @through_phi(
+; CHECK: ; 3 = MemoryPhi({%entry,1},{%then,2})
+; CHECK-NEXT: ; MemoryUse(3) clobbered by 1
+entry:
+  store i32 0, i32* %a
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 1, i32* %b
+  br label %join
+
+join:
+  %x = load i32* %a
+  ret i32 %x
+}
+
+; When the sides disagree the MemoryPhi is the clobber.
+define i32 @phi_clobber(i1 %c, i32* %a) {
+; CHECK-LABEL: define i32 @phi_clobber(
+; CHECK: ; 2 = MemoryDef(1) clobbered by 1
+; CHECK: ; 3 = MemoryPhi({%entry,1},{%then,2})
+; CHECK-NEXT: ; MemoryUse(3) clobbered by 3
+entry:
+  store i32 0, i32* %a
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 1, i32* %a
+  br label %join
+
+join:
+  %x = load i32* %a
+  ret i32 %x
+}
+
+; A loop that only stores to %b doesn't clobber the load of %a after it.
+define i32 @loop(i32* noalias %a, i32* noalias %b, i32 %n) {
+; CHECK-LABEL: define i32 @loop(
+; CHECK: ; 2 = MemoryPhi({%entry,1},{%latch,5})
+; CHECK: ; 3 = MemoryDef(2) clobbered by 2
+; CHECK: ; 4 = MemoryDef(3) clobbered by 3
+; CHECK: ; 5 = MemoryPhi({%header,3},{%inner,4})
+; CHECK: ; MemoryUse(5) clobbered by 1
+; CHECK-NEXT: %x = load i32* %a
+entry:
+  store i32 0, i32* %a
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  store i32 %i, i32* %b
+  %c = icmp eq i32 %i, 7
+  br i1 %c, label %inner, label %latch
+
+inner:
+  store i32 %i, i32* %b
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  %x = load i32* %a
+  ret i32 %x
+}
+
+; Calls and volatile loads are not looked through.
+declare void @g()
+
+define i32 @call(i32* noalias %a) {
+; CHECK-LABEL: define i32 @call(
+; CHECK: ; 2 = MemoryDef(1) clobbered by 1
+; CHECK-NEXT: call void @g()
+; CHECK: ; 3 = MemoryDef(2) clobbered by 2
+; CHECK-NEXT: %x = load volatile i32* %a
+entry:
+  store i32 0, i32* %a
+  call void @g()
+  %x = load volatile i32* %a
+  ret i32 %x
+}
@@ -0,0 +1,44 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-cache-budget=1 \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-cache-budget=1 \
+; RUN:   -stats 2>&1 | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+; Compacting the caches after every query must not change the results.
+
+define void @nest(i32* %p, i32 %n, i32 %m) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %k = add i32 %i, %j
+  %idx = sext i32 %k to i64
+  %addr = getelementptr i32* %p, i64 %idx
+  store i32 %k, i32* %addr
+  %j.next = add nsw i32 %j, 1
+  %inner.cond = icmp slt i32 %j.next, 100
+  br i1 %inner.cond, label %inner, label %outer.latch
+
+outer.latch:
+  %j.lcssa = phi i32 [ %j.next, %inner ]
+  %i.next = add nsw i32 %i, 1
+  %outer.cond = icmp slt i32 %i.next, 50
+  br i1 %outer.cond, label %outer, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK: %k = add i32 %i, %j
+; CHECK-NEXT: -->  {{[{][{]}}0,+,1}<nuw><nsw><%outer>,+,1}<nw><%inner>{{ *}}Exits: {99,+,1}<nw><%outer>
+; CHECK: Loop %inner: backedge-taken count is 99
+; CHECK: Loop %outer: backedge-taken count is 49
+
+; STATS: SCEV cache compactions
+; STATS: SCEV cache entries dropped by compaction
@@ -0,0 +1,36 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-expr-depth=3 \
+; RUN:   | FileCheck %s -check-prefix=LIMIT
+
+; %r is analyzed first, so its operand chain is analyzed recursively from it.
+; With the depth limit, %x1 is left opaque in the expressions built for that
+; query, but is still analyzed when it is queried directly.
+
+define i32 @chain(i32 %a) {
+entry:
+  br label %def
+
+use:
+  %r = shl i32 %x3, 1
+  ret i32 %r
+
+def:
+  %x1 = shl i32 %a, 1
+  %x2 = shl i32 %x1, 1
+  %x3 = shl i32 %x2, 1
+  br label %use
+}
+
+; CHECK: %r = shl i32 %x3, 1
+; CHECK-NEXT: -->  (16 * %a)
+; CHECK: %x1 = shl i32 %a, 1
+; CHECK-NEXT: -->  (2 * %a)
+; CHECK: %x3 = shl i32 %x2, 1
+; CHECK-NEXT: -->  (8 * %a)
+
+; LIMIT: %r = shl i32 %x3, 1
+; LIMIT-NEXT: -->  (8 * %x1)
+; LIMIT: %x1 = shl i32 %a, 1
+; LIMIT-NEXT: -->  (2 * %a)
+; LIMIT: %x3 = shl i32 %x2, 1
+; LIMIT-NEXT: -->  (4 * %x1)
@@ -0,0 +1,60 @@
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scalar-evolution-max-trip-count-depth=1 | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scalar-evolution-max-trip-count-depth=1 -stats 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=STATS
+; RUN: opt < %s -analyze -scalar-evolution -stats 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=NOLIMIT
+; REQUIRES: asserts
+
+; The loops are laid out last to first, so the trip count of %h2 is computed
+; first.  Proving that a loop is entered asks for the trip count of the loop
+; before it, and with a limit of 1 that nested computation is cut off for
+; %h2 and %h1.  A count that isn't computed because of the limit isn't
+; remembered, so every loop still gets its count when it is queried directly.
+
+define void @f(i32* %p, i32 %n) {
+entry:
+  br label %h0
+h2:
+  %i2 = phi i32 [ 0, %h1 ], [ %i2.next, %h2 ]
+  %a2 = mul i32 %i2, 5
+  %b2 = add i32 %a2, %n
+  %idx2 = sext i32 %b2 to i64
+  %g2 = getelementptr i32* %p, i64 %idx2
+  store i32 %b2, i32* %g2
+  %i2.next = add nsw i32 %i2, 1
+  %c2 = icmp slt i32 %i2.next, %n
+  br i1 %c2, label %h2, label %exit
+h1:
+  %i1 = phi i32 [ 0, %h0 ], [ %i1.next, %h1 ]
+  %a1 = mul i32 %i1, 4
+  %b1 = add i32 %a1, %n
+  %idx1 = sext i32 %b1 to i64
+  %g1 = getelementptr i32* %p, i64 %idx1
+  store i32 %b1, i32* %g1
+  %i1.next = add nsw i32 %i1, 1
+  %c1 = icmp slt i32 %i1.next, %n
+  br i1 %c1, label %h1, label %h2
+h0:
+  %i0 = phi i32 [ 0, %entry ], [ %i0.next, %h0 ]
+  %a0 = mul i32 %i0, 3
+  %b0 = add i32 %a0, %n
+  %idx0 = sext i32 %b0 to i64
+  %g0 = getelementptr i32* %p, i64 %idx0
+  store i32 %b0, i32* %g0
+  %i0.next = add nsw i32 %i0, 1
+  %c0 = icmp slt i32 %i0.next, %n
+  br i1 %c0, label %h0, label %h1
+exit:
+  ret void
+}
+
+; CHECK: Loop %h2: backedge-taken count is (-1 + (1 smax %n))
+; CHECK: Loop %h1: backedge-taken count is (-1 + (1 smax %n))
+; CHECK: Loop %h0: backedge-taken count is (-1 + (1 smax %n))
+
+; STATS: 2 scalar-evolution - Number of backedge-taken counts not computed due to the depth limit
+
+; There is no limit by default.
+; NOLIMIT-NOT: depth limit
@@ -0,0 +1,27 @@
+; Check that abbreviations with tuned operand widths are still used and
+; round-trip.
+; RUN: llvm-as -bitcode-tune-abbrevs < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as -bitcode-tune-abbrevs < %s | llvm-dis | FileCheck %s
+
+; BC: FUNCTION_BLOCK
+; BC: CONSTANTS_BLOCK
+; BC: INTEGER abbrevid=5 op0=2000000
+; BC: INST_LOAD abbrevid=4 op0=3
+; BC: INST_BINOP abbrevid=5 op0=1 op1=2
+; BC: INST_BINOP abbrevid=6 op0=1 op1=4
+; BC: INST_CAST abbrevid=7 op0=1
+; BC: INST_RET abbrevid=9 op0=1
+
+; CHECK: define i64 @f(i32* %p, i32 %a)
+; CHECK-NEXT: %x = load i32* %p
+; CHECK-NEXT: %y = add i32 %x, 1000000
+; CHECK-NEXT: %z = mul nsw i32 %y, %a
+; CHECK-NEXT: %e = zext i32 %z to i64
+; CHECK-NEXT: ret i64 %e
+define i64 @f(i32* %p, i32 %a) {
+  %x = load i32* %p
+  %y = add i32 %x, 1000000
+  %z = mul nsw i32 %y, %a
+  %e = zext i32 %z to i64
+  ret i64 %e
+}
@@ -0,0 +1,74 @@
+; RUN: opt -S -O2 -j3 -j-check < %s | FileCheck %s
+; RUN: opt -S -sroa -instcombine -globalopt -gvn -simplifycfg -j2 -j-check < %s | FileCheck %s
+; RUN: opt -S -O2 -j1 < %s | FileCheck %s
+
+; opt -j runs the function passes over several functions at once, and
+; -j-check compares the result with that of running them serially.  The
+; functions keep their order, and metadata and globals shared between
+; functions optimized on different threads stay shared.
+
+@w = extern_weak global i32
+@arr = global [4 x i32] zeroinitializer
+@0 = private constant [4 x i8] c"abc\00"
+
+; CHECK-LABEL: define i32 @first(
+; CHECK: load i32* %p, !alias.scope [[SCOPE:![0-9]+]]
+; CHECK: call fastcc i32 @helper(
+define i32 @first(i32* %p) {
+entry:
+  %a = alloca i32
+  %v = load i32* %p, !alias.scope !0
+  store i32 %v, i32* %a
+  %r = load i32* %a
+  %s = call i32 @helper(i32 %r)
+  ret i32 %s
+}
+
+; CHECK-LABEL: define internal fastcc i32 @helper(
+; CHECK-NEXT: shl i32 %x, 1
+define internal i32 @helper(i32 %x) noinline {
+  %y = add i32 %x, 0
+  %z = mul i32 %y, 2
+  ret i32 %z
+}
+
+; CHECK-LABEL: define i32 @second(
+; CHECK: load i32* %p, !noalias [[SCOPE]]
+; CHECK: select i1 icmp eq (i32* @w, i32* null)
+define i32 @second(i32* %p) {
+  %v = load i32* %p, !noalias !0
+  %c = icmp eq i32* @w, null
+  %r = select i1 %c, i32 %v, i32 0
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @third(
+; CHECK: br i1 %done, label %exit, label %loop, !llvm.loop [[LOOP:![0-9]+]]
+; CHECK: add i32 %{{.*}}, 97
+define i32 @third(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %gep = getelementptr [4 x i32]* @arr, i32 0, i32 %i
+  %x = load i32* %gep
+  %sum.next = add i32 %sum, %x
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !llvm.loop !1
+
+exit:
+  %s = getelementptr [4 x i8]* @0, i32 0, i32 0
+  %l = load i8* %s
+  %e = zext i8 %l to i32
+  %t = add i32 %sum.next, %e
+  ret i32 %t
+}
+
+; CHECK: [[SCOPE]] = metadata !{metadata [[SCOPE]]}
+; CHECK-NEXT: [[LOOP]] = metadata !{metadata [[LOOP]]}
+; CHECK-NOT: metadata
+!0 = metadata !{metadata !0}
+!1 = metadata !{metadata !1}
@@ -0,0 +1,38 @@
+; RUN: opt < %s -correlated-propagation -S | FileCheck %s
+; RUN: opt < %s -correlated-propagation -lvi-max-cache-entries=1 -S | FileCheck %s
+; RUN: opt < %s -correlated-propagation -lvi-max-cache-entries=1 -stats -disable-output 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; With a tiny cache limit the cache is cleared between queries.  Later
+; queries recompute what they need, and the results don't change.
+
+; STATS: Number of times the cache was over its limit
+
+; CHECK-LABEL: @f(
+define i32 @f(i32 %x) {
+entry:
+  %c = icmp ult i32 %x, 10
+  br i1 %c, label %small, label %big
+
+small:
+  %y = add i32 %x, 1
+  br label %next
+
+next:
+; CHECK: next:
+; CHECK-NEXT: br i1 true, label %last, label %big
+  %c1 = icmp ult i32 %x, 10
+  br i1 %c1, label %last, label %big
+
+last:
+; CHECK: last:
+; CHECK-NEXT: br i1 false, label %big, label %exit
+  %c2 = icmp ugt i32 %x, 20
+  br i1 %c2, label %big, label %exit
+
+exit:
+  ret i32 %y
+
+big:
+  ret i32 0
+}
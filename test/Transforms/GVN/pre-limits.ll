@@ -0,0 +1,60 @@
+; RUN: opt < %s -basicaa -gvn -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -gvn-max-pre-blocks=2 -S | FileCheck %s --check-prefix=NOPRE
+; RUN: opt < %s -basicaa -gvn -gvn-max-nonlocal-load-deps=0 -S | FileCheck %s --check-prefix=NOLOAD
+
+; PRE is skipped in functions with more blocks than -gvn-max-pre-blocks, and
+; non-local loads are no longer looked at once their dependencies add up to
+; more than -gvn-max-nonlocal-load-deps.
+
+@G = common global i32 0
+@H = common global i32 0
+
+; CHECK-LABEL: @scalar(
+; CHECK: bb1:
+; CHECK-NEXT: %a.pre-phi = phi i32
+; NOPRE-LABEL: @scalar(
+; NOPRE: bb1:
+; NOPRE-NEXT: %a = add i32 %x, 42
+define i32 @scalar(i32 %x, i1 %c) {
+entry:
+  br i1 %c, label %bb, label %bb1
+
+bb:
+  %b = add i32 %x, 42
+  store i32 %b, i32* @G
+  br label %bb1
+
+bb1:
+  %a = add i32 %x, 42
+  br label %return
+
+return:
+  ret i32 %a
+}
+
+; CHECK-LABEL: @loads(
+; CHECK: bb1:
+; CHECK-NEXT: phi i32 [ %y, %bb ], [ %z, %entry ]
+; CHECK-NOT: load
+; CHECK: ret i32
+; NOLOAD-LABEL: @loads(
+; NOLOAD: bb1:
+; NOLOAD-NEXT: %l = phi i32 [ %y, %bb ], [ %z, %entry ]
+; NOLOAD-NEXT: %m = load i32* @H
+define i32 @loads(i32 %y, i32 %z, i1 %c) {
+entry:
+  store i32 %z, i32* @G
+  store i32 %z, i32* @H
+  br i1 %c, label %bb, label %bb1
+
+bb:
+  store i32 %y, i32* @G
+  store i32 %y, i32* @H
+  br label %bb1
+
+bb1:
+  %l = load i32* @G
+  %m = load i32* @H
+  %r = add i32 %l, %m
+  ret i32 %r
+}
@@ -0,0 +1,53 @@
+; RUN: opt < %s -inline -inline-threshold=20 -S | FileCheck %s
+; RUN: opt < %s -inline -inline-threshold=20 -stats -disable-output 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; The inliner caches the cost of the call sites it looks at while visiting an
+; SCC.  After @small is inlined, the calls to @big with unchanged arguments
+; are not analyzed again, but the one whose argument became a constant is.
+
+; STATS: 2 inline - Number of inline costs reused, not recomputed
+
+declare void @g(i32)
+
+define internal i32 @small(i32 %x) {
+  ret i32 0
+}
+
+define i32 @big(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %zero, label %work
+
+zero:
+  ret i32 0
+
+work:
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  ret i32 %x
+}
+
+define i32 @caller(i32 %y) {
+; CHECK-LABEL: @caller(
+; CHECK-NEXT: %a = call i32 @big(i32 %y)
+; CHECK-NEXT: %a2 = call i32 @big(i32 %a)
+; CHECK-NEXT: call void @g(i32 %a)
+; CHECK-NEXT: call void @g(i32 0)
+; CHECK-NEXT: ret i32 0
+  %a = call i32 @big(i32 %y)
+  %a2 = call i32 @big(i32 %a)
+  call void @g(i32 %a)
+  %z = call i32 @small(i32 %y)
+  call void @g(i32 %z)
+  %b = call i32 @big(i32 %z)
+  ret i32 %b
+}
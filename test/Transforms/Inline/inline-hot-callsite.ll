@@ -0,0 +1,146 @@
+; RUN: opt < %s -inline -S | FileCheck %s
+; RUN: opt < %s -inline -inlinehot-threshold=225 -inlinecold-callsite-threshold=225 -S | FileCheck %s --check-prefix=NOPROF
+
+; In a caller with branch weights, call sites executed much more often than
+; the entry get the threshold for hot call sites, and call sites executed
+; much less often get the one for cold call sites.  Callers without branch
+; weights use the usual threshold.
+
+declare void @g(i32)
+
+define i32 @medium(i32 %x) {
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  ret i32 %x
+}
+
+define i32 @small(i32 %x) {
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  call void @g(i32 %x)
+  ret i32 %x
+}
+
+define i32 @profiled(i32 %n, i1 %c) {
+; CHECK-LABEL: @profiled(
+; CHECK: rare:
+; CHECK-NEXT: call i32 @small(
+; CHECK-NEXT: call i32 @medium(
+; CHECK: loop:
+; CHECK-NOT: call i32 @medium(
+; CHECK: exit:
+; CHECK-NOT: call i32 @small(
+; CHECK: ret i32
+; NOPROF-LABEL: @profiled(
+; NOPROF: rare:
+; NOPROF-NOT: call i32 @small(
+; NOPROF: call i32 @medium(
+; NOPROF: loop:
+; NOPROF: call i32 @medium(
+entry:
+  br i1 %c, label %rare, label %loop, !prof !0
+
+rare:
+  %r1 = call i32 @small(i32 %n)
+  %r2 = call i32 @medium(i32 %r1)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ 0, %rare ], [ %i.next, %loop ]
+  %v = call i32 @medium(i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !prof !1
+
+exit:
+  %s = call i32 @small(i32 %n)
+  ret i32 %s
+}
+
+define i32 @unprofiled(i32 %n) {
+; CHECK-LABEL: @unprofiled(
+; CHECK: loop:
+; CHECK-NEXT: phi
+; CHECK-NEXT: call i32 @medium(
+; CHECK: exit:
+; CHECK-NOT: call i32 @small(
+; CHECK: ret i32
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = call i32 @medium(i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %s = call i32 @small(i32 %n)
+  ret i32 %s
+}
+
+; A single weighted branch, as from __builtin_expect, says nothing about how
+; often the unweighted loop runs, so the call in it keeps the usual threshold.
+; Not every branch has weights, so nothing is cold either.
+define i32 @lone_weight(i32 %n, i1 %c) {
+; CHECK-LABEL: @lone_weight(
+; CHECK: rare:
+; CHECK-NOT: call i32 @small(
+; CHECK: loop:
+; CHECK-NEXT: phi
+; CHECK-NEXT: call i32 @medium(
+; CHECK: ret i32
+entry:
+  br i1 %c, label %rare, label %loop, !prof !0
+
+rare:
+  %r = call i32 @small(i32 %n)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ 0, %rare ], [ %i.next, %loop ]
+  %v = call i32 @medium(i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %v
+}
+
+; The exit of the loop has weights, so its trip count is known even though
+; the branch before it has none, and the call in it is hot.
+define i32 @weighted_loop(i32 %n, i1 %c) {
+; CHECK-LABEL: @weighted_loop(
+; CHECK: loop:
+; CHECK-NOT: call i32 @medium(
+; CHECK: ret i32
+entry:
+  br i1 %c, label %pre, label %loop
+
+pre:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ 0, %pre ], [ %i.next, %loop ]
+  %v = call i32 @medium(i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !prof !1
+
+exit:
+  ret i32 %v
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 1000}
+!1 = metadata !{metadata !"branch_weights", i32 1000, i32 100000}
@@ -0,0 +1,43 @@
+; RUN: opt < %s -S -loop-deletion -verify-loop-info | FileCheck %s
+
+; Deleting a dead loop nest inside a live loop removes all of its blocks from
+; LoopInfo at once.  -verify-loop-info checks that the result matches a
+; recomputed LoopInfo.
+
+; CHECK-LABEL: @f(
+; CHECK-NOT: dead.outer:
+; CHECK-NOT: dead.inner:
+; CHECK: live.latch:
+
+define void @f(i32 %n, i32* %p) {
+entry:
+  br label %live.header
+
+live.header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %live.latch ]
+  br label %dead.outer
+
+dead.outer:
+  %j = phi i32 [ 0, %live.header ], [ %j.next, %dead.outer.latch ]
+  br label %dead.inner
+
+dead.inner:
+  %k = phi i32 [ 0, %dead.outer ], [ %k.next, %dead.inner ]
+  %k.next = add i32 %k, 1
+  %k.cmp = icmp slt i32 %k.next, %n
+  br i1 %k.cmp, label %dead.inner, label %dead.outer.latch
+
+dead.outer.latch:
+  %j.next = add i32 %j, 1
+  %j.cmp = icmp slt i32 %j.next, %n
+  br i1 %j.cmp, label %dead.outer, label %live.latch
+
+live.latch:
+  store i32 %i, i32* %p
+  %i.next = add i32 %i, 1
+  %i.cmp = icmp slt i32 %i.next, %n
+  br i1 %i.cmp, label %live.header, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,41 @@
+; RUN: opt < %s -S -loop-unroll -unroll-runtime -unroll-count=2 -verify-loop-info | FileCheck %s
+
+; Unrolling an outer loop copies its inner loop, both in the unrolled body
+; and in the prolog that runs the left over iterations.  The copies are loops
+; and must be added to LoopInfo.
+
+; The copy of the inner loop in the prolog of the outer loop.
+; CHECK: [[PROLOG:inner.unr[0-9]+]]:
+; CHECK-NEXT: phi
+; CHECK: br i1 %{{.*}}, label %{{.*}}, label %[[PROLOG]]
+; The copy in the unrolled outer loop body.
+; CHECK: inner.1:
+; CHECK: br i1 %{{.*}}, label %{{.*}}, label %inner.1
+
+define void @nested(i32* nocapture %a, i32 %n, i32 %m) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %idx = add i32 %i, %j
+  %gep = getelementptr inbounds i32* %a, i32 %idx
+  %x = load i32* %gep, align 4
+  %y = add i32 %x, 1
+  store i32 %y, i32* %gep, align 4
+  %j.next = add i32 %j, 1
+  %inner.done = icmp eq i32 %j.next, %m
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add i32 %i, 1
+  %outer.done = icmp eq i32 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
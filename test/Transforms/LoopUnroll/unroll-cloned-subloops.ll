@@ -0,0 +1,47 @@
+; RUN: opt < %s -S -loop-unroll -verify-loop-info | FileCheck %s
+
+; Completely unrolling the outer loop copies the inner loop into each
+; iteration.  The copies are queued for the loop passes, so once the outer
+; loop is gone the unroller visits them too.  In the copies the trip count of
+; the inner loop has become a constant, and they are completely unrolled.
+; The inner loop of the first iteration was visited before the outer loop,
+; and stays a loop.
+
+; CHECK-LABEL: @triangle(
+; CHECK: inner:
+; CHECK: br i1 %{{.*}}, label %outer.latch, label %inner
+; CHECK: inner.1:
+; CHECK-NEXT: store i32 1, i32* %a
+; CHECK: store i32 1, i32* %gep.1.1
+; CHECK-NOT: br i1
+; CHECK: inner.2:
+; CHECK-NEXT: store i32 2, i32* %a
+; CHECK: store i32 2, i32* %gep.2.1
+; CHECK: store i32 2, i32* %gep.2.2
+; CHECK-NOT: br i1
+; CHECK: ret void
+
+define void @triangle(i32* %a) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %gep = getelementptr inbounds i32* %a, i32 %j
+  store i32 %i, i32* %gep, align 4
+  %j.next = add nuw nsw i32 %j, 1
+  %inner.done = icmp ugt i32 %j.next, %i
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i32 %i, 1
+  %outer.done = icmp eq i32 %i.next, 3
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
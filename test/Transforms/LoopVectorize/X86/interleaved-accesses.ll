@@ -0,0 +1,194 @@
+; RUN: opt -S -basicaa -loop-vectorize -instcombine -mcpu=corei7 -enable-interleaved-mem-accesses < %s | FileCheck %s
+; RUN: opt -S -basicaa -loop-vectorize -instcombine -mcpu=corei7 < %s | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; Strided accesses that between them access every element are vectorized as
+; one wide load or store and shufflevectors.
+
+; void cmul(float *restrict A, float *restrict B, float K) {
+;   for (int i = 0; i < 1024; i++) {
+;     float Re = A[2*i], Im = A[2*i+1];
+;     B[2*i] = Re * K - Im;
+;     B[2*i+1] = Im * K + Re;
+;   }
+; }
+
+; CHECK-LABEL: @cmul(
+; CHECK: vector.body:
+; CHECK: %wide.vec = load <8 x float>* %{{.*}}, align 4
+; CHECK: %strided.vec = shufflevector <8 x float> %wide.vec, <8 x float> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+; CHECK: %strided.vec1 = shufflevector <8 x float> %wide.vec, <8 x float> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
+; CHECK: %interleaved.vec = shufflevector <4 x float> %{{.*}}, <4 x float> %{{.*}}, <8 x i32> <i32 0, i32 4, i32 1, i32 5, i32 2, i32 6, i32 3, i32 7>
+; CHECK: store <8 x float> %interleaved.vec, <8 x float>* %{{.*}}, align 4
+; DISABLED-LABEL: @cmul(
+; DISABLED-NOT: load <8 x float>
+; DISABLED: ret void
+
+define void @cmul(float* noalias %A, float* noalias %B, float %K) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %mul = shl nsw i64 %iv, 1
+  %arrayidx = getelementptr inbounds float* %A, i64 %mul
+  %re = load float* %arrayidx, align 4
+  %add = or i64 %mul, 1
+  %arrayidx2 = getelementptr inbounds float* %A, i64 %add
+  %im = load float* %arrayidx2, align 4
+  %m1 = fmul float %re, %K
+  %r0 = fsub float %m1, %im
+  %m2 = fmul float %im, %K
+  %r1 = fadd float %m2, %re
+  %arrayidx3 = getelementptr inbounds float* %B, i64 %mul
+  store float %r0, float* %arrayidx3, align 4
+  %arrayidx4 = getelementptr inbounds float* %B, i64 %add
+  store float %r1, float* %arrayidx4, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Accesses to A[2*i] and A[2*i+1] never overlap, so the members can be
+; swapped in place.
+
+; void swap(int *A) {
+;   for (int i = 0; i < 1024; i++) {
+;     int X = A[2*i], Y = A[2*i+1];
+;     A[2*i] = Y;
+;     A[2*i+1] = X;
+;   }
+; }
+
+; CHECK-LABEL: @swap(
+; CHECK: vector.body:
+; CHECK: %wide.vec = load <8 x i32>* %{{.*}}, align 4
+; CHECK: %strided.vec = shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+; CHECK: %strided.vec1 = shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
+; CHECK: %interleaved.vec = shufflevector <4 x i32> %strided.vec1, <4 x i32> %strided.vec, <8 x i32> <i32 0, i32 4, i32 1, i32 5, i32 2, i32 6, i32 3, i32 7>
+; CHECK: store <8 x i32> %interleaved.vec
+
+define void @swap(i32* %A) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %mul = shl nsw i64 %iv, 1
+  %p0 = getelementptr inbounds i32* %A, i64 %mul
+  %x = load i32* %p0, align 4
+  %add = or i64 %mul, 1
+  %p1 = getelementptr inbounds i32* %A, i64 %add
+  %y = load i32* %p1, align 4
+  store i32 %y, i32* %p0, align 4
+  store i32 %x, i32* %p1, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The three channels of an RGB image of floats form a group of factor 3.
+
+; void gray(float *restrict P, float *restrict Q) {
+;   for (int i = 0; i < 1024; i++)
+;     Q[i] = P[3*i] + P[3*i+1] + P[3*i+2];
+; }
+
+; CHECK-LABEL: @gray(
+; CHECK: vector.body:
+; CHECK: %wide.vec = load <12 x float>* %{{.*}}, align 4
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 0, i32 3, i32 6, i32 9>
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 1, i32 4, i32 7, i32 10>
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 2, i32 5, i32 8, i32 11>
+
+define void @gray(float* noalias %P, float* noalias %Q) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %mul = mul nsw i64 %iv, 3
+  %p0 = getelementptr inbounds float* %P, i64 %mul
+  %r = load float* %p0, align 4
+  %a1 = add nsw i64 %mul, 1
+  %p1 = getelementptr inbounds float* %P, i64 %a1
+  %g = load float* %p1, align 4
+  %a2 = add nsw i64 %mul, 2
+  %p2 = getelementptr inbounds float* %P, i64 %a2
+  %b = load float* %p2, align 4
+  %s1 = fadd fast float %r, %g
+  %s2 = fadd fast float %s1, %b
+  %q = getelementptr inbounds float* %Q, i64 %iv
+  store float %s2, float* %q, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; A store between the loads of A[2*i] and A[2*i+1] may write to either, so
+; they are not grouped.
+
+; CHECK-LABEL: @store_between(
+; CHECK-NOT: %wide.vec
+; CHECK: ret void
+
+define void @store_between(i32* %A, i32* %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %mul = shl nsw i64 %iv, 1
+  %p0 = getelementptr inbounds i32* %A, i64 %mul
+  %x = load i32* %p0, align 4
+  %q = getelementptr inbounds i32* %B, i64 %iv
+  store i32 %x, i32* %q, align 4
+  %add = or i64 %mul, 1
+  %p1 = getelementptr inbounds i32* %A, i64 %add
+  %y = load i32* %p1, align 4
+  %s = add i32 %x, %y
+  store i32 %s, i32* %q, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Only A[2*i] is accessed, so there is no group: the wide load would read
+; elements the loop does not.
+
+; CHECK-LABEL: @gap(
+; CHECK-NOT: %wide.vec
+; CHECK: ret void
+
+define void @gap(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %mul = shl nsw i64 %iv, 1
+  %p0 = getelementptr inbounds i32* %A, i64 %mul
+  %x = load i32* %p0, align 4
+  %q = getelementptr inbounds i32* %B, i64 %iv
+  store i32 %x, i32* %q, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -36,3 +36,59 @@ for.end:                                          ; preds = %for.inc, %entry
   ret i32 %sum.0.lcssa
 }
 
+
+; The same conditional reduction after the branch was turned into a select.
+;CHECK-LABEL: @reduction_select(
+;CHECK: load <4 x i32>
+;CHECK: icmp sgt <4 x i32>
+;CHECK: add <4 x i32>
+;CHECK: select <4 x i1>
+;CHECK: middle.block:
+;CHECK: add <4 x i32>
+;CHECK: ret i32
+define i32 @reduction_select(i32* nocapture %A, i32 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ %indvars.iv.next, %for.body ], [ 0, %entry ]
+  %sum.011 = phi i32 [ %sum.1, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32* %A, i64 %indvars.iv
+  %0 = load i32* %arrayidx, align 4
+  %cmp1 = icmp sgt i32 %0, 30
+  %add = add i32 %sum.011, %0
+  %sum.1 = select i1 %cmp1, i32 %add, i32 %sum.011
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret i32 %sum.1
+}
+
+; Selecting a value that is not part of the reduction restarts it, which
+; cannot be done in each vector lane.
+;CHECK-LABEL: @reduction_select_reset(
+;CHECK-NOT: <4 x i32>
+;CHECK: ret i32
+define i32 @reduction_select_reset(i32* nocapture %A, i32 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ %indvars.iv.next, %for.body ], [ 0, %entry ]
+  %sum.011 = phi i32 [ %sum.1, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32* %A, i64 %indvars.iv
+  %0 = load i32* %arrayidx, align 4
+  %cmp1 = icmp sgt i32 %0, 30
+  %add = add i32 %sum.011, %0
+  %sum.1 = select i1 %cmp1, i32 %add, i32 7
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret i32 %sum.1
+}
@@ -0,0 +1,69 @@
+; RUN: opt -S -loop-vectorize -enable-interleaved-mem-accesses -force-vector-width=4 -force-vector-unroll=1 -instcombine < %s | FileCheck %s
+; RUN: opt -S -loop-vectorize -force-vector-width=4 -force-vector-unroll=1 < %s | FileCheck %s --check-prefix=NOINTERLEAVE
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; With interleaved accesses enabled, the dependence checker knows that two
+; accesses with a stride of two elements and an odd distance never overlap.
+; The inbounds GEPs cannot wrap as their index is 2*i or 2*i+1 computed with
+; nsw from an induction that does not wrap.
+;
+;   for (i = 0; i < n; i++)
+;     A[2*i] = A[2*i+1] * 3;
+
+; CHECK-LABEL: @odd_to_even(
+; CHECK: vector.body:
+; CHECK: mul <4 x i32>
+; NOINTERLEAVE-LABEL: @odd_to_even(
+; NOINTERLEAVE-NOT: vector.body:
+; NOINTERLEAVE: ret void
+define void @odd_to_even(i32* %A, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %even = shl nsw i64 %i, 1
+  %odd = or i64 %even, 1
+  %odd.gep = getelementptr inbounds i32* %A, i64 %odd
+  %x = load i32* %odd.gep, align 4
+  %y = mul i32 %x, 3
+  %even.gep = getelementptr inbounds i32* %A, i64 %even
+  store i32 %y, i32* %even.gep, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %for.body
+
+exit:
+  ret void
+}
+
+; A distance of one stride is a real dependence: each iteration reads the
+; element the previous one wrote.
+;
+;   for (i = 0; i < n; i++)
+;     A[2*i+2] = A[2*i] * 3;
+
+; CHECK-LABEL: @carried(
+; CHECK-NOT: vector.body:
+; CHECK: ret void
+define void @carried(i32* %A, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %even = shl nsw i64 %i, 1
+  %even.gep = getelementptr inbounds i32* %A, i64 %even
+  %x = load i32* %even.gep, align 4
+  %y = mul i32 %x, 3
+  %next = add nsw i64 %even, 2
+  %next.gep = getelementptr inbounds i32* %A, i64 %next
+  store i32 %y, i32* %next.gep, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %for.body
+
+exit:
+  ret void
+}
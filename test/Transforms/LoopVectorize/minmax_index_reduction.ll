@@ -0,0 +1,135 @@
+; RUN: opt -S -loop-vectorize -dce -instcombine -force-vector-width=2 -force-vector-unroll=1 < %s | FileCheck %s
+; RUN: opt -S -loop-vectorize -force-vector-width=4 -force-vector-unroll=2 < %s | FileCheck %s --check-prefix=UNROLL
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Find the position of the first maximum. Each lane keeps the index of its
+; own maximum, and after the loop the least index among the lanes that hold
+; the overall maximum is taken.
+; CHECK-LABEL: @max_index(
+; CHECK: vector.body:
+; CHECK: %[[CMP:.*]] = icmp slt <2 x i32> %{{.*}}, %[[X:.*]]
+; CHECK: select <2 x i1> %[[CMP]], <2 x i32> %[[X]]
+; CHECK: select <2 x i1> %[[CMP]], <2 x i64> %{{.*}}
+; CHECK: middle.block:
+; CHECK: %[[MAX:.*]] = select i1 %{{.*}}, i32
+; CHECK: insertelement <2 x i32> undef, i32 %[[MAX]], i32 0
+; CHECK: icmp eq <2 x i32>
+; CHECK: select <2 x i1> %{{.*}}, <2 x i64> %{{.*}}, <2 x i64> <i64 9223372036854775807, i64 9223372036854775807>
+; CHECK: icmp slt <2 x i64>
+; CHECK: ret i64
+
+; UNROLL-LABEL: @max_index(
+; UNROLL: middle.block:
+; UNROLL: rdx.idx.cmp{{.*}} = icmp eq <4 x i32>
+; UNROLL: rdx.idx.cmp{{.*}} = icmp eq <4 x i32>
+; UNROLL: icmp slt <4 x i64>
+define i64 @max_index(i32* %a, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %max = phi i32 [ -2147483648, %entry ], [ %max.next, %loop ]
+  %idx = phi i64 [ 0, %entry ], [ %idx.next, %loop ]
+  %p = getelementptr inbounds i32* %a, i64 %i
+  %x = load i32* %p, align 4
+  %c = icmp slt i32 %max, %x
+  %max.next = select i1 %c, i32 %x, i32 %max
+  %idx.next = select i1 %c, i64 %i, i64 %idx
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i64 %idx.next
+}
+
+; The position of the first minimum as a 32-bit index, from a compare that
+; keeps the old minimum, with the index truncated from the wider induction.
+; The induction may exceed the signed range of the index, so the indices are
+; compared unsigned.
+; CHECK-LABEL: @min_index_float(
+; CHECK: vector.body:
+; CHECK: fcmp oge <2 x float>
+; CHECK: middle.block:
+; CHECK: fcmp oeq <2 x float>
+; CHECK: select <2 x i1> %{{.*}}, <2 x i32> %{{.*}}, <2 x i32> <i32 -1, i32 -1>
+; CHECK: icmp ult <2 x i32>
+; CHECK: ret i32
+define i32 @min_index_float(float* %a, i32 %n) #0 {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %min = phi float [ 0x47EFFFFFE0000000, %entry ], [ %min.next, %loop ]
+  %idx = phi i32 [ -1, %entry ], [ %idx.next, %loop ]
+  %p = getelementptr inbounds float* %a, i64 %i
+  %x = load float* %p, align 4
+  %c = fcmp oge float %x, %min
+  %min.next = select i1 %c, float %min, float %x
+  %i.trunc = trunc i64 %i to i32
+  %idx.next = select i1 %c, i32 %idx, i32 %i.trunc
+  %i.next = add nuw nsw i64 %i, 1
+  %lftr.wideiv = trunc i64 %i.next to i32
+  %done = icmp eq i32 %lftr.wideiv, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %idx.next
+}
+
+; With a non-strict compare the last position of the maximum is kept, which
+; the lanes cannot agree on.
+; CHECK-LABEL: @max_index_last(
+; CHECK-NOT: <2 x i32>
+; CHECK: ret i32
+define i32 @max_index_last(i32* %a, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %max = phi i32 [ 0, %entry ], [ %max.next, %loop ]
+  %idx = phi i32 [ 0, %entry ], [ %idx.next, %loop ]
+  %p = getelementptr inbounds i32* %a, i32 %i
+  %x = load i32* %p, align 4
+  %c = icmp sge i32 %x, %max
+  %max.next = select i1 %c, i32 %x, i32 %max
+  %idx.next = select i1 %c, i32 %i, i32 %idx
+  %i.next = add nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %idx.next
+}
+
+; The index may wrap, so the first position is not the least one.
+; CHECK-LABEL: @max_index_wrap(
+; CHECK-NOT: <2 x i32>
+; CHECK: ret i8
+define i8 @max_index_wrap(i32* %a, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %max = phi i32 [ 0, %entry ], [ %max.next, %loop ]
+  %idx = phi i8 [ 0, %entry ], [ %idx.next, %loop ]
+  %p = getelementptr inbounds i32* %a, i32 %i
+  %x = load i32* %p, align 4
+  %c = icmp sgt i32 %x, %max
+  %max.next = select i1 %c, i32 %x, i32 %max
+  %i.trunc = trunc i32 %i to i8
+  %idx.next = select i1 %c, i8 %i.trunc, i8 %idx
+  %i.next = add nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i8 %idx.next
+}
+
+attributes #0 = { "no-nans-fp-math"="true" }
@@ -0,0 +1,268 @@
+; RUN: opt -S -basicaa -loop-vectorize -enable-outer-loop-vectorization -force-vector-width=4 -force-vector-unroll=1 -dce -instcombine < %s | FileCheck %s
+; RUN: opt -S -basicaa -loop-vectorize -enable-outer-loop-vectorization -force-vector-width=4 -force-vector-unroll=1 < %s | FileCheck %s --check-prefix=UNIFORM
+; RUN: opt -S -basicaa -loop-vectorize -force-vector-width=4 -force-vector-unroll=1 < %s | FileCheck %s --check-prefix=NOOUTER
+
+; Outer loops marked with llvm.loop.vectorize.enable are vectorized when their
+; inner loop runs the same number of times in each iteration, and running the
+; iterations in lockstep keeps the order of dependent memory accesses.  The
+; inner loop is kept, with its induction scalar and its other values widened.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK-LABEL: @filter(
+; CHECK: vector.body:
+; CHECK: inner.vec.body:
+; CHECK: %inner.index = phi i64 [ 0, %vector.body ], [ %inner.index.next, %inner.vec.body ]
+; CHECK: %[[K:.*]] = phi i64 [ 0, %vector.body ], [ %[[KNEXT:.*]], %inner.vec.body ]
+; CHECK: %vec.phi = phi <4 x float> [ zeroinitializer, %vector.body ], [ %[[SUM:.*]], %inner.vec.body ]
+; CHECK: load <4 x float>*
+; CHECK: %[[W:.*]] = load float*
+; CHECK: %[[SUM]] = fadd <4 x float> %vec.phi
+; CHECK: %[[KNEXT]] = add i64 %[[K]], 1
+; CHECK: icmp eq i64 %inner.index, 7
+; CHECK: br i1 %{{.*}}, label %inner.vec.exit, label %inner.vec.body
+; CHECK: inner.vec.exit:
+; CHECK: store <4 x float> %[[SUM]]
+; CHECK: %index.next = add i64 %index, 4
+; The weight is the same in all lanes, so it is loaded once.
+; UNIFORM-LABEL: @filter(
+; UNIFORM: %b.uniform = load float* %{{.*}}, align 4, !tbaa ![[TBAA:[0-9]+]]
+; UNIFORM-NOT: load float*
+; UNIFORM: shufflevector <4 x float> %{{.*}}, <4 x float> undef, <4 x i32> zeroinitializer{{$}}
+; UNIFORM: fmul <4 x float>
+; NOOUTER-LABEL: @filter(
+; NOOUTER-NOT: <4 x
+; NOOUTER: ret void
+define void @filter(float* noalias %out, float* noalias %in, float* noalias %w, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %x = phi i64 [ 0, %entry ], [ %x.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %k = phi i64 [ 0, %outer ], [ %k.next, %inner ]
+  %sum = phi float [ 0.000000e+00, %outer ], [ %sum.next, %inner ]
+  %idx = add nsw i64 %x, %k
+  %in.gep = getelementptr inbounds float* %in, i64 %idx
+  %a = load float* %in.gep, align 4
+  %w.gep = getelementptr inbounds float* %w, i64 %k
+  %b = load float* %w.gep, align 4, !tbaa !6
+  %mul = fmul float %a, %b
+  %sum.next = fadd float %sum, %mul
+  %k.next = add nuw nsw i64 %k, 1
+  %inner.done = icmp eq i64 %k.next, 8
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %out.gep = getelementptr inbounds float* %out, i64 %x
+  store float %sum.lcssa, float* %out.gep, align 4
+  %x.next = add nuw nsw i64 %x, 1
+  %outer.done = icmp eq i64 %x.next, %n
+  br i1 %outer.done, label %exit, label %outer, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+; The inner loop starts at the outer induction, runs a loop invariant number
+; of times and updates the output in place.
+; CHECK-LABEL: @shifted(
+; CHECK: inner.vec.body:
+; CHECK: %[[K:.*]] = phi i64 [ %index, %vector.body ], [ %[[KNEXT:.*]], %inner.vec.body ]
+; CHECK: %[[IN:.*]] = getelementptr inbounds i32* %in, i64 %[[K]]
+; CHECK: load <4 x i32>*
+; CHECK: store <4 x i32>
+; CHECK: %[[KNEXT]] = add i64 %[[K]], 1
+; CHECK: br i1 %{{.*}}, label %inner.vec.exit, label %inner.vec.body
+define void @shifted(i32* noalias %out, i32* noalias %in, i32* noalias %w, i64 %n, i64 %m) {
+entry:
+  br label %outer
+
+outer:
+  %x = phi i64 [ 0, %entry ], [ %x.next, %outer.latch ]
+  %out.gep = getelementptr inbounds i32* %out, i64 %x
+  store i32 0, i32* %out.gep, align 4
+  %end = add nsw i64 %x, %m
+  br label %inner
+
+inner:
+  %k = phi i64 [ %x, %outer ], [ %k.next, %inner ]
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %in.gep = getelementptr inbounds i32* %in, i64 %k
+  %a = load i32* %in.gep, align 4
+  %w.gep = getelementptr inbounds i32* %w, i64 %j
+  %b = load i32* %w.gep, align 4
+  %mul = mul i32 %a, %b
+  %o = load i32* %out.gep, align 4
+  %add = add i32 %o, %mul
+  store i32 %add, i32* %out.gep, align 4
+  %k.next = add nsw i64 %k, 1
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %k.next, %end
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %x.next = add nuw nsw i64 %x, 1
+  %outer.done = icmp eq i64 %x.next, %n
+  br i1 %outer.done, label %exit, label %outer, !llvm.loop !2
+
+exit:
+  ret void
+}
+
+; The inner trip count depends on the outer induction.
+; CHECK-LABEL: @triangle(
+; CHECK-NOT: <4 x
+; CHECK: ret void
+define void @triangle(float* noalias %out, float* noalias %in, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %x = phi i64 [ 0, %entry ], [ %x.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %k = phi i64 [ 0, %outer ], [ %k.next, %inner ]
+  %sum = phi float [ 0.000000e+00, %outer ], [ %sum.next, %inner ]
+  %in.gep = getelementptr inbounds float* %in, i64 %k
+  %a = load float* %in.gep, align 4
+  %sum.next = fadd float %sum, %a
+  %k.next = add nuw nsw i64 %k, 1
+  %inner.done = icmp eq i64 %k, %x
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %out.gep = getelementptr inbounds float* %out, i64 %x
+  store float %sum.lcssa, float* %out.gep, align 4
+  %x.next = add nuw nsw i64 %x, 1
+  %outer.done = icmp eq i64 %x.next, %n
+  br i1 %outer.done, label %exit, label %outer, !llvm.loop !3
+
+exit:
+  ret void
+}
+
+; The pointers may alias, but the accesses are marked as parallel.
+; CHECK-LABEL: @parallel(
+; CHECK: inner.vec.body:
+; CHECK: load <4 x float>*
+; CHECK: inner.vec.exit:
+; CHECK: store <4 x float>
+define void @parallel(float* %out, float* %in, float* %w, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %x = phi i64 [ 0, %entry ], [ %x.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %k = phi i64 [ 0, %outer ], [ %k.next, %inner ]
+  %sum = phi float [ 0.000000e+00, %outer ], [ %sum.next, %inner ]
+  %idx = add nsw i64 %x, %k
+  %in.gep = getelementptr inbounds float* %in, i64 %idx
+  %a = load float* %in.gep, align 4, !llvm.mem.parallel_loop_access !4
+  %w.gep = getelementptr inbounds float* %w, i64 %k
+  %b = load float* %w.gep, align 4, !llvm.mem.parallel_loop_access !4
+  %mul = fmul float %a, %b
+  %sum.next = fadd float %sum, %mul
+  %k.next = add nuw nsw i64 %k, 1
+  %inner.done = icmp eq i64 %k.next, 8
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %out.gep = getelementptr inbounds float* %out, i64 %x
+  store float %sum.lcssa, float* %out.gep, align 4, !llvm.mem.parallel_loop_access !4
+  %x.next = add nuw nsw i64 %x, 1
+  %outer.done = icmp eq i64 %x.next, %n
+  br i1 %outer.done, label %exit, label %outer, !llvm.loop !4
+
+exit:
+  ret void
+}
+
+; Each iteration reads the element that the previous one wrote.
+;
+;   for (x = 0; x < n; x++) {
+;     s = 0;
+;     for (k = 0; k < 8; k++)
+;       s += b[k];
+;     a[x + 1] = a[x] + s;
+;   }
+; CHECK-LABEL: @carried(
+; CHECK-NOT: <4 x
+; CHECK: ret void
+define void @carried(i32* noalias %a, i32* noalias %b, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %x = phi i64 [ 0, %entry ], [ %x.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %k = phi i64 [ 0, %outer ], [ %k.next, %inner ]
+  %sum = phi i32 [ 0, %outer ], [ %sum.next, %inner ]
+  %b.gep = getelementptr inbounds i32* %b, i64 %k
+  %v = load i32* %b.gep, align 4
+  %sum.next = add i32 %sum, %v
+  %k.next = add nuw nsw i64 %k, 1
+  %inner.done = icmp eq i64 %k.next, 8
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %s = phi i32 [ %sum.next, %inner ]
+  %a.gep = getelementptr inbounds i32* %a, i64 %x
+  %ax = load i32* %a.gep, align 4
+  %add = add i32 %ax, %s
+  %x.next = add nuw nsw i64 %x, 1
+  %a.next.gep = getelementptr inbounds i32* %a, i64 %x.next
+  store i32 %add, i32* %a.next.gep, align 4
+  %outer.done = icmp eq i64 %x.next, %n
+  br i1 %outer.done, label %exit, label %outer, !llvm.loop !5
+
+exit:
+  ret void
+}
+
+; Innermost loops keep scalarizing loads from an invariant address.
+; UNIFORM-LABEL: @invariant_inner(
+; UNIFORM-NOT: .uniform
+; UNIFORM: load i32* %p
+; UNIFORM: load i32* %p
+; UNIFORM: load i32* %p
+; UNIFORM: load i32* %p
+; UNIFORM-NOT: .uniform
+; UNIFORM: ret void
+define void @invariant_inner(i32* noalias %a, i32* noalias %p, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32* %p, align 4
+  %a.gep = getelementptr inbounds i32* %a, i64 %i
+  store i32 %v, i32* %a.gep, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+!0 = metadata !{metadata !0, metadata !1}
+!1 = metadata !{metadata !"llvm.loop.vectorize.enable", i1 true}
+!2 = metadata !{metadata !2, metadata !1}
+!3 = metadata !{metadata !3, metadata !1}
+!4 = metadata !{metadata !4, metadata !1}
+!5 = metadata !{metadata !5, metadata !1}
+!6 = metadata !{metadata !"float", metadata !7}
+!7 = metadata !{metadata !"tbaa root"}
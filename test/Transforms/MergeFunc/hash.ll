@@ -0,0 +1,57 @@
+; RUN: opt -S -mergefunc < %s | FileCheck %s
+; RUN: opt -mergefunc -stats -disable-output < %s 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; Functions are only compared with others that have the same structural hash.
+; @a and @b are equal and are merged.  @c has the same opcodes but different
+; constants, so it has the same hash but is kept.  @d is the only function
+; with its opcodes, and @e differs from @a only in the shape of its CFG, so
+; neither is compared with anything.
+
+; STATS: 1 mergefunc - Number of functions merged
+; STATS: 2 mergefunc - Number of functions skipped because their hash is unique
+
+define i32 @a(i32 %x) {
+; CHECK-LABEL: @a(
+; CHECK: add i32 %x, 1
+  %1 = add i32 %x, 1
+  %2 = mul i32 %1, 3
+  ret i32 %2
+}
+
+define i32 @b(i32 %x) {
+  %1 = add i32 %x, 1
+  %2 = mul i32 %1, 3
+  ret i32 %2
+}
+
+define i32 @c(i32 %x) {
+; CHECK-LABEL: @c(
+; CHECK: add i32 %x, 2
+  %1 = add i32 %x, 2
+  %2 = mul i32 %1, 3
+  ret i32 %2
+}
+
+define i32 @d(i32 %x) {
+; CHECK-LABEL: @d(
+; CHECK: sub i32 %x, 1
+  %1 = sub i32 %x, 1
+  %2 = mul i32 %1, 3
+  ret i32 %2
+}
+
+define i32 @e(i32 %x) {
+; CHECK-LABEL: @e(
+; CHECK: add i32 %x, 1
+  %1 = add i32 %x, 1
+  br label %next
+
+next:
+  %2 = mul i32 %1, 3
+  ret i32 %2
+}
+
+; The thunk that replaces @b is added at the end of the module.
+; CHECK-LABEL: @b(
+; CHECK-NEXT: tail call i32 @a(
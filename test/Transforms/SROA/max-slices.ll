@@ -0,0 +1,45 @@
+; RUN: opt < %s -sroa -S | FileCheck %s
+; RUN: opt < %s -sroa -sroa-max-alloca-slices=2 -S | FileCheck %s --check-prefix=LIMIT
+; RUN: opt < %s -sroa -sroa-max-alloca-slices=2 -force-ssa-updater -S | FileCheck %s --check-prefix=LIMIT
+
+; Allocas with more slices than -sroa-max-alloca-slices are not split, but are
+; still promoted when they can be as a whole.
+
+target datalayout = "e-p:64:64:64-i32:32:32-i64:32:64-n8:16:32:64"
+
+define i32 @scalar(i32 %x, i32 %y) {
+; CHECK-LABEL: @scalar(
+; CHECK-NOT: alloca
+; CHECK: ret i32
+; LIMIT-LABEL: @scalar(
+; LIMIT-NOT: alloca
+; LIMIT: ret i32
+entry:
+  %a = alloca i32
+  store i32 %x, i32* %a
+  %v1 = load i32* %a
+  store i32 %y, i32* %a
+  %v2 = load i32* %a
+  %r = add i32 %v1, %v2
+  ret i32 %r
+}
+
+define i32 @aggregate(i32 %x, i32 %y) {
+; CHECK-LABEL: @aggregate(
+; CHECK-NOT: alloca
+; CHECK: add i32 %x, %y
+; LIMIT-LABEL: @aggregate(
+; LIMIT: alloca { i32, i32 }
+; LIMIT: store i32 %x
+; LIMIT: store i32 %y
+entry:
+  %s = alloca { i32, i32 }
+  %f0 = getelementptr { i32, i32 }* %s, i32 0, i32 0
+  %f1 = getelementptr { i32, i32 }* %s, i32 0, i32 1
+  store i32 %x, i32* %f0
+  store i32 %y, i32* %f1
+  %v0 = load i32* %f0
+  %v1 = load i32* %f1
+  %r = add i32 %v0, %v1
+  ret i32 %r
+}
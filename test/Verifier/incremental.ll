@@ -0,0 +1,17 @@
+; RUN: opt < %s -verify-each -verify-incremental -instcombine -simplifycfg \
+; RUN:     -stats -disable-output 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Only @changed is modified by instcombine.  Both functions are verified once
+; after instcombine, and neither needs re-verifying after simplifycfg.
+; CHECK: 2 verify - Number of functions verified
+; CHECK: 2 verify - Number of unmodified functions skipped by incremental verification
+
+define i32 @changed(i32 %x) {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
+
+define i32 @unchanged(i32 %x) {
+  ret i32 %x
+}
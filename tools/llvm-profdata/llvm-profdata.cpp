@@ -7,13 +7,17 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// llvm-profdata merges .profdata files.
+// llvm-profdata merges .profdata files, and instrumentation or sample
+// profiles.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/ProfileData/SampleProfWriter.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
@@ -33,6 +37,39 @@ static void exitWithError(const Twine &Message, StringRef Whence = "") {
   ::exit(1);
 }
 
+static void mergeSampleProfiles(const cl::list<std::string> &Inputs,
+                                StringRef OutputFilename, bool OutputText) {
+  using namespace sampleprof;
+  if (!OutputText && OutputFilename.compare("-") == 0)
+    exitWithError("Cannot write binary sample profile format to stdout.");
+
+  std::error_code EC;
+  raw_fd_ostream Output(OutputFilename.data(), EC,
+                        OutputText ? sys::fs::F_Text : sys::fs::F_None);
+  if (EC)
+    exitWithError(EC.message(), OutputFilename);
+
+  // Parse errors are reported through the context's diagnostic handler.
+  LLVMContext Context;
+  SampleProfileWriter Writer;
+  for (const auto &Filename : Inputs) {
+    std::unique_ptr<SampleProfileReader> Reader;
+    if (std::error_code EC =
+            SampleProfileReader::create(Filename, Reader, Context))
+      exitWithError(EC.message(), Filename);
+    if (std::error_code EC = Reader->read())
+      exitWithError(EC.message(), Filename);
+
+    for (const auto &I : Reader->getProfiles())
+      Writer.addFunctionSamples(I.getKey(), I.getValue());
+  }
+
+  if (OutputText)
+    Writer.writeText(Output);
+  else
+    Writer.writeBinary(Output);
+}
+
 int merge_main(int argc, const char *argv[]) {
   cl::list<std::string> Inputs(cl::Positional, cl::Required, cl::OneOrMore,
                                cl::desc("<filenames...>"));
@@ -43,8 +80,19 @@ int merge_main(int argc, const char *argv[]) {
   cl::alias OutputFilenameA("o", cl::desc("Alias for --output"),
                             cl::aliasopt(OutputFilename));
 
+  cl::opt<bool> SampleProfile("sample", cl::init(false),
+                              cl::desc("Merge sample profiles"));
+  cl::opt<bool> OutputText("text", cl::init(false),
+                           cl::desc("Write sample profiles in the text format "
+                                    "instead of the binary one"));
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
+  if (SampleProfile) {
+    mergeSampleProfiles(Inputs, OutputFilename, OutputText);
+    return 0;
+  }
+
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -71,6 +119,27 @@ int merge_main(int argc, const char *argv[]) {
   return 0;
 }
 
+static void showSampleProfile(StringRef Filename, raw_fd_ostream &OS,
+                              bool ShowAllFunctions, StringRef ShowFunction) {
+  using namespace sampleprof;
+  LLVMContext Context;
+  std::unique_ptr<SampleProfileReader> Reader;
+  if (std::error_code EC =
+          SampleProfileReader::create(Filename, Reader, Context))
+    exitWithError(EC.message(), Filename);
+
+  if (!ShowAllFunctions && !ShowFunction.empty()) {
+    if (Reader->getSamplesFor(ShowFunction))
+      Reader->printFunctionProfile(OS, ShowFunction);
+    return;
+  }
+
+  if (std::error_code EC = Reader->read())
+    exitWithError(EC.message(), Filename);
+  Reader->print(OS);
+  OS << "Total functions: " << Reader->getProfiles().size() << "\n";
+}
+
 int show_main(int argc, const char *argv[]) {
   cl::opt<std::string> Filename(cl::Positional, cl::Required,
                                 cl::desc("<profdata-file>"));
@@ -88,8 +157,24 @@ int show_main(int argc, const char *argv[]) {
   cl::alias OutputFilenameA("o", cl::desc("Alias for --output"),
                             cl::aliasopt(OutputFilename));
 
+  cl::opt<bool> SampleProfile("sample", cl::init(false),
+                              cl::desc("Show a sample profile"));
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data summary\n");
 
+  if (SampleProfile) {
+    if (OutputFilename.empty())
+      OutputFilename = "-";
+    std::error_code EC;
+    raw_fd_ostream OS(OutputFilename.data(), EC, sys::fs::F_Text);
+    if (EC)
+      exitWithError(EC.message(), OutputFilename);
+    if (ShowAllFunctions && !ShowFunction.empty())
+      errs() << "warning: -function argument ignored: showing all functions\n";
+    showSampleProfile(Filename, OS, ShowAllFunctions, ShowFunction);
+    return 0;
+  }
+
   std::unique_ptr<InstrProfReader> Reader;
   if (std::error_code EC = InstrProfReader::create(Filename, Reader))
     exitWithError(EC.message(), Filename);
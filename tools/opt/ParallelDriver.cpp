@@ -0,0 +1,905 @@
+//===- ParallelDriver.cpp - Run opt's function passes on threads ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements opt -j.  An LLVMContext may only be used by one thread
+/// at a time, so every thread works on a copy of the module that it reads from
+/// bitcode into a context of its own.  Once the function passes have run, the
+/// thread strips its copy down to the bodies of the functions it optimized,
+/// and those are linked back into the original module.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ParallelDriver.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/UseListOrder.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Pass.h"
+#include "llvm/PassInfo.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+#include <memory>
+
+using namespace llvm;
+
+namespace {
+/// A pass manager that only records the passes added to it, so that they can
+/// be handed out to the pass managers that run parts of the pipeline.
+class PassRecorder : public legacy::PassManagerBase {
+public:
+  ~PassRecorder() { DeleteContainerPointers(Passes); }
+
+  void add(Pass *P) override { Passes.push_back(P); }
+
+  /// Hand the immutable passes over to \p PM.  Every pass manager that runs
+  /// part of the pipeline needs them.
+  void takeImmutablePasses(std::vector<Pass *> &PM) {
+    for (Pass *&P : Passes)
+      if (P && P->getAsImmutablePass()) {
+        PM.push_back(P);
+        P = nullptr;
+      }
+  }
+
+  /// Hand the other passes in [Begin, End) over to \p PM.
+  void takePasses(unsigned Begin, unsigned End, std::vector<Pass *> &PM) {
+    for (unsigned I = Begin; I != End; ++I)
+      if (Passes[I]) {
+        PM.push_back(Passes[I]);
+        Passes[I] = nullptr;
+      }
+  }
+
+  std::vector<Pass *> Passes;
+};
+
+/// One set of instances of the passes in the pipeline.  No pass object is
+/// shared between pass managers, so no pass object is used by two threads.
+struct PipelineInstance {
+  PassRecorder Passes;
+  PassRecorder FPasses;
+  bool RunFPasses;
+
+  explicit PipelineInstance(const PipelineBuilder &Build) {
+    RunFPasses = Build(Passes, FPasses);
+  }
+};
+
+/// A run of passes in a pass list that are either all run in parallel or all
+/// run serially.  Immutable passes belong to no segment.
+struct Segment {
+  unsigned Begin, End;
+  bool Parallel;
+};
+
+/// The attributes of a global value that linking the optimized functions back
+/// into the module may change.
+struct SavedGlobal {
+  GlobalValue *GV;
+  std::string Name;
+  GlobalValue::LinkageTypes Linkage;
+  GlobalValue::VisibilityTypes Visibility;
+  GlobalValue::DLLStorageClassTypes DLLStorageClass;
+  bool UnnamedAddr;
+  Comdat *C;
+  bool Unnamed;
+
+  SavedGlobal(GlobalObject *GO, unsigned Index)
+      : GV(GO), Linkage(GO->getLinkage()), Visibility(GO->getVisibility()),
+        DLLStorageClass(GO->getDLLStorageClass()),
+        UnnamedAddr(GO->hasUnnamedAddr()), C(GO->getComdat()),
+        Unnamed(!GO->hasName()) {
+    // The linker matches the copies of a global value up by name.  Number the
+    // names rather than have them made unique, which would throw off the
+    // numbering of the names that the passes make unique.
+    if (Unnamed)
+      GO->setName("opt.j." + Twine(Index));
+    Name = GO->getName();
+  }
+
+  void restore() {
+    GV->setLinkage(Linkage);
+    GV->setVisibility(Visibility);
+    GV->setDLLStorageClass(DLLStorageClass);
+    GV->setUnnamedAddr(UnnamedAddr);
+    cast<GlobalObject>(GV)->setComdat(C);
+    if (Unnamed)
+      GV->setName("");
+  }
+};
+}
+
+static const char *const MetadataAnchorName = "opt.j.metadata";
+
+/// Anchor the metadata that the instructions of \p M refer to in a named
+/// metadata node.  Nodes in cycles, such as alias scopes and loop IDs, aren't
+/// found by uniquing, so reading a thread's results back and linking them in
+/// creates copies of them.  The anchor lets mapMetadataToAnchor replace the
+/// copies with the nodes they were made from.
+static void addMetadataAnchor(Module &M) {
+  SmallVector<MDNode *, 32> Worklist;
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB) {
+        MDs.clear();
+        I.getAllMetadata(MDs);
+        for (auto &MD : MDs)
+          Worklist.push_back(MD.second);
+        for (Value *Op : I.operands())
+          if (MDNode *N = dyn_cast_or_null<MDNode>(Op))
+            Worklist.push_back(N);
+      }
+
+  NamedMDNode *Anchor = M.getOrInsertNamedMetadata(MetadataAnchorName);
+  SmallPtrSet<MDNode *, 32> Seen;
+  while (!Worklist.empty()) {
+    MDNode *N = Worklist.pop_back_val();
+    if (!Seen.insert(N))
+      continue;
+    // Function-local nodes are copied with the function that uses them.
+    if (!N->isFunctionLocal())
+      Anchor->addOperand(N);
+    for (unsigned I = 0, E = N->getNumOperands(); I != E; ++I)
+      if (MDNode *Op = dyn_cast_or_null<MDNode>(N->getOperand(I)))
+        Worklist.push_back(Op);
+  }
+}
+
+namespace {
+/// A handle to an anchored node in a thread's copy of the module.  Unlike the
+/// operands of named metadata, it stays with the node if the node is replaced.
+class AnchoredNode : public CallbackVH {
+public:
+  AnchoredNode(MDNode *N) : CallbackVH(N) {}
+  AnchoredNode(const AnchoredNode &RHS) : CallbackVH(RHS) {}
+};
+}
+
+/// Return the node that stands in the anchor for a node that was deleted.
+static MDNode *getDeletedNode(LLVMContext &Context) {
+  return MDNode::get(Context, MDString::get(Context, MetadataAnchorName));
+}
+
+/// Point the instructions of the functions \p Names of \p M, which were just
+/// linked in, at the metadata that \p M anchors rather than at copies of it.
+/// The anchor of the linked module was appended to that of \p M, so the
+/// second half of the anchor lists the copies.
+static void mapMetadataToAnchor(Module &M,
+                                const std::vector<std::string> &Names) {
+  NamedMDNode *Anchor = M.getNamedMetadata(MetadataAnchorName);
+  unsigned NumOriginals = Anchor->getNumOperands() / 2;
+  MDNode *Deleted = getDeletedNode(M.getContext());
+  ValueToValueMapTy VM;
+  SmallVector<MDNode *, 32> Originals;
+  for (unsigned I = 0; I != NumOriginals; ++I) {
+    Originals.push_back(Anchor->getOperand(I));
+    MDNode *Copy = Anchor->getOperand(NumOriginals + I);
+    if (Copy != Deleted)
+      VM[Copy] = Originals.back();
+  }
+  Anchor->dropAllReferences();
+  for (MDNode *N : Originals)
+    Anchor->addOperand(N);
+
+  // The nodes the passes made are remapped to refer to the originals too.
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  for (const std::string &Name : Names)
+    for (BasicBlock &BB : *M.getFunction(Name))
+      for (Instruction &I : BB) {
+        MDs.clear();
+        I.getAllMetadata(MDs);
+        for (auto &MD : MDs)
+          I.setMetadata(MD.first,
+                        MapValue(MD.second, VM, RF_IgnoreMissingEntries));
+        for (Use &Op : I.operands())
+          if (MDNode *N = dyn_cast_or_null<MDNode>(Op.get()))
+            Op.set(MapValue(N, VM, RF_IgnoreMissingEntries));
+      }
+}
+
+static bool isDebugInfoVersion(MDNode *Flag) {
+  if (Flag->getNumOperands() < 3)
+    return false;
+  MDString *Key = dyn_cast_or_null<MDString>(Flag->getOperand(1));
+  return Key && Key->getString() == "Debug Info Version";
+}
+
+/// Give \p GO the attributes under which linking in the optimized functions
+/// doesn't change it.  Those that matter are saved as a SavedGlobal first.
+static void prepareForLinking(GlobalObject &GO) {
+  // Comparisons with extern_weak declarations would be folded if they lost
+  // their linkage, so those are left for the linker to replace.
+  if ((GO.isDeclaration() && !GO.hasExternalWeakLinkage()) ||
+      GO.hasLocalLinkage())
+    GO.setLinkage(GlobalValue::ExternalLinkage);
+  GO.setDLLStorageClass(GlobalValue::DefaultStorageClass);
+  GO.setComdat(nullptr);
+}
+
+/// Return true if the defined functions of \p M can be optimized separately
+/// and linked back in.
+static bool canSplit(Module &M) {
+  // Aliases may refer to functions in a way the linker can't redirect to the
+  // optimized bodies, and the addresses of blocks don't survive the bodies
+  // being deleted.  The loop vectorizer replaces the ID of a loop it has seen
+  // everywhere, so loops in different functions must not share one.
+  if (!M.alias_empty())
+    return false;
+  unsigned LoopMD = M.getContext().getMDKindID("llvm.loop");
+  DenseMap<MDNode *, Function *> LoopIDs;
+  unsigned NumDefined = 0;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    ++NumDefined;
+    for (BasicBlock &BB : F) {
+      if (BB.hasAddressTaken())
+        return false;
+      if (MDNode *LoopID = BB.getTerminator()->getMetadata(LoopMD))
+        if (LoopIDs.insert(std::make_pair(LoopID, &F)).first->second != &F)
+          return false;
+    }
+  }
+  return NumDefined > 1;
+}
+
+static void runPasses(Module &M, std::vector<Pass *> &Passes) {
+  legacy::PassManager PM;
+  for (Pass *P : Passes)
+    PM.add(P);
+  PM.run(M);
+}
+
+static void runFunctionPasses(Module &M, std::vector<Pass *> &Passes) {
+  legacy::FunctionPassManager FPM(&M);
+  for (Pass *P : Passes)
+    FPM.add(P);
+  FPM.doInitialization();
+  for (Function &F : M)
+    FPM.run(F);
+  FPM.doFinalization();
+}
+
+/// Run the whole pipeline over \p M the way opt does without -j.
+static void runSerially(Module &M, const PipelineBuilder &Build) {
+  legacy::PassManager Passes;
+  legacy::FunctionPassManager FPasses(&M);
+  if (Build(Passes, FPasses)) {
+    FPasses.doInitialization();
+    for (Function &F : M)
+      FPasses.run(F);
+    FPasses.doFinalization();
+  }
+  Passes.run(M);
+}
+
+static const PassInfo *getPassInfo(const void *ID) {
+  return PassRegistry::getPassRegistry()->getPassInfo(ID);
+}
+
+/// Return true if \p P, or an analysis it requires, is a module pass other
+/// than an immutable pass.  Such a pass needs the whole module, which a thread
+/// has no up to date copy of.
+static bool requiresModulePass(Pass *P, DenseMap<AnalysisID, bool> &Cache) {
+  AnalysisUsage AU;
+  P->getAnalysisUsage(AU);
+  SmallVector<AnalysisID, 8> Required(AU.getRequiredSet().begin(),
+                                      AU.getRequiredSet().end());
+  Required.append(AU.getRequiredTransitiveSet().begin(),
+                  AU.getRequiredTransitiveSet().end());
+  for (AnalysisID ID : Required) {
+    auto Cached = Cache.find(ID);
+    if (Cached != Cache.end()) {
+      if (Cached->second)
+        return true;
+      continue;
+    }
+
+    // Analysis groups are implemented by immutable passes unless a module
+    // pass implementing them ran earlier, which computeSegments checks for.
+    const PassInfo *PI = getPassInfo(ID);
+    if (PI && PI->isAnalysisGroup()) {
+      Cache[ID] = false;
+      continue;
+    }
+    if (!PI || !PI->getNormalCtor()) {
+      Cache[ID] = true;
+      return true;
+    }
+
+    // Guard against cycles while looking at the analysis' own requirements.
+    Cache[ID] = false;
+    std::unique_ptr<Pass> Analysis(PI->createPass());
+    bool Result = (Analysis->getPassKind() == PT_Module &&
+                   !Analysis->getAsImmutablePass()) ||
+                  requiresModulePass(Analysis.get(), Cache);
+    Cache[ID] = Result;
+    if (Result)
+      return true;
+  }
+  return false;
+}
+
+/// Return true if \p P may change the IR, so that running it in parallel may
+/// pay off.
+static bool isTransformation(Pass *P) {
+  const PassInfo *PI = getPassInfo(P->getPassID());
+  return PI && !PI->isAnalysis() &&
+         StringRef(PI->getPassArgument()) != "verify";
+}
+
+/// Split \p Passes into segments.  Function passes, and the passes that the
+/// pass manager nests inside them, run in parallel unless they are nested in a
+/// call graph SCC pass, or need a module pass, or an earlier module pass
+/// implements an analysis group that they may use.  Segments with nothing
+/// but analyses and verifiers are run serially, as are all other passes.
+static std::vector<Segment> computeSegments(const std::vector<Pass *> &Passes) {
+  std::vector<Segment> Segments;
+  DenseMap<AnalysisID, bool> Cache;
+  bool InSCC = false, AfterModuleAnalysis = false;
+  for (unsigned I = 0, E = Passes.size(); I != E; ++I) {
+    Pass *P = Passes[I];
+    if (P->getAsImmutablePass())
+      continue;
+
+    bool Parallel = false;
+    switch (P->getPassKind()) {
+    case PT_BasicBlock:
+    case PT_Region:
+    case PT_Loop:
+    case PT_Function:
+      Parallel = !InSCC && !AfterModuleAnalysis &&
+                 !requiresModulePass(P, Cache);
+      break;
+    case PT_CallGraphSCC:
+      InSCC = true;
+      break;
+    default: {
+      InSCC = false;
+      const PassInfo *PI = getPassInfo(P->getPassID());
+      if (PI && !PI->getInterfacesImplemented().empty())
+        AfterModuleAnalysis = true;
+      break;
+    }
+    }
+
+    if (!Segments.empty() && Segments.back().Parallel == Parallel)
+      Segments.back().End = I + 1;
+    else
+      Segments.push_back({ I, I + 1, Parallel });
+  }
+
+  std::vector<Segment> Merged;
+  for (Segment S : Segments) {
+    if (S.Parallel &&
+        std::none_of(Passes.begin() + S.Begin, Passes.begin() + S.End,
+                     isTransformation))
+      S.Parallel = false;
+    if (!Merged.empty() && !Merged.back().Parallel && !S.Parallel)
+      Merged.back().End = S.End;
+    else
+      Merged.push_back(S);
+  }
+  return Merged;
+}
+
+/// Split the defined functions of \p M into at most \p Count runs of
+/// consecutive functions with about the same number of instructions.  Returns
+/// the index of the first function of each run among the defined functions,
+/// followed by the number of defined functions.
+static std::vector<unsigned> splitFunctions(Module &M, unsigned Count) {
+  std::vector<uint64_t> Sizes;
+  uint64_t Total = 0;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    uint64_t Size = 1;
+    for (BasicBlock &BB : F)
+      Size += BB.size();
+    Sizes.push_back(Size);
+    Total += Size;
+  }
+
+  unsigned NumFunctions = Sizes.size();
+  Count = std::min(Count, NumFunctions);
+  std::vector<unsigned> Bounds(1, 0);
+  uint64_t Sum = 0;
+  for (unsigned I = 0; I + 1 < NumFunctions; ++I) {
+    Sum += Sizes[I];
+    unsigned Runs = Bounds.size();
+    if (Runs == Count)
+      break;
+    // End the current run once it has its share of the instructions, or when
+    // every function left is needed to start a run of its own.
+    if (Sum * Count >= Total * Runs || NumFunctions - I - 1 == Count - Runs)
+      Bounds.push_back(I + 1);
+  }
+  Bounds.push_back(NumFunctions);
+  return Bounds;
+}
+
+/// Run \p Passes over the defined functions [Begin, End) of the module in
+/// \p Bitcode, and write a module with just the bodies of those functions to
+/// \p Result.  Everything else is left as declarations for the linker to
+/// resolve against the original module.
+static void runOnFunctions(StringRef Bitcode, std::vector<Pass *> Passes,
+                           unsigned Begin, unsigned End, std::string &Result,
+                           std::string &Error) {
+  LLVMContext Context;
+  ErrorOr<Module *> ModuleOrErr =
+      parseBitcodeFile(MemoryBufferRef(Bitcode, "opt -j"), Context);
+  if (std::error_code EC = ModuleOrErr.getError()) {
+    DeleteContainerPointers(Passes);
+    Error = EC.message();
+    return;
+  }
+  std::unique_ptr<Module> M(ModuleOrErr.get());
+
+  // The passes may replace anchored nodes, which the operands of the anchor
+  // would follow, but the anchor has to list the nodes it was read with.
+  NamedMDNode *Anchor = M->getNamedMetadata(MetadataAnchorName);
+  std::vector<AnchoredNode> Anchored;
+  Anchored.reserve(Anchor->getNumOperands());
+  for (unsigned I = 0, E = Anchor->getNumOperands(); I != E; ++I)
+    Anchored.push_back(Anchor->getOperand(I));
+  Anchor->eraseFromParent();
+
+  std::vector<Function *> Functions;
+  SmallPtrSet<Function *, 16> Optimized;
+  unsigned Index = 0;
+  for (Function &F : *M) {
+    Functions.push_back(&F);
+    if (F.isDeclaration())
+      continue;
+    if (Index >= Begin && Index < End)
+      Optimized.insert(&F);
+    ++Index;
+  }
+  std::vector<GlobalVariable *> Variables;
+  for (GlobalVariable &GV : M->globals())
+    Variables.push_back(&GV);
+
+  {
+    legacy::FunctionPassManager FPM(M.get());
+    for (Pass *P : Passes)
+      FPM.add(P);
+    FPM.doInitialization();
+    for (Function *F : Functions)
+      if (Optimized.count(F))
+        FPM.run(*F);
+    FPM.doFinalization();
+  }
+
+  for (Function *F : Functions) {
+    if (Optimized.count(F))
+      F->setLinkage(GlobalValue::ExternalLinkage);
+    else if (!F->isDeclaration())
+      F->deleteBody();
+    prepareForLinking(*F);
+  }
+  for (GlobalVariable *GV : Variables) {
+    if (GV->hasAppendingLinkage() && GV->use_empty()) {
+      GV->eraseFromParent();
+      continue;
+    }
+    GV->setInitializer(nullptr);
+    prepareForLinking(*GV);
+  }
+  // The globals that the passes added keep their linkage, but comdats are
+  // left to the original module.
+  for (Function &F : *M)
+    F.setComdat(nullptr);
+  for (GlobalVariable &GV : M->globals())
+    GV.setComdat(nullptr);
+  M->getComdatSymbolTable().clear();
+  M->setModuleInlineAsm("");
+  // Keep the debug info version, or the debug info would be stripped when the
+  // module is read back.
+  MDNode *DebugInfoVersion = nullptr;
+  if (NamedMDNode *Flags = M->getModuleFlagsMetadata())
+    for (unsigned I = 0, E = Flags->getNumOperands(); I != E; ++I)
+      if (isDebugInfoVersion(Flags->getOperand(I)))
+        DebugInfoVersion = Flags->getOperand(I);
+  while (!M->named_metadata_empty())
+    M->named_metadata_begin()->eraseFromParent();
+  if (DebugInfoVersion)
+    M->addModuleFlag(DebugInfoVersion);
+  Anchor = M->getOrInsertNamedMetadata(MetadataAnchorName);
+  for (Value *N : Anchored)
+    Anchor->addOperand(N ? cast<MDNode>(N) : getDeletedNode(Context));
+
+  raw_string_ostream OS(Result);
+  WriteBitcodeToFile(M.get(), OS);
+  OS.flush();
+}
+
+/// Number the uses of the values that the instructions in \p M use, in use
+/// list order, and save the names of the functions defined in \p M.
+static void recordUseListOrder(Module &M,
+                               DenseMap<const Use *, unsigned> &Order,
+                               std::vector<std::string> &Names) {
+  SmallPtrSet<const Value *, 32> Seen;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    Names.push_back(F.getName());
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB)
+        for (const Use &Op : I.operands()) {
+          // Instructions and blocks move over with their uses.
+          const Value *V = Op.get();
+          if (!V || isa<Instruction>(V) || isa<BasicBlock>(V) ||
+              !Seen.insert(V))
+            continue;
+          unsigned Index = 0;
+          for (const Use &U : V->uses())
+            Order[&U] = Index++;
+        }
+  }
+}
+
+/// Put the uses of the values that the instructions in the functions \p Names
+/// of \p M use back in the order recorded by recordUseListOrder, ahead of the
+/// uses that were already there.  Function passes may depend on the order of
+/// the uses within a function, so this keeps them from behaving differently
+/// after the module has been split up.
+static void restoreUseListOrder(Module &M,
+                                const DenseMap<const Use *, unsigned> &Order,
+                                const std::vector<std::string> &Names) {
+  auto Index = [&](const Use &U) {
+    auto I = Order.find(&U);
+    return I == Order.end() ? ~0U : I->second;
+  };
+  SmallPtrSet<Value *, 32> Seen;
+  for (const std::string &Name : Names)
+    for (BasicBlock &BB : *M.getFunction(Name))
+      for (Instruction &I : BB)
+        for (Use &Op : I.operands()) {
+          Value *V = Op.get();
+          if (!V || isa<Instruction>(V) || isa<BasicBlock>(V) ||
+              !Seen.insert(V))
+            continue;
+          V->sortUseList([&](const Use &L, const Use &R) {
+            return Index(L) < Index(R);
+          });
+        }
+}
+
+/// The linker replaces the declarations it links definitions into, and
+/// extern_weak declarations, with new globals at the end of the module.  Put
+/// the globals in \p Saved back in their places in \p List, ahead of any that
+/// the passes added, and give them their attributes back.
+template <typename GlobalT>
+static void restoreGlobals(Module &M, iplist<GlobalT> &List,
+                           std::vector<SavedGlobal> &Saved) {
+  SmallPtrSet<GlobalT *, 16> Original;
+  for (SavedGlobal &S : Saved) {
+    S.GV = cast<GlobalT>(M.getNamedValue(S.Name));
+    Original.insert(cast<GlobalT>(S.GV));
+  }
+  std::vector<GlobalT *> Added;
+  for (GlobalT &G : List)
+    if (!Original.count(&G))
+      Added.push_back(&G);
+  for (SavedGlobal &S : Saved)
+    List.splice(List.end(), List, cast<GlobalT>(S.GV));
+  for (GlobalT *G : Added)
+    List.splice(List.end(), List, G);
+  for (SavedGlobal &S : Saved)
+    S.restore();
+}
+
+/// Run the passes of segment \p S of the pass list that \p List picks out of
+/// each pipeline instance over the defined functions of \p M on \p Threads
+/// threads, and replace the function bodies in \p M with the results.
+static bool
+runInParallel(StringRef Arg0, Module &M, unsigned Threads,
+              const PipelineBuilder &Build, const Segment &S,
+              PassRecorder PipelineInstance::*List) {
+  std::vector<SavedGlobal> Functions, Variables;
+  unsigned Index = 0;
+  for (Function &F : M)
+    Functions.push_back(SavedGlobal(&F, Index++));
+  for (GlobalVariable &GV : M.globals())
+    Variables.push_back(SavedGlobal(&GV, Index++));
+  addMetadataAnchor(M);
+
+  std::string Bitcode;
+  raw_string_ostream OS(Bitcode);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+
+  std::vector<unsigned> Bounds = splitFunctions(M, Threads);
+  unsigned NumRuns = Bounds.size() - 1;
+  std::vector<std::string> Results(NumRuns), Errors(NumRuns);
+  {
+    ThreadPool Pool(NumRuns);
+    for (unsigned I = 0; I != NumRuns; ++I) {
+      PipelineInstance Instance(Build);
+      std::vector<Pass *> Passes;
+      (Instance.*List).takeImmutablePasses(Passes);
+      (Instance.*List).takePasses(S.Begin, S.End, Passes);
+      StringRef Input = Bitcode;
+      unsigned Begin = Bounds[I], End = Bounds[I + 1];
+      std::string &Result = Results[I], &Error = Errors[I];
+      Pool.async([=, &Result, &Error] {
+        runOnFunctions(Input, Passes, Begin, End, Result, Error);
+      });
+    }
+    Pool.wait();
+  }
+
+  // Link the optimized bodies in.  The linker has to be set up while the
+  // bodies are still there, or it won't know about the struct types they use.
+  // Local symbols are made external for the time being, so that the linker
+  // resolves references to them, and declarations plain external, so that it
+  // doesn't replace them.
+  Linker L(&M);
+  for (Function &F : M) {
+    if (!F.isDeclaration())
+      F.deleteBody();
+    prepareForLinking(F);
+  }
+  for (GlobalVariable &GV : M.globals())
+    prepareForLinking(GV);
+
+  for (unsigned I = 0; I != NumRuns; ++I) {
+    std::string Error = Errors[I];
+    std::unique_ptr<Module> Src;
+    if (Error.empty()) {
+      ErrorOr<Module *> ModuleOrErr =
+          parseBitcodeFile(MemoryBufferRef(Results[I], "opt -j"),
+                           M.getContext());
+      if (std::error_code EC = ModuleOrErr.getError())
+        Error = EC.message();
+      else
+        Src.reset(ModuleOrErr.get());
+    }
+    if (Src) {
+      // Function passes may raise the alignment of a global variable.  The
+      // ones they add have local linkage.
+      for (GlobalVariable &GV : Src->globals()) {
+        if (GV.hasLocalLinkage())
+          continue;
+        GlobalVariable *Original = M.getGlobalVariable(GV.getName(), true);
+        if (Original && GV.getAlignment() > Original->getAlignment())
+          Original->setAlignment(GV.getAlignment());
+      }
+      // The linker moves the instructions over and points their operands at
+      // the values in M, which puts the uses in a different order.
+      DenseMap<const Use *, unsigned> Order;
+      std::vector<std::string> Names;
+      recordUseListOrder(*Src, Order, Names);
+      if (!L.linkInModule(Src.get(), Linker::DestroySource, &Error)) {
+        restoreUseListOrder(M, Order, Names);
+        mapMetadataToAnchor(M, Names);
+      }
+    }
+    if (!Error.empty()) {
+      errs() << Arg0 << ": -j: " << Error << '\n';
+      return false;
+    }
+  }
+
+  restoreGlobals(M, M.getFunctionList(), Functions);
+  restoreGlobals(M, M.getGlobalList(), Variables);
+  M.getNamedMetadata(MetadataAnchorName)->eraseFromParent();
+  return true;
+}
+
+/// Run the pipeline over \p M segment by segment.
+static bool runSegments(StringRef Arg0, Module &M, unsigned Threads,
+                        const PipelineBuilder &Build) {
+  std::vector<Segment> Segments, FSegments;
+  bool RunFPasses;
+  {
+    PipelineInstance Layout(Build);
+    Segments = computeSegments(Layout.Passes.Passes);
+    FSegments = computeSegments(Layout.FPasses.Passes);
+    RunFPasses = Layout.RunFPasses;
+  }
+
+  // The function passes of the -O levels run over each function before the
+  // rest of the pipeline, by a function pass manager of their own.
+  if (RunFPasses && !FSegments.empty()) {
+    if (FSegments.size() == 1 && FSegments[0].Parallel && canSplit(M)) {
+      if (!runInParallel(Arg0, M, Threads, Build, FSegments[0],
+                         &PipelineInstance::FPasses))
+        return false;
+    } else {
+      PipelineInstance Instance(Build);
+      std::vector<Pass *> Passes;
+      Instance.FPasses.takeImmutablePasses(Passes);
+      Instance.FPasses.takePasses(0, Instance.FPasses.Passes.size(), Passes);
+      runFunctionPasses(M, Passes);
+    }
+  }
+
+  for (const Segment &S : Segments) {
+    if (S.Parallel && canSplit(M)) {
+      if (!runInParallel(Arg0, M, Threads, Build, S,
+                         &PipelineInstance::Passes))
+        return false;
+      continue;
+    }
+    PipelineInstance Instance(Build);
+    std::vector<Pass *> Passes;
+    Instance.Passes.takeImmutablePasses(Passes);
+    Instance.Passes.takePasses(S.Begin, S.End, Passes);
+    runPasses(M, Passes);
+  }
+  return true;
+}
+
+/// Read \p Bitcode into \p Context, naming the module after \p M.  Returns
+/// null after printing a message if \p Bitcode can't be read, which happens
+/// if the input module isn't valid.
+static std::unique_ptr<Module> readModule(StringRef Arg0, StringRef Bitcode,
+                                          const Module &M,
+                                          LLVMContext &Context) {
+  ErrorOr<Module *> ModuleOrErr =
+      parseBitcodeFile(MemoryBufferRef(Bitcode, "opt -j"), Context);
+  if (std::error_code EC = ModuleOrErr.getError()) {
+    errs() << Arg0 << ": -j-check: " << EC.message() << '\n';
+    return nullptr;
+  }
+  std::unique_ptr<Module> Copy(ModuleOrErr.get());
+  Copy->setModuleIdentifier(M.getModuleIdentifier());
+  return Copy;
+}
+
+/// Drop the names of the arguments, blocks and instructions of \p M, and of
+/// the internal globals the passes added, which aren't among \p Globals.  The
+/// suffixes that make names unique depend on the names held before, which the
+/// copies made for -j don't know about.
+static void stripLocalNames(Module &M, const StringSet<> &Globals) {
+  for (GlobalVariable &GV : M.globals())
+    if (GV.hasLocalLinkage() && !Globals.count(GV.getName()))
+      GV.setName("");
+  for (Function &F : M) {
+    if (F.hasLocalLinkage() && !Globals.count(F.getName()))
+      F.setName("");
+    for (Argument &A : F.args())
+      A.setName("");
+    for (BasicBlock &BB : F) {
+      BB.setName("");
+      for (Instruction &I : BB)
+        I.setName("");
+    }
+  }
+}
+
+/// The reader strips the debug info from modules without a debug info
+/// version, but that is left to the reader of the original input.  Give \p M
+/// a version for the time being if it has none, and return true if so.
+static bool addDebugInfoVersion(Module &M) {
+  if (getDebugMetadataVersionFromModule(M))
+    return false;
+  M.addModuleFlag(Module::Warning, "Debug Info Version",
+                  DEBUG_METADATA_VERSION);
+  return true;
+}
+
+static void removeDebugInfoVersion(Module &M) {
+  NamedMDNode *Flags = M.getModuleFlagsMetadata();
+  if (!Flags)
+    return;
+  SmallVector<MDNode *, 4> Kept;
+  for (unsigned I = 0, E = Flags->getNumOperands(); I != E; ++I) {
+    MDNode *Flag = Flags->getOperand(I);
+    if (!isDebugInfoVersion(Flag))
+      Kept.push_back(Flag);
+  }
+  if (Kept.empty()) {
+    Flags->eraseFromParent();
+    return;
+  }
+  Flags->dropAllReferences();
+  for (MDNode *Flag : Kept)
+    Flags->addOperand(Flag);
+}
+
+bool llvm::runPipelineInParallel(StringRef Arg0, Module &M, unsigned Threads,
+                                 bool Check, const PipelineBuilder &Build) {
+  // The order of the uses of a value can make a difference to what the passes
+  // do, and the order of the predecessors of a block shows in the output, so
+  // keep it when the module is copied through bitcode.
+  bool PreserveUseListOrder = shouldPreserveBitcodeUseListOrder();
+  setPreserveBitcodeUseListOrder(true);
+  bool AddedDebugInfoVersion = addDebugInfoVersion(M);
+
+  // With -j-check, the module is also optimized serially, starting from a copy
+  // in a context of its own, so that its struct types keep their names.
+  std::string Input;
+  if (Check) {
+    raw_string_ostream OS(Input);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  bool Success = true;
+  if (!canSplit(M))
+    runSerially(M, Build);
+  else
+    Success = runSegments(Arg0, M, Threads, Build);
+  if (AddedDebugInfoVersion)
+    removeDebugInfoVersion(M);
+  if (!Success || !Check) {
+    setPreserveBitcodeUseListOrder(PreserveUseListOrder);
+    return Success;
+  }
+
+  // Compare the modules without the names that may differ.
+  LLVMContext ExpectedContext, ActualContext;
+  std::unique_ptr<Module> Reference =
+      readModule(Arg0, Input, M, ExpectedContext);
+  if (!Reference) {
+    setPreserveBitcodeUseListOrder(PreserveUseListOrder);
+    return false;
+  }
+  StringSet<> Globals;
+  for (GlobalValue &GV : Reference->globals())
+    if (GV.hasName())
+      Globals.insert(GV.getName());
+  for (GlobalValue &GV : *Reference)
+    if (GV.hasName())
+      Globals.insert(GV.getName());
+  runSerially(*Reference, Build);
+  if (AddedDebugInfoVersion)
+    removeDebugInfoVersion(*Reference);
+  std::string Output;
+  raw_string_ostream OS(Output);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+  std::unique_ptr<Module> Result = readModule(Arg0, Output, M, ActualContext);
+  setPreserveBitcodeUseListOrder(PreserveUseListOrder);
+  if (!Result)
+    return false;
+
+  stripLocalNames(*Reference, Globals);
+  stripLocalNames(*Result, Globals);
+  std::string Expected, Actual;
+  raw_string_ostream ExpectedOS(Expected), ActualOS(Actual);
+  ExpectedOS << *Reference;
+  ActualOS << *Result;
+  ExpectedOS.flush();
+  ActualOS.flush();
+  if (Expected == Actual)
+    return true;
+
+  // Point at the first line that differs.
+  StringRef ExpectedRest = Expected, ActualRest = Actual;
+  std::pair<StringRef, StringRef> ExpectedLine, ActualLine;
+  do {
+    ExpectedLine = ExpectedRest.split('\n');
+    ActualLine = ActualRest.split('\n');
+    ExpectedRest = ExpectedLine.second;
+    ActualRest = ActualLine.second;
+  } while (ExpectedLine.first == ActualLine.first);
+  errs() << Arg0 << ": -j" << Threads
+         << " gives a different module than running the passes serially\n"
+         << "  expected: " << ExpectedLine.first << '\n'
+         << "  got:      " << ActualLine.first << '\n';
+  return false;
+}
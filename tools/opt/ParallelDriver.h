@@ -0,0 +1,53 @@
+//===- ParallelDriver.h - Run opt's function passes on threads --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// A function which runs opt's legacy pass pipeline with the function passes
+/// spread over several threads, for opt -j.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_OPT_PARALLELDRIVER_H
+#define LLVM_TOOLS_OPT_PARALLELDRIVER_H
+
+#include "llvm/ADT/StringRef.h"
+#include <functional>
+
+namespace llvm {
+class Module;
+
+namespace legacy {
+class PassManagerBase;
+}
+
+/// \brief Adds fresh instances of the passes of the pipeline to \p Passes, and
+/// of the function passes run over each function beforehand to \p FPasses.
+/// Returns true if the passes in \p FPasses are to be run.
+typedef std::function<bool(legacy::PassManagerBase &Passes,
+                           legacy::PassManagerBase &FPasses)> PipelineBuilder;
+
+/// \brief Run the pipeline that \p Build adds over \p M, running the function
+/// passes over up to \p Threads functions at a time.
+///
+/// The pipeline is split into segments.  Runs of function passes (and the
+/// loop, region and basic block passes nested in them) that are not nested in
+/// a call graph SCC pass are run in parallel: each thread reads its own copy
+/// of \p M into a context of its own, runs the passes over a share of the
+/// functions, and the optimized bodies are linked back into \p M.  The other
+/// segments are run over \p M as usual.  \p Build is called once per pass
+/// manager, so it must not have side effects.
+///
+/// If \p Check is set, the pipeline is also run serially over a copy of \p M
+/// and the results are compared.  Returns false if they differ or something
+/// went wrong, after printing a message.
+bool runPipelineInParallel(StringRef Arg0, Module &M, unsigned Threads,
+                           bool Check, const PipelineBuilder &Build);
+}
+
+#endif
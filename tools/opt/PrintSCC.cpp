@@ -27,6 +27,7 @@
 
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/CallGraphSCCSchedule.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
@@ -61,6 +62,21 @@ namespace {
       AU.addRequired<CallGraphWrapperPass>();
     }
   };
+
+  struct CallGraphSCCSchedulePrinter : public ModulePass {
+    static char ID;  // Pass identification, replacement for typeid
+    CallGraphSCCSchedulePrinter() : ModulePass(ID) {}
+
+    // run - Print the dependencies between SCCs in the call graph.
+    bool runOnModule(Module &M) override;
+
+    void print(raw_ostream &O, const Module* = nullptr) const override { }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AU.setPreservesAll();
+      AU.addRequired<CallGraphWrapperPass>();
+    }
+  };
 }
 
 char CFGSCC::ID = 0;
@@ -71,6 +87,11 @@ char CallGraphSCC::ID = 0;
 static RegisterPass<CallGraphSCC>
 Z("print-callgraph-sccs", "Print SCCs of the Call Graph");
 
+char CallGraphSCCSchedulePrinter::ID = 0;
+static RegisterPass<CallGraphSCCSchedulePrinter>
+W("print-callgraph-scc-schedule",
+  "Print the dependencies between SCCs of the Call Graph");
+
 bool CFGSCC::runOnFunction(Function &F) {
   unsigned sccNum = 0;
   errs() << "SCCs for Function " << F.getName() << " in PostOrder:";
@@ -109,3 +130,10 @@ bool CallGraphSCC::runOnModule(Module &M) {
 
   return true;
 }
+
+// run - Print the dependencies between SCCs in the call graph.
+bool CallGraphSCCSchedulePrinter::runOnModule(Module &M) {
+  CallGraph &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+  CallGraphSCCSchedule(CG).print(errs());
+  return false;
+}
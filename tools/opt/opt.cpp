@@ -14,6 +14,7 @@
 
 #include "BreakpointPrinter.h"
 #include "NewPMDriver.h"
+#include "ParallelDriver.h"
 #include "PassPrinters.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/CallGraph.h"
@@ -181,6 +182,16 @@ DefaultDataLayout("default-data-layout",
           cl::desc("data layout string to use if not specified by module"),
           cl::value_desc("layout-string"), cl::init(""));
 
+static cl::opt<unsigned>
+Threads("j", cl::desc("Run function passes over up to N functions at a time"),
+        cl::value_desc("N"), cl::init(1), cl::Prefix);
+
+static cl::opt<bool>
+CheckParallel("j-check",
+              cl::desc("Check that -j gives the same module as running the "
+                       "passes serially"),
+              cl::Hidden);
+
 
 
 static inline void addPass(PassManagerBase &PM, Pass *P) {
@@ -198,7 +209,7 @@ static inline void addPass(PassManagerBase &PM, Pass *P) {
 /// OptLevel.
 ///
 /// OptLevel - Optimization Level
-static void AddOptimizationPasses(PassManagerBase &MPM,FunctionPassManager &FPM,
+static void AddOptimizationPasses(PassManagerBase &MPM, PassManagerBase &FPM,
                                   unsigned OptLevel, unsigned SizeLevel) {
   FPM.add(createVerifierPass());          // Verify that input is correct
   MPM.add(createDebugInfoVerifierPass()); // Verify that debug info is correct
@@ -305,6 +316,158 @@ static TargetMachine* GetTargetMachine(Triple TheTriple) {
                                         GetCodeGenOptLevel());
 }
 
+/// Add the passes selected on the command line to \p Passes, and the function
+/// passes of the -O levels to \p FPasses, which must be non-null if an -O level
+/// was given.  With -j this is called once per pass manager, so it must leave
+/// the options alone.  Returns true if the passes in \p FPasses are to be run
+/// over each function before \p Passes.
+static bool addPipelinePasses(const char *Arg0, PassManagerBase &Passes,
+                              PassManagerBase *FPasses, Module &M,
+                              TargetMachine *TM, raw_ostream *Out) {
+  // Add an appropriate TargetLibraryInfo pass for the module's triple.
+  TargetLibraryInfo *TLI = new TargetLibraryInfo(Triple(M.getTargetTriple()));
+
+  // The -disable-simplify-libcalls flag actually disables all builtin optzns.
+  if (DisableSimplifyLibCalls)
+    TLI->disableAllFunctions();
+  Passes.add(TLI);
+
+  // Add an appropriate DataLayout instance for this module.
+  const DataLayout *DL = M.getDataLayout();
+  if (DL)
+    Passes.add(new DataLayoutPass(&M));
+
+  // Add internal analysis passes from the target machine.
+  if (TM)
+    TM->addAnalysisPasses(Passes);
+
+  if (FPasses) {
+    if (DL)
+      FPasses->add(new DataLayoutPass(&M));
+    if (TM)
+      TM->addAnalysisPasses(*FPasses);
+  }
+
+  if (PrintBreakpoints)
+    Passes.add(createBreakpointPrinter(*Out));
+
+  // If the -strip-debug command line option was specified, add it.  If
+  // -std-compile-opts was also specified, it will handle StripDebug.
+  if (StripDebug && !StandardCompileOpts)
+    addPass(Passes, createStripSymbolsPass(true));
+
+  // Each of these is cleared once its passes have been added.
+  bool StdCompileOpts = StandardCompileOpts, StdLinkOpts = StandardLinkOpts;
+  bool O1 = OptLevelO1, O2 = OptLevelO2, Os = OptLevelOs, Oz = OptLevelOz,
+       O3 = OptLevelO3;
+
+  // Create a new optimization pass for each one specified on the command line
+  for (unsigned i = 0; i < PassList.size(); ++i) {
+    // Check to see if -std-compile-opts was specified before this option.  If
+    // so, handle it.
+    if (StdCompileOpts &&
+        StandardCompileOpts.getPosition() < PassList.getPosition(i)) {
+      AddStandardCompilePasses(Passes);
+      StdCompileOpts = false;
+    }
+
+    if (StdLinkOpts &&
+        StandardLinkOpts.getPosition() < PassList.getPosition(i)) {
+      AddStandardLinkPasses(Passes);
+      StdLinkOpts = false;
+    }
+
+    if (O1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 1, 0);
+      O1 = false;
+    }
+
+    if (O2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 2, 0);
+      O2 = false;
+    }
+
+    if (Os && OptLevelOs.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 2, 1);
+      Os = false;
+    }
+
+    if (Oz && OptLevelOz.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 2, 2);
+      Oz = false;
+    }
+
+    if (O3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
+      AddOptimizationPasses(Passes, *FPasses, 3, 0);
+      O3 = false;
+    }
+
+    const PassInfo *PassInf = PassList[i];
+    Pass *P = nullptr;
+    if (PassInf->getTargetMachineCtor())
+      P = PassInf->getTargetMachineCtor()(TM);
+    else if (PassInf->getNormalCtor())
+      P = PassInf->getNormalCtor()();
+    else
+      errs() << Arg0 << ": cannot create pass: "
+             << PassInf->getPassName() << "\n";
+    if (P) {
+      PassKind Kind = P->getPassKind();
+      addPass(Passes, P);
+
+      if (AnalyzeOnly) {
+        switch (Kind) {
+        case PT_BasicBlock:
+          Passes.add(createBasicBlockPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_Region:
+          Passes.add(createRegionPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_Loop:
+          Passes.add(createLoopPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_Function:
+          Passes.add(createFunctionPassPrinter(PassInf, *Out, Quiet));
+          break;
+        case PT_CallGraphSCC:
+          Passes.add(createCallGraphPassPrinter(PassInf, *Out, Quiet));
+          break;
+        default:
+          Passes.add(createModulePassPrinter(PassInf, *Out, Quiet));
+          break;
+        }
+      }
+    }
+
+    if (PrintEachXForm)
+      Passes.add(createPrintModulePass(errs()));
+  }
+
+  // If -std-compile-opts was specified at the end of the pass list, add them.
+  if (StdCompileOpts)
+    AddStandardCompilePasses(Passes);
+
+  if (StdLinkOpts)
+    AddStandardLinkPasses(Passes);
+
+  if (O1)
+    AddOptimizationPasses(Passes, *FPasses, 1, 0);
+
+  if (O2)
+    AddOptimizationPasses(Passes, *FPasses, 2, 0);
+
+  if (Os)
+    AddOptimizationPasses(Passes, *FPasses, 2, 1);
+
+  if (Oz)
+    AddOptimizationPasses(Passes, *FPasses, 2, 2);
+
+  if (O3)
+    AddOptimizationPasses(Passes, *FPasses, 3, 0);
+
+  return O1 || O2 || Os || Oz || O3;
+}
+
 #ifdef LINK_POLLY_INTO_TOOLS
 namespace polly {
 void initializePollyPasses(llvm::PassRegistry &Registry);
@@ -419,28 +582,9 @@ int main(int argc, char **argv) {
                : 1;
   }
 
-  // Create a PassManager to hold and optimize the collection of passes we are
-  // about to build.
-  //
-  PassManager Passes;
-
-  // Add an appropriate TargetLibraryInfo pass for the module's triple.
-  TargetLibraryInfo *TLI = new TargetLibraryInfo(Triple(M->getTargetTriple()));
-
-  // The -disable-simplify-libcalls flag actually disables all builtin optzns.
-  if (DisableSimplifyLibCalls)
-    TLI->disableAllFunctions();
-  Passes.add(TLI);
-
-  // Add an appropriate DataLayout instance for this module.
-  const DataLayout *DL = M.get()->getDataLayout();
-  if (!DL && !DefaultDataLayout.empty()) {
+  // Use the -default-data-layout if the module doesn't specify one.
+  if (!M->getDataLayout() && !DefaultDataLayout.empty())
     M->setDataLayout(DefaultDataLayout);
-    DL = M.get()->getDataLayout();
-  }
-
-  if (DL)
-    Passes.add(new DataLayoutPass(M.get()));
 
   Triple ModuleTriple(M->getTargetTriple());
   TargetMachine *Machine = nullptr;
@@ -448,20 +592,6 @@ int main(int argc, char **argv) {
     Machine = GetTargetMachine(Triple(ModuleTriple));
   std::unique_ptr<TargetMachine> TM(Machine);
 
-  // Add internal analysis passes from the target machine.
-  if (TM.get())
-    TM->addAnalysisPasses(Passes);
-
-  std::unique_ptr<FunctionPassManager> FPasses;
-  if (OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3) {
-    FPasses.reset(new FunctionPassManager(M.get()));
-    if (DL)
-      FPasses->add(new DataLayoutPass(M.get()));
-    if (TM.get())
-      TM->addAnalysisPasses(*FPasses);
-
-  }
-
   if (PrintBreakpoints) {
     // Default to standard output.
     if (!Out) {
@@ -475,128 +605,42 @@ int main(int argc, char **argv) {
         return 1;
       }
     }
-    Passes.add(createBreakpointPrinter(Out->os()));
     NoOutput = true;
   }
 
-  // If the -strip-debug command line option was specified, add it.  If
-  // -std-compile-opts was also specified, it will handle StripDebug.
-  if (StripDebug && !StandardCompileOpts)
-    addPass(Passes, createStripSymbolsPass(true));
+  bool HasOptLevel =
+      OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3;
+  raw_ostream *OS = Out ? &Out->os() : nullptr;
 
-  // Create a new optimization pass for each one specified on the command line
-  for (unsigned i = 0; i < PassList.size(); ++i) {
-    // Check to see if -std-compile-opts was specified before this option.  If
-    // so, handle it.
-    if (StandardCompileOpts &&
-        StandardCompileOpts.getPosition() < PassList.getPosition(i)) {
-      AddStandardCompilePasses(Passes);
-      StandardCompileOpts = false;
-    }
-
-    if (StandardLinkOpts &&
-        StandardLinkOpts.getPosition() < PassList.getPosition(i)) {
-      AddStandardLinkPasses(Passes);
-      StandardLinkOpts = false;
-    }
-
-    if (OptLevelO1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 1, 0);
-      OptLevelO1 = false;
-    }
-
-    if (OptLevelO2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2, 0);
-      OptLevelO2 = false;
-    }
-
-    if (OptLevelOs && OptLevelOs.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2, 1);
-      OptLevelOs = false;
-    }
-
-    if (OptLevelOz && OptLevelOz.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2, 2);
-      OptLevelOz = false;
-    }
-
-    if (OptLevelO3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 3, 0);
-      OptLevelO3 = false;
-    }
+  // Before executing passes, print the final values of the LLVM options.
+  cl::PrintOptionValues();
 
-    const PassInfo *PassInf = PassList[i];
-    Pass *P = nullptr;
-    if (PassInf->getTargetMachineCtor())
-      P = PassInf->getTargetMachineCtor()(TM.get());
-    else if (PassInf->getNormalCtor())
-      P = PassInf->getNormalCtor()();
-    else
-      errs() << argv[0] << ": cannot create pass: "
-             << PassInf->getPassName() << "\n";
-    if (P) {
-      PassKind Kind = P->getPassKind();
-      addPass(Passes, P);
+  // Create a PassManager to hold and optimize the collection of passes we are
+  // about to build.
+  //
+  PassManager Passes;
 
-      if (AnalyzeOnly) {
-        switch (Kind) {
-        case PT_BasicBlock:
-          Passes.add(createBasicBlockPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_Region:
-          Passes.add(createRegionPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_Loop:
-          Passes.add(createLoopPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_Function:
-          Passes.add(createFunctionPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        case PT_CallGraphSCC:
-          Passes.add(createCallGraphPassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        default:
-          Passes.add(createModulePassPrinter(PassInf, Out->os(), Quiet));
-          break;
-        }
-      }
+  // With -j, the pipeline is split up between several pass managers, each of
+  // which gets its own instances of the passes.  Passes that print analyses
+  // or time the other passes want a single pass manager.
+  if (Threads > 1 && !AnalyzeOnly && !PrintBreakpoints &&
+      !TimePassesIsEnabled) {
+    auto Build = [&](PassManagerBase &MPM, PassManagerBase &FPM) {
+      return addPipelinePasses(argv[0], MPM, HasOptLevel ? &FPM : nullptr,
+                               *M, TM.get(), OS);
+    };
+    if (!runPipelineInParallel(argv[0], *M, Threads, CheckParallel, Build))
+      return 1;
+  } else {
+    std::unique_ptr<FunctionPassManager> FPasses;
+    if (HasOptLevel)
+      FPasses.reset(new FunctionPassManager(M.get()));
+    if (addPipelinePasses(argv[0], Passes, FPasses.get(), *M, TM.get(), OS)) {
+      FPasses->doInitialization();
+      for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+        FPasses->run(*F);
+      FPasses->doFinalization();
     }
-
-    if (PrintEachXForm)
-      Passes.add(createPrintModulePass(errs()));
-  }
-
-  // If -std-compile-opts was specified at the end of the pass list, add them.
-  if (StandardCompileOpts) {
-    AddStandardCompilePasses(Passes);
-    StandardCompileOpts = false;
-  }
-
-  if (StandardLinkOpts) {
-    AddStandardLinkPasses(Passes);
-    StandardLinkOpts = false;
-  }
-
-  if (OptLevelO1)
-    AddOptimizationPasses(Passes, *FPasses, 1, 0);
-
-  if (OptLevelO2)
-    AddOptimizationPasses(Passes, *FPasses, 2, 0);
-
-  if (OptLevelOs)
-    AddOptimizationPasses(Passes, *FPasses, 2, 1);
-
-  if (OptLevelOz)
-    AddOptimizationPasses(Passes, *FPasses, 2, 2);
-
-  if (OptLevelO3)
-    AddOptimizationPasses(Passes, *FPasses, 3, 0);
-
-  if (OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3) {
-    FPasses->doInitialization();
-    for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
-      FPasses->run(*F);
-    FPasses->doFinalization();
   }
 
   // Check that the module is well formed on completion of optimization
@@ -613,9 +657,6 @@ int main(int argc, char **argv) {
       Passes.add(createBitcodeWriterPass(Out->os()));
   }
 
-  // Before executing passes, print the final values of the LLVM options.
-  cl::PrintOptionValues();
-
   // Now that we have all of the passes ready, run them.
   Passes.run(*M.get());
 
@@ -0,0 +1,107 @@
+//===- CallGraphSCCScheduleTest.cpp - Unit tests for SCC schedules --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/CallGraphSCCSchedule.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+#include <memory>
+
+using namespace llvm;
+
+namespace {
+
+std::unique_ptr<Module> parseAssembly(const char *Assembly) {
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M =
+      parseAssemblyString(Assembly, Error, getGlobalContext());
+
+  std::string ErrMsg;
+  raw_string_ostream OS(ErrMsg);
+  Error.print("", OS);
+
+  // A failure here means that the test itself is buggy.
+  if (!M)
+    report_fatal_error(OS.str().c_str());
+
+  return M;
+}
+
+// Two chains that meet at @top, with a cycle between @b1 and @b2.
+static const char ChainsIR[] =
+    "define internal void @a1() {\n"
+    "  ret void\n"
+    "}\n"
+    "define internal void @a2() {\n"
+    "  call void @a1()\n"
+    "  ret void\n"
+    "}\n"
+    "define internal void @b1() {\n"
+    "  call void @b2()\n"
+    "  ret void\n"
+    "}\n"
+    "define internal void @b2() {\n"
+    "  call void @b1()\n"
+    "  call void @a1()\n"
+    "  ret void\n"
+    "}\n"
+    "define void @top() {\n"
+    "  call void @a2()\n"
+    "  call void @b1()\n"
+    "  ret void\n"
+    "}\n";
+
+TEST(CallGraphSCCScheduleTest, Levels) {
+  std::unique_ptr<Module> M = parseAssembly(ChainsIR);
+  CallGraph CG(*M);
+  CallGraphSCCSchedule S(CG);
+
+  // a1; a2 and {b1, b2}; top; the external node.
+  EXPECT_EQ(5u, S.getNumSCCs());
+  EXPECT_EQ(4u, S.getNumLevels());
+  EXPECT_EQ(2u, S.getMaxLevelWidth());
+  for (unsigned I = 0, E = S.getNumSCCs(); I != E; ++I)
+    for (unsigned J = 0, JE = S.getCallees(I).size(); J != JE; ++J)
+      EXPECT_LT(S.getLevel(S.getCallees(I)[J]), S.getLevel(I));
+}
+
+TEST(CallGraphSCCScheduleTest, ReadyTracking) {
+  std::unique_ptr<Module> M = parseAssembly(ChainsIR);
+  CallGraph CG(*M);
+  CallGraphSCCSchedule S(CG);
+
+  // Finish SCCs in the order they become ready, and check that each one
+  // only becomes ready after all of its callees.
+  std::vector<bool> Done(S.getNumSCCs());
+  SmallVector<unsigned, 8> Ready;
+  S.reset(Ready);
+  EXPECT_EQ(1u, Ready.size());
+  unsigned NumDone = 0;
+  while (!Ready.empty()) {
+    unsigned I = Ready.pop_back_val();
+    for (unsigned J = 0, JE = S.getCallees(I).size(); J != JE; ++J)
+      EXPECT_TRUE(Done[S.getCallees(I)[J]]);
+    EXPECT_FALSE(Done[I]);
+    Done[I] = true;
+    ++NumDone;
+    S.finish(I, Ready);
+  }
+  EXPECT_EQ(S.getNumSCCs(), NumDone);
+
+  // The schedule can be run again.
+  Ready.clear();
+  S.reset(Ready);
+  EXPECT_EQ(1u, Ready.size());
+}
+
+}
@@ -47,13 +47,14 @@ static void writeModuleToBuffer(std::unique_ptr<Module> Mod,
   WriteBitcodeToFile(Mod.get(), OS);
 }
 
-static std::unique_ptr<Module> getLazyModuleFromAssembly(LLVMContext &Context,
-                                                         SmallString<1024> &Mem,
-                                                         const char *Assembly) {
+static std::unique_ptr<Module>
+getLazyModuleFromAssembly(LLVMContext &Context, SmallString<1024> &Mem,
+                          const char *Assembly, bool LazyMetadata = false) {
   writeModuleToBuffer(parseAssembly(Assembly), Mem);
   std::unique_ptr<MemoryBuffer> Buffer =
       MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
-  ErrorOr<Module *> ModuleOrErr = getLazyBitcodeModule(Buffer, Context);
+  ErrorOr<Module *> ModuleOrErr =
+      getLazyBitcodeModule(Buffer, Context, LazyMetadata);
   return std::unique_ptr<Module>(ModuleOrErr.get());
 }
 
@@ -139,4 +140,56 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+TEST(BitReaderTest, LazyLoadMetadata) {
+  SmallString<1024> Mem;
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = getLazyModuleFromAssembly(
+      Context, Mem, "define void @f() {\n"
+                    "  ret void, !dbg !3\n"
+                    "}\n"
+                    "define void @g() {\n"
+                    "  ret void, !foo !4\n"
+                    "}\n"
+                    "!named = !{!0}\n"
+                    "!llvm.module.flags = !{!5}\n"
+                    "!0 = metadata !{metadata !\"root\", metadata !1}\n"
+                    "!1 = metadata !{metadata !\"unrelated\"}\n"
+                    "!2 = metadata !{metadata !\"scope\"}\n"
+                    "!3 = metadata !{i32 1, i32 2, metadata !2, null}\n"
+                    "!4 = metadata !{metadata !4, metadata !2}\n"
+                    "!5 = metadata !{i32 1, metadata !\"Debug Info Version\", "
+                    "i32 1}\n",
+      /* LazyMetadata */ true);
+  EXPECT_EQ(nullptr, M->getNamedMetadata("named"));
+
+  // Materializing @f pulls in the scope of its location.
+  EXPECT_FALSE(M->getFunction("f")->Materialize());
+  EXPECT_EQ(nullptr, M->getNamedMetadata("named"));
+  Instruction *RetF = M->getFunction("f")->getEntryBlock().getTerminator();
+  MDNode *Scope = RetF->getDebugLoc().getScope(Context);
+  ASSERT_TRUE(Scope);
+  EXPECT_EQ("scope", cast<MDString>(Scope->getOperand(0))->getString());
+
+  // Self-references and already loaded operands are resolved.
+  EXPECT_FALSE(M->getFunction("g")->Materialize());
+  Instruction *RetG = M->getFunction("g")->getEntryBlock().getTerminator();
+  MDNode *Foo = RetG->getMetadata("foo");
+  ASSERT_TRUE(Foo);
+  EXPECT_EQ(Foo, Foo->getOperand(0));
+  EXPECT_EQ(Scope, Foo->getOperand(1));
+
+  // Named metadata is only read on request.
+  EXPECT_FALSE(M->materializeMetadata());
+  NamedMDNode *Named = M->getNamedMetadata("named");
+  ASSERT_TRUE(Named);
+  ASSERT_EQ(1u, Named->getNumOperands());
+  MDNode *Root = Named->getOperand(0);
+  EXPECT_EQ("root", cast<MDString>(Root->getOperand(0))->getString());
+  MDNode *Unrelated = cast<MDNode>(Root->getOperand(1));
+  EXPECT_EQ("unrelated",
+            cast<MDString>(Unrelated->getOperand(0))->getString());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+}
+
 } // end namespace
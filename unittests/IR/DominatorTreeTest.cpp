@@ -10,6 +10,8 @@
 #include "llvm/IR/Dominators.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -222,6 +224,110 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    // Check that DT matches a tree computed from scratch.
+    static void expectUpToDate(DominatorTreeBase<BasicBlock> &DT,
+                               Function &F) {
+      DominatorTreeBase<BasicBlock> Fresh(DT.isPostDominator());
+      Fresh.recalculate(F);
+      for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+        DomTreeNode *Node = DT.getNode(BB), *FreshNode = Fresh.getNode(BB);
+        ASSERT_EQ(FreshNode != nullptr, Node != nullptr);
+        if (!Node)
+          continue;
+        BasicBlock *IDom =
+            Node->getIDom() ? Node->getIDom()->getBlock() : nullptr;
+        BasicBlock *FreshIDom =
+            FreshNode->getIDom() ? FreshNode->getIDom()->getBlock() : nullptr;
+        EXPECT_EQ(FreshIDom, IDom);
+      }
+    }
+
+    // Rewrite the terminator of BB to branch to exactly Succs.
+    static void setSuccessors(BasicBlock *BB, ArrayRef<BasicBlock *> Succs,
+                              Value *Cond) {
+      BB->getTerminator()->eraseFromParent();
+      if (Succs.empty()) {
+        ReturnInst::Create(BB->getContext(), BB);
+        return;
+      }
+      SwitchInst *SI = SwitchInst::Create(Cond, Succs[0], Succs.size(), BB);
+      for (unsigned i = 1, e = Succs.size(); i != e; ++i)
+        SI->addCase(ConstantInt::get(cast<IntegerType>(Cond->getType()), i),
+                    Succs[i]);
+    }
+
+    TEST(DominatorTree, EdgeUpdates) {
+      LLVMContext C;
+      Module M("EdgeUpdates", C);
+      Type *I32 = Type::getInt32Ty(C);
+      Function *F = Function::Create(
+          FunctionType::get(Type::getVoidTy(C), I32, false),
+          GlobalValue::ExternalLinkage, "f", &M);
+      Value *Cond = F->arg_begin();
+
+      // Start from a chain of blocks.
+      const unsigned NumBlocks = 16;
+      std::vector<BasicBlock *> Blocks;
+      std::vector<std::vector<BasicBlock *> > Succs(NumBlocks);
+      for (unsigned i = 0; i != NumBlocks; ++i) {
+        Blocks.push_back(BasicBlock::Create(C, "", F));
+        new UnreachableInst(C, Blocks.back());
+      }
+      for (unsigned i = 0; i != NumBlocks; ++i) {
+        if (i + 1 != NumBlocks)
+          Succs[i].push_back(Blocks[i + 1]);
+        setSuccessors(Blocks[i], Succs[i], Cond);
+      }
+
+      DominatorTree DT;
+      DT.recalculate(*F);
+      DominatorTreeBase<BasicBlock> PDT(true);
+      PDT.recalculate(*F);
+
+      unsigned Seed = 42;
+      auto Rand = [&](unsigned N) {
+        Seed = Seed * 1103515245 + 12345;
+        return (Seed >> 16) % N;
+      };
+
+      typedef DominatorTreeBase<BasicBlock>::UpdateType UpdateType;
+      for (unsigned Iter = 0; Iter != 400; ++Iter) {
+        // Every fourth round applies a batch of updates at once.
+        unsigned NumUpdates = Iter % 4 == 3 ? 1 + Rand(4) : 1;
+        std::vector<UpdateType> Updates;
+        for (unsigned i = 0; i != NumUpdates; ++i) {
+          unsigned From = Rand(NumBlocks);
+          BasicBlock *To = Blocks[1 + Rand(NumBlocks - 1)];
+          std::vector<BasicBlock *> &S = Succs[From];
+          std::vector<BasicBlock *>::iterator I =
+              std::find(S.begin(), S.end(), To);
+          if (I == S.end()) {
+            S.push_back(To);
+            Updates.push_back(
+                UpdateType(DominatorTree::Insert, Blocks[From], To));
+          } else {
+            S.erase(I);
+            Updates.push_back(
+                UpdateType(DominatorTree::Delete, Blocks[From], To));
+          }
+          setSuccessors(Blocks[From], S, Cond);
+        }
+
+        if (Updates.size() == 1 && Updates[0].Kind == DominatorTree::Insert) {
+          DT.insertEdge(Updates[0].From, Updates[0].To);
+          PDT.insertEdge(Updates[0].From, Updates[0].To);
+        } else if (Updates.size() == 1) {
+          DT.deleteEdge(Updates[0].From, Updates[0].To);
+          PDT.deleteEdge(Updates[0].From, Updates[0].To);
+        } else {
+          DT.applyUpdates(Updates);
+          PDT.applyUpdates(Updates);
+        }
+        expectUpToDate(DT, *F);
+        expectUpToDate(PDT, *F);
+      }
+    }
   }
 }
 
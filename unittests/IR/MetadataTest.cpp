@@ -127,6 +127,39 @@ TEST_F(MDNodeTest, Delete) {
   delete I;
 }
 
+TEST_F(MDNodeTest, RAUWUniquing) {
+  MDString *A = MDString::get(Context, "a");
+  MDString *B = MDString::get(Context, "b");
+  MDNode *Temp = MDNode::getTemporary(Context, None);
+
+  // Resolving a forward reference rehashes the node so that it can be found
+  // by its new operands.
+  Value *FwdOps[] = {A, Temp, B};
+  MDNode *N = MDNode::get(Context, FwdOps);
+  WeakVH WN = N;
+  MDString *C = MDString::get(Context, "c");
+  Temp->replaceAllUsesWith(C);
+  MDNode::deleteTemporary(Temp);
+  ASSERT_EQ(N, WN);
+  Value *ResolvedOps[] = {A, C, B};
+  EXPECT_EQ(N, MDNode::getIfExists(Context, ResolvedOps));
+  EXPECT_EQ(C, N->getOperand(1));
+
+  // The same operands at different positions make a different node.
+  Value *SwappedOps[] = {A, B, C};
+  MDNode *Swapped = MDNode::get(Context, SwappedOps);
+  EXPECT_NE(N, Swapped);
+
+  // Changing an operand so that the node collides with an existing one merges
+  // the two.
+  Value *OtherOps[] = {A, B, B};
+  MDNode *Other = MDNode::get(Context, OtherOps);
+  WeakVH WOther = Other;
+  Other->replaceOperandWith(2, C);
+  EXPECT_EQ(Swapped, WOther);
+  EXPECT_EQ(nullptr, MDNode::getIfExists(Context, OtherOps));
+}
+
 TEST(NamedMDNodeTest, Search) {
   LLVMContext Context;
   Constant *C = ConstantInt::get(Type::getInt32Ty(Context), 1);
@@ -109,4 +109,46 @@ TEST(UseTest, reverse) {
   ASSERT_EQ(8u, I);
 }
 
+TEST(UseTest, hungoff) {
+  LLVMContext C;
+
+  const char *ModuleString = "define i32 @f(i32 %x, i32 %y) {\n"
+                             "entry:\n"
+                             "  br label %loop\n"
+                             "loop:\n"
+                             "  %p = phi i32 [ %x, %entry ], [ %p, %loop ]\n"
+                             "  br label %loop\n"
+                             "}\n";
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(ModuleString, Err, C);
+  Function *F = M->getFunction("f");
+  ASSERT_TRUE(F);
+  Argument &X = *F->arg_begin();
+  Argument &Y = *std::next(F->arg_begin());
+  PHINode *P = cast<PHINode>(F->back().begin());
+  BasicBlock *Entry = &F->front();
+
+  // Grow the hung-off operand list several times; every use must still find
+  // the PHI and its own operand number.
+  for (unsigned I = 0; I != 32; ++I)
+    P->addIncoming(&X, Entry);
+  ASSERT_EQ(34u, P->getNumIncomingValues());
+  unsigned NumUses = 0;
+  for (Use &U : X.uses()) {
+    EXPECT_EQ(P, U.getUser());
+    EXPECT_EQ(&X, P->getIncomingValue(U.getOperandNo()));
+    ++NumUses;
+  }
+  EXPECT_EQ(33u, NumUses);
+
+  X.replaceAllUsesWith(&Y);
+  EXPECT_TRUE(X.use_empty());
+  NumUses = 0;
+  for (User *U : Y.users()) {
+    EXPECT_EQ(P, U);
+    ++NumUses;
+  }
+  EXPECT_EQ(33u, NumUses);
+}
+
 } // end anonymous namespace
@@ -0,0 +1,51 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryTask) {
+  std::atomic<unsigned> Count(0);
+  {
+    ThreadPool Pool(4);
+    for (unsigned i = 0; i != 100; ++i)
+      Pool.async([&Count] { ++Count; });
+    Pool.wait();
+    EXPECT_EQ(100u, Count);
+
+    // The pool can be reused after wait().
+    for (unsigned i = 0; i != 10; ++i)
+      Pool.async([&Count] { ++Count; });
+  }
+  // The destructor waits for the remaining tasks.
+  EXPECT_EQ(110u, Count);
+}
+
+TEST(ThreadPoolTest, SeparateResults) {
+  std::vector<unsigned> Results(1000);
+  ThreadPool Pool(3);
+  for (unsigned i = 0; i != Results.size(); ++i)
+    Pool.async([&Results, i] { Results[i] = i * i; });
+  Pool.wait();
+  for (unsigned i = 0; i != Results.size(); ++i)
+    EXPECT_EQ(i * i, Results[i]);
+}
+
+TEST(ThreadPoolTest, ThreadCount) {
+  EXPECT_LE(1u, ThreadPool::getHardwareThreadCount());
+  ThreadPool Pool(2);
+  EXPECT_LE(1u, Pool.getThreadCount());
+}
+
+}